@@ -52,7 +52,9 @@ enum rist_data_block_receiver_flags
 {
 	RIST_DATA_FLAGS_DISCONTINUITY = 1 << 0,
 	RIST_DATA_FLAGS_FLOW_BUFFER_START = 1 << 1,
-	RIST_DATA_FLAGS_OVERFLOW = 1 << 2
+	RIST_DATA_FLAGS_OVERFLOW = 1 << 2,
+	/* reassembled frame with missing fragments (RIST_FRAME_POLICY_DELIVER_INCOMPLETE) */
+	RIST_DATA_FLAGS_INCOMPLETE_FRAME = 1 << 3
 };
 
 
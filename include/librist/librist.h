@@ -14,6 +14,7 @@
 #include "sender.h"
 #include "peer.h"
 #include "stats.h"
+#include "stats_shm.h"
 #include "logging.h"
 #include "librist_srp.h"
 #include "opt.h"
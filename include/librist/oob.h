@@ -62,6 +62,25 @@ typedef int (*oob_callback_func_t)(void *arg, const struct rist_oob_block *oob_b
  */
 RIST_API int rist_oob_callback_set(struct rist_ctx *ctx, oob_callback_func_t callback_func, void *arg);
 
+/**
+ * @brief Pace out-of-band data
+ *
+ * Out-of-band data (tunnelled IP, rist_oob_write) is sent after the data,
+ * retransmissions and rtcp of each protocol loop pass. With a rate set it
+ * is also paced by a token bucket, waits while media is queued for sending
+ * and backs off (halving its rate, down to 1/16th) while the media path
+ * reports loss, recovering step by step once it is clean. Data queued for
+ * longer than max_delay_ms is dropped instead of being sent late in a burst.
+ * Rate, queueing delay and drops are reported in the "oob" stats object.
+ * Must be called before rist_start.
+ *
+ * @param ctx RIST context
+ * @param max_kbps out-of-band rate limit, 0 for no limit (default)
+ * @param max_delay_ms queueing deadline, 0 for none (default)
+ * @return 0 on success, -3 if already started, -4 for an out of range rate
+ */
+RIST_API int rist_oob_bandwidth_set(struct rist_ctx *ctx, uint32_t max_kbps, uint32_t max_delay_ms);
+
 #ifdef __cplusplus
 }
 #endif
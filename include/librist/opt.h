@@ -39,11 +39,72 @@ typedef struct {
 	rist_thread_callback_func_t thread_callback;
 } rist_thread_callback_t;
 
+/**
+ * @brief Path as seen by a path policy
+ *
+ * A path is a peer carrying the session: on a sender every peer created with rist_peer_create
+ * (a listening peer and the receivers connected to it count as one path), on a receiver every
+ * sender connected to it. The fields are refreshed by the library right before a hook is called,
+ * state is owned by the policy (see path_attach).
+ */
+struct rist_path {
+	struct rist_peer *peer;
+	uint32_t peer_id;
+	/* rist_peer_config weight */
+	uint32_t weight;
+	/* last and smoothed round trip time */
+	uint32_t rtt_us;
+	uint32_t avg_rtt_us;
+	/* sender: share of the packets sent in the last stats interval that were retransmissions,
+	 * receiver: share of the flow found missing in the last stats interval */
+	uint32_t loss_permille;
+	/* bits per second */
+	uint64_t bitrate;
+	uint64_t retry_bitrate;
+	/* rist_peer_config recovery_maxbitrate, kbps */
+	uint32_t recovery_maxbitrate;
+	bool alive;
+	void *state;
+};
+
+/**
+ * @brief Path scheduling and retransmission policy
+ *
+ * Replaces the built-in heuristics for the hooks that are set, a NULL hook keeps the built-in
+ * behaviour. All hooks but path_detach are called from the protocol thread and must not block.
+ *
+ * path_attach: first time a path is handed to the policy, returns the per path state.
+ * path_detach: the peer is being destroyed (called from the destroying thread), release the state.
+ * path_update: a new rtt measurement or the stats interval loss figure is available.
+ * select_data (sender): set send[i] for each of the count live paths the packet with sequence
+ *   number seq goes out on, replaces the weighted round robin. Nothing set drops the packet.
+ * admit_retransmit (sender): decide whether a requested retransmission is sent on path, admit is
+ *   the verdict of the built-in bandwidth check. max_retries and recovery_length_max still apply.
+ * select_nack_path (receiver): return the index of the path the nacks for flow_id are sent on,
+ *   builtin is the index of the lowest rtt path, or count when that path is not among the ones
+ *   offered. An index of count or more keeps the lowest rtt path. May be called more than once
+ *   per nack round.
+ */
+typedef struct {
+	void *(*path_attach)(void *arg, const struct rist_path *path);
+	void (*path_detach)(void *arg, const struct rist_path *path);
+	void (*path_update)(void *arg, const struct rist_path *path);
+	void (*select_data)(void *arg, const struct rist_path *const *paths, size_t count, uint32_t seq, bool *send);
+	bool (*admit_retransmit)(void *arg, const struct rist_path *path, uint32_t seq, uint32_t transmit_count, uint32_t age_ms, bool admit);
+	size_t (*select_nack_path)(void *arg, const struct rist_path *const *paths, size_t count, uint32_t flow_id, size_t builtin);
+} rist_path_policy_t;
+
 enum rist_opt
 {
 	//Set callback called when a thread is created or destroyed. This can only be set before rist_start is called.
 	//optval1 must point to a rist_thread_callback_t struct, optval2 may contain a pointer to user data, optval3 must be NULL.
-	RIST_OPT_THREAD_CALLBACK
+	RIST_OPT_THREAD_CALLBACK,
+	//Publish live peer and flow counters into a memory mapped stats page, see stats_shm.h. This can only be set before rist_start is called.
+	//optval1 must point to the file path (e.g. /dev/shm/rist-stats), optval2 may point to an int update interval in ms (default 100), optval3 must be NULL.
+	RIST_OPT_STATS_SHM,
+	//Install a path scheduling and retransmission policy, see rist_path_policy_t. This can only be set before rist_start is called.
+	//optval1 must point to a rist_path_policy_t struct (copied), optval2 may contain a pointer to user data passed to the hooks, optval3 must be NULL.
+	RIST_OPT_PATH_POLICY
 };
 
 /**
@@ -63,7 +63,15 @@ enum rist_congestion_control_mode
 	RIST_CONGESTION_CONTROL_MODE_AGGRESSIVE = 2
 };
 
-#define RIST_PEER_CONFIG_VERSION (0)
+enum rist_cipher
+{
+	RIST_CIPHER_AES = 0,
+	RIST_CIPHER_CHACHA20 = 1
+};
+
+/* Version 1 added the fields from multicast_shared on, the library ignores
+ * them in a struct of an older version */
+#define RIST_PEER_CONFIG_VERSION (1)
 
 struct rist_peer_config
 {
@@ -118,6 +126,35 @@ struct rist_peer_config
 	uint32_t timing_mode;
 	char srp_username[RIST_MAX_STRING_LONG];
 	char srp_password[RIST_MAX_STRING_LONG];
+
+	/* Multicast reception */
+	// Share one socket between all multicast receive peers on the same
+	// port and interface, packets are demultiplexed on destination group
+	int multicast_shared;
+	// Optional source address for source specific multicast (IGMPv3/MLDv2)
+	char multicast_source[RIST_MAX_STRING_SHORT];
+
+	/* Explicit congestion notification */
+	// Senders mark data as ECT(0), receivers count CE marked packets
+	// and report them back so retries can be throttled before loss
+	int ecn;
+
+	/* Source port striping */
+	// Spread the packets of a connecting sender over this many local ports
+	// (receive side scaling/ECMP), the receiver sees one peer per port and
+	// joins them into one flow by flow id, it needs no setting
+	uint32_t stripe_ports;
+
+	/* Cipher used with the encryption secret */
+	// ChaCha20 is faster than AES on CPUs without AES instructions, it
+	// always uses a 256 bit key and is signalled to the peer in the GRE header
+	enum rist_cipher cipher;
+
+	/* Receiver flow scheduling */
+	// Share of the per round nack processing budget (see
+	// rist_receiver_flow_nack_budget_set) given to the flow of this peer,
+	// 0 is the same as 1
+	uint32_t flow_weight;
 };
 
 /**
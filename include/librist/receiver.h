@@ -60,6 +60,268 @@ RIST_API int rist_receiver_nack_type_set(struct rist_ctx *ctx, enum rist_nack_ty
  */
 RIST_API int rist_receiver_set_output_fifo_size(struct rist_ctx *ctx, uint32_t desired_size);
 
+enum rist_fifo_policy
+{
+	/* discard the packet that does not fit (default) */
+	RIST_FIFO_POLICY_DROP_NEWEST = 0,
+	/* discard the oldest unread packet to make room */
+	RIST_FIFO_POLICY_DROP_OLDEST = 1,
+	/* pause output and keep the data in the recovery buffer for as long as
+	 * it stays within the latency budget, then fall back to dropping */
+	RIST_FIFO_POLICY_HOLD = 2,
+	/* let the fifo grow beyond its size up to max_bytes of payload */
+	RIST_FIFO_POLICY_GROW = 3,
+};
+
+/**
+ * @brief Set output fifo overflow policy
+ *
+ * Select what happens when the application does not read the output fifo
+ * fast enough. RIST_FIFO_POLICY_GROW reserves room for up to 65536 packets per
+ * flow (or the fifo size if larger), max_bytes additionally caps the payload
+ * bytes held in the fifo (0 for no byte limit). max_bytes is ignored by the
+ * other policies. RIST_FIFO_POLICY_HOLD only applies when no data callback is
+ * set. Can only be set before starting.
+ *
+ * @param ctx RIST receiver context
+ * @param policy overflow policy
+ * @param max_bytes byte limit for RIST_FIFO_POLICY_GROW
+ * @return 0 for success
+ */
+RIST_API int rist_receiver_set_output_fifo_policy(struct rist_ctx *ctx, enum rist_fifo_policy policy, size_t max_bytes);
+
+enum rist_fifo_event
+{
+	/* fifo count reached the high watermark */
+	RIST_FIFO_EVENT_HIGH_WATERMARK = 0,
+	/* fifo count went back down to the low watermark */
+	RIST_FIFO_EVENT_LOW_WATERMARK = 1,
+	/* output was paused (RIST_FIFO_POLICY_HOLD) */
+	RIST_FIFO_EVENT_HOLD = 2,
+	/* data was discarded because the fifo is full */
+	RIST_FIFO_EVENT_DROP = 3,
+};
+
+/**
+ * @brief Output fifo event callback
+ *
+ * Called from the protocol thread, must return quickly. HOLD and DROP are
+ * reported once per episode, i.e.: again only after output resumed normally.
+ *
+ * @param arg optional user data set via rist_receiver_output_fifo_event_callback_set
+ * @param flow_id flow the event applies to
+ * @param event event type
+ * @param count number of packets in the fifo of that flow
+ */
+typedef void (*receiver_fifo_event_callback_t)(void *arg, uint32_t flow_id, enum rist_fifo_event event, uint32_t count);
+
+/**
+ * @brief Enable output fifo event notifications
+ *
+ * @param ctx RIST receiver context
+ * @param high_watermark fifo count that triggers RIST_FIFO_EVENT_HIGH_WATERMARK, 0 to disable watermarks
+ * @param low_watermark fifo count that triggers RIST_FIFO_EVENT_LOW_WATERMARK after a high watermark event
+ * @param callback function called on fifo events
+ * @param arg the extra argument passed to the callback
+ * @return 0 for success
+ */
+RIST_API int rist_receiver_output_fifo_event_callback_set(struct rist_ctx *ctx, uint32_t high_watermark, uint32_t low_watermark,
+			receiver_fifo_event_callback_t callback, void *arg);
+
+/**
+ * @brief Bound the per flow nack processing of the protocol loop
+ *
+ * Each nack round a flow may process at most budget * weight entries of its
+ * missing queue, the remainder is continued in the next round. This keeps a
+ * flow with burst loss from delaying the nacks of the other flows. The weight
+ * comes from the flow-weight peer setting or rist_receiver_flow_weight_set.
+ * Rounds that ran out of budget are counted as nack_throttled in the flow
+ * stats. Can be changed at any time.
+ *
+ * @param ctx RIST receiver context
+ * @param budget missing queue entries per round and unit of weight, 0 for no limit (default)
+ * @return 0 for success
+ */
+RIST_API int rist_receiver_flow_nack_budget_set(struct rist_ctx *ctx, uint32_t budget);
+
+/**
+ * @brief Change the nack scheduling weight of an existing flow
+ *
+ * @param ctx RIST receiver context
+ * @param flow_id flow to change
+ * @param weight share of the nack budget, 0 is the same as 1
+ * @return 0 for success, negative if the flow does not exist
+ */
+RIST_API int rist_receiver_flow_weight_set(struct rist_ctx *ctx, uint32_t flow_id, uint32_t weight);
+
+/**
+ * @brief Nack lost retransmissions again without waiting a round trip
+ *
+ * The sender answers the sequence numbers of a nack in order, so when a
+ * retransmission arrives while a lower one of the same nack is still
+ * missing, that one was lost on the way. With this enabled it is nacked again
+ * in the next nack round instead of after the retry interval, which saves
+ * about one rtt per lost retransmission. The nack is marked as an early
+ * re-nack so that the sender does not hold it back for one rtt as a
+ * duplicate, senders that predate the mark still do. Only applies to flows
+ * arriving over a single path that show no reordering. These nacks still
+ * count against max-retries and the return path budget, and show up as
+ * early_renacks in the flow stats. Can be changed at any time.
+ *
+ * @param ctx RIST receiver context
+ * @param enable true to enable, disabled by default
+ * @return 0 for success
+ */
+RIST_API int rist_receiver_early_renack_set(struct rist_ctx *ctx, bool enable);
+
+enum rist_frame_policy
+{
+	/* output the fragments of a frame as separate packets (default) */
+	RIST_FRAME_POLICY_DISABLED = 0,
+	/* output complete frames only, frames with missing fragments are discarded */
+	RIST_FRAME_POLICY_DROP_INCOMPLETE = 1,
+	/* output frames with missing fragments as far as they arrived, flagged
+	 * with RIST_DATA_FLAGS_INCOMPLETE_FRAME */
+	RIST_FRAME_POLICY_DELIVER_INCOMPLETE = 2,
+};
+
+/**
+ * @brief Reassemble frames written with rist_sender_data_write_frame
+ *
+ * When enabled, the fragments of a frame are collected and output as one
+ * data block through rist_receiver_data_read2 or the data callback, once the
+ * last fragment is due for output. Packets that are not part of a frame are
+ * output unchanged. Frames that lost fragments after all retries or exceed
+ * max_frame_size are handled according to the policy and counted as
+ * frames_incomplete in the flow stats, a frame whose tail is missing as soon
+ * as it is due. Can only be set before starting.
+ *
+ * @param ctx RIST receiver context
+ * @param policy reassembly policy
+ * @param max_frame_size largest frame to reassemble in bytes, 0 for the default (16 MiB)
+ * @return 0 for success
+ */
+RIST_API int rist_receiver_frame_reassembly_set(struct rist_ctx *ctx, enum rist_frame_policy policy, size_t max_frame_size);
+
+enum rist_overload_tier
+{
+	/* no degradation (default) */
+	RIST_OVERLOAD_TIER_NONE = 0,
+	/* socket reads take precedence over nack rounds */
+	RIST_OVERLOAD_TIER_DRAIN = 1,
+	/* no nacks for packets a retransmission can no longer reach in time */
+	RIST_OVERLOAD_TIER_DEADLINE = 2,
+	/* stats, timeout checks and logging below warnings are cut back */
+	RIST_OVERLOAD_TIER_REDUCED = 3,
+	/* the flows with the lowest weight are shed, one at a time */
+	RIST_OVERLOAD_TIER_SHED = 4,
+};
+
+/**
+ * @brief Enable overload control of the receiver protocol loop
+ *
+ * The protocol loop watches its own lag, the socket read backlog and the
+ * missing/output queue fill. While it keeps falling behind it steps through
+ * the degradation tiers up to max_tier, every tier includes the ones below
+ * it, and steps back down as soon as it keeps up again. A shed flow keeps its
+ * session (keepalives and rtcp) but its data is discarded until the loop
+ * leaves the shed tier, the flow with the lowest flow-weight goes first and
+ * the last flow is never shed. The current tier and the tier transitions are
+ * reported in the "overload" object of the flow stats. Can be changed at any
+ * time.
+ *
+ * @param ctx RIST receiver context
+ * @param max_tier highest tier to enter, RIST_OVERLOAD_TIER_NONE disables overload control
+ * @return 0 for success
+ */
+RIST_API int rist_receiver_overload_control_set(struct rist_ctx *ctx, enum rist_overload_tier max_tier);
+
+enum rist_resync_policy
+{
+	/* no discontinuity detection, the flow only resets after its buffer
+	 * ran dry or too many packets were dropped as late or for a full buffer
+	 * (default) */
+	RIST_RESYNC_POLICY_DISABLED = 0,
+	/* discard the data buffered before the discontinuity */
+	RIST_RESYNC_POLICY_FLUSH = 1,
+	/* output the data buffered before the discontinuity right away, the
+	 * packets of the new space that come in meanwhile are dropped */
+	RIST_RESYNC_POLICY_DRAIN = 2,
+};
+
+/**
+ * @brief Select how flows resynchronize after a discontinuity
+ *
+ * A flow is rebased on the first packet of a new sequence/timestamp space:
+ * when the sender restarted (restart marker, see
+ * rist_sender_restart_marker_enable), when the flow id changed, or when a few
+ * packets in a row jump behind the output point with a newer source time or
+ * move the source clock by more than twice the recovery buffer. The missing
+ * queue of the old space is dropped (no nacks for it) and the clock offset is
+ * estimated again. Rebases are counted as resyncs in the flow stats. The
+ * detection is off by default. Can be changed at any time.
+ *
+ * @param ctx RIST receiver context
+ * @param policy what happens to the data buffered before the discontinuity
+ * @return 0 for success
+ */
+RIST_API int rist_receiver_resync_policy_set(struct rist_ctx *ctx, enum rist_resync_policy policy);
+
+enum rist_socket_filter
+{
+	/* every datagram reaches the protocol thread (default) */
+	RIST_SOCKET_FILTER_DISABLED = 0,
+	/* datagrams without a valid rtp or gre header for the profile and the
+	 * key configuration of the peer are dropped */
+	RIST_SOCKET_FILTER_SHAPE = 1,
+	/* as above, and only the remote address of a connecting peer gets
+	 * through, listening peers keep the header check */
+	RIST_SOCKET_FILTER_PEERS = 2,
+};
+
+/**
+ * @brief Drop unwanted datagrams in the kernel
+ *
+ * Attaches a socket filter (classic BPF, Linux only) to the receive sockets
+ * of the peers, so that stray or spoofed traffic is discarded before it
+ * costs a wakeup and a copy to the protocol thread. The filter is generated
+ * from the peer configuration and regenerated as senders authenticate.
+ * Listening peers accept any source, so that new, bonded and reconnecting
+ * senders can always connect; they and multicast peers only get the header
+ * check. Datagrams dropped by the kernel are reported per peer as
+ * socket_drops in the flow stats. Can be changed at any time.
+ *
+ * @param ctx RIST receiver context
+ * @param mode filter mode
+ * @return 0 for success, -4 when socket filters are not available
+ */
+RIST_API int rist_receiver_socket_filter_set(struct rist_ctx *ctx, enum rist_socket_filter mode);
+
+/**
+ * @brief Relay the received data through a sender without buffering it
+ *
+ * Cut-through relay for multi-hop chains: every packet is handed to the
+ * sender as soon as it is stored, repairs included, with its sequence number
+ * and source time preserved. Downstream nacks are served from the history of
+ * the sender; a nack for a packet that did not reach the relay yet makes
+ * the relay nack it upstream right away if it was still waiting on the
+ * reorder buffer, the repair is forwarded once it arrives. The latency of a
+ * chain then approaches one recovery buffer (the last receiver) instead of
+ * one buffer per hop. The first flow that delivers data is relayed until it
+ * is deleted, any other flow is only output locally (a warning is logged and
+ * its relay stats say relayed false). The receiver still outputs the data
+ * as usual.
+ *
+ * The sender must not be written to by the application while relaying and
+ * has to outlive the receiver: destroy the receiver first. Must be called
+ * before rist_start.
+ *
+ * @param ctx RIST receiver context
+ * @param sender_ctx RIST sender context to forward to, NULL to disable
+ * @return 0 for success
+ */
+RIST_API int rist_receiver_relay_set(struct rist_ctx *ctx, struct rist_ctx *sender_ctx);
+
 /**
  * @brief Reads rist data
  *
@@ -130,6 +392,89 @@ RIST_API void rist_receiver_data_block_free2(struct rist_data_block **block);
  */
 RIST_API int rist_receiver_data_notify_fd_set(struct rist_ctx *ctx, int fd);
 
+/**
+ * @brief New flow callback
+ *
+ * Called from the protocol thread when a flow is created, before any of its
+ * data is output. A reader opened from within the callback therefore gets
+ * all of the flow data. Must return quickly.
+ *
+ * @param arg optional user data set via rist_receiver_flow_callback_set
+ * @param flow_id id of the new flow
+ */
+typedef void (*receiver_flow_callback_t)(void *arg, uint32_t flow_id);
+
+/**
+ * @brief Enable new flow notifications
+ *
+ * @param ctx RIST receiver context
+ * @param callback function called for every new flow, NULL to disable
+ * @param arg the extra argument passed to the callback
+ * @return 0 for success
+ */
+RIST_API int rist_receiver_flow_callback_set(struct rist_ctx *ctx, receiver_flow_callback_t callback, void *arg);
+
+struct rist_flow_reader;
+
+/**
+ * @brief Open a reader dedicated to one flow
+ *
+ * The output fifo of the flow is then consumed through the reader only:
+ * rist_receiver_data_read2 skips it and its data no longer signals the
+ * context wide condition or notify fd. Each reader has its own wakeup, so
+ * one thread per flow can read without scanning or contending with the
+ * others. The reader may be opened before the flow exists (it attaches once
+ * the flow is created, e.g.: from the new flow callback) and outlives it: a
+ * flow that times out and comes back with the same id is attached again.
+ * Only one reader can be open per flow id. The reader belongs to the
+ * receiver context: close it before rist_destroy, which frees the readers
+ * still open and leaves their handles dangling.
+ *
+ * @param ctx RIST receiver context
+ * @param flow_id id of the flow to read
+ * @param[out] reader the reader handle
+ * @return 0 for success, -4 if a reader for flow_id is already open
+ */
+RIST_API int rist_receiver_flow_reader_open(struct rist_ctx *ctx, uint32_t flow_id, struct rist_flow_reader **reader);
+
+/**
+ * @brief Reads rist data of the flow of a reader
+ *
+ * Same semantics as rist_receiver_data_read2. A reader must only be read
+ * from one thread at a time.
+ *
+ * @param reader reader handle
+ * @param[out] data_block reference counted data_block structure MUST be freed via rist_receiver_data_block_free2
+ * @param timeout How long to wait for queue data (ms), 0 for no wait
+ * @return num buffers remaining on queue +1 (0 if no buffer returned), -1 on error
+ */
+RIST_API int rist_receiver_flow_reader_read(struct rist_flow_reader *reader, struct rist_data_block **data_block, int timeout);
+
+/**
+ * @brief Set the data ready signalling fd of a reader
+ *
+ * Same as rist_receiver_data_notify_fd_set, for the data of the reader's
+ * flow only (e.g.: one pipe per flow).
+ *
+ * @param reader reader handle
+ * @param fd The file descriptor to be written to, 0 to disable
+ * @return 0 on success, -1 on error
+ */
+RIST_API int rist_receiver_flow_reader_notify_fd_set(struct rist_flow_reader *reader, int fd);
+
+/**
+ * @brief Close a flow reader
+ *
+ * Data still queued stays with the flow and is read through
+ * rist_receiver_data_read2 again. Must not be called while another thread
+ * is reading from the reader. Readers left open are freed by rist_destroy,
+ * a handle must not be used nor closed after the context was destroyed.
+ *
+ * @param reader double pointer to the reader, set to NULL
+ * @return 0 on success, -1 on error
+ */
+RIST_API int rist_receiver_flow_reader_close(struct rist_flow_reader **reader);
+
 #ifdef __cplusplus
 }
 #endif
@@ -57,6 +57,95 @@ RIST_API int rist_sender_npd_enable(struct rist_ctx *ctx);
  */
 RIST_API int rist_sender_npd_disable(struct rist_ctx *ctx);
 
+/**
+ * @brief Enable MPEG-TS adaptation field stuffing suppression
+ *
+ *  Strips the 0xFF stuffing that pads TS adaptation fields and signals the
+ *  removed length of every packet in the RTP header extension, the receiver
+ *  restores the packets byte exact. Like NPD this only affects packets
+ *  inserted after enabling it. Can be combined with NPD.
+ *  This is not negotiated and breaks interoperability: a receiver without
+ *  support (earlier librist versions, other implementations) outputs the
+ *  shortened packets with the extension in front of them, i.e. corrupt TS.
+ *  Only enable it when every receiver of the stream supports it.
+ * @param ctx RIST sender ctx
+ * @return 0 on success, -1 in case of error.
+ */
+RIST_API int rist_sender_ts_stuffing_enable(struct rist_ctx *ctx);
+
+/**
+ * @brief Disable MPEG-TS adaptation field stuffing suppression
+ *
+ * @param ctx RIST sender ctx
+ * @return 0 on success, -1 in case of error.
+ */
+RIST_API int rist_sender_ts_stuffing_disable(struct rist_ctx *ctx);
+
+/**
+ * @brief Enable the wire image cache for retransmissions
+ *
+ *  Keeps the encrypted datagram of every packet in the sender buffer, so that
+ *  retransmissions to the same peer are sent as is instead of being encrypted
+ *  again. With several peers the image is kept for the first peer a packet
+ *  is sent to, retransmissions to the others and after a key rotation are
+ *  encrypted normally. Only has an effect with encryption (main and advanced
+ *  profile) and not on peers with arrival timing, roughly doubles the memory
+ *  used by the sender buffer.
+ * @param ctx RIST sender ctx
+ * @return 0 on success, -1 in case of error.
+ */
+RIST_API int rist_sender_wire_cache_enable(struct rist_ctx *ctx);
+
+/**
+ * @brief Disable the wire image cache for retransmissions
+ *
+ * @param ctx RIST sender ctx
+ * @return 0 on success, -1 in case of error.
+ */
+RIST_API int rist_sender_wire_cache_disable(struct rist_ctx *ctx);
+
+/**
+ * @brief Enable the sender restart marker
+ *
+ *  Flags the first 64 data packets written after enabling it in the RTP header
+ *  extension, so that a receiver rebases the flow right away instead of
+ *  taking the new sequence numbers for loss or reordering. Enable it before
+ *  writing data, the receiver needs to support it and have a resync policy
+ *  set (rist_receiver_resync_policy_set).
+ * @param ctx RIST sender ctx
+ * @return 0 on success, -1 in case of error.
+ */
+RIST_API int rist_sender_restart_marker_enable(struct rist_ctx *ctx);
+
+/**
+ * @brief Disable the sender restart marker
+ *
+ * @param ctx RIST sender ctx
+ * @return 0 on success, -1 in case of error.
+ */
+RIST_API int rist_sender_restart_marker_disable(struct rist_ctx *ctx);
+
+/**
+ * @brief Move older sender history out of the heap
+ *
+ *  For recovery windows of tens of seconds or more at high bitrates. The
+ *  payload of packets sent more than hot_ms ago moves into a ring of
+ *  store_bytes, an anonymous memory arena (on hugepages when the system has
+ *  them reserved) or, given a directory, a new unnamed file in there mapped
+ *  into memory of which only the chunk being written stays resident. Late retransmissions are read
+ *  back from there, packets the ring wrapped over are no longer recoverable:
+ *  size it for the bitrate times the recovery window. How far back the
+ *  history goes is still set by the buffer size of the peers. Must be
+ *  called before rist_start, not available on Windows.
+ * @param ctx RIST sender ctx
+ * @param hot_ms age in ms at which a sent packet moves out of the heap
+ * @param store_bytes size of the ring, 0 to disable
+ * @param dir directory of the file backing the ring, NULL for memory
+ * @return 0 on success, -1 on a bad ctx, -3 when already started and -4
+ *  when the store cannot be set up
+ */
+RIST_API int rist_sender_history_set(struct rist_ctx *ctx, uint32_t hot_ms, size_t store_bytes, const char *dir);
+
 /**
  * @brief Retrieve the current flow_id value
  *
@@ -87,10 +176,97 @@ RIST_API int rist_sender_flow_id_set(struct rist_ctx *ctx, uint32_t flow_id);
  * @param ctx RIST sender context
  * @param data_block pointer to the rist_data_block structure
  * the ts_ntp will be populated by the lib if a value of 0 is passed
- * @return number of written bytes on success, -1 in case of error.
+ * @return number of written bytes on success, -EAGAIN when refused by flow control, -1 in case of error.
  */
 RIST_API int rist_sender_data_write(struct rist_ctx *ctx, const struct rist_data_block *data_block);
 
+/**
+ * @brief Write a frame of arbitrary size
+ *
+ * Splits the frame into fragments of at most fragment_size bytes and queues
+ * them in one go, each fragment takes one sequence number and all of them
+ * share the frame timestamp. The first and last fragments are marked in the
+ * RTP header extension so that a receiver with rist_receiver_frame_reassembly_set
+ * can output the frame as one block, other receivers get the fragments as
+ * separate packets. NPD and TS stuffing suppression do not apply to frames.
+ *
+ * @param ctx RIST sender context
+ * @param data_block pointer to the rist_data_block structure holding the frame,
+ * with RIST_DATA_FLAGS_USE_SEQ the seq field is the sequence number of the first fragment
+ * @param fragment_size payload bytes per fragment, 0 for the default (1316)
+ * @return number of written bytes on success, -EAGAIN when refused by flow control, -1 in case of error.
+ */
+RIST_API int rist_sender_data_write_frame(struct rist_ctx *ctx, const struct rist_data_block *data_block, size_t fragment_size);
+
+/**
+ * @brief Enable write flow control
+ *
+ * Once the number of packets waiting to be sent by the protocol thread
+ * reaches high_watermark, rist_sender_data_write refuses data until the queue
+ * has drained to low_watermark. With a timeout the write blocks up to that
+ * long for the queue to drain instead of being refused right away.
+ * Refused writes return -EAGAIN.
+ *
+ * @param ctx RIST sender context
+ * @param high_watermark queued packets at which writes are held back, 0 to disable
+ * @param low_watermark queued packets at which writes resume
+ * @param timeout max time (ms) a write blocks waiting for the queue to drain, 0 for no wait
+ * @return 0 on success, -1 on error
+ */
+RIST_API int rist_sender_flow_control_set(struct rist_ctx *ctx, uint32_t high_watermark, uint32_t low_watermark, int timeout);
+
+typedef int (*sender_write_ready_callback_t)(void *arg);
+
+/**
+ * @brief Get notified when writes can resume
+ *
+ * The callback is called from the protocol thread when the queue drained to
+ * the low watermark after writes were held back, it must return quickly.
+ *
+ * @param ctx RIST sender context
+ * @param callback function to call, NULL to disable
+ * @param arg the extra argument passed to the callback
+ * @return 0 on success, -1 on error
+ */
+RIST_API int rist_sender_write_ready_callback_set(struct rist_ctx *ctx, sender_write_ready_callback_t callback, void *arg);
+
+/**
+ * @brief Set write ready notification file descriptor
+ *
+ * A single byte is written to the fd when writes can resume, making it
+ * usable with poll/select in the application's input loop.
+ *
+ * @param ctx RIST sender context
+ * @param fd file descriptor, 0 to disable
+ * @return 0 on success, -1 on error
+ */
+RIST_API int rist_sender_write_ready_notify_fd_set(struct rist_ctx *ctx, int fd);
+
+struct rist_sender_queue_info
+{
+	/* packets waiting to be sent by the protocol thread */
+	uint32_t pending;
+	/* size of the sender queue (packets, includes the retransmission history) */
+	uint32_t capacity;
+	uint32_t high_watermark;
+	uint32_t low_watermark;
+	/* writes are currently held back */
+	uint32_t backpressure;
+	/* writes refused because of flow control */
+	uint64_t writes_refused;
+	/* writes that had to wait for the queue to drain */
+	uint64_t writes_blocked;
+};
+
+/**
+ * @brief Get sender queue occupancy and flow control counters
+ *
+ * @param ctx RIST sender context
+ * @param[out] info destination
+ * @return 0 on success, -1 on error
+ */
+RIST_API int rist_sender_queue_info_get(struct rist_ctx *ctx, struct rist_sender_queue_info *info);
+
 
 #ifdef __cplusplus
 }
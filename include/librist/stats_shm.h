@@ -0,0 +1,149 @@
+/*
+ * Copyright © 2020, VideoLAN and librist authors
+ * Copyright © 2019-2020 SipRadius LLC
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef LIBRIST_STATS_SHM_H
+#define LIBRIST_STATS_SHM_H
+
+#include "common.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Shared memory statistics page
+ *
+ * When enabled with RIST_OPT_STATS_SHM the protocol thread periodically
+ * copies its live counters into a memory mapped file (e.g. under /dev/shm).
+ * Counters are cumulative since the peer/flow was created, so monitoring
+ * tools derive rates from the difference between two snapshots. The page is
+ * guarded by a sequence lock, use rist_stats_shm_reader_snapshot() to get a
+ * consistent copy; readers never block the library.
+ */
+
+#define RIST_STATS_SHM_MAGIC (0x52535453) /* "STSR" */
+#define RIST_STATS_SHM_VERSION (1)
+#define RIST_STATS_SHM_MAX_PEERS (64)
+#define RIST_STATS_SHM_MAX_FLOWS (64)
+
+/* rist_stats_shm_peer flags */
+#define RIST_STATS_SHM_PEER_AUTHENTICATED (1 << 0)
+#define RIST_STATS_SHM_PEER_DEAD (1 << 1)
+#define RIST_STATS_SHM_PEER_DATA (1 << 2)
+
+/* rist_stats_shm truncated flags, the page holds at most
+ * RIST_STATS_SHM_MAX_PEERS peers and RIST_STATS_SHM_MAX_FLOWS flows */
+#define RIST_STATS_SHM_TRUNCATED_PEERS (1 << 0)
+#define RIST_STATS_SHM_TRUNCATED_FLOWS (1 << 1)
+
+/* rist_stats_shm mode */
+#define RIST_STATS_SHM_MODE_SENDER (0)
+#define RIST_STATS_SHM_MODE_RECEIVER (1)
+
+struct rist_stats_shm_peer
+{
+	uint32_t peer_id;
+	uint32_t flow_id;
+	uint32_t flags;
+	/* round trip time (microseconds) */
+	uint32_t rtt;
+	uint32_t avg_rtt;
+	uint32_t reserved;
+	/* bits per second */
+	uint64_t bandwidth;
+	uint64_t retry_bandwidth;
+	/* sender counters */
+	uint64_t sent;
+	uint64_t received;
+	uint64_t retransmitted;
+	uint64_t bandwidth_skipped;
+	uint64_t bloat_skipped;
+	uint64_t retransmit_skipped;
+	/* receiver counters */
+	uint64_t received_data;
+	uint64_t received_rtcp;
+	uint64_t sent_rtcp;
+	char cname[RIST_MAX_STRING_SHORT];
+};
+
+struct rist_stats_shm_flow
+{
+	uint32_t flow_id;
+	uint32_t peer_count;
+	uint32_t dead;
+	uint32_t reserved;
+	/* bits per second */
+	uint64_t bitrate;
+	uint64_t received;
+	uint64_t missing;
+	uint64_t reordered;
+	uint64_t recovered;
+	uint64_t retries;
+	uint64_t lost;
+	uint64_t duplicates;
+	uint64_t dropped_late;
+	uint64_t dropped_full;
+	/* current missing queue depth */
+	uint64_t missing_queue;
+};
+
+struct rist_stats_shm
+{
+	uint32_t magic;
+	uint32_t version;
+	/* size of this structure, checked by readers */
+	uint32_t size;
+	/* sequence lock: odd while the library is writing */
+	uint32_t seq;
+	uint32_t mode;
+	uint32_t profile;
+	/* non zero once the context has been destroyed */
+	uint32_t closed;
+	uint32_t peer_count;
+	uint32_t flow_count;
+	/* RIST_STATS_SHM_TRUNCATED_* when there was more to publish than fits */
+	uint32_t truncated;
+	/* number of updates and monotonic time of the last one (microseconds) */
+	uint64_t updates;
+	uint64_t timestamp;
+	struct rist_stats_shm_peer peers[RIST_STATS_SHM_MAX_PEERS];
+	struct rist_stats_shm_flow flows[RIST_STATS_SHM_MAX_FLOWS];
+};
+
+struct rist_stats_shm_reader;
+
+/**
+ * @brief Map a stats page published by a librist context
+ *
+ * @param[out] reader Store the new reader handle
+ * @param path file passed to RIST_OPT_STATS_SHM
+ * @return 0 on success, -1 if the file cannot be mapped or has an incompatible layout
+ */
+RIST_API int rist_stats_shm_reader_open(struct rist_stats_shm_reader **reader, const char *path);
+
+/**
+ * @brief Copy a consistent snapshot of the stats page
+ *
+ * @param reader reader handle
+ * @param[out] snapshot destination
+ * @return 0 on success, -1 if no consistent copy could be made (writer busy)
+ */
+RIST_API int rist_stats_shm_reader_snapshot(struct rist_stats_shm_reader *reader, struct rist_stats_shm *snapshot);
+
+/**
+ * @brief Unmap the stats page and free the reader
+ */
+RIST_API void rist_stats_shm_reader_close(struct rist_stats_shm_reader **reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBRIST_STATS_SHM_H */
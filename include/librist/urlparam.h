@@ -36,6 +36,12 @@
 #define RIST_URL_PARAM_MIN_RETRIES "min-retries"
 #define RIST_URL_PARAM_MAX_RETRIES "max-retries"
 #define RIST_URL_PARAM_TIMING_MODE "timing-mode"
+#define RIST_URL_PARAM_MULTICAST_SHARED "multicast-shared"
+#define RIST_URL_PARAM_MULTICAST_SOURCE "multicast-source"
+#define RIST_URL_PARAM_ECN "ecn"
+#define RIST_URL_PARAM_STRIPE_PORTS "stripe-ports"
+#define RIST_URL_PARAM_CIPHER "cipher"
+#define RIST_URL_PARAM_FLOW_WEIGHT "flow-weight"
 /* udp specific parameters */
 #define RIST_URL_PARAM_STREAM_ID "stream-id"
 #define RIST_URL_PARAM_RTP_TIMESTAMP "rtp-timestamp"
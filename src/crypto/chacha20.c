@@ -0,0 +1,232 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "chacha20.h"
+#include <string.h>
+
+/* ChaCha20 only needs 32 bit add/xor/rotate, so it is fast on CPUs without
+ * AES instructions. Several blocks are computed in parallel with GCC vector
+ * extensions: 4 lanes map onto SSE2 or NEON registers, 8 lanes onto AVX2
+ * which is only used when the CPU reports it at runtime. */
+#if defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define CHACHA20_VEC4 1
+#else
+#define CHACHA20_VEC4 0
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHACHA20_VEC8 1
+#else
+#define CHACHA20_VEC8 0
+#endif
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTERROUND(a, b, c, d) \
+	do { \
+		a += b; d ^= a; d = ROTL32(d, 16); \
+		c += d; b ^= c; b = ROTL32(b, 12); \
+		a += b; d ^= a; d = ROTL32(d, 8); \
+		c += d; b ^= c; b = ROTL32(b, 7); \
+	} while (0)
+
+#define DOUBLEROUND(x) \
+	do { \
+		QUARTERROUND(x[0], x[4], x[8], x[12]); \
+		QUARTERROUND(x[1], x[5], x[9], x[13]); \
+		QUARTERROUND(x[2], x[6], x[10], x[14]); \
+		QUARTERROUND(x[3], x[7], x[11], x[15]); \
+		QUARTERROUND(x[0], x[5], x[10], x[15]); \
+		QUARTERROUND(x[1], x[6], x[11], x[12]); \
+		QUARTERROUND(x[2], x[7], x[8], x[13]); \
+		QUARTERROUND(x[3], x[4], x[9], x[14]); \
+	} while (0)
+
+static inline uint32_t load_le32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void store_le32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+}
+
+static void chacha20_block(uint32_t state[16], uint8_t keystream[RIST_CHACHA20_BLOCK_SIZE])
+{
+	uint32_t x[16];
+	memcpy(x, state, sizeof(x));
+	for (int i = 0; i < 10; i++)
+		DOUBLEROUND(x);
+	for (int i = 0; i < 16; i++)
+		store_le32(&keystream[i * 4], x[i] + state[i]);
+	state[12]++;
+}
+
+static size_t chacha20_blocks_c(uint32_t state[16], const uint8_t *in, uint8_t *out, size_t nblocks)
+{
+	uint8_t keystream[RIST_CHACHA20_BLOCK_SIZE];
+	for (size_t n = 0; n < nblocks; n++) {
+		chacha20_block(state, keystream);
+		for (int i = 0; i < RIST_CHACHA20_BLOCK_SIZE; i++)
+			out[i] = in[i] ^ keystream[i];
+		in += RIST_CHACHA20_BLOCK_SIZE;
+		out += RIST_CHACHA20_BLOCK_SIZE;
+	}
+	return nblocks;
+}
+
+#if CHACHA20_VEC4
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+
+static size_t chacha20_blocks_vec4(uint32_t state[16], const uint8_t *in, uint8_t *out, size_t nblocks)
+{
+	const u32x4 lane = { 0, 1, 2, 3 };
+	const u32x4 zero = { 0 };
+	size_t done = 0;
+	while (nblocks - done >= 4) {
+		u32x4 j[16], x[16];
+		for (int i = 0; i < 16; i++)
+			j[i] = zero + state[i];
+		j[12] += lane;
+		memcpy(x, j, sizeof(x));
+		for (int i = 0; i < 10; i++)
+			DOUBLEROUND(x);
+		for (int i = 0; i < 16; i++)
+			x[i] += j[i];
+		for (int l = 0; l < 4; l++) {
+			for (int i = 0; i < 16; i++) {
+				size_t off = l * RIST_CHACHA20_BLOCK_SIZE + i * 4;
+				store_le32(&out[off], load_le32(&in[off]) ^ x[i][l]);
+			}
+		}
+		state[12] += 4;
+		in += 4 * RIST_CHACHA20_BLOCK_SIZE;
+		out += 4 * RIST_CHACHA20_BLOCK_SIZE;
+		done += 4;
+	}
+	return done + chacha20_blocks_c(state, in, out, nblocks - done);
+}
+#endif
+
+#if CHACHA20_VEC8
+typedef uint32_t u32x8 __attribute__((vector_size(32)));
+
+__attribute__((target("avx2")))
+static size_t chacha20_blocks_avx2(uint32_t state[16], const uint8_t *in, uint8_t *out, size_t nblocks)
+{
+	const u32x8 lane = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	const u32x8 zero = { 0 };
+	size_t done = 0;
+	while (nblocks - done >= 8) {
+		u32x8 j[16], x[16];
+		for (int i = 0; i < 16; i++)
+			j[i] = zero + state[i];
+		j[12] += lane;
+		memcpy(x, j, sizeof(x));
+		for (int i = 0; i < 10; i++)
+			DOUBLEROUND(x);
+		for (int i = 0; i < 16; i++)
+			x[i] += j[i];
+		for (int l = 0; l < 8; l++) {
+			for (int i = 0; i < 16; i++) {
+				size_t off = l * RIST_CHACHA20_BLOCK_SIZE + i * 4;
+				store_le32(&out[off], load_le32(&in[off]) ^ x[i][l]);
+			}
+		}
+		state[12] += 8;
+		in += 8 * RIST_CHACHA20_BLOCK_SIZE;
+		out += 8 * RIST_CHACHA20_BLOCK_SIZE;
+		done += 8;
+	}
+#if CHACHA20_VEC4
+	return done + chacha20_blocks_vec4(state, in, out, nblocks - done);
+#else
+	return done + chacha20_blocks_c(state, in, out, nblocks - done);
+#endif
+}
+#endif
+
+static rist_chacha20_blocks_func chacha20_select(const char **name)
+{
+#if CHACHA20_VEC8
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		*name = "avx2";
+		return chacha20_blocks_avx2;
+	}
+#endif
+#if CHACHA20_VEC4
+#if defined(__SSE2__)
+	*name = "sse2";
+#else
+	*name = "neon";
+#endif
+	return chacha20_blocks_vec4;
+#else
+	*name = "c";
+	return chacha20_blocks_c;
+#endif
+}
+
+const char *_librist_crypto_chacha20_impl(void)
+{
+	const char *name;
+	chacha20_select(&name);
+	return name;
+}
+
+void _librist_crypto_chacha20_init(struct rist_chacha20 *ctx)
+{
+	const char *name;
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->offset = RIST_CHACHA20_BLOCK_SIZE;
+	ctx->blocks = chacha20_select(&name);
+}
+
+void _librist_crypto_chacha20_setkey(struct rist_chacha20 *ctx, const uint8_t key[RIST_CHACHA20_KEY_SIZE])
+{
+	/* "expand 32-byte k" */
+	ctx->state[0] = 0x61707865;
+	ctx->state[1] = 0x3320646e;
+	ctx->state[2] = 0x79622d32;
+	ctx->state[3] = 0x6b206574;
+	for (int i = 0; i < 8; i++)
+		ctx->state[4 + i] = load_le32(&key[i * 4]);
+	ctx->offset = RIST_CHACHA20_BLOCK_SIZE;
+}
+
+void _librist_crypto_chacha20_starts(struct rist_chacha20 *ctx, const uint8_t nonce[RIST_CHACHA20_NONCE_SIZE], uint32_t counter)
+{
+	ctx->state[12] = counter;
+	for (int i = 0; i < 3; i++)
+		ctx->state[13 + i] = load_le32(&nonce[i * 4]);
+	ctx->offset = RIST_CHACHA20_BLOCK_SIZE;
+}
+
+void _librist_crypto_chacha20_crypt(struct rist_chacha20 *ctx, const uint8_t inbuf[], uint8_t outbuf[], size_t len)
+{
+	while (len > 0 && ctx->offset < RIST_CHACHA20_BLOCK_SIZE) {
+		*outbuf++ = *inbuf++ ^ ctx->keystream[ctx->offset++];
+		len--;
+	}
+	if (len >= RIST_CHACHA20_BLOCK_SIZE) {
+		size_t nblocks = ctx->blocks(ctx->state, inbuf, outbuf, len / RIST_CHACHA20_BLOCK_SIZE);
+		inbuf += nblocks * RIST_CHACHA20_BLOCK_SIZE;
+		outbuf += nblocks * RIST_CHACHA20_BLOCK_SIZE;
+		len -= nblocks * RIST_CHACHA20_BLOCK_SIZE;
+	}
+	if (len > 0) {
+		chacha20_block(ctx->state, ctx->keystream);
+		ctx->offset = 0;
+		while (len > 0) {
+			*outbuf++ = *inbuf++ ^ ctx->keystream[ctx->offset++];
+			len--;
+		}
+	}
+}
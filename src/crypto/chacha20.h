@@ -0,0 +1,35 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_CRYPTO_CHACHA20_H
+#define RIST_CRYPTO_CHACHA20_H
+
+#include "common/attributes.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define RIST_CHACHA20_KEY_SIZE 32
+#define RIST_CHACHA20_NONCE_SIZE 12
+#define RIST_CHACHA20_BLOCK_SIZE 64
+
+typedef size_t (*rist_chacha20_blocks_func)(uint32_t state[16], const uint8_t *in, uint8_t *out, size_t nblocks);
+
+/* RFC 8439 ChaCha20 stream cipher, the keystream position is kept across
+ * calls so a packet can be processed in several pieces (headers first) */
+struct rist_chacha20 {
+	uint32_t state[16];
+	uint8_t keystream[RIST_CHACHA20_BLOCK_SIZE];
+	size_t offset;
+	rist_chacha20_blocks_func blocks;
+};
+
+RIST_PRIV void _librist_crypto_chacha20_init(struct rist_chacha20 *ctx);
+RIST_PRIV void _librist_crypto_chacha20_setkey(struct rist_chacha20 *ctx, const uint8_t key[RIST_CHACHA20_KEY_SIZE]);
+RIST_PRIV void _librist_crypto_chacha20_starts(struct rist_chacha20 *ctx, const uint8_t nonce[RIST_CHACHA20_NONCE_SIZE], uint32_t counter);
+RIST_PRIV void _librist_crypto_chacha20_crypt(struct rist_chacha20 *ctx, const uint8_t inbuf[], uint8_t outbuf[], size_t len);
+RIST_PRIV const char *_librist_crypto_chacha20_impl(void);
+
+#endif
@@ -9,6 +9,7 @@
 #include "psk.h"
 #include "log-private.h"
 #include "crypto-private.h"
+#include "librist/peer.h"
 #include <string.h>
 
 #if HAVE_MBEDTLS
@@ -46,6 +47,8 @@ int _librist_crypto_psk_rist_key_init(struct rist_key *key, uint32_t key_size, u
 #elif defined(LINUX_CRYPTO)
 	linux_crypto_init(&key->linux_crypto_ctx);
 #endif
+	key->cipher = RIST_CIPHER_AES;
+	_librist_crypto_chacha20_init(&key->chacha20);
 	key->odd = odd;
 	return 0;
 }
@@ -77,6 +80,8 @@ int _librist_crypto_psk_rist_key_clone(struct rist_key *key_in, struct rist_key
 #elif defined(LINUX_CRYPTO)
 	linux_crypto_init(&key_out->linux_crypto_ctx);
 #endif
+	key_out->cipher = key_in->cipher;
+	_librist_crypto_chacha20_init(&key_out->chacha20);
 	key_out->odd = key_in->odd;
 	return 0;
 }
@@ -124,6 +129,11 @@ static void _librist_crypto_aes_key(struct rist_key *key)
             aes_key, key->key_size / 8);
 #endif
 
+    if (key->cipher == RIST_CIPHER_CHACHA20) {
+        _librist_crypto_chacha20_setkey(&key->chacha20, aes_key);
+        key->used_times = 0;
+        return;
+    }
 
 #if HAVE_MBEDTLS
     mbedtls_aes_setkey_enc(&key->mbedtls_aes_ctx, aes_key, key->key_size);
@@ -185,6 +195,11 @@ void _librist_crypto_aes_ctr(const uint8_t key[], int key_size, uint8_t iv[], co
 
 static void _librist_crypto_psk_aes_ctr(struct rist_key *key, const uint8_t inbuf[], uint8_t outbuf[], size_t payload_len)
 {
+	if (key->cipher == RIST_CIPHER_CHACHA20) {
+		_librist_crypto_chacha20_crypt(&key->chacha20, inbuf, outbuf, payload_len);
+		key->used_times++;
+		return;
+	}
 #if HAVE_MBEDTLS
 	mbedtls_aes_crypt_ctr(&key->mbedtls_aes_ctx, payload_len, &key->aes_offset, key->iv, key->strean_block, inbuf, outbuf);
 #elif HAVE_NETTLE
@@ -209,6 +224,11 @@ static void _librist_crypto_psk_aes_ctr(struct rist_key *key, const uint8_t inbu
 		aes_decrypt_ctr(inbuf, payload_len, outbuf,	key->aes_key_sched, key->key_size, key->iv);
 #else
 	aes_decrypt_ctr(inbuf, payload_len, outbuf, key->aes_key_sched, key->key_size, key->iv);
+#endif
+#if !HAVE_MBEDTLS && !HAVE_NETTLE
+	//Move the counter past the consumed blocks so a block aligned first pass can be continued
+	for (size_t i = 0; i < payload_len / AES_BLOCK_SIZE; i++)
+		increment_iv(key->iv, AES_BLOCK_SIZE);
 #endif
     key->used_times++;
 }
@@ -219,6 +239,9 @@ static void _librist_crypto_psk_prepare_iv(struct rist_key *key, uint8_t gre_ver
     uint8_t copy_offset = gre_version >= 1 ? 0 : 12;
     memset(key->iv, 0, 16);
     memcpy(key->iv + copy_offset, &seq_nbe, sizeof(seq_nbe));
+    // ChaCha20 takes the first 96 bits as nonce and counts blocks from 0
+    if (key->cipher == RIST_CIPHER_CHACHA20)
+        _librist_crypto_chacha20_starts(&key->chacha20, key->iv, 0);
 }
 
 static void _librist_crypto_psk_generate_nonce(struct rist_key *key) {
@@ -273,6 +296,17 @@ void _librist_crypto_psk_encrypt(struct rist_key *key, uint32_t seq_nbe, uint8_t
     return;
 }
 
+void _librist_crypto_psk_set_cipher(struct rist_key *key, int cipher)
+{
+	if (key->cipher == cipher)
+		return;
+	key->cipher = cipher;
+	if (cipher == RIST_CIPHER_CHACHA20)
+		key->key_size = 256;
+	//Key material depends on the cipher, force a new derivation on next use
+	memset(key->gre_nonce, 0, sizeof(key->gre_nonce));
+}
+
 int _librist_crypto_psk_set_passphrase(struct rist_key *key, const uint8_t *passsphrase, size_t passphrase_len) {
 	if (passphrase_len > sizeof(key->password) -1) {
 		return -1;
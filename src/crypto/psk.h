@@ -21,6 +21,7 @@
 #endif
 #include "contrib/aes.h"
 #endif
+#include "chacha20.h"
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
@@ -43,6 +44,8 @@ struct rist_key {
 	struct linux_crypto *linux_crypto_ctx;
 #endif
 	uint32_t aes_key_sched[60];//Do we still need this fallback?
+	int cipher;
+	struct rist_chacha20 chacha20;
 	uint32_t key_rotation;
     uint64_t used_times;
 	uint8_t password[128];
@@ -57,7 +60,10 @@ RIST_PRIV int _librist_crypto_psk_rist_key_destroy(struct rist_key *key);
 RIST_PRIV int _librist_crypto_psk_rist_key_clone(struct rist_key *key_in, struct rist_key *key_out);
 RIST_PRIV void _librist_crypto_psk_decrypt(struct rist_key *key, uint8_t nonce[4], uint32_t seq_nbe, uint8_t gre_version, const uint8_t inbuf[], uint8_t outbuf[], size_t payload_len);
 RIST_PRIV void _librist_crypto_psk_encrypt(struct rist_key *key, uint32_t seq_nbe, uint8_t gre_version, const uint8_t inbuf[], uint8_t outbuf[], size_t payload_len);
+/* Continues the CTR keystream of the last encrypt/decrypt call. Without MbedTLS
+ * an AES key can only continue after a multiple of AES_BLOCK_SIZE bytes. */
 RIST_PRIV void _librist_crypto_psk_encrypt_continue(struct rist_key *key, const uint8_t inbuf[], uint8_t outbuf[], size_t payload_len);
+RIST_PRIV void _librist_crypto_psk_set_cipher(struct rist_key *key, int cipher);
 RIST_PRIV int _librist_crypto_psk_set_passphrase(struct rist_key *key, const uint8_t *passsphrase, size_t passphrase_len);
 RIST_PRIV void _librist_crypto_psk_get_passphrase(struct rist_key *key, const uint8_t **passphrase, size_t *passphrase_len);
 RIST_PRIV void _librist_crypto_aes_ctr(const uint8_t key[], int key_size, uint8_t iv[], const uint8_t inbuf[], uint8_t outbuf[], size_t payload_len);
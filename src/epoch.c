@@ -0,0 +1,201 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "epoch.h"
+#include "time-shim.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+int rist_epoch_init(struct rist_epoch *e)
+{
+	atomic_init(&e->counter, 0);
+	atomic_init(&e->readers[0], 0);
+	atomic_init(&e->readers[1], 0);
+	e->retired = NULL;
+	return pthread_mutex_init(&e->lock, NULL);
+}
+
+void rist_epoch_destroy(struct rist_epoch *e)
+{
+	struct rist_epoch_retired *r = e->retired;
+	while (r) {
+		struct rist_epoch_retired *next = r->next;
+		bool embedded = r->embedded;
+		r->free_fn(r->ptr);
+		if (!embedded)
+			free(r);
+		r = next;
+	}
+	e->retired = NULL;
+	pthread_mutex_destroy(&e->lock);
+}
+
+unsigned rist_epoch_enter(struct rist_epoch *e)
+{
+	for (;;) {
+		unsigned slot = atomic_load(&e->counter) & 1;
+		atomic_fetch_add(&e->readers[slot], 1);
+		/* The writer may have flipped the epoch between the load and the
+		 * increment, in which case it might not have seen us */
+		if ((atomic_load(&e->counter) & 1) == slot)
+			return slot;
+		atomic_fetch_sub(&e->readers[slot], 1);
+	}
+}
+
+void rist_epoch_leave(struct rist_epoch *e, unsigned slot)
+{
+	atomic_fetch_sub_explicit(&e->readers[slot], 1, memory_order_release);
+}
+
+/* Called with e->lock held. Readers of the previous parity are stragglers that
+ * started before the current epoch, the epoch can only move once they left. */
+static bool epoch_try_advance(struct rist_epoch *e)
+{
+	unsigned long cur = atomic_load(&e->counter);
+	if (atomic_load(&e->readers[(cur + 1) & 1]) != 0)
+		return false;
+	atomic_store(&e->counter, cur + 1);
+	return true;
+}
+
+void rist_epoch_synchronize(struct rist_epoch *e)
+{
+	pthread_mutex_lock(&e->lock);
+	unsigned long target = atomic_load(&e->counter) + 2;
+	while (atomic_load(&e->counter) < target) {
+		if (epoch_try_advance(e))
+			continue;
+		pthread_mutex_unlock(&e->lock);
+		usleep(50);
+		pthread_mutex_lock(&e->lock);
+	}
+	pthread_mutex_unlock(&e->lock);
+}
+
+static void epoch_retire_record(struct rist_epoch *e, struct rist_epoch_retired *r, void *ptr,
+				void (*free_fn)(void *ptr), bool embedded)
+{
+	r->ptr = ptr;
+	r->free_fn = free_fn;
+	r->embedded = embedded;
+	pthread_mutex_lock(&e->lock);
+	r->epoch = atomic_load(&e->counter);
+	r->next = e->retired;
+	e->retired = r;
+	pthread_mutex_unlock(&e->lock);
+}
+
+void rist_epoch_retire(struct rist_epoch *e, void *ptr, void (*free_fn)(void *ptr))
+{
+	struct rist_epoch_retired *r = malloc(sizeof(*r));
+	if (!r) {
+		rist_epoch_synchronize(e);
+		free_fn(ptr);
+		return;
+	}
+	epoch_retire_record(e, r, ptr, free_fn, false);
+}
+
+void rist_epoch_retire_embedded(struct rist_epoch *e, struct rist_epoch_retired *r, void *ptr, void (*free_fn)(void *ptr))
+{
+	epoch_retire_record(e, r, ptr, free_fn, true);
+}
+
+void rist_epoch_reclaim(struct rist_epoch *e)
+{
+	if (!e->retired)
+		return;
+	struct rist_epoch_retired *expired = NULL;
+	pthread_mutex_lock(&e->lock);
+	epoch_try_advance(e);
+	unsigned long cur = atomic_load(&e->counter);
+	struct rist_epoch_retired **prev = &e->retired;
+	while (*prev) {
+		struct rist_epoch_retired *r = *prev;
+		if (r->epoch + 2 <= cur) {
+			*prev = r->next;
+			r->next = expired;
+			expired = r;
+		} else
+			prev = &r->next;
+	}
+	pthread_mutex_unlock(&e->lock);
+	while (expired) {
+		struct rist_epoch_retired *next = expired->next;
+		bool embedded = expired->embedded;
+		expired->free_fn(expired->ptr);
+		if (!embedded)
+			free(expired);
+		expired = next;
+	}
+}
+
+static void epoch_publish(void ***array, size_t *len, void **a, size_t n)
+{
+	atomic_thread_fence(memory_order_release);
+	*(void **volatile *)array = a;
+	atomic_thread_fence(memory_order_release);
+	*(volatile size_t *)len = n;
+}
+
+/* The retire record of the replaced array is allocated before publishing, so
+ * that the array helpers never have to wait for a grace period */
+int rist_epoch_array_add(struct rist_epoch *e, void ***array, size_t *len, void *item)
+{
+	size_t n = *len;
+	void **old = *array;
+	void **a = malloc((n + 1) * sizeof(*a));
+	struct rist_epoch_retired *r = old ? malloc(sizeof(*r)) : NULL;
+	if (!a || (old && !r)) {
+		free(a);
+		free(r);
+		return -1;
+	}
+	if (n)
+		memcpy(a, old, n * sizeof(*a));
+	a[n] = item;
+	epoch_publish(array, len, a, n + 1);
+	if (old)
+		epoch_retire_record(e, r, old, free, false);
+	return 0;
+}
+
+bool rist_epoch_array_remove(struct rist_epoch *e, void ***array, size_t *len, void *item)
+{
+	size_t n = *len;
+	void **old = *array;
+	size_t i;
+	for (i = 0; i < n; i++) {
+		if (old[i] == item)
+			break;
+	}
+	if (i == n)
+		return false;
+	/* Same slot count as before: a reader may still pair the old length
+	 * with the new array, the trailing slot keeps the removed item. */
+	void **a = malloc(n * sizeof(*a));
+	struct rist_epoch_retired *r = malloc(sizeof(*r));
+	if (!a || !r) {
+		free(a);
+		free(r);
+		/* In place, readers may see an entry twice but never a stale slot */
+		old[i] = old[n - 1];
+		old[n - 1] = item;
+		epoch_publish(array, len, old, n - 1);
+		return true;
+	}
+	memcpy(a, old, n * sizeof(*a));
+	a[i] = a[n - 1];
+	a[n - 1] = item;
+	epoch_publish(array, len, a, n - 1);
+	epoch_retire_record(e, r, old, free, false);
+	return true;
+}
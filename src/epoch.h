@@ -0,0 +1,75 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_EPOCH_H
+#define RIST_EPOCH_H
+
+#include "common/attributes.h"
+#include "pthread-shim.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Epoch based reclamation for the read-mostly peer and flow lists.
+ *
+ * Readers bracket their list walk with rist_epoch_enter()/rist_epoch_leave()
+ * and never block. Writers keep serializing among themselves (peerlist_lock,
+ * flows_lock), publish the new version with a release store and then either
+ * wait for the readers that may still see the old version
+ * (rist_epoch_synchronize) or hand it to rist_epoch_retire() so that it is
+ * freed by a later rist_epoch_reclaim() call from the protocol thread.
+ * Read sections must be short. Writers may run inside one (the protocol
+ * thread services its sockets from a read section) as long as they never
+ * wait for a grace period: rist_epoch_synchronize() must not be called from a
+ * read section or while holding a lock a reader may take, the array helpers
+ * and rist_epoch_retire_embedded() never wait.
+ */
+
+struct rist_epoch_retired {
+	void *ptr;
+	void (*free_fn)(void *ptr);
+	unsigned long epoch;
+	/* the record is part of ptr and goes with it */
+	bool embedded;
+	struct rist_epoch_retired *next;
+};
+
+struct rist_epoch {
+	atomic_ulong counter;
+	/* readers inside a section started on an even/odd epoch */
+	atomic_ulong readers[2];
+	/* serializes epoch advances and the retired list */
+	pthread_mutex_t lock;
+	struct rist_epoch_retired *retired;
+};
+
+RIST_PRIV int rist_epoch_init(struct rist_epoch *e);
+/* frees everything still retired, no readers may be left */
+RIST_PRIV void rist_epoch_destroy(struct rist_epoch *e);
+RIST_PRIV unsigned rist_epoch_enter(struct rist_epoch *e);
+RIST_PRIV void rist_epoch_leave(struct rist_epoch *e, unsigned slot);
+RIST_PRIV void rist_epoch_synchronize(struct rist_epoch *e);
+RIST_PRIV void rist_epoch_retire(struct rist_epoch *e, void *ptr, void (*free_fn)(void *ptr));
+/* Same with the record embedded in the retired object, never allocates or waits */
+RIST_PRIV void rist_epoch_retire_embedded(struct rist_epoch *e, struct rist_epoch_retired *r, void *ptr, void (*free_fn)(void *ptr));
+RIST_PRIV void rist_epoch_reclaim(struct rist_epoch *e);
+
+/* Copy on write pointer arrays (sender and flow peer lists). The published
+ * array never holds fewer slots than the length a reader may pair it with,
+ * removed entries stay valid until the grace period ends. */
+RIST_PRIV int rist_epoch_array_add(struct rist_epoch *e, void ***array, size_t *len, void *item);
+RIST_PRIV bool rist_epoch_array_remove(struct rist_epoch *e, void ***array, size_t *len, void *item);
+
+/* Snapshot of a copy on write array for use inside a read section */
+static inline void **rist_epoch_array_get(void **const *array, const size_t *len, size_t *out_len)
+{
+	*out_len = *(const volatile size_t *)len;
+	atomic_thread_fence(memory_order_acquire);
+	return *(void **const volatile *)array;
+}
+
+#endif
@@ -75,19 +75,58 @@ void rist_flush_missing_flow_queue(struct rist_flow *flow)
 	}
 	flow->missing = NULL;
 	flow->missing_counter = 0;
+	flow->nack_resume = NULL;
+	for (size_t i = 0; i < RIST_NACK_BATCHES; i++)
+		flow->nack_batches[i].count = 0;
+	flow->renack_count = 0;
 }
 
-void rist_delete_flow(struct rist_receiver *ctx, struct rist_flow *f)
+static void rist_flow_free(void *arg)
 {
-	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Triggering data output thread termination\n");
-	//This needs to be before the lock, as we may (happens rarely) fail to acquire it at all, due to output thread
-	//locking/unlocking too quickly.
-	atomic_store_explicit(&f->shutdown, 1, memory_order_release);
+	struct rist_flow *f = arg;
+	for (size_t i = 0; i < f->dataout_fifo_queue_capacity; i++)
+	{
+		if (f->dataout_fifo_queue[i])
+		{
+			free_data_block(&f->dataout_fifo_queue[i]);
+		}
+	}
+	free(f->dataout_fifo_queue);
+	free(f->frame.data);
+	free(f);
+}
+
+/* Reaper side of rist_delete_flow, the flow is unlinked and past its grace period */
+static void rist_flow_reap(void *arg)
+{
+	struct rist_flow *f = arg;
+	struct rist_receiver *ctx = (void *)f->receiver_id;
+	//The shutdown flag was raised before the lock, as we may (happens rarely) fail to acquire it at all, due to
+	//output thread locking/unlocking too quickly.
 	pthread_mutex_lock(&f->mutex);
 	bool running = f->receiver_thread_running;
 	pthread_mutex_unlock(&f->mutex);
 	if (running)
 		pthread_join(f->receiver_thread, NULL);
+
+	f->peer_lst_len = 0;
+	free(f->peer_lst);
+	f->peer_lst = NULL;
+
+	/* Delete all missing queue elements (if any) */
+	rist_flush_missing_flow_queue(f);
+	/* Delete all buffer data (if any) */
+	empty_receiver_queue(f, &ctx->common);
+
+	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Flow %"PRIu32" reclaimed\n", f->flow_id);
+	rist_flow_free(f);
+}
+
+/* Unlinks the flow, the output thread join and the frees are left to the reaper */
+void rist_delete_flow(struct rist_receiver *ctx, struct rist_flow *f)
+{
+	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Triggering data output thread termination\n");
+	atomic_store_explicit(&f->shutdown, 1, memory_order_release);
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Resetting peer states\n");
 	struct rist_peer *p = NULL;
 	for (size_t i = 0; i <f->peer_lst_len; i++)
@@ -125,48 +164,43 @@ void rist_delete_flow(struct rist_receiver *ctx, struct rist_flow *f)
 		peer = peer->next;
 	}
 
-	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Free flow peer list\n");
-	f->peer_lst_len = 0;
-	free(f->peer_lst);
-	f->peer_lst = NULL;
-
-	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Deleting missing queue elements\n");
-	/* Delete all missing queue elements (if any) */
-	rist_flush_missing_flow_queue(f);
-
-	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Deleting output buffer data\n");
-	/* Delete all buffer data (if any) */
-	empty_receiver_queue(f, &ctx->common);
+	/* the next flow that delivers data is relayed */
+	if (ctx->relay_flow == f)
+		ctx->relay_flow = NULL;
 
-	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Freeing data fifo queue\n");
-	for (size_t i = 0; i < ctx->fifo_queue_size; i++)
-	{
-		if (f->dataout_fifo_queue[i])
-		{
-			free_data_block(&f->dataout_fifo_queue[i]);
-		}
-	}
-	free(f->dataout_fifo_queue);
 	// Delete flow
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Deleting flow\n");
+	pthread_mutex_lock(&ctx->common.flows_lock);
 	struct rist_flow **prev_flow = &ctx->common.FLOWS;
 	struct rist_flow *current_flow = *prev_flow;
 	while (current_flow)
 	{
 		if (current_flow == f) {
 			*prev_flow = current_flow->next;
-			free(current_flow);
-			current_flow = NULL;
 			break;
 		}
 		prev_flow = &current_flow->next;
 		current_flow = current_flow->next;
 	}
-
+	/* the reader stays open and attaches again if the flow comes back. The
+	 * output thread of this flow runs until the reaper, it must not signal a
+	 * reader the application closes meanwhile */
+	if (f->reader) {
+		f->reader->flow = NULL;
+		f->reader = NULL;
+	}
+	pthread_mutex_unlock(&ctx->common.flows_lock);
+	/* Application threads may still be reading the data fifo, the reaper waits them out */
+	size_t bytes = sizeof(*f) + f->dataout_fifo_queue_capacity * sizeof(*f->dataout_fifo_queue)
+		+ atomic_load_explicit(&f->receiver_queue_size, memory_order_acquire)
+		+ atomic_load_explicit(&f->dataout_fifo_queue_bytesize, memory_order_acquire);
+	rist_reaper_defer(&ctx->common.reaper, &f->reap_job, f, rist_flow_reap, bytes);
 }
 
 static void rist_flow_append(struct rist_flow **FLOWS, struct rist_flow *f)
 {
+	/* the flow must be complete before lock free readers can reach it */
+	atomic_thread_fence(memory_order_release);
 	if (*FLOWS == NULL) {
 		// First entry
 		*FLOWS = f;
@@ -195,7 +229,8 @@ static struct rist_flow *create_flow(struct rist_receiver *ctx, uint32_t flow_id
 	f->receiver_id = ctx->id;
 	f->stats_next_time = timestampNTP_u64();
 	f->max_output_jitter = ctx->common.rist_max_jitter;
-	f->dataout_fifo_queue = calloc(ctx->fifo_queue_size, sizeof(*f->dataout_fifo_queue));
+	f->dataout_fifo_queue = calloc(ctx->fifo_queue_capacity, sizeof(*f->dataout_fifo_queue));
+	f->dataout_fifo_queue_capacity = ctx->fifo_queue_capacity;
 	int ret = pthread_cond_init(&f->condition, NULL);
 	if (ret) {
 		free(f);
@@ -215,16 +250,27 @@ static struct rist_flow *create_flow(struct rist_receiver *ctx, uint32_t flow_id
 	atomic_init(&f->receiver_queue_output_idx, 0);
 	atomic_init(&f->dataout_fifo_queue_write_index, 0);
 	atomic_init(&f->dataout_fifo_queue_read_index, 0);
+	atomic_init(&f->dataout_fifo_queue_bytesize, 0);
 	atomic_init(&f->fifo_overflow, false);
+	f->nacks.allowance = -1;
+	f->nack_weight = 1;
 
 	f->session_timeout = RIST_DEFAULT_SESSION_TIMEOUT * RIST_CLOCK;
 	f->flow_timeout = 250 * RIST_CLOCK;
 
-	/* Append flow to list */
+	f->logging_settings = ctx->common.logging_settings;
+
+	/* Append flow to list, claimed by its reader before data readers can see it */
 	pthread_mutex_lock(&ctx->common.flows_lock);
+	for (struct rist_flow_reader *r = ctx->flow_readers; r != NULL; r = r->next) {
+		if (r->flow_id == flow_id) {
+			r->flow = f;
+			f->reader = r;
+			break;
+		}
+	}
 	rist_flow_append(&ctx->common.FLOWS, f);
 	pthread_mutex_unlock(&ctx->common.flows_lock);
-	f->logging_settings = ctx->common.logging_settings;
 
 	return f;
 }
@@ -283,6 +329,8 @@ int rist_receiver_associate_flow(struct rist_peer *p, uint32_t flow_id)
 
 		f->recovery_buffer_ticks = p->recovery_buffer_ticks;
 		rist_log_priv(&ctx->common, RIST_LOG_INFO, "FLOW #%"PRIu32" created (short=%d)\n", flow_id, f->short_seq);
+		if (ctx->flow_callback)
+			ctx->flow_callback(ctx->flow_callback_argument, flow_id);
 	} else {
 		/* double check that this peer is not a member of this flow already */
 		if (flow_has_peer(f, flow_id, p->adv_peer_id)) {
@@ -313,14 +361,17 @@ int rist_receiver_associate_flow(struct rist_peer *p, uint32_t flow_id)
 	if (f->missing_counter_max < p->missing_counter_max)
 		f->missing_counter_max = p->missing_counter_max;
 
+	// The flow gets the largest nack scheduling weight of its peers
+	if (f->nack_weight < p->config.flow_weight)
+		f->nack_weight = p->config.flow_weight;
+
 	/* now assign flow to peer and add to list */
 	p->flow = f;
 	p->adv_flow_id = flow_id;
-	if (ret == 1) {
-		// TODO: lock the list?
-		f->peer_lst = realloc(f->peer_lst, (f->peer_lst_len + 1) * sizeof(*f->peer_lst));
-		f->peer_lst[f->peer_lst_len] = p;
-		f->peer_lst_len++;
+	if (ret == 1 && rist_peer_lst_add(&ctx->common, &f->peer_lst, &f->peer_lst_len, p) != 0) {
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Could not add peer to flow, OOM\n");
+		p->flow = NULL;
+		return -1;
 	}
 
 	rist_log_priv(&ctx->common, RIST_LOG_INFO,
@@ -0,0 +1,144 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "history_store.h"
+#include <string.h>
+
+static void ring_copy_in(struct rist_history_store *s, uint64_t pos, const uint8_t *buf, size_t len)
+{
+	size_t off = (size_t)(pos % s->capacity);
+	size_t first = s->capacity - off < len ? s->capacity - off : len;
+	memcpy(&s->base[off], buf, first);
+	memcpy(s->base, &buf[first], len - first);
+}
+
+static void ring_copy_out(const struct rist_history_store *s, uint64_t pos, uint8_t *buf, size_t len)
+{
+	size_t off = (size_t)(pos % s->capacity);
+	size_t first = s->capacity - off < len ? s->capacity - off : len;
+	memcpy(buf, &s->base[off], first);
+	memcpy(&buf[first], s->base, len - first);
+}
+
+int rist_history_store_read(const struct rist_history_store *s, uint64_t pos, void *buf, size_t len)
+{
+	if (!s->base || pos + len > s->head || s->head - pos > s->capacity)
+		return -1;
+	ring_copy_out(s, pos, buf, len);
+	return 0;
+}
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* A file without a name in dir: O_TMPFILE where the kernel and the file
+ * system have it, else a fresh mkstemp name unlinked right away. Nothing that
+ * already exists in dir (a planted file or symlink) is ever opened */
+static int history_file_open(const char *dir)
+{
+	int fd;
+#ifdef O_TMPFILE
+	fd = open(dir, O_RDWR | O_TMPFILE | O_EXCL | O_CLOEXEC, 0600);
+	if (fd >= 0 || (errno != EOPNOTSUPP && errno != EISDIR && errno != EINVAL))
+		return fd;
+#endif
+	char path[PATH_MAX];
+	if (snprintf(path, sizeof(path), "%s/rist_history_XXXXXX", dir) >= (int)sizeof(path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	fd = mkstemp(path);
+	if (fd < 0)
+		return -1;
+	unlink(path);
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	return fd;
+}
+
+int rist_history_store_open(struct rist_history_store *s, size_t capacity, const char *dir)
+{
+	memset(s, 0, sizeof(*s));
+	if (capacity == 0)
+		return -1;
+	capacity = (capacity + RIST_HISTORY_STORE_CHUNK - 1) / RIST_HISTORY_STORE_CHUNK * RIST_HISTORY_STORE_CHUNK;
+	void *base = MAP_FAILED;
+	if (dir) {
+		int fd = history_file_open(dir);
+		if (fd < 0)
+			return -1;
+		if (ftruncate(fd, (off_t)capacity) == 0)
+			base = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		s->file = true;
+	} else {
+#ifdef MAP_HUGETLB
+		/* chunks are a multiple of the 2 MB hugepage size, the mapping reserves
+		 * its hugepages up front and fails when not enough are set aside */
+		base = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		s->hugepages = base != MAP_FAILED;
+#endif
+		if (base == MAP_FAILED)
+			base = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	}
+	if (base == MAP_FAILED) {
+		memset(s, 0, sizeof(*s));
+		return -1;
+	}
+	s->base = base;
+	s->capacity = capacity;
+	return 0;
+}
+
+void rist_history_store_close(struct rist_history_store *s)
+{
+	if (s->base)
+		munmap(s->base, s->capacity);
+	memset(s, 0, sizeof(*s));
+}
+
+uint64_t rist_history_store_append(struct rist_history_store *s, const void *buf, size_t len)
+{
+	uint64_t pos = s->head;
+	ring_copy_in(s, pos, buf, len);
+	s->head += len;
+	if (s->file) {
+		/* the page cache holds on to the written chunks, a read faults them back in */
+		uint64_t chunks = s->capacity / RIST_HISTORY_STORE_CHUNK;
+		for (; s->released < s->head / RIST_HISTORY_STORE_CHUNK; s->released++)
+			madvise(&s->base[(s->released % chunks) * RIST_HISTORY_STORE_CHUNK], RIST_HISTORY_STORE_CHUNK, MADV_DONTNEED);
+	}
+	return pos;
+}
+
+#else
+
+int rist_history_store_open(struct rist_history_store *s, size_t capacity, const char *dir)
+{
+	(void)capacity;
+	(void)dir;
+	memset(s, 0, sizeof(*s));
+	return -1;
+}
+
+void rist_history_store_close(struct rist_history_store *s)
+{
+	memset(s, 0, sizeof(*s));
+}
+
+uint64_t rist_history_store_append(struct rist_history_store *s, const void *buf, size_t len)
+{
+	(void)buf;
+	s->head += len;
+	return s->head - len;
+}
+
+#endif
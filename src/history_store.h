@@ -0,0 +1,53 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_HISTORY_STORE_H
+#define RIST_HISTORY_STORE_H
+
+#include "common/attributes.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Cold tier of the sender history (rist_sender_history_set).
+ *
+ * A byte ring in a single mapping, either an anonymous arena (on hugepages
+ * when the system has them reserved) or a file mapped shared. Records are
+ * appended sequentially and addressed by their position in the stream of
+ * appended bytes, a record stays readable until the ring wraps over it.
+ * For a file backed store the written chunks behind the head are dropped
+ * from the process as the head moves on, the page cache keeps (or writes
+ * back) the data, so the resident size stays around one chunk.
+ */
+
+#define RIST_HISTORY_STORE_CHUNK (4 * 1024 * 1024)
+
+struct rist_history_store {
+	uint8_t *base;
+	/* multiple of RIST_HISTORY_STORE_CHUNK */
+	size_t capacity;
+	/* bytes appended since open */
+	uint64_t head;
+	/* chunks released from the mapping, file backed only */
+	uint64_t released;
+	bool file;
+	bool hugepages;
+};
+
+/* capacity is rounded up to whole chunks, dir NULL for an anonymous arena.
+ * The backing file is created new in dir and has no name once open, so
+ * nothing is left behind by a crash.
+ * Returns 0 or -1, the store is left zeroed on failure */
+RIST_PRIV int rist_history_store_open(struct rist_history_store *s, size_t capacity, const char *dir);
+/* Unmaps the store */
+RIST_PRIV void rist_history_store_close(struct rist_history_store *s);
+/* Appends len bytes (at most the capacity) and returns their position */
+RIST_PRIV uint64_t rist_history_store_append(struct rist_history_store *s, const void *buf, size_t len);
+/* Copies back a record, returns -1 when it has been overwritten since */
+RIST_PRIV int rist_history_store_read(const struct rist_history_store *s, uint64_t pos, void *buf, size_t len);
+
+#endif
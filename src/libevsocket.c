@@ -48,9 +48,14 @@ struct evsocket_event {
 	struct evsocket_event *next;
 };
 
+/* Events may be added and removed from other threads while the loop runs: the
+ * event list is guarded by lock, the loop polls and serves the copy made by
+ * rebuild_poll (pfd, _array and n_pfd) which only the loop thread touches. */
 struct evsocket_ctx {
+	pthread_mutex_t lock;
 	int changed;
 	int n_events;
+	int n_pfd;
 	int last_served;
 	struct pollfd *pfd;
 	struct evsocket_event *events;
@@ -121,11 +126,13 @@ struct evsocket_event *evsocket_addevent(struct evsocket_ctx *ctx, int fd, short
 	e->err_callback = err_callback;
 	e->arg = arg;
 
+	pthread_mutex_lock(&ctx->lock);
 	ctx->changed = 1;
 
 	e->next = ctx->events;
 	ctx->events = e;
 	ctx->n_events++;
+	pthread_mutex_unlock(&ctx->lock);
 	return e;
 }
 
@@ -137,6 +144,7 @@ void evsocket_delevent(struct evsocket_ctx *ctx, struct evsocket_event *e)
 		return;
 	}
 
+	pthread_mutex_lock(&ctx->lock);
 	ctx->changed = 1;
 	cur = ctx->events;
 	prev = NULL;
@@ -150,13 +158,14 @@ void evsocket_delevent(struct evsocket_ctx *ctx, struct evsocket_event *e)
 			}
 
 			free(e);
+			ctx->n_events--;
 			break;
 		}
 
 		prev = cur;
 		cur = cur->next;
 	}
-	ctx->n_events--;
+	pthread_mutex_unlock(&ctx->lock);
 }
 
 
@@ -194,7 +203,7 @@ static void rebuild_poll(struct evsocket_ctx *ctx)
 				ctx->n_events);
 		}
 
-		ctx->n_events = 0;
+		ctx->n_pfd = 0;
 		ctx->changed = 0;
 		return;
 	}
@@ -208,6 +217,7 @@ static void rebuild_poll(struct evsocket_ctx *ctx)
 		e = e->next;
 	}
 
+	ctx->n_pfd = i;
 	ctx->last_served = 1;
 	ctx->changed = 0;
 }
@@ -221,9 +231,9 @@ static void serve_event(struct evsocket_ctx *ctx, int n)
 		return;
 	}
 
-	if (n >= ctx->n_events) {
+	if (n >= ctx->n_pfd) {
 		rist_log_priv3( RIST_LOG_ERROR, "libevsocket, serve_event: Invalid event %d >= %d\n",
-			n, ctx->n_events);
+			n, ctx->n_pfd);
 		return;
 	}
 
@@ -250,6 +260,10 @@ struct evsocket_ctx *evsocket_create(void)
 	if (!ctx) {
 		return NULL;
 	}
+	if (pthread_mutex_init(&ctx->lock, NULL) != 0) {
+		free(ctx);
+		return NULL;
+	}
 
 	ctx->giveup = 0;
 	ctx->n_events = 0;
@@ -279,6 +293,7 @@ int evsocket_loop_single(struct evsocket_ctx *ctx, int timeout, int max_events)
 		goto loop_error;
 	}
 
+	pthread_mutex_lock(&ctx->lock);
 	if (ctx->changed) {
 		//rist_log_priv3( RIST_LOG_DEBUG, "libevsocket, evsocket_loop_single: rebuild poll\n");
 		rebuild_poll(ctx);
@@ -287,22 +302,24 @@ int evsocket_loop_single(struct evsocket_ctx *ctx, int timeout, int max_events)
 	if (ctx->pfd == NULL) {
 		//rist_log_priv3( RIST_LOG_DEBUG, "libevsocket, evsocket_loop_single: ctx->pfd is null, no events?\n");
 		ctx->changed = 1;
+		pthread_mutex_unlock(&ctx->lock);
 		retval = -2;
 		goto loop_error;
 	}
+	pthread_mutex_unlock(&ctx->lock);
 
-	if (ctx->n_events < 1) {
+	if (ctx->n_pfd < 1) {
 		rist_log_priv3( RIST_LOG_ERROR, "libevsocket, evsocket_loop_single: no events (%d)\n",
-			ctx->n_events);
+			ctx->n_pfd);
 		retval = -3;
 		goto loop_error;
 	}
 
-	pollret = poll(ctx->pfd, ctx->n_events, timeout);
+	pollret = poll(ctx->pfd, ctx->n_pfd, timeout);
 	if (pollret <= 0) {
 		if (pollret < 0) {
 			rist_log_priv3( RIST_LOG_ERROR, "libevsocket, evsocket_loop: poll returned %d, n_events = %d, error = %d\n",
-				pollret, ctx->n_events, errno);
+				pollret, ctx->n_pfd, errno);
 			retval = -4;
 			goto loop_error;
 		}
@@ -310,7 +327,7 @@ int evsocket_loop_single(struct evsocket_ctx *ctx, int timeout, int max_events)
 		return 0;
 	}
 
-	for (i = ctx->last_served +1; i < ctx->n_events; i++) {
+	for (i = ctx->last_served +1; i < ctx->n_pfd; i++) {
 		if (ctx->pfd[i].revents != 0) {
 			serve_event(ctx, i);
 			if (max_events > 0 && ++event_count >= max_events)
@@ -337,6 +354,7 @@ loop_error:
 void evsocket_destroy(struct evsocket_ctx *ctx)
 {
 	ctx_del(ctx);
+	pthread_mutex_destroy(&ctx->lock);
 	if (ctx->pfd)
 		free(ctx->pfd);
 	if (ctx->_array)
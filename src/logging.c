@@ -103,6 +103,8 @@ void rist_log_priv(struct rist_common_ctx *cctx, enum rist_log_level level, cons
 {
 	if (RIST_UNLIKELY(cctx->logging_settings == NULL))
 		return;
+	if (RIST_UNLIKELY(cctx->log_quiet) && level > RIST_LOG_WARN)
+		return;
 	va_list argp;
 	va_start(argp, format);
 	rist_log_impl(cctx->logging_settings, level, cctx->sender_id, cctx->receiver_id, format, argp);
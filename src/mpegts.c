@@ -76,3 +76,90 @@ int expand_null_packets(uint8_t payload[], size_t *payload_len, uint8_t npd_bits
 	}
 	return counter;
 }
+
+/* Length of the 0xFF run that closes the adaptation field of a TS packet.
+ * Only the trailing run is taken, whatever it overlaps is restored as 0xFF
+ * so the packet comes back byte exact without parsing the optional fields.
+ * The adaptation field flags byte is always kept. */
+static size_t ts_stuffing_len(const uint8_t pkt[])
+{
+	if (pkt[0] != 0x47 || !CHECK_BIT(pkt[3], 5))
+		return 0;
+	size_t af_len = pkt[4];
+	if (af_len < 2 || 5 + af_len > 188)
+		return 0;
+	size_t end = 5 + af_len;
+	size_t len = 0;
+	while (len < af_len - 1 && pkt[end - 1 - len] == 0xFF)
+		len++;
+	return len;
+}
+
+int suppress_ts_stuffing(const uint8_t payload_in[], uint8_t payload_out[], size_t *payload_len, struct rist_rtp_hdr_ext *header_ext, struct rist_rtp_hdr_ext_stuffing *stuffing)
+{
+	size_t packet_size = 188;
+	if (RIST_UNLIKELY(*payload_len % packet_size != 0)) {
+		packet_size = 204;
+		if (RIST_UNLIKELY(*payload_len % packet_size != 0))
+			return -1;
+	}
+	size_t count = *payload_len / packet_size;
+	if (RIST_UNLIKELY(count == 0 || count > 7))
+		return -1;
+	size_t removed = 0;
+	memset(stuffing, 0, sizeof(*stuffing));
+	for (size_t i = 0; i < count; i++) {
+		stuffing->len[i] = (uint8_t)ts_stuffing_len(&payload_in[i * packet_size]);
+		removed += stuffing->len[i];
+	}
+	//Only worth it when we save more than the extra header bytes
+	size_t overhead = sizeof(*stuffing);
+	if (!CHECK_BIT(header_ext->flags, 7))
+		overhead += sizeof(*header_ext);
+	if (removed <= overhead)
+		return 0;
+	if (packet_size == 204)
+		SET_BIT(header_ext->npd_bits, 7);
+	SET_BIT(header_ext->flags, 6);
+	//payload_out may be payload_in, output never overtakes the input
+	size_t output_offset = 0;
+	for (size_t i = 0; i < count; i++) {
+		const uint8_t *pkt = &payload_in[i * packet_size];
+		size_t len = stuffing->len[i];
+		size_t cut = 5 + pkt[4] - len;
+		if (len == 0)
+			cut = packet_size;
+		memmove(&payload_out[output_offset], pkt, cut);
+		if (len > 0)
+			memmove(&payload_out[output_offset + cut], &pkt[cut + len], packet_size - cut - len);
+		output_offset += packet_size - len;
+	}
+	*payload_len = output_offset;
+	return (int)removed;
+}
+
+int expand_ts_stuffing(uint8_t payload[], size_t *payload_len, uint8_t npd_bits, const struct rist_rtp_hdr_ext_stuffing *stuffing)
+{
+	size_t packet_size = CHECK_BIT(npd_bits, 7) == 0? 188: 204;
+	size_t offset = 0;
+	int restored = 0;
+	//Same 10k byte pre-allocated buffer assumption as expand_null_packets
+	for (int i = 0; i < 7 && offset < *payload_len; i++) {
+		size_t len = stuffing->len[i];
+		if (RIST_UNLIKELY(offset + packet_size - len > *payload_len))
+			return -1;
+		if (len > 0) {
+			uint8_t *pkt = &payload[offset];
+			size_t af_len = pkt[4];
+			if (RIST_UNLIKELY(pkt[0] != 0x47 || af_len < len + 1 || 5 + af_len > 188))
+				return -1;
+			size_t cut = 5 + af_len - len;
+			memmove(&pkt[cut + len], &pkt[cut], *payload_len - offset - cut);
+			memset(&pkt[cut], 0xFF, len);
+			*payload_len += len;
+			restored += (int)len;
+		}
+		offset += packet_size;
+	}
+	return restored;
+}
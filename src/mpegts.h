@@ -37,5 +37,7 @@ RIST_PACKED_STRUCT(mpegts_header, {
 
 RIST_PRIV int suppress_null_packets(const uint8_t payload_in[], uint8_t payload_out[], size_t *payload_len, struct rist_rtp_hdr_ext *header_ext);
 RIST_PRIV int expand_null_packets(uint8_t payload[], size_t *payload_len, uint8_t npd_bits);
+RIST_PRIV int suppress_ts_stuffing(const uint8_t payload_in[], uint8_t payload_out[], size_t *payload_len, struct rist_rtp_hdr_ext *header_ext, struct rist_rtp_hdr_ext_stuffing *stuffing);
+RIST_PRIV int expand_ts_stuffing(uint8_t payload[], size_t *payload_len, uint8_t npd_bits, const struct rist_rtp_hdr_ext_stuffing *stuffing);
 
 #endif
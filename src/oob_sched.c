@@ -0,0 +1,68 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "oob_sched.h"
+#include <string.h>
+
+static int64_t oob_sched_burst(const struct rist_oob_sched *s)
+{
+	uint64_t burst = s->rate * RIST_OOB_SCHED_BURST_MS / 1000;
+	return burst < RIST_OOB_SCHED_MIN_BURST ? RIST_OOB_SCHED_MIN_BURST : (int64_t)burst;
+}
+
+void rist_oob_sched_init(struct rist_oob_sched *s, uint64_t max_rate, uint64_t ticks_per_second, uint64_t now)
+{
+	memset(s, 0, sizeof(*s));
+	s->max_rate = max_rate;
+	s->rate = max_rate;
+	s->ticks_per_second = ticks_per_second;
+	s->tokens = oob_sched_burst(s);
+	s->last_refill = now;
+	s->next_adjust = now + ticks_per_second * RIST_OOB_SCHED_ADJUST_MS / 1000;
+}
+
+void rist_oob_sched_update(struct rist_oob_sched *s, uint64_t now, bool media_loss)
+{
+	if (!s->max_rate)
+		return;
+	s->loss |= media_loss;
+	if (now >= s->next_adjust) {
+		s->next_adjust = now + s->ticks_per_second * RIST_OOB_SCHED_ADJUST_MS / 1000;
+		uint64_t step = s->max_rate / RIST_OOB_SCHED_STEPS;
+		if (s->loss) {
+			s->rate /= 2;
+			if (s->rate < step)
+				s->rate = step;
+			s->backoffs++;
+		} else if (s->rate < s->max_rate) {
+			s->rate += step;
+			if (s->rate > s->max_rate)
+				s->rate = s->max_rate;
+		}
+		s->loss = false;
+	}
+	if (now <= s->last_refill)
+		return;
+	uint64_t elapsed = now - s->last_refill;
+	/* the bucket is full after a second anyway, this keeps the product in range */
+	if (elapsed > s->ticks_per_second)
+		elapsed = s->ticks_per_second;
+	s->last_refill = now;
+	s->tokens += (int64_t)(s->rate * elapsed / s->ticks_per_second);
+	int64_t burst = oob_sched_burst(s);
+	if (s->tokens > burst)
+		s->tokens = burst;
+}
+
+bool rist_oob_sched_take(struct rist_oob_sched *s, size_t len)
+{
+	if (!s->max_rate)
+		return true;
+	if (s->tokens <= 0)
+		return false;
+	s->tokens -= (int64_t)len;
+	return true;
+}
@@ -0,0 +1,52 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_OOB_SCHED_H
+#define RIST_OOB_SCHED_H
+
+#include "common/attributes.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Pacing of out-of-band data (rist_oob_bandwidth_set).
+ *
+ * A token bucket holding RIST_OOB_SCHED_BURST_MS worth of the current rate.
+ * A packet may go as long as the bucket is not in debt, so packets larger
+ * than the bucket still get through at the average rate. Every
+ * RIST_OOB_SCHED_ADJUST_MS the rate is halved if the media path reported
+ * loss in the meantime and raised by one step otherwise (AIMD), between
+ * max_rate / RIST_OOB_SCHED_STEPS and max_rate.
+ */
+
+#define RIST_OOB_SCHED_BURST_MS 10
+#define RIST_OOB_SCHED_ADJUST_MS 100
+#define RIST_OOB_SCHED_STEPS 16
+/* smallest bucket, one tunnelled ethernet frame */
+#define RIST_OOB_SCHED_MIN_BURST 1500
+
+struct rist_oob_sched {
+	/* configured rate in bytes per second, 0 = not paced */
+	uint64_t max_rate;
+	uint64_t rate;
+	uint64_t ticks_per_second;
+	int64_t tokens;
+	uint64_t last_refill;
+	uint64_t next_adjust;
+	/* media loss reported since the last adjustment */
+	bool loss;
+	/* rate reductions since start */
+	uint32_t backoffs;
+};
+
+RIST_PRIV void rist_oob_sched_init(struct rist_oob_sched *s, uint64_t max_rate, uint64_t ticks_per_second, uint64_t now);
+/* Refills the bucket, media_loss is latched until the next rate adjustment */
+RIST_PRIV void rist_oob_sched_update(struct rist_oob_sched *s, uint64_t now, bool media_loss);
+/* Charges len bytes, returns false (nothing charged) while the bucket is in debt */
+RIST_PRIV bool rist_oob_sched_take(struct rist_oob_sched *s, size_t len);
+
+#endif
@@ -0,0 +1,76 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "overload.h"
+#include <string.h>
+
+void rist_overload_init(struct rist_overload *o, uint64_t lag_unit, uint64_t window, uint64_t now)
+{
+	enum rist_overload_tier max_tier = o->max_tier;
+	memset(o, 0, sizeof(*o));
+	o->max_tier = max_tier;
+	o->lag_unit = lag_unit;
+	o->window = window;
+	o->window_end = now + window;
+}
+
+void rist_overload_sample(struct rist_overload *o, uint64_t lag, bool backlog, uint32_t queue_fill)
+{
+	o->loops++;
+	if (lag > o->lag_max)
+		o->lag_max = lag;
+	if (lag > o->lag_unit)
+		o->late_loops++;
+	if (queue_fill > o->queue_fill_max)
+		o->queue_fill_max = queue_fill;
+	if (backlog)
+		o->backlog_loops++;
+}
+
+int rist_overload_evaluate(struct rist_overload *o, uint64_t now)
+{
+	if (now < o->window_end)
+		return 0;
+	o->window_end = now + o->window;
+
+	/* one long iteration is enough to be hot, calm tolerates the odd late one */
+	bool hot = o->lag_max > 4 * o->lag_unit || o->late_loops * 2 > o->loops || o->backlog_loops * 2 > o->loops ||
+		(o->queue_fill_max >= 75 && o->late_loops > 0);
+	bool calm = o->lag_max <= 2 * o->lag_unit && o->late_loops * 10 <= o->loops &&
+		o->backlog_loops * 10 <= o->loops && o->queue_fill_max < 50;
+	o->lag_max = 0;
+	o->loops = 0;
+	o->late_loops = 0;
+	o->backlog_loops = 0;
+	o->queue_fill_max = 0;
+
+	int ret = 0;
+	if (hot) {
+		o->calm_windows = 0;
+		if (++o->hot_windows < RIST_OVERLOAD_ESCALATE_WINDOWS)
+			return 0;
+		o->hot_windows = 0;
+		if (o->tier < o->max_tier) {
+			o->tier++;
+			o->entered[o->tier]++;
+			ret = 1;
+		} else if (o->tier == RIST_OVERLOAD_TIER_SHED)
+			ret = 1;
+	} else if (calm) {
+		o->hot_windows = 0;
+		if (o->tier == RIST_OVERLOAD_TIER_NONE || ++o->calm_windows < RIST_OVERLOAD_RECOVER_WINDOWS)
+			return 0;
+		o->calm_windows = 0;
+		o->exited[o->tier]++;
+		o->tier--;
+		ret = -1;
+	} else {
+		/* neither: hold the current tier */
+		o->hot_windows = 0;
+		o->calm_windows = 0;
+	}
+	return ret;
+}
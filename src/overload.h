@@ -0,0 +1,65 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_OVERLOAD_H
+#define RIST_OVERLOAD_H
+
+#include "common/attributes.h"
+#include "librist/receiver.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Overload detection for the receiver protocol loop.
+ *
+ * The loop feeds one sample per iteration: how much longer than the poll
+ * timeout the iteration took (loop lag), whether a socket was still readable
+ * after RIST_OVERLOAD_RECV_BURST datagrams (backlog, the reads are only bounded
+ * with overload control enabled) and how full the missing
+ * and output queues are. Samples are judged per window; consecutive hot
+ * windows raise the degradation tier one step at a time, consecutive calm
+ * windows lower it again. Queue fill alone does not make a window hot, loss
+ * on the network fills the missing queue without the host being short on CPU.
+ */
+
+#define RIST_OVERLOAD_TIERS (RIST_OVERLOAD_TIER_SHED + 1)
+/* hot windows before the next tier (or the next shed flow) */
+#define RIST_OVERLOAD_ESCALATE_WINDOWS 2
+/* calm windows before stepping down one tier */
+#define RIST_OVERLOAD_RECOVER_WINDOWS 3
+/* datagrams read from one socket per poll event, the rest waits for the next round */
+#define RIST_OVERLOAD_RECV_BURST 256
+
+struct rist_overload {
+	/* highest tier the policy may enter, RIST_OVERLOAD_TIER_NONE disables it */
+	enum rist_overload_tier max_tier;
+	enum rist_overload_tier tier;
+	/* iteration lag that still counts as calm, in ticks */
+	uint64_t lag_unit;
+	uint64_t window;
+	uint64_t window_end;
+	/* current window */
+	uint64_t lag_max;
+	uint32_t loops;
+	uint32_t late_loops;
+	uint32_t backlog_loops;
+	uint32_t queue_fill_max;
+	uint32_t hot_windows;
+	uint32_t calm_windows;
+	/* tier transitions since start */
+	uint32_t entered[RIST_OVERLOAD_TIERS];
+	uint32_t exited[RIST_OVERLOAD_TIERS];
+};
+
+RIST_PRIV void rist_overload_init(struct rist_overload *o, uint64_t lag_unit, uint64_t window, uint64_t now);
+/* queue_fill in percent */
+RIST_PRIV void rist_overload_sample(struct rist_overload *o, uint64_t lag, bool backlog, uint32_t queue_fill);
+/* Closes the window once it is over. Returns 1 when the tier went up (or,
+ * already at the shed tier, when another flow should be shed), -1 when it
+ * went down and 0 otherwise. */
+RIST_PRIV int rist_overload_evaluate(struct rist_overload *o, uint64_t now);
+
+#endif
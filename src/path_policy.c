@@ -0,0 +1,67 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "path_policy.h"
+#include "rist-private.h"
+#include "proto/rist_time.h"
+
+static struct rist_peer *path_peer(struct rist_peer *peer)
+{
+	if (!peer->is_data && peer->peer_data)
+		peer = peer->peer_data;
+	if (peer->sender_ctx && peer->parent)
+		peer = peer->parent;
+	return peer;
+}
+
+struct rist_path *rist_path_get(struct rist_common_ctx *cctx, struct rist_peer *peer)
+{
+	/* measurements live on the data peer, a listening sender peer has none of its own */
+	struct rist_peer *src = (!peer->is_data && peer->peer_data) ? peer->peer_data : peer;
+	struct rist_peer *owner = path_peer(peer);
+	struct rist_path *path = &owner->path;
+
+	path->peer = owner;
+	path->peer_id = owner->adv_peer_id;
+	path->weight = owner->config.weight;
+	path->recovery_maxbitrate = owner->config.recovery_maxbitrate;
+	path->alive = !owner->dead && (!owner->listening || owner->child_alive_count);
+	if (!src->listening) {
+		path->rtt_us = (uint32_t)(src->last_rtt * 1000 / RIST_CLOCK);
+		path->avg_rtt_us = (uint32_t)(src->eight_times_rtt / 8 * 1000 / RIST_CLOCK);
+		path->bitrate = src->bw.eight_times_bitrate_fast / 8;
+		path->retry_bitrate = src->retry_bw.eight_times_bitrate_fast / 8;
+	}
+	if (RIST_UNLIKELY(!owner->path_attached)) {
+		owner->path_attached = true;
+		if (cctx->path_policy.path_attach)
+			path->state = cctx->path_policy.path_attach(cctx->path_policy_arg, path);
+	}
+	return path;
+}
+
+void rist_path_update(struct rist_common_ctx *cctx, struct rist_peer *peer)
+{
+	if (RIST_LIKELY(!cctx->path_policy.path_update))
+		return;
+	struct rist_path *path = rist_path_get(cctx, peer);
+	cctx->path_policy.path_update(cctx->path_policy_arg, path);
+}
+
+void rist_path_loss_update(struct rist_common_ctx *cctx, struct rist_peer *peer, uint32_t loss_permille)
+{
+	if (RIST_LIKELY(!cctx->path_policy_set))
+		return;
+	path_peer(peer)->path.loss_permille = loss_permille > 1000 ? 1000 : loss_permille;
+	rist_path_update(cctx, peer);
+}
+
+void rist_path_detach(struct rist_common_ctx *cctx, struct rist_peer *peer)
+{
+	if (peer->path_attached && cctx->path_policy.path_detach)
+		cctx->path_policy.path_detach(cctx->path_policy_arg, &peer->path);
+	peer->path_attached = false;
+}
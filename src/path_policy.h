@@ -0,0 +1,40 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_PATH_POLICY_H
+#define RIST_PATH_POLICY_H
+
+#include "common/attributes.h"
+#include "librist/opt.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Glue between the peers and an application path policy (RIST_OPT_PATH_POLICY).
+ *
+ * Every hook site tests its hook pointer first, with no policy installed the
+ * hot paths cost a single load and compare. The struct rist_path embedded in
+ * each peer is refreshed right before it is handed out and attached to the
+ * policy (path_attach) the first time.
+ */
+
+/* Most paths offered to select_data / select_nack_path in one call */
+#define RIST_PATH_POLICY_MAX_PATHS 32
+
+struct rist_common_ctx;
+struct rist_peer;
+
+/* Refreshed and attached path the peer belongs to (rtcp peers map to their data peer,
+ * sender connections of a listening peer to the listening peer) */
+RIST_PRIV struct rist_path *rist_path_get(struct rist_common_ctx *cctx, struct rist_peer *peer);
+/* New rtt measurement on peer, calls path_update */
+RIST_PRIV void rist_path_update(struct rist_common_ctx *cctx, struct rist_peer *peer);
+/* Stats interval loss figure for peer, calls path_update */
+RIST_PRIV void rist_path_loss_update(struct rist_common_ctx *cctx, struct rist_peer *peer, uint32_t loss_permille);
+/* Peer is going away, calls path_detach when it was attached */
+RIST_PRIV void rist_path_detach(struct rist_common_ctx *cctx, struct rist_peer *peer);
+
+#endif
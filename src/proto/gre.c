@@ -11,6 +11,7 @@
 #include "udp-private.h"
 #include "eap.h"
 #include "peer.h"
+#include "rist_time.h"
 
 #include <errno.h>
 #include <stddef.h>
@@ -20,7 +21,67 @@
 #include <stdlib.h>
 #include <string.h>
 
-ssize_t _librist_proto_gre_send_data(struct rist_peer *p, uint8_t payload_type, uint16_t proto, uint8_t *payload, size_t payload_len, uint16_t src_port, uint16_t dst_port, uint8_t gre_version) {
+static struct rist_key *gre_tx_key(struct rist_peer *p, struct rist_peer *key_peer)
+{
+	if (key_peer->key_tx_odd_active)
+		return &p->key_tx_odd;
+	return &key_peer->key_tx;
+}
+
+static ssize_t gre_sendmsg(struct rist_peer *p, int sd, uint8_t *hdr_buf, size_t hdr_len, uint8_t *payload_wr, size_t payload_len)
+{
+	ssize_t ret;
+	int errorcode = 0;
+	//TODO: abstract this away
+#ifndef _WIN32
+	//TODO: this is POSIX only: add windows equivalent
+	struct msghdr msghdr;
+	struct iovec iov[2];
+	iov[0].iov_base = hdr_buf;
+	iov[0].iov_len = hdr_len;
+	iov[1].iov_base = payload_wr;
+	iov[1].iov_len = payload_len;
+	msghdr.msg_iov = iov;
+	msghdr.msg_iovlen = 2;
+	msghdr.msg_name = &p->u.address;
+	msghdr.msg_namelen = p->address_len;
+	msghdr.msg_control = NULL;
+	msghdr.msg_controllen = 0;
+	msghdr.msg_flags = 0;
+	ret = sendmsg(sd, &msghdr, MSG_DONTWAIT);
+	if (RIST_UNLIKELY(ret < 0)) {
+		errorcode = errno;
+	}
+#else
+	WSAMSG msghdr = { 0 };
+	WSABUF iov[2];
+	DWORD dwBytes = 0;
+	iov[0].len = hdr_len;
+	iov[0].buf = (char *)hdr_buf;
+	iov[1].len = payload_len;
+	iov[1].buf = (char *)payload_wr;
+	msghdr.name = (struct sockaddr *)&p->u.address;
+	msghdr.namelen = p->address_len;
+	msghdr.lpBuffers = iov;
+	msghdr.dwBufferCount = 2;
+
+	ret = payload_len + hdr_len;
+	if (RIST_UNLIKELY(WSASendMsg(sd, &msghdr, MSG_DONTWAIT, &dwBytes, NULL, NULL) != 0)) {
+		ret = -1;
+		errorcode = WSAGetLastError();
+	}
+#endif
+
+
+	if (RIST_UNLIKELY(errorcode)) {
+        struct rist_common_ctx *ctx = get_cctx(p);
+        rist_log_priv(ctx, RIST_LOG_ERROR, "Send failed: errno=%d, reason=%s, ret=%d, socket=%d\n", errorcode, strerror(errorcode), ret, sd);
+	}
+
+	return ret;
+}
+
+ssize_t _librist_proto_gre_send_data_wire(struct rist_peer *p, uint8_t payload_type, uint16_t proto, uint8_t *payload, size_t payload_len, uint16_t src_port, uint16_t dst_port, uint8_t gre_version, struct rist_wire_image **wire) {
 	bool encrypt = (p->key_tx.key_size > 0) && proto != RIST_GRE_PROTOCOL_TYPE_EAPOL;
 
 	/* Our encryption and compression operations directly modify the payload buffer we receive as a pointer
@@ -52,6 +113,19 @@ ssize_t _librist_proto_gre_send_data(struct rist_peer *p, uint8_t payload_type,
 		{
 			hdr->flags2 |= (1 & 1UL) << 6;
 		}
+		//Reserved bit 7 tells the receiver to use ChaCha20 instead of AES-CTR,
+		//legacy GRE versions have no way to carry it so refuse to send
+		if (key_peer->key_tx.cipher == RIST_CIPHER_CHACHA20) {
+			if (!gre_version) {
+				uint64_t now = timestampNTP_u64();
+				if (now > (p->log_repeat_timer + RIST_LOG_QUIESCE_TIMER)) {
+					rist_log_priv(get_cctx(p), RIST_LOG_ERROR, "Peer does not support ChaCha20 encryption, configure cipher=aes\n");
+					p->log_repeat_timer = now;
+				}
+				return -1;
+			}
+			SET_BIT(hdr->flags2, 7);
+		}
 	}
 	//VSF TR-06-02:_2022-08-11 wants us to send a sequence if we're capable of sending non-RIST traffic
 	//For now default to always considering us capable to do that.
@@ -92,14 +166,19 @@ ssize_t _librist_proto_gre_send_data(struct rist_peer *p, uint8_t payload_type,
 		red->src_port = htobe16(src_port);
 	}
 
+	struct rist_wire_image *image = NULL;
+	struct rist_key *key = NULL;
+	size_t rtp_offset = 0;
 	if (encrypt) {
 		if (modifying_payload || (hdr_payload_offset != hdr_len && !HAVE_MBEDTLS)) {
-			payload_wr = malloc(payload_len + 8);//Let's get rid of this malloc in the hotpath here
+			// The encrypted copy doubles as the wire image of the buffer
+			if (wire && modifying_payload && proto == RIST_GRE_PROTOCOL_TYPE_REDUCED)
+				image = malloc(sizeof(*image) + payload_len + 8);
+			payload_wr = image ? image->payload : malloc(payload_len + 8);//Let's get rid of this malloc in the hotpath here
 			modifying_payload = true;
 			assert(payload_wr);
 		}
 		pthread_mutex_lock(&key_peer->peer_lock);
-		struct rist_key *key = &key_peer->key_tx;
 
 #if HAVE_SRP_SUPPORT
         if (librist_peer_should_rollover_passphrase(key_peer)) {
@@ -108,8 +187,7 @@ ssize_t _librist_proto_gre_send_data(struct rist_peer *p, uint8_t payload_type,
 		}
 #endif
 
-		if (key_peer->key_tx_odd_active)
-			key = &p->key_tx_odd;
+		key = gre_tx_key(p, key_peer);
 
 		//Data that should be encrypted is part of the header
 		if (hdr_payload_offset != hdr_len) {
@@ -120,6 +198,7 @@ ssize_t _librist_proto_gre_send_data(struct rist_peer *p, uint8_t payload_type,
 #else
 			memcpy(payload_wr, &hdr_buf[hdr_payload_offset], hdr_len - hdr_payload_offset);
 			memcpy(&payload_wr[hdr_len - hdr_payload_offset], payload, payload_len);
+			rtp_offset = hdr_len - hdr_payload_offset;
 			payload_len += (hdr_len - hdr_payload_offset);
 			hdr_len -= (hdr_len - hdr_payload_offset);
 			_librist_crypto_psk_encrypt(key, htobe32(seq), gre_version, payload_wr, payload_wr, payload_len);
@@ -134,59 +213,58 @@ ssize_t _librist_proto_gre_send_data(struct rist_peer *p, uint8_t payload_type,
 		memcpy(&hdr_buf[nonce_offset], key->gre_nonce, sizeof(p->key_tx.gre_nonce));
 	}
 
-	ssize_t ret;
-	int errorcode = 0;
+	// Striped peers rotate their source port with the GRE sequence
+	int sd = p->stripe_count > 1 ? p->stripe_sd[seq % p->stripe_count] : p->sd;
+	ssize_t ret = gre_sendmsg(p, sd, hdr_buf, hdr_len, payload_wr, payload_len);
 
-	//TODO: abstract this away
-#ifndef _WIN32
-	//TODO: this is POSIX only: add windows equivalent
-	struct msghdr msghdr;
-	struct iovec iov[2];
-	iov[0].iov_base = hdr_buf;
-	iov[0].iov_len = hdr_len;
-	iov[1].iov_base = payload_wr;
-	iov[1].iov_len = payload_len;
-	msghdr.msg_iov = iov;
-	msghdr.msg_iovlen = 2;
-	msghdr.msg_name = &p->u.address;
-	msghdr.msg_namelen = p->address_len;
-	msghdr.msg_control = NULL;
-	msghdr.msg_controllen = 0;
-	msghdr.msg_flags = 0;
-	ret = sendmsg(p->sd, &msghdr, MSG_DONTWAIT);
-	if (RIST_UNLIKELY(ret < 0)) {
-		errorcode = errno;
+	if (image) {
+		image->peer = p;
+		image->key = key;
+		memcpy(image->gre_nonce, key->gre_nonce, sizeof(image->gre_nonce));
+		image->gre_seq = seq;
+		image->flow_id = p->adv_flow_id;
+		image->ssrc_lsb_offset = rtp_offset + offsetof(struct rist_rtp_hdr, ssrc) + 3;
+		image->retry = CHECK_BIT(payload[offsetof(struct rist_rtp_hdr, ssrc) + 3], 0);
+		image->hdr_len = hdr_len;
+		memcpy(image->hdr, hdr_buf, hdr_len);
+		image->payload_len = payload_len;
+		free(*wire);
+		*wire = image;
+	} else if (modifying_payload) {
+		free(payload_wr);
 	}
-#else
-	WSAMSG msghdr = { 0 };
-	WSABUF iov[2];
-	DWORD dwBytes = 0;
-	iov[0].len = hdr_len;
-	iov[0].buf = (char *)hdr_buf;
-	iov[1].len = payload_len;
-	iov[1].buf = (char *)payload_wr;
-	msghdr.name = (struct sockaddr *)&p->u.address;
-	msghdr.namelen = p->address_len;
-	msghdr.lpBuffers = iov;
-	msghdr.dwBufferCount = 2;
 
-	ret = payload_len + hdr_len;
-	if (RIST_UNLIKELY(WSASendMsg(p->sd, &msghdr, MSG_DONTWAIT, &dwBytes, NULL, NULL) != 0)) {
-		ret = -1;
-		errorcode = WSAGetLastError();
-	}
-#endif
+	return ret;
+}
 
-	if (modifying_payload) {
-		free(payload_wr);
-	}
+ssize_t _librist_proto_gre_send_data(struct rist_peer *p, uint8_t payload_type, uint16_t proto, uint8_t *payload, size_t payload_len, uint16_t src_port, uint16_t dst_port, uint8_t gre_version)
+{
+	return _librist_proto_gre_send_data_wire(p, payload_type, proto, payload, payload_len, src_port, dst_port, gre_version, NULL);
+}
 
-	if (RIST_UNLIKELY(errorcode)) {
-        struct rist_common_ctx *ctx = get_cctx(p);
-        rist_log_priv(ctx, RIST_LOG_ERROR, "Send failed: errno=%d, reason=%s, ret=%d, socket=%d\n", errorcode, strerror(errorcode), ret, p->sd);
-	}
+bool _librist_proto_gre_wire_valid(struct rist_peer *p, const struct rist_wire_image *wire)
+{
+	if (wire->peer != p || wire->flow_id != p->adv_flow_id)
+		return false;
+	struct rist_peer *key_peer = p;
+	if (key_peer->parent != NULL && key_peer->parent->multicast_sender)
+		key_peer = key_peer->parent;
+	// A key rotation or a new passphrase changes the nonce
+	pthread_mutex_lock(&key_peer->peer_lock);
+	const struct rist_key *key = gre_tx_key(p, key_peer);
+	bool valid = key == wire->key && key->key_size > 0 && memcmp(key->gre_nonce, wire->gre_nonce, sizeof(wire->gre_nonce)) == 0;
+	pthread_mutex_unlock(&key_peer->peer_lock);
+	return valid;
+}
 
-	return ret;
+ssize_t _librist_proto_gre_send_wire(struct rist_peer *p, struct rist_wire_image *wire, bool retry)
+{
+	if (wire->retry != retry) {
+		wire->payload[wire->ssrc_lsb_offset] ^= 0x01;
+		wire->retry = retry;
+	}
+	int sd = p->stripe_count > 1 ? p->stripe_sd[wire->gre_seq % p->stripe_count] : p->sd;
+	return gre_sendmsg(p, sd, wire->hdr, wire->hdr_len, wire->payload, wire->payload_len);
 }
 
 void _librist_proto_gre_send_keepalive(struct rist_peer *p, uint8_t gre_version) {
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "rist-private.h"
+#include "gre.h"
 
 struct rist_keepalive_info {
   	struct rist_keepalive_data ka;
@@ -12,7 +13,28 @@ struct rist_keepalive_info {
 	const char *json;
 };
 
+/* Encrypted datagram of a sender buffer as it was last sent, retransmissions
+ * to the same peer with the same key only flip the retransmit bit of the
+ * SSRC (a stream cipher keeps the bit position) instead of encrypting again */
+struct rist_wire_image {
+	struct rist_peer *peer;
+	const struct rist_key *key;
+	uint8_t gre_nonce[4];
+	uint32_t gre_seq;
+	uint32_t flow_id;
+	bool retry;
+	size_t ssrc_lsb_offset;
+	size_t hdr_len;
+	uint8_t hdr[MAX_GRE_SIZE];
+	size_t payload_len;
+	uint8_t payload[];
+};
+
 RIST_PRIV ssize_t _librist_proto_gre_send_data(struct rist_peer *p, uint8_t payload_type, uint16_t proto, uint8_t *payload, size_t payload_len, uint16_t src_port, uint16_t dst_port, uint8_t gre_version);
+/* Same as _librist_proto_gre_send_data, encrypted data packets are kept in *wire */
+RIST_PRIV ssize_t _librist_proto_gre_send_data_wire(struct rist_peer *p, uint8_t payload_type, uint16_t proto, uint8_t *payload, size_t payload_len, uint16_t src_port, uint16_t dst_port, uint8_t gre_version, struct rist_wire_image **wire);
+RIST_PRIV bool _librist_proto_gre_wire_valid(struct rist_peer *p, const struct rist_wire_image *wire);
+RIST_PRIV ssize_t _librist_proto_gre_send_wire(struct rist_peer *p, struct rist_wire_image *wire, bool retry);
 RIST_PRIV void _librist_proto_gre_send_keepalive(struct rist_peer *p, uint8_t gre_version);
 RIST_PRIV int _librist_proto_gre_parse_keepalive(const uint8_t buf[], size_t buflen, struct rist_keepalive_info  *info);
 RIST_PRIV void _librist_proto_gre_send_buffer_negotiation(struct rist_peer *p, uint16_t sender_max_buffer, uint16_t receiver_current_buffer);
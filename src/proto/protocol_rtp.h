@@ -12,4 +12,5 @@ void rist_rtcp_write_sdes(uint8_t *buf, int *offset, const char *name, const uin
 void rist_rtcp_write_echoreq(uint8_t *buf, int *offset, const uint32_t flow_id);
 void rist_rtcp_write_echoresp(uint8_t *buf, int *offset, const uint64_t request_time, const uint32_t flow_id);
 void rist_rtcp_write_xr_echoreq(uint8_t *buf, int *offset, struct rist_peer *peer) ;
+void rist_rtcp_write_xr_ecn(uint8_t *buf, int *offset, const uint32_t flow_id, const struct rist_ecn_counters *ecn);
 #endif /* RIST_PROTO_PROTOCOL_RTP_H */
@@ -127,7 +127,7 @@ void rist_rtcp_write_xr_echoreq(uint8_t *buf, int *offset,
   struct rist_rtcp_xr_rrtrb *block =
       (struct rist_rtcp_xr_rrtrb *)(buf + RIST_MAX_PAYLOAD_OFFSET + *offset);
   *offset += sizeof(*block);
-  block->block_type = 4;
+  block->block_type = RTCP_XR_BT_RRTR;
   block->length = htobe16(2);
   block->reserved = 0;
   uint64_t now = timestampNTP_u64();
@@ -136,3 +136,28 @@ void rist_rtcp_write_xr_echoreq(uint8_t *buf, int *offset,
   block->ntp_lsw = htobe32((uint32_t)(now & 0x000000000FFFFFFFF));
   xr_hdr->len = htobe16(1 + sizeof(*block) / 4);
 }
+
+void rist_rtcp_write_xr_ecn(uint8_t *buf, int *offset, const uint32_t flow_id,
+                                          const struct rist_ecn_counters *ecn) {
+  struct rist_rtcp_hdr *xr_hdr =
+      (struct rist_rtcp_hdr *)(buf + RIST_MAX_PAYLOAD_OFFSET + *offset);
+  *offset += sizeof(*xr_hdr);
+  xr_hdr->flags = 0x80; // v=2;p=0;
+  xr_hdr->ptype = PTYPE_XR;
+  xr_hdr->ssrc = htobe32(flow_id);
+  struct rist_rtcp_xr_ecn *block =
+      (struct rist_rtcp_xr_ecn *)(buf + RIST_MAX_PAYLOAD_OFFSET + *offset);
+  *offset += sizeof(*block);
+  block->block_type = RTCP_XR_BT_ECN_SUMMARY;
+  block->reserved = 0;
+  block->length = htobe16(sizeof(*block) / 4 - 1);
+  block->ssrc = htobe32(flow_id);
+  block->ect0 = htobe32(ecn->ect0);
+  block->ect1 = htobe32(ecn->ect1);
+  block->ce = htobe16((uint16_t)ecn->ce);
+  block->not_ect = htobe16((uint16_t)ecn->not_ect);
+  /* loss and duplicates are reported through nacks and flow stats */
+  block->lost = 0;
+  block->duplicates = 0;
+  xr_hdr->len = htobe16(1 + sizeof(*block) / 4);
+}
@@ -95,6 +95,15 @@ RTCP Control Channel:
 
 #define ECHO_REQUEST 2
 #define ECHO_RESPONSE 3
+/* Header only APP packet (name "RIST") ahead of the nack in a compound
+ * packet: its sequence numbers are early re-nacks. Senders that do not know
+ * the subtype skip it and handle the nack as any other */
+#define NACK_FMT_EARLY 4
+
+// RTCP XR block types
+#define RTCP_XR_BT_RRTR 4
+#define RTCP_XR_BT_DLRR 5
+#define RTCP_XR_BT_ECN_SUMMARY 13
 
 #define RTCP_SDES_SIZE 10
 #define RTP_MPEGTS_FLAGS 0x80
@@ -104,6 +113,7 @@ RTCP Control Channel:
 #define RTCP_NACK_RANGE_FLAGS 0x80
 #define RTCP_NACK_BITMASK_FLAGS 0x81
 #define RTCP_NACK_SEQEXT_FLAGS 0x81
+#define RTCP_NACK_EARLY_FLAGS 0x84
 #define RTCP_ECHOEXT_REQ_FLAGS 0x82
 #define RTCP_ECHOEXT_RESP_FLAGS 0x83
 
@@ -131,6 +141,21 @@ RIST_PACKED_STRUCT(rist_rtp_hdr_ext, {
 	uint16_t seq_ext;
 })
 
+/* rist_rtp_hdr_ext flags: bit 7 NPD, bit 6 TS stuffing, bits 5 to 3 mark the
+ * fragments of a frame written with rist_sender_data_write_frame, bit 2 marks
+ * the first packets after the sender (re)started */
+#define RIST_RTP_EXT_FRAGMENT (1 << 5)
+#define RIST_RTP_EXT_FRAGMENT_FIRST (1 << 4)
+#define RIST_RTP_EXT_FRAGMENT_LAST (1 << 3)
+#define RIST_RTP_EXT_FRAGMENT_MASK (RIST_RTP_EXT_FRAGMENT | RIST_RTP_EXT_FRAGMENT_FIRST | RIST_RTP_EXT_FRAGMENT_LAST)
+#define RIST_RTP_EXT_RESTART (1 << 2)
+
+/* Follows rist_rtp_hdr_ext when flags bit 6 is set (length = 3): number of
+ * adaptation field stuffing bytes removed from each transmitted TS packet */
+RIST_PACKED_STRUCT(rist_rtp_hdr_ext_stuffing, {
+	uint8_t len[8];
+})
+
 RIST_PACKED_STRUCT(rist_protocol_hdr,{
 	uint16_t src_port;
 	uint16_t dst_port;
@@ -240,6 +265,19 @@ RIST_PACKED_STRUCT(rist_rtcp_xr_dlrr, {
 	uint32_t lrr;
 	uint32_t delay;
 })
+//ECN summary report block (RFC 6679), counters are cumulative
+RIST_PACKED_STRUCT(rist_rtcp_xr_ecn, {
+	uint8_t block_type;
+	uint8_t reserved;
+	uint16_t length;
+	uint32_t ssrc;
+	uint32_t ect0;
+	uint32_t ect1;
+	uint16_t ce;
+	uint16_t not_ect;
+	uint16_t lost;
+	uint16_t duplicates;
+})
 
 static inline uint32_t get_rtp_ts_clock(uint8_t ptype) {
 	uint32_t clock = 0;
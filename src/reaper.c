@@ -0,0 +1,103 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "reaper.h"
+
+int rist_reaper_init(struct rist_reaper *r, struct rist_epoch *epoch)
+{
+	r->jobs = NULL;
+	r->jobs_tail = &r->jobs;
+	r->epoch = epoch;
+	r->running = false;
+	r->stop = false;
+	atomic_init(&r->pending_bytes, 0);
+	atomic_init(&r->pending, 0);
+	if (pthread_mutex_init(&r->lock, NULL) != 0)
+		return -1;
+	if (pthread_cond_init(&r->condition, NULL) != 0) {
+		pthread_mutex_destroy(&r->lock);
+		return -1;
+	}
+	return 0;
+}
+
+static void reaper_run(struct rist_reaper *r, struct rist_reaper_job *jobs)
+{
+	if (!jobs)
+		return;
+	/* one grace period covers the whole batch */
+	rist_epoch_synchronize(r->epoch);
+	while (jobs) {
+		/* the job goes with the object it reaps */
+		struct rist_reaper_job *next = jobs->next;
+		size_t bytes = jobs->bytes;
+		jobs->reap(jobs->ptr);
+		atomic_fetch_sub_explicit(&r->pending_bytes, bytes, memory_order_relaxed);
+		atomic_fetch_sub_explicit(&r->pending, 1, memory_order_release);
+		jobs = next;
+	}
+}
+
+static struct rist_reaper_job *reaper_take(struct rist_reaper *r)
+{
+	struct rist_reaper_job *jobs = r->jobs;
+	r->jobs = NULL;
+	r->jobs_tail = &r->jobs;
+	return jobs;
+}
+
+PTHREAD_START_FUNC(rist_reaper_thread, arg)
+{
+	struct rist_reaper *r = arg;
+	pthread_mutex_lock(&r->lock);
+	while (!r->stop) {
+		if (!r->jobs) {
+			pthread_cond_wait(&r->condition, &r->lock);
+			continue;
+		}
+		struct rist_reaper_job *jobs = reaper_take(r);
+		pthread_mutex_unlock(&r->lock);
+		reaper_run(r, jobs);
+		pthread_mutex_lock(&r->lock);
+	}
+	pthread_mutex_unlock(&r->lock);
+	return 0;
+}
+
+void rist_reaper_defer(struct rist_reaper *r, struct rist_reaper_job *job, void *ptr, void (*reap)(void *ptr), size_t bytes)
+{
+	if (!r->running) {
+		rist_epoch_synchronize(r->epoch);
+		reap(ptr);
+		return;
+	}
+	job->ptr = ptr;
+	job->reap = reap;
+	job->bytes = bytes;
+	job->next = NULL;
+	atomic_fetch_add_explicit(&r->pending_bytes, bytes, memory_order_relaxed);
+	atomic_fetch_add_explicit(&r->pending, 1, memory_order_relaxed);
+	pthread_mutex_lock(&r->lock);
+	*r->jobs_tail = job;
+	r->jobs_tail = &job->next;
+	pthread_cond_signal(&r->condition);
+	pthread_mutex_unlock(&r->lock);
+}
+
+void rist_reaper_destroy(struct rist_reaper *r)
+{
+	if (r->running) {
+		pthread_mutex_lock(&r->lock);
+		r->stop = true;
+		pthread_cond_signal(&r->condition);
+		pthread_mutex_unlock(&r->lock);
+		pthread_join(r->thread, NULL);
+		r->running = false;
+	}
+	reaper_run(r, reaper_take(r));
+	pthread_cond_destroy(&r->condition);
+	pthread_mutex_destroy(&r->lock);
+}
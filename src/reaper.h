@@ -0,0 +1,62 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_REAPER_H
+#define RIST_REAPER_H
+
+#include "common/attributes.h"
+#include "pthread-shim.h"
+#include "epoch.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Deferred teardown of unlinked flows and peers.
+ *
+ * The protocol thread or an API call only unlinks a flow or peer and hands it
+ * over with rist_reaper_defer(), the job record is embedded in the object.
+ * The reaper thread collects the handed over objects in batches, waits for a
+ * single epoch grace period per batch and then runs their reap function
+ * (socket closes, thread joins, queue draining, frees). Handing over never
+ * allocates or waits while the thread runs, it may be done from an epoch read
+ * section or with peerlist_lock held. With no reaper thread (before start,
+ * after destroy) rist_reaper_defer() waits for the grace period and reaps
+ * inline.
+ */
+
+struct rist_reaper_job {
+	void *ptr;
+	void (*reap)(void *ptr);
+	size_t bytes;
+	struct rist_reaper_job *next;
+};
+
+struct rist_reaper {
+	pthread_mutex_t lock;
+	pthread_cond_t condition;
+	struct rist_reaper_job *jobs;
+	struct rist_reaper_job **jobs_tail;
+	struct rist_epoch *epoch;
+	pthread_t thread;
+	/* set once the thread is created, before anything is deferred */
+	bool running;
+	bool stop;
+	/* memory held by unlinked objects waiting for the reaper */
+	atomic_size_t pending_bytes;
+	atomic_size_t pending;
+};
+
+RIST_PRIV int rist_reaper_init(struct rist_reaper *r, struct rist_epoch *epoch);
+/* Thread function, started by the owner with r as argument */
+RIST_PRIV PTHREAD_START_FUNC(rist_reaper_thread, arg);
+/* ptr must already be unreachable for new epoch readers, job lives in ptr and
+ * must not be touched by reap after it freed ptr */
+RIST_PRIV void rist_reaper_defer(struct rist_reaper *r, struct rist_reaper_job *job, void *ptr, void (*reap)(void *ptr), size_t bytes);
+/* Stops the thread and reaps whatever is still pending */
+RIST_PRIV void rist_reaper_destroy(struct rist_reaper *r);
+
+#endif
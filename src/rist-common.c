@@ -28,16 +28,21 @@
 #include "config.h"
 #include "rist-thread.h"
 #include "peer.h"
+#include "path_policy.h"
 #include <stdbool.h>
 #include "stdio-shim.h"
 #include <assert.h>
 
 
 static void rist_peer_recv(struct evsocket_ctx *evctx, int fd, short revents, void *arg, bool *again);
+static void rist_peer_recv_packet(struct rist_peer *peer, uint8_t *recv_buf, size_t recv_bufsize, struct sockaddr *addr, socklen_t addrlen, uint64_t now, uint8_t ecn);
 static void rist_peer_recv_wrap(struct evsocket_ctx *evctx, int fd, short revents, void *arg);
 static void rist_peer_sockerr(struct evsocket_ctx *evctx, int fd, short revents, void *arg);
+static void rist_shared_socket_recv_wrap(struct evsocket_ctx *evctx, int fd, short revents, void *arg);
+static void rist_shared_socket_sockerr(struct evsocket_ctx *evctx, int fd, short revents, void *arg);
 static PTHREAD_START_FUNC(receiver_pthread_dataout,arg);
 static void store_peer_settings(const struct rist_peer_config *settings, struct rist_peer *peer);
+static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f);
 static struct rist_peer *peer_initialize(const char *url, struct rist_sender *sender_ctx,
 										struct rist_receiver *receiver_ctx);
 void remove_peer_from_flow(struct rist_peer *peer);
@@ -237,6 +242,33 @@ int parse_url_options(const char* url, struct rist_peer_config *output_peer_conf
 				int temp = atoi( val );
 				if (temp > 0)
 					output_peer_config->max_retries = temp;
+			} else if (output_peer_config->version >= 1 && strcmp( url_params[i].key, RIST_URL_PARAM_MULTICAST_SHARED ) == 0) {
+				int temp = atoi( val );
+				if (temp >= 0)
+					output_peer_config->multicast_shared = temp;
+			} else if (output_peer_config->version >= 1 && strcmp( url_params[i].key, RIST_URL_PARAM_MULTICAST_SOURCE ) == 0) {
+				strncpy((void *)output_peer_config->multicast_source, val, 128-1);
+			} else if (output_peer_config->version >= 1 && strcmp( url_params[i].key, RIST_URL_PARAM_ECN ) == 0) {
+				int temp = atoi( val );
+				if (temp >= 0)
+					output_peer_config->ecn = temp;
+			} else if (output_peer_config->version >= 1 && strcmp( url_params[i].key, RIST_URL_PARAM_STRIPE_PORTS ) == 0) {
+				int temp = atoi( val );
+				if (temp >= 0)
+					output_peer_config->stripe_ports = temp;
+			} else if (output_peer_config->version >= 1 && strcmp( url_params[i].key, RIST_URL_PARAM_FLOW_WEIGHT ) == 0) {
+				int temp = atoi( val );
+				if (temp >= 0)
+					output_peer_config->flow_weight = temp;
+			} else if (output_peer_config->version >= 1 && strcmp( url_params[i].key, RIST_URL_PARAM_CIPHER ) == 0) {
+				if (strcmp(val, "chacha20") == 0)
+					output_peer_config->cipher = RIST_CIPHER_CHACHA20;
+				else if (strcmp(val, "aes") == 0)
+					output_peer_config->cipher = RIST_CIPHER_AES;
+				else {
+					ret = -1;
+					fprintf(stderr, "Unknown cipher %s\n", val);
+				}
 			} else {
 				ret = -1;
 				fprintf(stderr, "Unknown or invalid parameter %s\n", url_params[i].key);
@@ -370,12 +402,16 @@ struct rist_buffer *rist_new_buffer(struct rist_common_ctx *ctx, const void *buf
 	b->transmit_count = 0;
 	b->use_seq = 0;
 	b->retry_queued = false;
+	b->frame_flags = 0;
+	b->wire = NULL;
+	b->cold = false;
 	return b;
 }
 
 void free_rist_buffer(struct rist_common_ctx *ctx, struct rist_buffer *b)
 {
 	RIST_MARK_UNUSED(ctx);
+	free(b->wire);
 	free(b->data);
 	free(b);
 
@@ -416,7 +452,7 @@ static uint64_t receiver_calculate_packet_time(struct rist_flow *f, const uint64
 	return packet_time;
 }
 
-static int receiver_insert_queue_packet(struct rist_flow *f, struct rist_peer *peer, size_t idx, const void *buf, size_t len, uint32_t seq, uint64_t source_time, uint16_t src_port, uint16_t dst_port, uint64_t packet_time)
+static int receiver_insert_queue_packet(struct rist_flow *f, struct rist_peer *peer, size_t idx, const void *buf, size_t len, uint32_t seq, uint64_t source_time, uint16_t src_port, uint16_t dst_port, uint64_t packet_time, uint8_t frame_flags)
 {
 	/*
 	   rist_log_priv(get_cctx(peer), RIST_LOG_INFO,
@@ -429,6 +465,7 @@ static int receiver_insert_queue_packet(struct rist_flow *f, struct rist_peer *p
 		return -1;
 	}
 	f->receiver_queue[idx]->peer = peer;
+	f->receiver_queue[idx]->frame_flags = frame_flags;
 	f->receiver_queue[idx]->packet_time = packet_time;
 	f->receiver_queue[idx]->target_output_time = packet_time + f->recovery_buffer_ticks;
 	atomic_fetch_add_explicit(&f->receiver_queue_size, len, memory_order_release);
@@ -513,7 +550,254 @@ static void recalculate_clock_offset(struct rist_flow *flow)
 }
 
 
-static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64_t packet_recv_time, const void *buf, size_t len, uint32_t seq, uint64_t rtt, bool retry, uint16_t src_port, uint16_t dst_port, uint8_t payload_type)
+static void receiver_count_late(struct rist_common_ctx *cctx, struct rist_flow *f)
+{
+	pthread_mutex_lock(&cctx->stats_lock);
+	f->stats_instant.dropped_late++;
+	if (f->stats_instant.dropped_late > 5 * f->stats_instant.received)
+		f->receiver_queue_has_items = false;
+	if ((f->stats_instant.dropped_late > (f->stats_instant.received * 5) && f->stats_instant.received > 100) ||
+		(f->stats_instant.dropped_late > 100 && f->stats_instant.received == 0)) {
+			rist_log_priv(cctx, RIST_LOG_ERROR, "Too many late packets received, resetting flow");
+			f->receiver_queue_has_items = false;
+	}
+	pthread_mutex_unlock(&cctx->stats_lock);
+}
+
+static inline int32_t receiver_seq_delta(const struct rist_flow *f, uint32_t a, uint32_t b)
+{
+	if (f->short_seq)
+		return (int16_t)(uint16_t)(a - b);
+	return (int32_t)(a - b);
+}
+
+/* The source clock of the packet is more than twice the recovery buffer behind
+ * the newest packet of the flow. Wraps of the RTP timestamp are left to
+ * receiver_calculate_packet_time. */
+static bool receiver_source_time_jumped_back(const struct rist_flow *f, uint64_t source_time)
+{
+	if (source_time >= f->max_source_time)
+		return false;
+	uint64_t back = f->max_source_time - source_time;
+	return back > 2 * f->recovery_buffer_ticks && back < (uint64_t)(10LL * 3600LL * 1000LL * RIST_CLOCK);
+}
+
+/* Decides whether a (non retry) data packet starts a new sequence/timestamp
+ * space. Returns 1 when the flow has to be rebased on it, -1 when it does not
+ * fit the current space but the discontinuity is not confirmed yet (the packet
+ * is dropped) and 0 otherwise. A restart marker is trusted right away, the
+ * heuristics need RIST_RESYNC_CONFIRM_PACKETS consecutive packets so that
+ * stragglers of a lagging path do not reset a healthy flow. */
+static int receiver_check_discontinuity(struct rist_flow *f, uint32_t seq, uint64_t source_time, uint64_t now, bool marked, bool arrival_timing, const char **reason)
+{
+	if (f->resync_marked && !marked) {
+		int32_t since = receiver_seq_delta(f, seq, f->resync_seq);
+		if (since >= 2 * RIST_RESTART_MARKER_PACKETS && since < 0x4000)
+			f->resync_marked = false;
+	}
+	if (marked && !f->resync_marked) {
+		*reason = "sender restart";
+		return 1;
+	}
+	if (f->rtc_timing_mode || arrival_timing)
+		return 0;
+
+	bool foreign;
+	if (source_time > f->max_source_time) {
+		int32_t span = receiver_seq_delta(f, f->last_seq_found, f->last_seq_output);
+		if (span < 0)
+			span = 0;
+		if (receiver_seq_delta(f, seq, f->last_seq_found) < -(span + 1)) {
+			/* behind the output point, yet newer than anything received */
+			*reason = "sequence restarted";
+			foreign = true;
+		} else if (source_time + f->time_offset > now + 2 * f->recovery_buffer_ticks &&
+				(now - f->time_offset_changed_ts) > 3 * f->recovery_buffer_ticks) {
+			*reason = "source clock jumped ahead";
+			foreign = true;
+		} else
+			foreign = false;
+	} else {
+		*reason = "source clock jumped back";
+		foreign = receiver_source_time_jumped_back(f, source_time);
+	}
+	if (!foreign) {
+		f->resync_candidates = 0;
+		return 0;
+	}
+
+	if (f->resync_candidates > 0) {
+		int32_t step = receiver_seq_delta(f, seq, f->resync_candidate_seq);
+		if (step < 1 || step > 4 * RIST_RESYNC_CONFIRM_PACKETS || source_time < f->resync_candidate_time)
+			f->resync_candidates = 0;
+	}
+	f->resync_candidates++;
+	f->resync_candidate_seq = seq;
+	f->resync_candidate_time = source_time;
+	if (f->resync_candidates < RIST_RESYNC_CONFIRM_PACKETS)
+		return -1;
+	return 1;
+}
+
+/* Makes the next packet rebase the flow (first packet path of receiver_enqueue),
+ * which discards the queued data and the missing queue of the old space. With
+ * RIST_RESYNC_POLICY_DRAIN the queued data is handed to the dataout thread
+ * first, which resets the flow once it is out. */
+static void receiver_flow_resync(struct rist_receiver *ctx, struct rist_flow *f, const char *reason)
+{
+	rist_log_priv(&ctx->common, RIST_LOG_NOTICE, "Discontinuity on flow %"PRIu32" (%s), resynchronizing\n", f->flow_id, reason);
+	f->resync_candidates = 0;
+	f->resyncs++;
+	if (ctx->resync_policy == RIST_RESYNC_POLICY_DRAIN && atomic_load_explicit(&f->receiver_queue_size, memory_order_acquire) > 0) {
+		atomic_store_explicit(&f->resync_draining, true, memory_order_release);
+		if (pthread_cond_signal(&f->condition))
+			rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Call to pthread_cond_signal failed.\n");
+		return;
+	}
+	f->receiver_queue_has_items = false;
+}
+
+/* Cheap check on the RTP header of a data packet, done before the payload is
+ * decrypted, expanded or handed to receiver_enqueue. Returns true (and accounts
+ * the packet) when its flow is shed, when it is a duplicate of a queued packet
+ * or when its slot has already been output and it is past its deadline. Anything not clear-cut is
+ * left to receiver_enqueue, which also handles flow id changes. */
+static bool receiver_early_reject(struct rist_peer *peer, const struct rist_rtp_hdr *rtp, uint64_t now)
+{
+	struct rist_flow *f = peer->flow;
+	if (!peer->receiver_mode || !peer->authenticated || !f || !f->authenticated)
+		return false;
+	if ((rtp->flags & 0xc0) != 0x80 || rtp->payload_type >= 200)
+		return false;
+	uint32_t flow_id = be32toh(rtp->ssrc) & ~1UL;
+	if (flow_id != f->flow_id && flow_id != f->flow_id_actual)
+		return false;
+	if (RIST_UNLIKELY(f->overload_shed)) {
+		pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
+		f->stats_instant.overload_shed++;
+		pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
+		return true;
+	}
+	if (!f->receiver_queue_has_items)
+		return false;
+	if (RIST_UNLIKELY(f->rtc_timing_mode || peer->config.timing_mode == RIST_TIMING_MODE_ARRIVAL))
+		return false;
+	//The RTP header only carries the low 16 bits, a queue slot of an extended
+	//sequence flow can't be matched on those
+	if (!f->short_seq)
+		return false;
+
+	uint32_t seq = be16toh(rtp->seq);
+	uint64_t source_time = convertRTPtoNTP(rtp->payload_type, 0, be32toh(rtp->ts));
+	size_t idx = seq & (f->receiver_queue_max - 1);
+	struct rist_buffer *b = f->receiver_queue[idx];
+	if (b && b->seq == seq && b->source_time == source_time) {
+		pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
+		f->stats_instant.dupe++;
+		pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
+		return true;
+	}
+	if (b == NULL && (uint16_t)(f->last_seq_output - seq) < 0x8000) {
+		uint64_t packet_time = source_time + f->time_offset;
+		if (packet_time < f->last_packet_ts && now > (packet_time + (f->recovery_buffer_ticks *1.1)) &&
+				!receiver_source_time_jumped_back(f, source_time)) {
+			receiver_count_late(get_cctx(peer), f);
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Cut-through relay: a packet stored for the first time (original or
+ * repair) goes to the downstream sender right away, keeping its sequence
+ * number and source time. Only one flow is relayed, the first one that
+ * delivers data, until it is deleted. The data of the others is only output
+ * locally. */
+static void receiver_relay_forward(struct rist_receiver *ctx, struct rist_flow *f, const void *buf, size_t len, uint32_t seq, uint64_t source_time)
+{
+	struct rist_sender *sender = ctx->relay_sender;
+	if (RIST_LIKELY(!sender))
+		return;
+	if (!ctx->relay_flow)
+		ctx->relay_flow = f;
+	else if (ctx->relay_flow != f) {
+		if (!f->relay_ignored) {
+			f->relay_ignored = true;
+			rist_log_priv(&ctx->common, RIST_LOG_WARN, "Flow %"PRIu32" is not relayed, the relay carries flow %"PRIu32"\n",
+					f->flow_id, ctx->relay_flow->flow_id);
+		}
+		return;
+	}
+	/* virtual ports 0: the downstream peer configuration applies */
+	if (rist_sender_enqueue(sender, buf, len, source_time, 0, 0, seq) != 0)
+		return;
+	pthread_cond_signal(&sender->condition);
+	pthread_mutex_lock(&ctx->common.stats_lock);
+	f->stats_instant.relay_forwarded++;
+	pthread_mutex_unlock(&ctx->common.stats_lock);
+}
+
+/* Cut-through relay: downstream asked the relay sender for packets it does
+ * not hold. Whatever the relay did not nack upstream yet (still inside the
+ * reorder wait) is nacked this round, repairs are forwarded on arrival. */
+static void receiver_relay_expedite(struct rist_receiver *ctx, struct rist_flow *f)
+{
+	struct rist_sender *sender = ctx->relay_sender;
+	size_t read = atomic_load_explicit(&sender->relay_request_read, memory_order_relaxed);
+	size_t write = atomic_load_explicit(&sender->relay_request_write, memory_order_acquire);
+	if (read == write)
+		return;
+	uint64_t now = timestampNTP_u64();
+	uint32_t expedited = 0;
+	for (; read != write; read = (read + 1) & (RIST_RELAY_REQUESTS - 1)) {
+		uint16_t seq = (uint16_t)sender->relay_requests[read];
+		for (struct rist_missing_buffer *m = f->missing; m; m = m->next) {
+			if ((uint16_t)m->seq != seq)
+				continue;
+			if (m->nack_count == 0 && m->next_nack > now) {
+				m->next_nack = now;
+				expedited++;
+			}
+			break;
+		}
+	}
+	atomic_store_explicit(&sender->relay_request_read, read, memory_order_release);
+	if (expedited) {
+		pthread_mutex_lock(&ctx->common.stats_lock);
+		f->stats_instant.relay_expedited += expedited;
+		pthread_mutex_unlock(&ctx->common.stats_lock);
+	}
+}
+
+/* Early re-nack: the repairs of a nack batch come back in order, so a repair
+ * arriving while lower sequence numbers of its batch are still missing means
+ * those retransmissions got lost. They are nacked again next round instead
+ * of after the retry timer. Not used while the data shows reordering. */
+static void receiver_repair_track(struct rist_flow *f, uint32_t seq, uint64_t now)
+{
+	if (f->reorder_time && now - f->reorder_time < f->recovery_buffer_ticks)
+		return;
+	/* the newest batch holding seq is the nack this repair answers */
+	for (size_t i = 1; i <= RIST_NACK_BATCHES; i++) {
+		struct rist_nack_batch *batch = &f->nack_batches[(f->nack_batch_write - i) & (RIST_NACK_BATCHES - 1)];
+		for (size_t j = batch->next; j < batch->count; j++) {
+			if (batch->seq[j] != seq)
+				continue;
+			for (size_t k = batch->next; k < j && f->renack_count < RIST_MAX_NACKS; k++) {
+				uint32_t gap = batch->seq[k];
+				/* bitmask nacks repair each 16 packet window in ascending order */
+				bool before = f->short_seq ? (int16_t)(uint16_t)(seq - gap) > 0 : (int32_t)(seq - gap) > 0;
+				struct rist_buffer *b = f->receiver_queue[gap & (f->receiver_queue_max - 1)];
+				if (before && (!b || b->seq != gap))
+					f->renack[f->renack_count++] = gap;
+			}
+			batch->next = j + 1;
+			return;
+		}
+	}
+}
+
+static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64_t packet_recv_time, const void *buf, size_t len, uint32_t seq, uint64_t rtt, bool retry, uint16_t src_port, uint16_t dst_port, uint8_t payload_type, uint8_t frame_flags)
 {
 	struct rist_flow *f = peer->flow;
 
@@ -528,6 +812,24 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 	//fprintf(stderr, "Offset would've been: %llu\n", now - source_time);
 	if (RIST_UNLIKELY((!f->receiver_queue_has_items && retry) || (f->rtc_timing_mode && f->time_offset == 0)))
 		return -1;
+	/* the old space is still being drained, the first packet after it rebases the flow */
+	if (RIST_UNLIKELY(atomic_load_explicit(&f->resync_draining, memory_order_acquire)))
+		return -1;
+	bool marked = frame_flags & RIST_RTP_EXT_RESTART;
+	if (f->receiver_queue_has_items && !retry && peer->receiver_ctx->resync_policy != RIST_RESYNC_POLICY_DISABLED) {
+		const char *reason = NULL;
+		int discontinuity = receiver_check_discontinuity(f, seq, source_time, now, marked,
+				peer->config.timing_mode == RIST_TIMING_MODE_ARRIVAL, &reason);
+		if (RIST_UNLIKELY(discontinuity < 0)) {
+			rist_log_priv(get_cctx(peer), RIST_LOG_DEBUG, "Packet %"PRIu32" does not fit the flow (%s), holding off\n", seq, reason);
+			return -1;
+		}
+		if (RIST_UNLIKELY(discontinuity > 0)) {
+			receiver_flow_resync(peer->receiver_ctx, f, reason);
+			if (atomic_load_explicit(&f->resync_draining, memory_order_acquire))
+				return -1;
+		}
+	}
 	if (RIST_UNLIKELY(!f->receiver_queue_has_items)) {
 		/* we just received our first packet for this flow */
 		pthread_mutex_lock(&f->mutex);
@@ -548,6 +850,11 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 		/* Calculate and store clock offset with respect to source */
 		if (!f->rtc_timing_mode)
 			f->time_offset = (int64_t)now_monotonic - (int64_t)source_time;
+		f->offset_recalc_sample_count = 0;
+		f->too_late_ctr = 0;
+		f->resync_candidates = 0;
+		f->resync_marked = marked;
+		f->resync_seq = seq;
 		/* This ensures the next packet does not trigger nacks */
 		f->last_seq_output = seq - 1;
 		f->last_seq_found = seq;
@@ -558,8 +865,9 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 				"Storing first packet seq %" PRIu32 ", idx %zu, %" PRIu64 ", offset %" PRId64 " ms, output_idx %zu\n",
 				seq, idx_initial, source_time, peer->flow->time_offset / RIST_CLOCK, idx_initial);
 		uint64_t packet_time = source_time + f->time_offset;
+		f->last_packet_ts = packet_time;
 
-		receiver_insert_queue_packet(f, peer, idx_initial, buf, len, seq, source_time, src_port, dst_port, packet_time);
+		receiver_insert_queue_packet(f, peer, idx_initial, buf, len, seq, source_time, src_port, dst_port, packet_time, frame_flags);
 		atomic_store_explicit(&f->receiver_queue_output_idx, idx_initial, memory_order_release);
 
 		/* reset stats */
@@ -568,6 +876,7 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 		pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
 		f->receiver_queue_has_items = true;
 		pthread_mutex_unlock(&f->mutex);
+		receiver_relay_forward(peer->receiver_ctx, f, buf, len, seq, source_time);
 		return 0; // not a dupe
 	}
 
@@ -622,16 +931,13 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 		if (now > (packet_time + (f->recovery_buffer_ticks *1.1)))
 		{
 			rist_log_priv(get_cctx(peer), RIST_LOG_DEBUG, "Packet %"PRIu32" too late, dropping!\n", seq);
-			pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
-			f->stats_instant.dropped_late++;
-                        if (f->stats_instant.dropped_late > 5 * f->stats_instant.received)
-                            f->receiver_queue_has_items = false;
-			if ((f->stats_instant.dropped_late > (f->stats_instant.received * 5) && f->stats_instant.received > 100) ||
-				(f->stats_instant.dropped_late > 100 && f->stats_instant.received == 0)) {
-					rist_log_priv(get_cctx(peer), RIST_LOG_ERROR, "Too many late packets received, resetting flow");
-					f->receiver_queue_has_items = false;
-			}
-			pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
+			receiver_count_late(get_cctx(peer), f);
+			return -1;
+		}
+		// The output is past it already, e.g. data from before the first packet
+		// of the flow replayed after authentication, its slot is not ours
+		if (receiver_seq_delta(f, seq, f->last_seq_output) <= 0) {
+			rist_log_priv(get_cctx(peer), RIST_LOG_DEBUG, "Packet %"PRIu32" is behind the output, dropping!\n", seq);
 			return -1;
 		}
 		if (!retry) {
@@ -677,7 +983,7 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 
 
 	/* Now, we insert the packet into receiver queue */
-	if (receiver_insert_queue_packet(f, peer, idx, buf, len, seq, source_time, src_port, dst_port, packet_time)) {
+	if (receiver_insert_queue_packet(f, peer, idx, buf, len, seq, source_time, src_port, dst_port, packet_time, frame_flags)) {
 		// only error is OOM, safe to exit here ...
 		return 0;
 	}
@@ -686,6 +992,11 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 		f->stats_instant.reordered++;
 	f->stats_instant.received++;
 	pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
+	if (out_of_order)
+		f->reorder_time = now_monotonic;
+	else if (retry && peer->receiver_ctx->early_renack)
+		receiver_repair_track(f, seq, now_monotonic);
+	receiver_relay_forward(peer->receiver_ctx, f, buf, len, seq, source_time);
 	// Check for missing data and queue retries
 	if (!retry) {
 		/* check for missing packets */
@@ -752,6 +1063,30 @@ static int rist_process_nack(struct rist_flow *f, struct rist_missing_buffer *b)
 			} else if (rtt > peer->config.recovery_rtt_max) {
 				rtt = peer->config.recovery_rtt_max;
 			}
+			bool past_deadline = (uint64_t)(now - b->insertion_time) + rtt > recovery_buffer_ticks;
+			if (past_deadline && peer->receiver_ctx && peer->receiver_ctx->overload.tier >= RIST_OVERLOAD_TIER_DEADLINE) {
+				// Overloaded, the retransmission would only add load and still arrive too late
+				pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
+				f->stats_instant.overload_nacks_dropped++;
+				pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
+				return 12;
+			}
+			if (f->nacks.allowance >= 0) {
+				// The return path is budgeted, do not spend it on packets that can no longer arrive in time
+				if (past_deadline) {
+					pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
+					f->stats_instant.return_nacks_dropped++;
+					pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
+					return 11;
+				}
+				if (f->nacks.allowance == 0) {
+					pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
+					f->stats_instant.return_nacks_deferred++;
+					pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
+					return 0;
+				}
+				f->nacks.allowance--;
+			}
 			if (b->nack_count == 0) {
 				f->missing_counter++;
 				pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
@@ -843,6 +1178,246 @@ static struct rist_data_block *new_data_block(struct rist_data_block *output_buf
 	return output_buffer;
 }
 
+static void receiver_fifo_event(struct rist_receiver *ctx, struct rist_flow *f, enum rist_fifo_event event, uint32_t count)
+{
+	if (ctx->fifo_event_callback)
+		ctx->fifo_event_callback(ctx->fifo_event_callback_argument, f->flow_id, event, count);
+}
+
+static uint32_t receiver_fifo_count(struct rist_receiver *ctx, struct rist_flow *f)
+{
+	unsigned long write_index = atomic_load_explicit(&f->dataout_fifo_queue_write_index, memory_order_relaxed);
+	unsigned long read_index = atomic_load_explicit(&f->dataout_fifo_queue_read_index, memory_order_acquire);
+	return (uint32_t)((write_index - read_index) & (ctx->fifo_queue_capacity - 1));
+}
+
+/* Would one more packet of len bytes exceed the fifo limits? */
+static bool receiver_fifo_full(struct rist_receiver *ctx, struct rist_flow *f, uint32_t count, size_t len)
+{
+	if (ctx->fifo_policy != RIST_FIFO_POLICY_GROW)
+		return count + 1 >= ctx->fifo_queue_size;
+	if (count + 1 >= ctx->fifo_queue_capacity)
+		return true;
+	// The configured fifo size is always available, the byte limit only restricts growth beyond it
+	return ctx->fifo_max_bytes && count + 1 >= ctx->fifo_queue_size &&
+		atomic_load_explicit(&f->dataout_fifo_queue_bytesize, memory_order_relaxed) + len > ctx->fifo_max_bytes;
+}
+
+static void receiver_fifo_watermarks(struct rist_receiver *ctx, struct rist_flow *f, uint32_t count)
+{
+	if (!ctx->fifo_high_watermark)
+		return;
+	if (!f->fifo_above_high_watermark && count >= ctx->fifo_high_watermark) {
+		f->fifo_above_high_watermark = true;
+		receiver_fifo_event(ctx, f, RIST_FIFO_EVENT_HIGH_WATERMARK, count);
+	} else if (f->fifo_above_high_watermark && count <= ctx->fifo_low_watermark) {
+		f->fifo_above_high_watermark = false;
+		receiver_fifo_event(ctx, f, RIST_FIFO_EVENT_LOW_WATERMARK, count);
+	}
+}
+
+/* Take the oldest unread block away from the application readers, returns
+ * false when the fifo is empty */
+static bool receiver_fifo_drop_oldest(struct rist_receiver *ctx, struct rist_flow *f)
+{
+	unsigned long read_index = atomic_load_explicit(&f->dataout_fifo_queue_read_index, memory_order_acquire);
+	unsigned long write_index = atomic_load_explicit(&f->dataout_fifo_queue_write_index, memory_order_relaxed);
+	if (read_index == write_index)
+		return false;
+	// Losing the race means a reader consumed it, which frees the slot just the same
+	if (!atomic_compare_exchange_strong(&f->dataout_fifo_queue_read_index, &read_index, (read_index + 1) & (ctx->fifo_queue_capacity - 1)))
+		return true;
+	struct rist_data_block *block = f->dataout_fifo_queue[read_index];
+	f->dataout_fifo_queue[read_index] = NULL;
+	if (block) {
+		atomic_fetch_sub_explicit(&f->dataout_fifo_queue_bytesize, block->payload_len, memory_order_relaxed);
+		rist_receiver_data_block_free2(&block);
+	}
+	return true;
+}
+
+/* Hand a data block to the application: data callback and/or output fifo */
+static void receiver_output_block(struct rist_receiver *ctx, struct rist_flow *f, struct rist_data_block *block, uint64_t delay_rtc)
+{
+	if (ctx->receiver_data_callback && block) {
+		rist_ref_inc(block->ref);
+		// send to callback synchronously
+		ctx->receiver_data_callback(ctx->receiver_data_callback_argument,
+				block);
+	}
+
+	size_t block_len = block ? block->payload_len : 0;
+	uint32_t fifo_count = ctx->fifo_queue_size ? receiver_fifo_count(ctx, f) : 0;
+	bool dropped = false;
+	bool queued = false;
+	if (ctx->fifo_policy == RIST_FIFO_POLICY_DROP_OLDEST && ctx->fifo_queue_size) {
+		while (receiver_fifo_full(ctx, f, fifo_count, block_len) && receiver_fifo_drop_oldest(ctx, f)) {
+			dropped = true;
+			fifo_count = receiver_fifo_count(ctx, f);
+		}
+	}
+	if (!ctx->fifo_queue_size || receiver_fifo_full(ctx, f, fifo_count, block_len)) {
+		if (!ctx->receiver_data_callback)
+			rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Rist data out fifo queue overflow\n");
+		rist_receiver_data_block_free2(&block);
+		atomic_store_explicit(&f->fifo_overflow, true, memory_order_release);
+		dropped = true;
+	} else
+	{
+		size_t dataout_fifo_write_index = atomic_load_explicit(&f->dataout_fifo_queue_write_index, memory_order_relaxed);
+		f->dataout_fifo_queue[dataout_fifo_write_index] = block;
+		atomic_fetch_add_explicit(&f->dataout_fifo_queue_bytesize, block_len, memory_order_relaxed);
+		atomic_store_explicit(&f->dataout_fifo_queue_write_index, (dataout_fifo_write_index + 1)& (ctx->fifo_queue_capacity-1), memory_order_release);
+		if (dropped) {
+			if (!ctx->receiver_data_callback)
+				rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Rist data out fifo queue overflow, dropped oldest data\n");
+			atomic_store_explicit(&f->fifo_overflow, true, memory_order_release);
+		}
+		queued = true;
+		receiver_fifo_watermarks(ctx, f, fifo_count + 1);
+		f->fifo_holding = false;
+	}
+	if (dropped && !f->fifo_dropping) {
+		f->fifo_dropping = true;
+		receiver_fifo_event(ctx, f, RIST_FIFO_EVENT_DROP, fifo_count);
+	} else if (!dropped) {
+		f->fifo_dropping = false;
+	}
+	pthread_mutex_lock(&ctx->common.stats_lock);
+	if (f->stats_instant.buffer_duration_count < 2048)
+	{
+		f->stats_instant.buffer_duration[f->stats_instant.buffer_duration_count] = (uint32_t)(delay_rtc / RIST_CLOCK);
+		f->stats_instant.buffer_duration_count++;
+	}
+	pthread_mutex_unlock(&ctx->common.stats_lock);
+	// A flow with its own reader only wakes that reader, the section keeps it from being closed meanwhile
+	unsigned epoch = rist_epoch_enter(&ctx->common.epoch);
+	struct rist_flow_reader *reader = f->reader;
+	int notify_fd = reader ? reader->notify_fd : ctx->receiver_data_ready_notify_fd;
+	// Wake up the fifo read thread (poll)
+	if (queued && notify_fd) {
+		// send a data ready signal by writing a single byte of value 0
+		char empty = '\0';
+		if(write(notify_fd, &empty, 1) == -1)
+		{
+			// We ignore the error condition as missing data is not harmful here
+			// It is only a signaling mechanism
+		}
+	}
+	if (pthread_cond_signal(reader ? &reader->condition : &ctx->condition))
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Call to pthread_cond_signal failed.\n");
+	rist_epoch_leave(&ctx->common.epoch, epoch);
+}
+
+/* Frame reassembly (rist_receiver_frame_reassembly_set) */
+static void receiver_frame_output(struct rist_receiver *ctx, struct rist_flow *f, uint64_t delay_rtc)
+{
+	uint32_t flags = f->frame_block_flags;
+	if (f->frame_incomplete) {
+		pthread_mutex_lock(&ctx->common.stats_lock);
+		f->stats_instant.frames_incomplete++;
+		pthread_mutex_unlock(&ctx->common.stats_lock);
+		rist_log_priv(&ctx->common, RIST_LOG_DEBUG, "Frame starting at %"PRIu32" is incomplete (%zu bytes), %s\n",
+				f->frame.seq, f->frame.size, ctx->frame_policy == RIST_FRAME_POLICY_DELIVER_INCOMPLETE ? "releasing" : "dropping");
+		flags |= RIST_DATA_FLAGS_INCOMPLETE_FRAME;
+	}
+	uint8_t *payload = f->frame.data;
+	f->frame.data = NULL;
+	f->frame.alloc_size = 0;
+	f->frame_active = false;
+	if (!payload || (f->frame_incomplete && ctx->frame_policy != RIST_FRAME_POLICY_DELIVER_INCOMPLETE)) {
+		free(payload);
+		return;
+	}
+	struct rist_data_block *block = new_data_block(NULL, &f->frame, &payload[RIST_MAX_PAYLOAD_OFFSET], f->flow_id, flags);
+	if (!block) {
+		free(payload);
+		return;
+	}
+	receiver_output_block(ctx, f, block, delay_rtc);
+}
+
+static void receiver_frame_append(struct rist_receiver *ctx, struct rist_flow *f, struct rist_buffer *b)
+{
+	size_t size = f->frame.size + b->size;
+	if (size > ctx->frame_max_size) {
+		f->frame_incomplete = true;
+		return;
+	}
+	if (size > f->frame.alloc_size) {
+		size_t alloc_size = f->frame.alloc_size ? f->frame.alloc_size * 2 : 16 * b->size;
+		if (alloc_size < size)
+			alloc_size = size;
+		if (alloc_size > ctx->frame_max_size)
+			alloc_size = ctx->frame_max_size;
+		uint8_t *data = realloc(f->frame.data, alloc_size + RIST_MAX_PAYLOAD_OFFSET);
+		if (!data) {
+			rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Could not grow frame reassembly buffer to %zu bytes\n", alloc_size);
+			f->frame_incomplete = true;
+			return;
+		}
+		f->frame.data = data;
+		f->frame.alloc_size = alloc_size;
+	}
+	memcpy((uint8_t *)f->frame.data + RIST_MAX_PAYLOAD_OFFSET + f->frame.size, (uint8_t *)b->data + RIST_MAX_PAYLOAD_OFFSET, b->size);
+	f->frame.size = size;
+}
+
+/* Returns false when b is not part of a frame and has to be output as is */
+static bool receiver_frame_reassemble(struct rist_receiver *ctx, struct rist_flow *f, struct rist_buffer *b, uint32_t flags, uint64_t now)
+{
+	if (!(b->frame_flags & RIST_RTP_EXT_FRAGMENT)) {
+		// The tail of the frame in progress was lost
+		if (f->frame_active) {
+			f->frame_incomplete = true;
+			receiver_frame_output(ctx, f, now - f->frame.time);
+		}
+		return false;
+	}
+	bool first = b->frame_flags & RIST_RTP_EXT_FRAGMENT_FIRST;
+	if (first && f->frame_active) {
+		f->frame_incomplete = true;
+		receiver_frame_output(ctx, f, now - f->frame.time);
+	}
+	if (!f->frame_active) {
+		f->frame_active = true;
+		// Without the first fragment the head of the frame was lost
+		f->frame_incomplete = !first;
+		f->frame_block_flags = flags;
+		f->frame.peer = b->peer;
+		f->frame.seq = b->seq;
+		f->frame.source_time = b->source_time;
+		f->frame.src_port = b->src_port;
+		f->frame.dst_port = b->dst_port;
+		f->frame.time = b->time;
+		f->frame.target_output_time = b->target_output_time;
+		f->frame.size = 0;
+	} else if (b->seq != f->frame_next_seq) {
+		// Fragments in the middle were lost
+		f->frame_incomplete = true;
+	}
+	f->frame_next_seq = f->short_seq ? (uint16_t)(b->seq + 1) : b->seq + 1;
+	receiver_frame_append(ctx, f, b);
+	if (b->frame_flags & RIST_RTP_EXT_FRAGMENT_LAST)
+		receiver_frame_output(ctx, f, now - f->frame.time);
+	return true;
+}
+
+/* The fragments of a frame share its timestamp and with it their deadline. Once
+ * the frame is due and none of its remaining fragments is queued (next is the
+ * first packet queued after the missing ones, if any), they are not going to
+ * make it: the frame is output as it is instead of waiting until next is due,
+ * or for a packet that may never come. */
+static void receiver_frame_expire(struct rist_receiver *ctx, struct rist_flow *f, struct rist_buffer *next, uint64_t now)
+{
+	if (f->frame.target_output_time > now)
+		return;
+	if (next && (next->frame_flags & RIST_RTP_EXT_FRAGMENT) && !(next->frame_flags & RIST_RTP_EXT_FRAGMENT_FIRST))
+		return;
+	f->frame_incomplete = true;
+	receiver_frame_output(ctx, f, timestampNTP_u64() - f->frame.time);
+}
+
 static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f)
 {
 
@@ -853,6 +1428,8 @@ static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f)
 	else
 		now = timestampNTP_RTC_u64();
 	size_t output_idx = atomic_load_explicit(&f->receiver_queue_output_idx, memory_order_acquire);
+	if (f->frame_active && atomic_load_explicit(&f->receiver_queue_size, memory_order_acquire) == 0)
+		receiver_frame_expire(ctx, f, NULL, now);
 	while (atomic_load_explicit(&f->receiver_queue_size, memory_order_acquire) > 0 && atomic_load_explicit(&f->shutdown, memory_order_acquire) == 0) {
 		// Find the first non-null packet in the queuecounter loop
 		struct rist_buffer *b = f->receiver_queue[output_idx];
@@ -875,11 +1452,13 @@ static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f)
 					return;
 				}
 			}
+			if (f->frame_active)
+				receiver_frame_expire(ctx, f, b, now);
 			if (b) {
 				uint64_t delay1 = (now - b->time);
 				if (RIST_UNLIKELY(delay1 > (2LLU * recovery_buffer_ticks))) {
 					// According to the real time clock, it is too late, continue.
-				} else if (b->target_output_time > now) {
+				} else if (b->target_output_time > now && !f->resync_draining) {
 					// The block we found is not ready for output, so we wait.
 					break;
 				}
@@ -897,6 +1476,22 @@ static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f)
 
 				now = timestampNTP_u64();
 				uint64_t delay_rtc = (now - b->time);
+				if (ctx->fifo_policy == RIST_FIFO_POLICY_HOLD && ctx->fifo_queue_size && !ctx->receiver_data_callback && !f->resync_draining &&
+						delay_rtc <= (1.1 * recovery_buffer_ticks) &&
+						receiver_fifo_full(ctx, f, receiver_fifo_count(ctx, f), b->size)) {
+					// Application is not reading, keep the data in the buffer while we are within the latency budget
+					if (holes) {
+						// Already accounted for as lost, remember the discontinuity for the next output
+						f->fifo_hold_holes = true;
+						atomic_store_explicit(&f->receiver_queue_output_idx, output_idx, memory_order_release);
+					}
+					if (!f->fifo_holding) {
+						f->fifo_holding = true;
+						rist_log_priv(&ctx->common, RIST_LOG_WARN, "Rist data out fifo queue full, holding output\n");
+						receiver_fifo_event(ctx, f, RIST_FIFO_EVENT_HOLD, receiver_fifo_count(ctx, f));
+					}
+					break;
+				}
 				if (RIST_UNLIKELY(delay_rtc > (1.1 * recovery_buffer_ticks) )) {
 					// Double check the age of the packet within our receiver queue
 					// Safety net for discontinuities in source timestamp, clock drift or improperly scaled timestamp
@@ -921,7 +1516,7 @@ static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f)
 							drop? "dropping" : "releasing");
 
 				}
-				else if (b->target_output_time > now && (!f->currently_scaling_buffer || (f->currently_scaling_buffer && (b->packet_time + f->recovery_buffer_ticks) > now))) {
+				else if (b->target_output_time > now && !f->resync_draining && (!f->currently_scaling_buffer || (f->currently_scaling_buffer && (b->packet_time + f->recovery_buffer_ticks) > now))) {
 					// This is how we keep the buffer at the correct level
 					//rist_log_priv(&ctx->common, RIST_LOG_WARN, "age is %"PRIu64"/%"PRIu64" < %"PRIu64", size %zu\n",
 					//	delay_rtc / RIST_CLOCK , delay / RIST_CLOCK, recovery_buffer_ticks / RIST_CLOCK, f->receiver_queue_size);
@@ -938,6 +1533,10 @@ static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f)
 				f->last_output_time = now;
 				if (f->short_seq)
 					next_seq = (uint16_t)next_seq;
+				if (f->fifo_hold_holes) {
+					f->fifo_hold_holes = false;
+					holes = 1;
+				}
 				if (b->seq != next_seq && !holes) {
 					rist_log_priv(&ctx->common, RIST_LOG_ERROR,
 							"Discontinuity, expected %" PRIu32 " got %" PRIu32 "\n",
@@ -955,51 +1554,15 @@ static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f)
 						f->flag_flow_buffer_start = false;
 						flags |= RIST_DATA_FLAGS_FLOW_BUFFER_START;
 					}
-					/* insert into fifo queue */
-					uint8_t *payload = b->data;
-					struct rist_data_block *block = new_data_block(
-							NULL, b,
-							&payload[RIST_MAX_PAYLOAD_OFFSET], f->flow_id, flags);
-					b->data = NULL;
-					if (ctx->receiver_data_callback && block) {
-						rist_ref_inc(block->ref);
-						// send to callback synchronously
-						ctx->receiver_data_callback(ctx->receiver_data_callback_argument,
-								block);
-					}
-
-					size_t dataout_fifo_write_index = atomic_load_explicit(&f->dataout_fifo_queue_write_index, memory_order_relaxed);
-					size_t dataout_fifo_read_index = atomic_load_explicit(&f->dataout_fifo_queue_read_index, memory_order_acquire);
-					uint32_t fifo_count = (dataout_fifo_write_index - dataout_fifo_read_index)&(ctx->fifo_queue_size -1);
-					if (fifo_count +1 == ctx->fifo_queue_size || !ctx->fifo_queue_size) {
-						if (!ctx->receiver_data_callback)
-							rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Rist data out fifo queue overflow\n");
-						rist_receiver_data_block_free2(&block);
-						atomic_store_explicit(&f->fifo_overflow, true, memory_order_release);
-					} else
-					{
-						f->dataout_fifo_queue[dataout_fifo_write_index] = block;
-						atomic_store_explicit(&f->dataout_fifo_queue_write_index, (dataout_fifo_write_index + 1)& (ctx->fifo_queue_size-1), memory_order_relaxed);
-						// Wake up the fifo read thread (poll)
-						if (ctx->receiver_data_ready_notify_fd) {
-							// send a data ready signal by writing a single byte of value 0
-							char empty = '\0';
-							if(write(ctx->receiver_data_ready_notify_fd, &empty, 1) == -1)
-							{
-								// We ignore the error condition as missing data is not harmful here
-								// It is only a signaling mechanism
-							}
-						}
-					}
-					pthread_mutex_lock(&ctx->common.stats_lock);
-					if (f->stats_instant.buffer_duration_count < 2048)
-					{
-						f->stats_instant.buffer_duration[f->stats_instant.buffer_duration_count] = (uint32_t)(delay_rtc / RIST_CLOCK);
-						f->stats_instant.buffer_duration_count++;
+					if (ctx->frame_policy == RIST_FRAME_POLICY_DISABLED || !receiver_frame_reassemble(ctx, f, b, flags, now)) {
+						/* insert into fifo queue */
+						uint8_t *payload = b->data;
+						struct rist_data_block *block = new_data_block(
+								NULL, b,
+								&payload[RIST_MAX_PAYLOAD_OFFSET], f->flow_id, flags);
+						b->data = NULL;
+						receiver_output_block(ctx, f, block, delay_rtc);
 					}
-					pthread_mutex_unlock(&ctx->common.stats_lock);
-					if (pthread_cond_signal(&(ctx->condition)))
-						rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Call to pthread_cond_signal failed.\n");
 				}
 				// Track this one only for data
 				f->last_seq_output_source_time = b->source_time;
@@ -1036,44 +1599,155 @@ next:
 
 }
 
-static void send_nack_group(struct rist_receiver *ctx, struct rist_flow *f)
+/* select_nack_path hook, offers the live rtcp peers of the flow */
+static struct rist_peer *receiver_nack_peer_policy(struct rist_common_ctx *cctx, struct rist_flow *f,
+		struct rist_peer **peer_lst, size_t peer_lst_len, struct rist_peer *builtin)
+{
+	const struct rist_path *paths[RIST_PATH_POLICY_MAX_PATHS];
+	struct rist_peer *peers[RIST_PATH_POLICY_MAX_PATHS];
+	size_t count = 0;
+	size_t builtin_idx = SIZE_MAX;
+	for (size_t i = 0; i < peer_lst_len && count < RIST_PATH_POLICY_MAX_PATHS; i++)
+	{
+		struct rist_peer *check = peer_lst[i];
+		if (!check->is_rtcp || check->dead)
+			continue;
+		if (check == builtin)
+			builtin_idx = count;
+		peers[count] = check;
+		paths[count] = rist_path_get(cctx, check);
+		count++;
+	}
+	if (count == 0)
+		return builtin;
+	/* the builtin path is past the ones offered, any index out of range keeps it */
+	if (builtin_idx == SIZE_MAX)
+		builtin_idx = count;
+	size_t idx = cctx->path_policy.select_nack_path(cctx->path_policy_arg, paths, count, f->flow_id, builtin_idx);
+	return idx < count ? peers[idx] : builtin;
+}
+
+/* Live rtcp peer with the lowest rtt, nacks for the flow are sent through it */
+static struct rist_peer *receiver_nack_peer(struct rist_flow *f)
 {
-	// Now actually send all the nack IP packets for this flow (the above routing will process/group them)
-	if (f->nacks.counter == 0)
-		return;
-	pthread_mutex_lock(&ctx->common.peerlist_lock);
 	struct rist_peer *peer = NULL;
 	uint64_t last_rtt = UINT64_MAX;
-	if (f->peer_lst_len == 0 || f->peer_lst == NULL)
-		goto out;
-	for (size_t i = 0; i < f->peer_lst_len; i++)
+	size_t peer_lst_len;
+	struct rist_peer **peer_lst = rist_peer_lst_get(&f->peer_lst, &f->peer_lst_len, &peer_lst_len);
+	for (size_t i = 0; i < peer_lst_len; i++)
 	{
-		struct rist_peer *check = f->peer_lst[i];
+		struct rist_peer *check = peer_lst[i];
 		if (check->is_rtcp && !check->dead && check->last_rtt < last_rtt)
 		{
 			peer = check;
 			last_rtt = peer->last_rtt;
 		}
 	}
+	if (RIST_UNLIKELY(peer != NULL && peer->receiver_ctx->common.path_policy.select_nack_path != NULL))
+		peer = receiver_nack_peer_policy(&peer->receiver_ctx->common, f, peer_lst, peer_lst_len, peer);
+	return peer;
+}
+
+static void receiver_nack_allowance_update(struct rist_flow *f)
+{
+	struct rist_peer *peer = NULL;
+	if (f->peer_lst_len != 0 && f->peer_lst != NULL)
+		peer = receiver_nack_peer(f);
+	f->nacks.allowance = peer ? rist_return_budget_nack_allowance(peer) : -1;
+}
+
+/* Early re-nack: remember the nack about to go out, repairs over several
+ * paths can overtake each other so only single path flows are tracked */
+static void receiver_nack_batch_add(struct rist_flow *f, struct rist_peer **peer_lst, size_t peer_lst_len)
+{
+	size_t paths = 0;
+	for (size_t i = 0; i < peer_lst_len; i++) {
+		if (peer_lst[i]->is_data && !peer_lst[i]->dead)
+			paths++;
+	}
+	if (paths > 1)
+		return;
+	struct rist_nack_batch *batch = &f->nack_batches[f->nack_batch_write];
+	memcpy(batch->seq, f->nacks.array, f->nacks.counter * sizeof(batch->seq[0]));
+	batch->count = f->nacks.counter;
+	batch->next = 0;
+	f->nack_batch_write = (f->nack_batch_write + 1) & (RIST_NACK_BATCHES - 1);
+}
+
+static void send_nack_group(struct rist_receiver *ctx, struct rist_flow *f)
+{
+	// Now actually send all the nack IP packets for this flow (the above routing will process/group them)
+	if (f->nacks.counter == 0)
+		return;
+	unsigned epoch = rist_epoch_enter(&ctx->common.epoch);
+	struct rist_peer *peer = NULL;
+	size_t peer_lst_len;
+	struct rist_peer **peer_lst = rist_peer_lst_get(&f->peer_lst, &f->peer_lst_len, &peer_lst_len);
+	if (peer_lst_len == 0 || peer_lst == NULL)
+		goto out;
+	peer = receiver_nack_peer(f);
 	if (peer != NULL)
-		rist_receiver_send_nacks(peer,f->nacks.array, f->nacks.counter);
+		rist_receiver_send_nacks(peer,f->nacks.array, f->nacks.counter, f->nacks.early);
 	else
 	{
-		for (size_t i = 0; i < f->peer_lst_len; i++)
+		for (size_t i = 0; i < peer_lst_len; i++)
 		{
-			struct rist_peer *check = f->peer_lst[i];
+			struct rist_peer *check = peer_lst[i];
 			uint64_t dead_since = 0;
 			if (check->is_rtcp && check->dead_since > dead_since)
 			{
 				peer = check;
 			}
 			if (peer != NULL)
-				rist_receiver_send_nacks(peer,f->nacks.array, f->nacks.counter);
+				rist_receiver_send_nacks(peer,f->nacks.array, f->nacks.counter, f->nacks.early);
 		}
 	}
+	if (peer != NULL && ctx->early_renack)
+		receiver_nack_batch_add(f, peer_lst, peer_lst_len);
 	f->nacks.counter = 0;
+	receiver_nack_allowance_update(f);
 out:
-	pthread_mutex_unlock(&ctx->common.peerlist_lock);
+	rist_epoch_leave(&ctx->common.epoch, epoch);
+}
+
+/* Early re-nack: the gaps receiver_repair_track found go out right away in a
+ * nack of their own, flagged so that the sender lets them past its duplicate
+ * guard. rist_process_nack still applies max-retries, the deadline and the
+ * return path budget */
+static void receiver_renack_send(struct rist_receiver *ctx, struct rist_flow *f)
+{
+	uint64_t now;
+	if (RIST_LIKELY(!f->rtc_timing_mode))
+		now = timestampNTP_u64();
+	else
+		now = timestampNTP_RTC_u64();
+	uint32_t sent = 0;
+	f->nacks.early = true;
+	for (size_t i = 0; i < f->renack_count; i++) {
+		for (struct rist_missing_buffer *m = f->missing; m; m = m->next) {
+			if (m->seq != f->renack[i])
+				continue;
+			if (m->nack_count > 0 && m->next_nack > now) {
+				// We do not mix/group missing sequence numbers with different upper 2 bytes
+				if (f->nacks.counter && (f->nacks.array[0] >> 16) != (m->seq >> 16))
+					send_nack_group(ctx, f);
+				size_t counter = f->nacks.counter;
+				m->next_nack = now;
+				// anything it wants removed is removed by the next pass over the missing queue
+				rist_process_nack(f, m);
+				sent += (uint32_t)(f->nacks.counter - counter);
+			}
+			break;
+		}
+	}
+	send_nack_group(ctx, f);
+	f->nacks.early = false;
+	f->renack_count = 0;
+	if (sent) {
+		pthread_mutex_lock(&ctx->common.stats_lock);
+		f->stats_instant.early_renacks += sent;
+		pthread_mutex_unlock(&ctx->common.stats_lock);
+	}
 }
 
 void receiver_nack_output(struct rist_receiver *ctx, struct rist_flow *f)
@@ -1085,16 +1759,45 @@ void receiver_nack_output(struct rist_receiver *ctx, struct rist_flow *f)
 
 	const size_t maxcounter = RIST_MAX_NACKS;
 
+	unsigned epoch = rist_epoch_enter(&ctx->common.epoch);
+	receiver_nack_allowance_update(f);
+	rist_epoch_leave(&ctx->common.epoch, epoch);
+
+	if (ctx->relay_sender && ctx->relay_flow == f)
+		receiver_relay_expedite(ctx, f);
+	if (f->renack_count)
+		receiver_renack_send(ctx, f);
+
+	/* Weighted round robin between flows: each round a flow may look at
+	 * flow_nack_budget * weight entries, a pass over a long missing queue
+	 * (burst loss) then spans several rounds instead of starving the
+	 * other flows of this context. */
+	size_t budget = SIZE_MAX;
+	if (ctx->flow_nack_budget)
+		budget = (size_t)ctx->flow_nack_budget * f->nack_weight;
+
 	/* Now loop through missing queue and process items */
 	struct rist_missing_buffer *mb = f->missing;
 	struct rist_missing_buffer **prev = &f->missing;
 	struct rist_missing_buffer *previous = NULL;
+	if (f->nack_resume) {
+		previous = f->nack_resume;
+		prev = &previous->next;
+		mb = previous->next;
+		f->nack_resume = NULL;
+	}
 	int empty = 0;
 	uint32_t seq_msb = 0;
 	if (mb)
 		seq_msb = mb->seq >> 16;
 
 	while (mb) {
+		if (budget-- == 0) {
+			/* continue after the last visited entry next round */
+			f->nack_resume = previous;
+			f->stats_instant.nack_throttled++;
+			break;
+		}
 		int remove_from_queue_reason = 0;
 		struct rist_peer *peer = mb->peer;
 		ssize_t idx = mb->seq& (f->receiver_queue_max -1);
@@ -1270,9 +1973,13 @@ err:
 
 struct rist_peer *_librist_peer_create_common(struct rist_common_ctx *cctx, struct rist_receiver *rctx, struct rist_sender *sctx, const struct rist_peer_config *config)
 {
+	// Fields added in version 1 are not there in an older struct
+	bool config_v1 = config->version >= 1;
+	enum rist_cipher cipher = config_v1 ? config->cipher : RIST_CIPHER_AES;
 	int key_size = config->key_size;
 	if (strlen(config->secret) && !key_size) {
-		rist_log_priv(cctx, RIST_LOG_NOTICE, "PSK Set but key size not explicitly configured, defaulting to AES256");
+		if (cipher != RIST_CIPHER_CHACHA20)
+			rist_log_priv(cctx, RIST_LOG_NOTICE, "PSK Set but key size not explicitly configured, defaulting to AES256");
 		key_size = 256;
 	}
 	if (key_size) {
@@ -1285,6 +1992,12 @@ struct rist_peer *_librist_peer_create_common(struct rist_common_ctx *cctx, stru
 			rist_log_priv(cctx, RIST_LOG_ERROR, "Invalid secret passphrase\n");
 			return NULL;
 		}
+		if (cipher == RIST_CIPHER_CHACHA20) {
+			if (key_size != 256)
+				rist_log_priv(cctx, RIST_LOG_NOTICE, "ChaCha20 always uses a 256 bits key\n");
+			key_size = 256;
+			rist_log_priv(cctx, RIST_LOG_INFO, "Using ChaCha20 cipher (%s implementation)\n", _librist_crypto_chacha20_impl());
+		}
 		rist_log_priv(cctx, RIST_LOG_INFO, "Using %d bits secret key\n", key_size);
 	}
 	else {
@@ -1299,6 +2012,18 @@ struct rist_peer *_librist_peer_create_common(struct rist_common_ctx *cctx, stru
 
 	strncpy(&p->miface[0], config->miface, RIST_MAX_STRING_SHORT);
 	strncpy(&p->cname[0], config->cname, RIST_MAX_STRING_SHORT);
+	if (config_v1) {
+		p->multicast_shared = config->multicast_shared != 0;
+		snprintf(p->multicast_source, sizeof(p->multicast_source), "%s", config->multicast_source);
+		p->config.ecn = config->ecn;
+		p->config.flow_weight = config->flow_weight;
+		p->config.stripe_ports = config->stripe_ports;
+		p->config.cipher = cipher;
+	}
+	if (p->config.stripe_ports > RIST_MAX_STRIPE_PORTS) {
+		rist_log_priv(cctx, RIST_LOG_WARN, "Limiting source port striping to %d ports\n", RIST_MAX_STRIPE_PORTS);
+		p->config.stripe_ports = RIST_MAX_STRIPE_PORTS;
+	}
 	if (config->address_family && rist_set_manual_sockdata(p, config)) {
 		free(p);
 		return NULL;
@@ -1306,6 +2031,10 @@ struct rist_peer *_librist_peer_create_common(struct rist_common_ctx *cctx, stru
 
 	_librist_crypto_psk_rist_key_init(&p->key_tx, key_size, config->key_rotation, config->secret, false);
 	_librist_crypto_psk_rist_key_init(&p->key_tx_odd, key_size, config->key_rotation, config->secret, true);
+	if (key_size && cipher == RIST_CIPHER_CHACHA20) {
+		_librist_crypto_psk_set_cipher(&p->key_tx, RIST_CIPHER_CHACHA20);
+		_librist_crypto_psk_set_cipher(&p->key_tx_odd, RIST_CIPHER_CHACHA20);
+	}
 	_librist_crypto_psk_rist_key_clone(&p->key_tx, &p->key_rx);
 	_librist_crypto_psk_rist_key_clone(&p->key_tx_odd, &p->key_rx_odd);
 
@@ -1355,10 +2084,44 @@ struct rist_peer *rist_receiver_peer_insert_local(struct rist_receiver *ctx,
 	return p;
 }
 
-/* PEERS are created at startup. The default state is RIST_PEER_STATE_IDLE
- * This function will initiate the connection to the peer if a peer address is available.
- * If no address is configured for the endpoint, the peer is put in wait mode.
- */
+/* PEERS are created at startup. The default state is RIST_PEER_STATE_IDLE
+ * This function will initiate the connection to the peer if a peer address is available.
+ * If no address is configured for the endpoint, the peer is put in wait mode.
+ */
+void rist_peer_socket_filter_update(struct rist_peer *peer)
+{
+	struct rist_receiver *ctx = peer->receiver_ctx;
+	if (!ctx || peer->parent || peer->sd < 0)
+		return;
+	if (atomic_load_explicit(&peer->shutdown, memory_order_acquire))
+		return;
+	if (ctx->socket_filter == RIST_SOCKET_FILTER_DISABLED) {
+		if (peer->socket_filter_attached && rist_socket_filter_detach(peer->sd) == 0)
+			peer->socket_filter_attached = false;
+		return;
+	}
+
+	struct rist_socket_filter_spec spec = {
+		.gre = ctx->common.profile != RIST_PROFILE_SIMPLE,
+		/* srp derives the key later on, until then both are valid */
+		.check_key = !peer->shared_socket && (peer->key_rx.key_size != 0 || !peer->eap_ctx),
+		.encrypted = peer->key_rx.key_size != 0,
+	};
+	/* Only a connecting peer knows its sender up front. A listening peer keeps
+	 * the header check, an allowlist of the senders authenticated so far would
+	 * lock out new, bonded and reconnecting ones. */
+	if (ctx->socket_filter == RIST_SOCKET_FILTER_PEERS && !peer->listening && !peer->multicast_receiver && !peer->shared_socket)
+		rist_socket_filter_add_source(&spec, &peer->u.address);
+	if (rist_socket_filter_attach(peer->sd, &spec) != 0) {
+		rist_log_priv(get_cctx(peer), RIST_LOG_WARN, "Could not attach socket filter to peer %"PRIu32": %s\n",
+				peer->adv_peer_id, strerror(errno));
+		return;
+	}
+	peer->socket_filter_attached = true;
+	rist_log_priv(get_cctx(peer), RIST_LOG_DEBUG, "Socket filter of peer %"PRIu32" updated, %zu allowed sources\n",
+			peer->adv_peer_id, spec.source_count);
+}
+
 void rist_fsm_init_comm(struct rist_peer *peer)
 {
 
@@ -1391,9 +2154,22 @@ void rist_fsm_init_comm(struct rist_peer *peer)
 	/* Start the timer that reads data from this peer */
 	if (!peer->event_recv) {
 		struct evsocket_ctx *evctx = get_cctx(peer)->evctx;
-		peer->event_recv = evsocket_addevent(evctx, peer->sd, EVSOCKET_EV_READ,
-				rist_peer_recv_wrap, rist_peer_sockerr, peer);
+		if (peer->shared_socket) {
+			/* One event per shared socket, datagrams are demuxed to the peers */
+			if (!peer->shared_socket->event_recv)
+				peer->shared_socket->event_recv = evsocket_addevent(evctx, peer->sd, EVSOCKET_EV_READ,
+						rist_shared_socket_recv_wrap, rist_shared_socket_sockerr, peer->shared_socket);
+			peer->event_recv = peer->shared_socket->event_recv;
+		} else
+			peer->event_recv = evsocket_addevent(evctx, peer->sd, EVSOCKET_EV_READ,
+					rist_peer_recv_wrap, rist_peer_sockerr, peer);
+		/* Feedback may come back on any of the striped source ports */
+		for (size_t i = 1; i < peer->stripe_count; i++)
+			peer->stripe_event[i] = evsocket_addevent(evctx, peer->stripe_sd[i], EVSOCKET_EV_READ,
+					rist_peer_recv_wrap, rist_peer_sockerr, peer);
 	}
+	if (peer->receiver_mode)
+		rist_peer_socket_filter_update(peer);
 
 	/* Enable RTCP timer and jump start it */
 	if (!peer->listening && peer->is_rtcp) {
@@ -1429,11 +2205,27 @@ void rist_peer_authenticate(struct rist_peer *peer)
 	peer->authenticated = true;
 	if (peer->peer_data)
 		peer->peer_data->authenticated = true;
+	if (peer->receiver_mode && peer->parent)
+		rist_peer_socket_filter_update(peer->parent);
 
 	rist_log_priv(get_cctx(peer), RIST_LOG_INFO,
 			"Successfully Authenticated peer %"PRIu32"\n", peer->adv_peer_id);
 }
 
+/* The sockets are serviced from an epoch read section, the handlers take the
+ * peerlist_lock around their changes to the peer links, flows and socket
+ * filters. Returns false, without the lock, for a peer that is being removed. */
+static bool peer_lock_live(struct rist_peer *peer)
+{
+	struct rist_common_ctx *cctx = get_cctx(peer);
+	pthread_mutex_lock(&cctx->peerlist_lock);
+	if (atomic_load_explicit(&peer->shutdown, memory_order_acquire)) {
+		pthread_mutex_unlock(&cctx->peerlist_lock);
+		return false;
+	}
+	return true;
+}
+
 void rist_calculate_bitrate(size_t len, struct rist_bandwidth_estimation *bw)
 {
 	struct timeval tv;
@@ -1545,7 +2337,7 @@ static void rist_calculate_flow_bitrate(struct rist_flow *flow, size_t len, stru
 
 static void rist_sender_recv_nack(struct rist_peer *peer,
 		uint32_t flow_id, uint16_t src_port, uint16_t dst_port, const uint8_t *payload,
-		size_t payload_len, uint32_t nack_seq_msb)
+		size_t payload_len, uint32_t nack_seq_msb, bool early)
 {
 	RIST_MARK_UNUSED(flow_id);
 	RIST_MARK_UNUSED(src_port);
@@ -1586,10 +2378,10 @@ static void rist_sender_recv_nack(struct rist_peer *peer,
 			struct rist_rtp_nack_record *nr = (struct rist_rtp_nack_record *)(payload + sizeof(struct rist_rtcp_nack_range) + i * sizeof(struct rist_rtp_nack_record));
 			missing =  ntohs(nr->start);
 			additional = ntohs(nr->extra);
-			rist_retry_enqueue(peer->sender_ctx, nack_seq_msb + (uint32_t)missing, peer);
+			rist_retry_enqueue(peer->sender_ctx, nack_seq_msb + (uint32_t)missing, peer, early);
 			//rist_log_priv(get_cctx(peer), RIST_LOG_ERROR, "Record %"PRIu32": base packet: %"PRIu32" range len: %d\n", i, nack_seq_msb + missing, additional);
 			for (j = 0; j < additional; j++) {
-				rist_retry_enqueue(peer->sender_ctx, nack_seq_msb + (uint32_t)missing + j + 1, peer);
+				rist_retry_enqueue(peer->sender_ctx, nack_seq_msb + (uint32_t)missing + j + 1, peer, early);
 			}
 		}
 	} else if (rtcp->ptype == PTYPE_NACK_BITMASK) {
@@ -1603,11 +2395,11 @@ static void rist_sender_recv_nack(struct rist_peer *peer,
 			struct rist_rtp_nack_record *nr = (struct rist_rtp_nack_record *)(payload + sizeof(struct rist_rtcp_nack_bitmask) + i * sizeof(struct rist_rtp_nack_record));
 			missing = ntohs(nr->start);
 			bitmask = ntohs(nr->extra);
-			rist_retry_enqueue(peer->sender_ctx, nack_seq_msb + (uint32_t)missing, peer);
+			rist_retry_enqueue(peer->sender_ctx, nack_seq_msb + (uint32_t)missing, peer, early);
 			//rist_log_priv(get_cctx(peer), RIST_LOG_ERROR, "Record %"PRIu32": base packet: %"PRIu32" bitmask: %04x\n", i, nack_seq_msb + missing, bitmask);
 			for (j = 0; j < 16; j++) {
 				if ((bitmask & (1 << j)) == (1 << j))
-					rist_retry_enqueue(peer->sender_ctx, nack_seq_msb + missing + j + 1, peer);
+					rist_retry_enqueue(peer->sender_ctx, nack_seq_msb + missing + j + 1, peer, early);
 			}
 		}
 	} else {
@@ -1633,7 +2425,7 @@ static bool address_compare(struct sockaddr* addr1, struct sockaddr* addr2) {
 	return false;
 }
 
-static bool rist_receiver_data_authenticate(struct rist_peer *peer,uint64_t packet_recv_time, uint32_t flow_id)
+static bool rist_receiver_data_authenticate_locked(struct rist_peer *peer,uint64_t packet_recv_time, uint32_t flow_id)
 {
 	struct rist_receiver *ctx = peer->receiver_ctx;
 
@@ -1687,7 +2479,7 @@ static bool rist_receiver_data_authenticate(struct rist_peer *peer,uint64_t pack
 		} else {
 			if (packet_recv_time > (peer->log_repeat_timer + RIST_LOG_QUIESCE_TIMER)) {
 				rist_log_priv(&ctx->common, RIST_LOG_WARN,
-					"Received data packet (%"PRIu32") but handshake is still pending (waiting for an RTCP packet with SDES on it), ignoring ...\n",
+					"Received data packet (%"PRIu32") but handshake is still pending (waiting for an RTCP packet with SDES on it), buffering ...\n",
 						flow_id);
 					peer->log_repeat_timer = packet_recv_time;
 			}
@@ -1698,7 +2490,7 @@ static bool rist_receiver_data_authenticate(struct rist_peer *peer,uint64_t pack
 		if (!peer->authenticated) {
 			// rist_peer_authenticate is done during rtcp authentication (same peer)
 			rist_log_priv(&ctx->common, RIST_LOG_WARN,
-				"Received data packet (%"PRIu32") but handshake is still pending (waiting for an RTCP packet with SDES on it), ignoring ...\n",
+				"Received data packet (%"PRIu32") but handshake is still pending (waiting for an RTCP packet with SDES on it), buffering ...\n",
 					flow_id);
 			return false;
 		} else if (!peer->peer_rtcp) {
@@ -1725,6 +2517,20 @@ static bool rist_receiver_data_authenticate(struct rist_peer *peer,uint64_t pack
 	return true;
 }
 
+static bool rist_receiver_data_authenticate(struct rist_peer *peer, uint64_t packet_recv_time, uint32_t flow_id)
+{
+	struct rist_common_ctx *cctx = get_cctx(peer);
+	// Handshake done, the data path stays off the peerlist_lock
+	if (peer->authenticated && peer->flow && peer->flow->authenticated &&
+		(cctx->profile == RIST_PROFILE_SIMPLE ? (!peer->parent || peer->parent->authenticated) : peer->peer_rtcp != NULL))
+		return true;
+	if (!peer_lock_live(peer))
+		return false;
+	bool ret = rist_receiver_data_authenticate_locked(peer, packet_recv_time, flow_id);
+	pthread_mutex_unlock(&cctx->peerlist_lock);
+	return ret;
+}
+
 static bool rist_receiver_rtcp_authenticate(struct rist_peer *peer, uint32_t seq,
 		uint32_t flow_id)
 {
@@ -1862,17 +2668,141 @@ static bool rist_receiver_rtcp_authenticate(struct rist_peer *peer, uint32_t seq
 	}
 }
 
+/* Takes the oldest parked packet off the queue, the caller frees the buffer */
+static struct rist_buffer *rist_receiver_preauth_pop(struct rist_peer *peer)
+{
+	struct rist_preauth_packet *pkt = &peer->preauth_queue[peer->preauth_queue_read_idx];
+	struct rist_buffer *b = pkt->buffer;
+	pkt->buffer = NULL;
+	peer->preauth_queue_read_idx = (peer->preauth_queue_read_idx + 1) & (RIST_PREAUTH_QUEUE_BUFFERS - 1);
+	peer->preauth_queue_count--;
+	atomic_fetch_sub(&peer->receiver_ctx->preauth_buffers, 1);
+	atomic_fetch_sub(&peer->receiver_ctx->preauth_bytes, b->size);
+	return b;
+}
+
+static void rist_receiver_preauth_flush(struct rist_peer *peer)
+{
+	if (!peer->preauth_queue)
+		return;
+	while (peer->preauth_queue_count > 0)
+		free_rist_buffer(get_cctx(peer), rist_receiver_preauth_pop(peer));
+	free(peer->preauth_queue);
+	peer->preauth_queue = NULL;
+	peer->preauth_queue_read_idx = 0;
+}
+
+/* Park a data packet that arrived before the handshake completed. The queue is
+ * bounded in packets and in age (the max recovery buffer), the oldest packets
+ * are dropped first. Over all peers of the receiver the parked data is capped
+ * in packets and bytes, past that new packets are not parked. */
+static void rist_receiver_preauth_park(struct rist_peer *peer, uint32_t seq, uint32_t flow_id,
+		uint64_t source_time, uint64_t packet_recv_time, struct rist_buffer *payload, uint8_t retry, uint8_t payload_type)
+{
+	struct rist_receiver *ctx = peer->receiver_ctx;
+	// Retries are useless before the first packet has been output
+	if (retry || payload->size == 0)
+		return;
+	if (!peer->preauth_queue) {
+		peer->preauth_queue = calloc(RIST_PREAUTH_QUEUE_BUFFERS, sizeof(*peer->preauth_queue));
+		if (!peer->preauth_queue)
+			return;
+		peer->preauth_queue_read_idx = 0;
+		peer->preauth_queue_count = 0;
+	}
+	uint64_t max_age = (uint64_t)peer->config.recovery_length_max * RIST_CLOCK;
+	while (peer->preauth_queue_count > 0) {
+		struct rist_preauth_packet *oldest = &peer->preauth_queue[peer->preauth_queue_read_idx];
+		if (peer->preauth_queue_count < RIST_PREAUTH_QUEUE_BUFFERS && (packet_recv_time - oldest->recv_time) <= max_age)
+			break;
+		free_rist_buffer(get_cctx(peer), rist_receiver_preauth_pop(peer));
+	}
+	if (atomic_load(&ctx->preauth_buffers) >= RIST_PREAUTH_CTX_MAX_BUFFERS ||
+		atomic_load(&ctx->preauth_bytes) + payload->size > RIST_PREAUTH_CTX_MAX_BYTES) {
+		if (packet_recv_time > (peer->log_repeat_timer + RIST_LOG_QUIESCE_TIMER)) {
+			rist_log_priv(&ctx->common, RIST_LOG_WARN,
+				"Too much data waiting for authentication (%zu packets, %zu bytes), not buffering packets of peer %u\n",
+				atomic_load(&ctx->preauth_buffers), atomic_load(&ctx->preauth_bytes), peer->adv_peer_id);
+			peer->log_repeat_timer = packet_recv_time;
+		}
+		if (peer->preauth_queue_count == 0)
+			rist_receiver_preauth_flush(peer);
+		return;
+	}
+	size_t idx = (peer->preauth_queue_read_idx + peer->preauth_queue_count) & (RIST_PREAUTH_QUEUE_BUFFERS - 1);
+	struct rist_preauth_packet *pkt = &peer->preauth_queue[idx];
+	pkt->buffer = rist_new_buffer(get_cctx(peer), payload->data, payload->size, RIST_PAYLOAD_TYPE_DATA_RAW, seq, source_time, payload->src_port, payload->dst_port);
+	if (!pkt->buffer)
+		return;
+	pkt->buffer->frame_flags = payload->frame_flags;
+	pkt->flow_id = flow_id;
+	pkt->recv_time = packet_recv_time;
+	pkt->payload_type = payload_type;
+	peer->preauth_queue_count++;
+	atomic_fetch_add(&ctx->preauth_buffers, 1);
+	atomic_fetch_add(&ctx->preauth_bytes, payload->size);
+}
+
+/* Frees the queue of a peer once everything parked on it is too old to be
+ * replayed, so peers that never authenticate don't hold on to it */
+static void rist_receiver_preauth_expire(struct rist_peer *peer, uint64_t now)
+{
+	if (!peer->preauth_queue)
+		return;
+	uint64_t max_age = (uint64_t)peer->config.recovery_length_max * RIST_CLOCK;
+	if (peer->preauth_queue_count > 0) {
+		size_t newest = (peer->preauth_queue_read_idx + peer->preauth_queue_count - 1) & (RIST_PREAUTH_QUEUE_BUFFERS - 1);
+		if (now < peer->preauth_queue[newest].recv_time || (now - peer->preauth_queue[newest].recv_time) <= max_age)
+			return;
+	}
+	rist_receiver_preauth_flush(peer);
+}
+
+static void rist_receiver_recv_data_authenticated(struct rist_peer *peer, uint32_t seq, uint32_t flow_id,
+		uint64_t source_time, uint64_t packet_recv_time, struct rist_buffer *payload, uint8_t retry, uint8_t payload_type);
+
+static void rist_receiver_preauth_replay(struct rist_peer *peer, uint64_t now)
+{
+	uint64_t max_age = (uint64_t)peer->config.recovery_length_max * RIST_CLOCK;
+	size_t replayed = 0;
+	while (peer->preauth_queue_count > 0) {
+		struct rist_preauth_packet *pkt = &peer->preauth_queue[peer->preauth_queue_read_idx];
+		struct rist_buffer *b = rist_receiver_preauth_pop(peer);
+		if ((now - pkt->recv_time) <= max_age) {
+			struct rist_buffer payload = { .data = (uint8_t *)b->data + RIST_MAX_PAYLOAD_OFFSET, .size = b->size, .src_port = b->src_port, .dst_port = b->dst_port, .frame_flags = b->frame_flags };
+			rist_receiver_recv_data_authenticated(peer, b->seq, pkt->flow_id, b->source_time, pkt->recv_time, &payload, 0, pkt->payload_type);
+			replayed++;
+		}
+		free_rist_buffer(get_cctx(peer), b);
+	}
+	rist_receiver_preauth_flush(peer);
+	if (replayed)
+		rist_log_priv(get_cctx(peer), RIST_LOG_INFO,
+				"Replayed %zu data packets received on peer %u before authentication\n", replayed, peer->adv_peer_id);
+}
+
 static void rist_receiver_recv_data(struct rist_peer *peer, uint32_t seq, uint32_t flow_id,
 		uint64_t source_time, uint64_t packet_recv_time, struct rist_buffer *payload, uint8_t retry, uint8_t payload_type)
 {
 	assert(peer->receiver_ctx != NULL);
-	struct rist_receiver *ctx = peer->receiver_ctx;
 
 	if (!rist_receiver_data_authenticate(peer, packet_recv_time, flow_id)) {
 		// Error logging happens inside the function
+		rist_receiver_preauth_park(peer, seq, flow_id, source_time, packet_recv_time, payload, retry, payload_type);
 		return;
 	}
 
+	if (RIST_UNLIKELY(peer->preauth_queue != NULL))
+		rist_receiver_preauth_replay(peer, packet_recv_time);
+
+	rist_receiver_recv_data_authenticated(peer, seq, flow_id, source_time, packet_recv_time, payload, retry, payload_type);
+}
+
+static void rist_receiver_recv_data_authenticated(struct rist_peer *peer, uint32_t seq, uint32_t flow_id,
+		uint64_t source_time, uint64_t packet_recv_time, struct rist_buffer *payload, uint8_t retry, uint8_t payload_type)
+{
+	struct rist_receiver *ctx = peer->receiver_ctx;
+
 	//rist_log_priv(&ctx->common, RIST_LOG_ERROR,
 	//	"rist_recv_data, seq %"PRIu32", retry=%d\n", seq, retry);
 
@@ -1910,14 +2840,17 @@ static void rist_receiver_recv_data(struct rist_peer *peer, uint32_t seq, uint32
                         "Detected flow id change, old flow id: %u new id: %u, "
                         "resetting state\n",
                         peer->flow->flow_id_actual, flow_id);
-        peer->flow->receiver_queue_has_items = false;
+        if (ctx->resync_policy != RIST_RESYNC_POLICY_DISABLED)
+                receiver_flow_resync(ctx, peer->flow, "flow id change");
+        else
+                peer->flow->receiver_queue_has_items = false;
         peer->flow->flow_id_actual = flow_id;
 	}
 
 	// Wake up output thread when data comes in
 	if (pthread_cond_signal(&(peer->flow->condition)))
 		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Call to pthread_cond_signal failed.\n");
-	if (!receiver_enqueue(peer, source_time, packet_recv_time, payload->data, payload->size, seq, rtt, retry, payload->src_port, payload->dst_port, payload_type)) {
+	if (!receiver_enqueue(peer, source_time, packet_recv_time, payload->data, payload->size, seq, rtt, retry, payload->src_port, payload->dst_port, payload_type, payload->frame_flags)) {
 		pthread_mutex_lock(&ctx->common.stats_lock);
 		rist_calculate_flow_bitrate(peer->flow, payload->size, &peer->flow->bw); // update bitrate only if not a dupe
 		pthread_mutex_unlock(&ctx->common.stats_lock);
@@ -1964,6 +2897,7 @@ static void rist_rtcp_handle_echo_response(struct rist_peer *peer, struct rist_r
 		peer->peer_data->last_rtt = peer->last_rtt;
 		peer->peer_data->eight_times_rtt = peer->eight_times_rtt;
 	}
+	rist_path_update(get_cctx(peer), peer);
 }
 
 static void rist_handle_sr_pkt(struct rist_peer *peer, struct rist_rtcp_sr_pkt *sr) {
@@ -2011,6 +2945,61 @@ static void rist_handle_rr_pkt(struct rist_peer *peer, struct rist_rtcp_rr_pkt *
 		peer->peer_data->last_rtt = peer->last_rtt;
 		peer->peer_data->eight_times_rtt = peer->eight_times_rtt;
 	}
+	rist_path_update(get_cctx(peer), peer);
+}
+
+static void rist_receiver_count_ecn(struct rist_peer *peer, uint8_t ecn)
+{
+	switch (ecn) {
+		case RIST_ECN_ECT0:
+			peer->ecn_rx.ect0++;
+			peer->stats_receiver_instant.ecn_ect++;
+			break;
+		case RIST_ECN_ECT1:
+			peer->ecn_rx.ect1++;
+			peer->stats_receiver_instant.ecn_ect++;
+			break;
+		case RIST_ECN_CE:
+			peer->ecn_rx.ce++;
+			peer->stats_receiver_instant.ecn_ce++;
+			break;
+		default:
+			peer->ecn_rx.not_ect++;
+			break;
+	}
+}
+
+static void rist_handle_xr_ecn(struct rist_peer *peer, struct rist_rtcp_xr_ecn *block)
+{
+	struct rist_ecn_counters report = {
+		.ect0 = be32toh(block->ect0),
+		.ect1 = be32toh(block->ect1),
+		.ce = be16toh(block->ce),
+		.not_ect = be16toh(block->not_ect),
+	};
+	if (!peer->ecn_reported) {
+		// First report only sets the baseline for the deltas
+		peer->ecn_reported = true;
+		peer->ecn_last_report = report;
+		return;
+	}
+	// CE and not-ECT are 16 bit counters on the wire
+	uint32_t ce = (uint16_t)(report.ce - peer->ecn_last_report.ce);
+	uint32_t total = (report.ect0 - peer->ecn_last_report.ect0) + (report.ect1 - peer->ecn_last_report.ect1) + ce
+		+ (uint16_t)(report.not_ect - peer->ecn_last_report.not_ect);
+	peer->ecn_last_report = report;
+	peer->stats_sender_instant.ecn_ce += ce;
+	peer->stats_sender_instant.ecn_total += total;
+	if (ce == 0 || peer->config.congestion_control_mode == RIST_CONGESTION_CONTROL_MODE_OFF)
+		return;
+	// Stay in congestion mode for a couple of rtts or report intervals
+	uint64_t hold = (peer->eight_times_rtt / 8) * 2;
+	if (hold < 2 * RIST_PING_INTERVAL * RIST_CLOCK)
+		hold = 2 * RIST_PING_INTERVAL * RIST_CLOCK;
+	if (peer->ecn_congested_until < timestampNTP_u64())
+		rist_log_priv(get_cctx(peer), RIST_LOG_INFO, "Peer %"PRIu32" reported %"PRIu32"/%"PRIu32" CE marked packets, throttling retries\n",
+				peer->adv_peer_id, ce, total);
+	peer->ecn_congested_until = timestampNTP_u64() + hold;
 }
 
 static void rist_handle_xr_pkt(struct rist_peer *peer, uint8_t xr_pkt[])
@@ -2025,7 +3014,7 @@ static void rist_handle_xr_pkt(struct rist_peer *peer, uint8_t xr_pkt[])
 		struct rist_rtcp_xr_block_hdr *block = (struct rist_rtcp_xr_block_hdr *)&xr_pkt[offset];
 		uint8_t block_type = block->type;
 		uint16_t block_length = (be16toh(block->length)+1) * 4;
-		if (block_type == 5)
+		if (block_type == RTCP_XR_BT_DLRR)
 		{
 			struct rist_rtcp_xr_dlrr *dlrr = (struct rist_rtcp_xr_dlrr *)&xr_pkt[offset];
 			uint32_t ssrc  = be32toh(dlrr->ssrc);
@@ -2055,6 +3044,11 @@ static void rist_handle_xr_pkt(struct rist_peer *peer, uint8_t xr_pkt[])
 				peer->peer_data->last_rtt = peer->last_rtt;
 				peer->peer_data->eight_times_rtt = peer->eight_times_rtt;
 			}
+			rist_path_update(get_cctx(peer), peer);
+		}
+		else if (block_type == RTCP_XR_BT_ECN_SUMMARY && block_length >= sizeof(struct rist_rtcp_xr_ecn))
+		{
+			rist_handle_xr_ecn(peer, (struct rist_rtcp_xr_ecn *)&xr_pkt[offset]);
 		}
 		offset += block_length;
 		bytes_remaining -= block_length;
@@ -2090,6 +3084,7 @@ static void rist_recv_rtcp(struct rist_peer *peer, uint32_t seq,
 	uint16_t records;
 	uint8_t subtype;
 	uint32_t nack_seq_msb = 0;
+	bool nack_early = false;
 	peer->stats_receiver_instant.received_rtcp++;
 	struct rist_common_ctx *ctx = get_cctx(peer);
 
@@ -2138,6 +3133,11 @@ static void rist_recv_rtcp(struct rist_peer *peer, uint32_t seq,
 					rist_rtcp_handle_echo_request(peer, echorequest);
 					break;
 				}
+				else if (subtype == NACK_FMT_EARLY) {
+					struct rist_rtcp_nack_range *marker = (struct rist_rtcp_nack_range *)pkt;
+					nack_early = bytes >= sizeof(*marker) && memcmp(marker->name, "RIST", 4) == 0;
+					break;
+				}
 				else if (subtype == NACK_FMT_RANGE)	{
 					//Fallthrough
 					RIST_FALLTHROUGH;
@@ -2148,7 +3148,7 @@ static void rist_recv_rtcp(struct rist_peer *peer, uint32_t seq,
 				}
 			case PTYPE_NACK_BITMASK:
 				//Also FMT Range
-				rist_sender_recv_nack(peer, flow_id, payload->src_port, payload->dst_port, pkt, bytes_left, nack_seq_msb);
+				rist_sender_recv_nack(peer, flow_id, payload->src_port, payload->dst_port, pkt, bytes_left, nack_seq_msb, nack_early);
 				break;
 			case PTYPE_RR:
 				if (ntohs(rtcp->len) == 7) {
@@ -2177,12 +3177,16 @@ static void rist_recv_rtcp(struct rist_peer *peer, uint32_t seq,
 					bool peer_authenticated = peer->authenticated;
 					int connection_message = 0;
 					if (peer->receiver_mode) {
-						rist_receiver_rtcp_authenticate(peer, seq, flow_id);
+						if (peer_lock_live(peer)) {
+							rist_receiver_rtcp_authenticate(peer, seq, flow_id);
+							pthread_mutex_unlock(&ctx->peerlist_lock);
+						}
 						connection_message = RIST_CLIENT_CONNECTED;
 					} else if (peer->sender_ctx && peer->listening) {
 						// TODO: create rist_sender_recv_rtcp
-						if (!peer->authenticated) {
+						if (!peer->authenticated && peer_lock_live(peer)) {
 							rist_peer_authenticate(peer);
+							pthread_mutex_unlock(&ctx->peerlist_lock);
 						}
 						connection_message = RIST_CLIENT_CONNECTED;
 					}
@@ -2253,12 +3257,19 @@ static void rist_peer_sockerr(struct evsocket_ctx *evctx, int fd, short revents,
 	//rist_peer_remove(get_cctx(peer), peer, NULL);
 }
 
+static void rist_shared_socket_sockerr(struct evsocket_ctx *evctx, int fd, short revents, void *arg)
+{
+	RIST_MARK_UNUSED(evctx);
+	RIST_MARK_UNUSED(revents);
+	struct rist_shared_socket *s = (struct rist_shared_socket *)arg;
+	rist_log_priv(s->cctx, RIST_LOG_ERROR, "\tSocket error on shared socket %d!\n", fd);
+}
+
 void sender_peer_append(struct rist_sender *ctx, struct rist_peer *peer)
 {
 	/* Add a reference to ctx->peer_lst */
-	ctx->peer_lst = realloc(ctx->peer_lst, (ctx->peer_lst_len + 1) * sizeof(*ctx->peer_lst));
-	ctx->peer_lst[ctx->peer_lst_len] = peer;
-	ctx->peer_lst_len++;
+	if (rist_peer_lst_add(&ctx->common, &ctx->peer_lst, &ctx->peer_lst_len, peer) != 0)
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Could not add peer %u to the sender list, OOM\n", peer->adv_peer_id);
 }
 
 static void peer_copy_settings(struct rist_peer *peer_src, struct rist_peer *peer)
@@ -2284,6 +3295,10 @@ static void peer_copy_settings(struct rist_peer *peer_src, struct rist_peer *pee
 	peer->config.min_retries = peer_src->config.min_retries;
 	peer->config.max_retries = peer_src->config.max_retries;
 	peer->config.timing_mode = peer_src->config.timing_mode;
+	peer->config.ecn = peer_src->config.ecn;
+	peer->config.cipher = peer_src->config.cipher;
+	peer->config.stripe_ports = peer_src->config.stripe_ports;
+	peer->config.flow_weight = peer_src->config.flow_weight;
 	peer->rtcp_keepalive_interval = peer_src->rtcp_keepalive_interval;
 	peer->peer_ssrc = peer_src->peer_ssrc;
 	peer->session_timeout = peer_src->session_timeout;
@@ -2294,6 +3309,7 @@ static void peer_copy_settings(struct rist_peer *peer_src, struct rist_peer *pee
 
 static void kill_peer(struct rist_peer *peer)
 {
+	rist_receiver_preauth_flush(peer);
 	bool current_state = peer->dead;
 	peer->dead = true;
 	if (peer->peer_data && (current_state != peer->peer_data->dead && peer->peer_data->parent))
@@ -2303,11 +3319,42 @@ static void kill_peer(struct rist_peer *peer)
 
 static void rist_peer_recv_wrap(struct evsocket_ctx *evctx, int fd, short revents, void *arg) {
 	bool again = true;
-	while (true) {
+	int burst = get_cctx((struct rist_peer *)arg)->recv_burst;
+	for (int i = 0; burst == 0 || i < burst; i++) {
 		rist_peer_recv(evctx, fd, revents, arg, &again);
 		if (!again)
 			return;
 	}
+	// still readable, poll comes back to it after serving the other sockets
+	get_cctx((struct rist_peer *)arg)->recv_backlog = true;
+}
+
+static void rist_shared_socket_recv_wrap(struct evsocket_ctx *evctx, int fd, short revents, void *arg)
+{
+	RIST_MARK_UNUSED(evctx);
+	RIST_MARK_UNUSED(revents);
+	struct rist_shared_socket *s = (struct rist_shared_socket *)arg;
+	uint8_t *recv_buf = s->cctx->buf.recv;
+	int burst = s->cctx->recv_burst;
+	for (int i = 0; burst == 0 || i < burst; i++) {
+		struct sockaddr_storage src = {0};
+		struct sockaddr_storage dst;
+		socklen_t addrlen = sizeof(src);
+		uint8_t ecn;
+		ssize_t ret = rist_shared_socket_recv(s, recv_buf, RIST_MAX_PACKET_SIZE, &src, &addrlen, &dst, &ecn);
+		if (ret <= 0) {
+			if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+				rist_log_priv(s->cctx, RIST_LOG_ERROR, "Receive failed on shared socket %d: %s\n", fd, strerror(errno));
+			return;
+		}
+		unsigned epoch = rist_epoch_enter(&s->cctx->epoch);
+		struct rist_peer *peer = rist_shared_socket_demux(s, &dst, &src);
+		rist_epoch_leave(&s->cctx->epoch, epoch);
+		if (!peer || atomic_load_explicit(&peer->shutdown, memory_order_acquire))
+			continue;
+		rist_peer_recv_packet(peer, recv_buf, (size_t)ret, (struct sockaddr *)&src, addrlen, timestampNTP_u64(), ecn);
+	}
+	s->cctx->recv_backlog = true;
 }
 
 static void rist_new_connection(struct rist_peer *peer, struct rist_peer *p, uint32_t flow_id) {
@@ -2345,6 +3392,8 @@ static void rist_peer_recv(struct evsocket_ctx *evctx, int fd, short revents, vo
 
 	struct rist_peer *peer = (struct rist_peer *) arg;
 	if (atomic_load_explicit(&peer->shutdown, memory_order_acquire)) {
+		// nothing is read, the caller must not keep calling while the socket stays readable
+		*again = false;
 		return;
 	}
 	uint64_t now = timestampNTP_u64();
@@ -2352,18 +3401,16 @@ static void rist_peer_recv(struct evsocket_ctx *evctx, int fd, short revents, vo
 
 	socklen_t addrlen = peer->address_len;
 	size_t recv_bufsize = 0;
-	uint16_t family = peer->address_family;
 	struct sockaddr_storage ss = {0};
 	struct sockaddr *addr = (struct sockaddr *)&ss;
-	struct rist_peer *p = NULL;
 	uint8_t *recv_buf = cctx->buf.recv;
-	uint16_t port = 0;
 
-	ssize_t ret = recvfrom(peer->sd, (char*)recv_buf, RIST_MAX_PACKET_SIZE, MSG_DONTWAIT, (struct sockaddr *)addr, &addrlen);
-	if (ss.ss_family == AF_INET)
-		port = htons(((struct sockaddr_in *)addr)->sin_port);
+	uint8_t ecn = RIST_ECN_NOT_ECT;
+	ssize_t ret;
+	if (peer->config.ecn)
+		ret = rist_recvfrom_ecn(fd, recv_buf, RIST_MAX_PACKET_SIZE, addr, &addrlen, &ecn);
 	else
-		port = htons(((struct sockaddr_in6 *)addr)->sin6_port);
+		ret = recvfrom(fd, (char*)recv_buf, RIST_MAX_PACKET_SIZE, MSG_DONTWAIT, (struct sockaddr *)addr, &addrlen);
 
 #ifndef _WIN32
 	if (ret <= 0) {
@@ -2384,6 +3431,19 @@ static void rist_peer_recv(struct evsocket_ctx *evctx, int fd, short revents, vo
 	}
 
 	recv_bufsize = ret;
+	rist_peer_recv_packet(peer, recv_buf, recv_bufsize, addr, addrlen, now, ecn);
+}
+
+static void rist_peer_recv_packet(struct rist_peer *peer, uint8_t *recv_buf, size_t recv_bufsize, struct sockaddr *addr, socklen_t addrlen, uint64_t now, uint8_t ecn)
+{
+	struct rist_common_ctx *cctx = get_cctx(peer);
+	uint16_t family = peer->address_family;
+	struct rist_peer *p = NULL;
+	uint16_t port = 0;
+	if (addr->sa_family == AF_INET)
+		port = htons(((struct sockaddr_in *)addr)->sin_port);
+	else
+		port = htons(((struct sockaddr_in6 *)addr)->sin6_port);
 
 	struct rist_key *k = &peer->key_rx;
 	uint32_t seq = 0;
@@ -2394,6 +3454,7 @@ static void rist_peer_recv(struct evsocket_ctx *evctx, int fd, short revents, vo
 	uint32_t flow_id = 0;
 	uint16_t gre_proto = 0;
 	uint8_t rist_gre_version = RIST_GRE_VERSION_MIN;
+	bool early_checked = false;
 	if (cctx->profile > RIST_PROFILE_SIMPLE)
 	{
 		struct rist_gre_hdr *gre = NULL;
@@ -2474,7 +3535,43 @@ static void rist_peer_recv(struct evsocket_ctx *evctx, int fd, short revents, vo
 			{
 				int bits = (CHECK_BIT(gre->flags2, 6))? 256 : 128;
 				k->key_size = bits;
+				//C bit: the sender encrypts with ChaCha20, it has to be the cipher we are configured with
+				enum rist_cipher cipher = CHECK_BIT(gre->flags2, 7) ? RIST_CIPHER_CHACHA20 : RIST_CIPHER_AES;
+				if (cipher != p->config.cipher) {
+					pthread_mutex_unlock(&p->peer_lock);
+					if (now > (peer->log_repeat_timer + RIST_LOG_QUIESCE_TIMER)) {
+						rist_log_priv(get_cctx(peer), RIST_LOG_ERROR, "Receiving %s encrypted data, but configured for %s!\n",
+							cipher == RIST_CIPHER_CHACHA20 ? "ChaCha20" : "AES",
+							p->config.cipher == RIST_CIPHER_CHACHA20 ? "ChaCha20" : "AES");
+						peer->log_repeat_timer = now;
+					}
+					return;
+				}
+				_librist_crypto_psk_set_cipher(k, cipher);
 			}
+			//Decrypt the headers first and drop duplicate/late data before paying for
+			//the payload. Only MbedTLS and ChaCha20 can continue mid block, the other
+			//AES backends continue on a block boundary.
+			size_t hdr_len = (gre_proto == RIST_GRE_PROTOCOL_TYPE_VSF ? 4 : 0) + 4 + sizeof(struct rist_rtp_hdr);
+			if (!HAVE_MBEDTLS && k->cipher != RIST_CIPHER_CHACHA20)
+				hdr_len = (hdr_len + AES_BLOCK_SIZE - 1) & ~(size_t)(AES_BLOCK_SIZE - 1);
+			if (p->flow && (gre_proto == RIST_GRE_PROTOCOL_TYPE_VSF || gre_proto == RIST_GRE_PROTOCOL_TYPE_REDUCED) &&
+				recv_bufsize > payload_offset + hdr_len) {
+				uint8_t *hdr = &recv_buf[payload_offset];
+				_librist_crypto_psk_decrypt(k, &recv_buf[nonce_offset], htobe32(seq), rist_gre_version, hdr, hdr, hdr_len);
+				bool is_data = true;
+				if (gre_proto == RIST_GRE_PROTOCOL_TYPE_VSF) {
+					//Only plain RIST data (VSF proto 0, subtype 0) carries an RTP header
+					is_data = (hdr[0] | hdr[1] | hdr[2] | hdr[3]) == 0;
+					hdr += 4;
+				}
+				if (is_data && receiver_early_reject(p, (struct rist_rtp_hdr *)(hdr + 4), now)) {
+					pthread_mutex_unlock(&p->peer_lock);
+					return;
+				}
+				early_checked = true;
+				_librist_crypto_psk_encrypt_continue(k, &recv_buf[payload_offset + hdr_len], &recv_buf[payload_offset + hdr_len], (recv_bufsize - payload_offset - hdr_len));
+			} else
 			_librist_crypto_psk_decrypt(k, &recv_buf[nonce_offset], htobe32(seq), rist_gre_version,&recv_buf[payload_offset],  &recv_buf[payload_offset], (recv_bufsize - payload_offset));
 			pthread_mutex_unlock(&p->peer_lock);
 
@@ -2579,12 +3676,20 @@ protocol_bypass:
 			}
 			return;
 		}
+		if (p && !early_checked && receiver_early_reject(p, rtp, now))
+			return;
 	}
 
 
 	if (!p && (peer->listening || peer->multicast_sender) && (gre_proto == RIST_GRE_PROTOCOL_TYPE_REDUCED || gre_proto == RIST_GRE_PROTOCOL_TYPE_KEEPALIVE || gre_proto == RIST_GRE_PROTOCOL_TYPE_FULL || cctx->profile == RIST_PROFILE_SIMPLE)) {
 		/* No match, new peer creation when on listening mode */
+		if (!peer_lock_live(peer))
+			return;
 		p = peer_initialize(NULL, peer->sender_ctx, peer->receiver_ctx);
+		if (!p) {
+			pthread_mutex_unlock(&cctx->peerlist_lock);
+			return;
+		}
 		p->handled_first = false;
 		p->adv_peer_id = ++cctx->peer_counter;
 		// Copy settings and init/update global variables that depend on settings
@@ -2650,6 +3755,7 @@ protocol_bypass:
 				port = p->remote_port;
 			if (incoming_ip_string) {
 				if (cctx->auth.conn_cb(cctx->auth.arg,incoming_ip_string,port,parent_ip_string, parent_port, p)) {
+					pthread_mutex_unlock(&cctx->peerlist_lock);
 					free(p);
 					return;
 				}
@@ -2681,6 +3787,7 @@ protocol_bypass:
 			}
 		}
 		peer_append(p);
+		pthread_mutex_unlock(&cctx->peerlist_lock);
 	}
 	if (!p)
 		return;
@@ -2760,16 +3867,33 @@ protocol_bypass:
 			if (CHECK_BIT(rtp->flags, 4)) {
 				//RTP extension header
 				struct rist_rtp_hdr_ext * hdr_ext = (struct rist_rtp_hdr_ext *)(&recv_buf[payload_offset]);
-				if (memcmp(&hdr_ext->identifier, "RI", 2) == 0 && be16toh(hdr_ext->length) == 1)
+				uint16_t ext_words = be16toh(hdr_ext->length);
+				size_t ext_len = sizeof(*hdr_ext);
+				if (ext_words == 3)
+					ext_len += sizeof(struct rist_rtp_hdr_ext_stuffing);
+				if (memcmp(&hdr_ext->identifier, "RI", 2) == 0 && (ext_words == 1 || ext_words == 3) && payload.size >= ext_len)
 				{
-					payload.size -= sizeof(*hdr_ext);
-					data_payload += sizeof(*hdr_ext);
+					payload.size -= ext_len;
+					data_payload += ext_len;
+					if (ext_words == 3 && CHECK_BIT(hdr_ext->flags, 6))
+					{
+						const struct rist_rtp_hdr_ext_stuffing *stuffing = (const void *)&hdr_ext[1];
+						if (expand_ts_stuffing(data_payload, &payload.size, hdr_ext->npd_bits, stuffing) < 0)
+							rist_log_priv(cctx, RIST_LOG_WARN, "Malformed TS stuffing extension, passing the packet on as is\n");
+					}
 					if (CHECK_BIT(hdr_ext->flags, 7))
 						expand_null_packets(data_payload, &payload.size, hdr_ext->npd_bits);
+					payload.frame_flags = hdr_ext->flags & (RIST_RTP_EXT_FRAGMENT_MASK | RIST_RTP_EXT_RESTART);
 				}
 				payload.data = (void *)data_payload;
 			}
 			payload.type = RIST_PAYLOAD_TYPE_DATA_RAW;
+			rtp_time = be32toh(rtp->ts);
+			if (RIST_UNLIKELY(p->config.timing_mode == RIST_TIMING_MODE_ARRIVAL))
+				source_time = timestampNTP_u64();
+			else
+				source_time = convertRTPtoNTP(rtp->payload_type, time_extension, rtp_time);
+			seq = (uint32_t)be16toh(rtp->seq);
 		} else {
 			// remap the rtp payload to the correct rtcp header
 			struct rist_rtcp_hdr *rtcp = (struct rist_rtcp_hdr *)rtp;
@@ -2817,6 +3941,8 @@ protocol_bypass:
 			p->log_repeat_timer = now;
 		}
 		// Do not process non EAP packets until the peer has been authenticated!
+		if (payload.type == RIST_PAYLOAD_TYPE_DATA_RAW && p->receiver_mode)
+			rist_receiver_preauth_park(p, seq, flow_id, source_time, now, &payload, retry, rtp->payload_type);
 		return;
 	}
 #endif
@@ -2836,10 +3962,11 @@ protocol_bypass:
 		case RIST_PAYLOAD_TYPE_RTCP:
 			if (p->is_rtcp && !p->handled_first) {
 				rist_new_connection(peer, p, flow_id);
-				if (!peer->receiver_mode) {
+				if (!peer->receiver_mode && peer_lock_live(p)) {
 					// only profile > simple
 					// authenticate sender now that we have an address
 					rist_peer_authenticate(p);
+					pthread_mutex_unlock(&cctx->peerlist_lock);
 				}
 				p->handled_first = true;
 			}
@@ -2858,16 +3985,12 @@ protocol_bypass:
 				rist_new_connection(peer, p, flow_id);
 				p->handled_first = true;
 			}
-			rtp_time = be32toh(rtp->ts);
-			if (RIST_UNLIKELY(p->config.timing_mode == RIST_TIMING_MODE_ARRIVAL))
-				source_time = timestampNTP_u64();
-			else
-				source_time = convertRTPtoNTP(rtp->payload_type, time_extension, rtp_time);
-			seq = (uint32_t)be16toh(rtp->seq);
 			if (RIST_UNLIKELY(!p->receiver_mode))
 				rist_log_priv(get_cctx(peer), RIST_LOG_WARN,
 						"Received data packet on sender, ignoring (%d bytes)...\n", payload.size);
 			else {
+				if (p->config.ecn)
+					rist_receiver_count_ecn(p, ecn);
 				rist_calculate_bitrate((recv_bufsize - payload_offset), &p->bw);//use the unexpanded size to show real BW
 				rist_receiver_recv_data(p, seq, flow_id, source_time, now, &payload, retry, rtp->payload_type);
 			}
@@ -2942,6 +4065,7 @@ int rist_oob_enqueue(struct rist_common_ctx *ctx, struct rist_peer *peer, const
 	{
 		rist_log_priv(get_cctx(peer), RIST_LOG_ERROR,
 				"oob queue is full (%zu bytes), try again later\n", ctx->oob_queue_bytesize);
+		atomic_fetch_add_explicit(&ctx->oob_dropped, 1, memory_order_relaxed);
 		return -1;
 	}
 
@@ -2961,10 +4085,27 @@ int rist_oob_enqueue(struct rist_common_ctx *ctx, struct rist_peer *peer, const
 	return 0;
 }
 
-static void rist_oob_dequeue(struct rist_common_ctx *ctx, int maxcount)
+static void rist_oob_release(struct rist_common_ctx *ctx)
+{
+	struct rist_buffer *oob_buffer = ctx->oob_queue[ctx->oob_queue_read_index];
+	ctx->oob_queue[ctx->oob_queue_read_index] = NULL;
+	pthread_rwlock_wrlock(&ctx->oob_queue_lock);
+	ctx->oob_queue_bytesize -= oob_buffer->size;
+	ctx->oob_queue_read_index++;
+	pthread_rwlock_unlock(&ctx->oob_queue_lock);
+	free(oob_buffer->data);
+	free(oob_buffer);
+}
+
+/* OOB data goes after data, retransmissions and rtcp of the pass. When paced
+ * it also waits while media is queued (media_busy) and slows down while the
+ * media path is losing packets (media_loss) */
+static void rist_oob_dequeue(struct rist_common_ctx *ctx, int maxcount, uint64_t now, bool media_busy, bool media_loss)
 {
 	int counter = 0;
+	bool paced = ctx->oob_sched.max_rate != 0;
 
+	rist_oob_sched_update(&ctx->oob_sched, now, media_loss);
 	while (1) {
 		// If we fall behind, only empty 100 every 5ms (master loop)
 		if (counter++ > maxcount) {
@@ -2981,15 +4122,29 @@ static void rist_oob_dequeue(struct rist_common_ctx *ctx, int maxcount)
 		struct rist_buffer *oob_buffer = ctx->oob_queue[ctx->oob_queue_read_index];
 		if (!oob_buffer->data) {
 			rist_log_priv(ctx, RIST_LOG_ERROR, "Null oob buffer, skipping!!!\n");
-			ctx->oob_queue_read_index++;
+			rist_oob_release(ctx);
 			continue;
 		}
 
+		// Late oob data is dropped rather than sent in a burst
+		uint64_t delay = now > oob_buffer->time ? now - oob_buffer->time : 0;
+		if (ctx->oob_max_delay && delay > ctx->oob_max_delay) {
+			atomic_fetch_add_explicit(&ctx->oob_dropped, 1, memory_order_relaxed);
+			rist_oob_release(ctx);
+			continue;
+		}
+		if (paced && (media_busy || !rist_oob_sched_take(&ctx->oob_sched, oob_buffer->size)))
+			break;
+
 		uint8_t *payload = oob_buffer->data;
 		rist_send_common_rtcp(oob_buffer->peer, RIST_PAYLOAD_TYPE_DATA_OOB, &payload[RIST_MAX_PAYLOAD_OFFSET],
 				oob_buffer->size, 0, 0, 0, 0);
-		ctx->oob_queue_bytesize -= oob_buffer->size;
-		ctx->oob_queue_read_index++;
+		rist_calculate_bitrate(oob_buffer->size, &ctx->oob_bw);
+		ctx->oob_sent++;
+		ctx->oob_eight_times_delay = ctx->oob_eight_times_delay ? ctx->oob_eight_times_delay - ctx->oob_eight_times_delay / 8 + delay : delay * 8;
+		if (delay > ctx->oob_delay_max)
+			ctx->oob_delay_max = delay;
+		rist_oob_release(ctx);
 	}
 
 	return;
@@ -3042,6 +4197,29 @@ static void sender_send_nacks(struct rist_sender *ctx)
 
 }
 
+/* Release writers held back by the flow control once the queue drained */
+static void sender_flow_control_check(struct rist_sender *ctx)
+{
+	if (!atomic_load_explicit(&ctx->write_backpressure, memory_order_acquire))
+		return;
+	if (rist_get_sender_queue_pending(ctx) > ctx->write_low_watermark)
+		return;
+	pthread_mutex_lock(&ctx->queue_lock);
+	atomic_store_explicit(&ctx->write_backpressure, false, memory_order_release);
+	pthread_cond_broadcast(&ctx->write_ready_condition);
+	pthread_mutex_unlock(&ctx->queue_lock);
+	if (ctx->write_ready_callback)
+		ctx->write_ready_callback(ctx->write_ready_callback_argument);
+	if (ctx->write_ready_notify_fd) {
+		// send a write ready signal by writing a single byte of value 0
+		char empty = '\0';
+		if (write(ctx->write_ready_notify_fd, &empty, 1) == -1)
+		{
+			// Only a signaling mechanism, the application can still poll rist_sender_queue_info_get
+		}
+	}
+}
+
 static void sender_send_data(struct rist_sender *ctx, int maxcount)
 {
 	int counter = 0;
@@ -3161,9 +4339,19 @@ static PTHREAD_START_FUNC(receiver_pthread_dataout, arg)
 			rist_log_priv(&receiver_ctx->common, RIST_LOG_ERROR, "Error %d in receiver data out loop\n", ret);
 		if (atomic_load_explicit(&flow->shutdown,memory_order_acquire) > 0)
 			break;
-		if (atomic_load_explicit(&flow->receiver_queue_size, memory_order_acquire) > 0) {
+		// a resync drain releases everything queued at once, the next packet rebases the flow
+		bool resync_draining = atomic_load_explicit(&flow->resync_draining, memory_order_acquire);
+		// the application drains the fifo whether or not more data comes in
+		if (receiver_ctx->fifo_queue_size)
+			receiver_fifo_watermarks(receiver_ctx, flow, receiver_fifo_count(receiver_ctx, flow));
+		// with a frame pending its deadline has to be watched even when the queue ran empty
+		if (atomic_load_explicit(&flow->receiver_queue_size, memory_order_acquire) > 0 || flow->frame_active) {
 			receiver_output(receiver_ctx, flow);
 		}
+		if (resync_draining) {
+			flow->receiver_queue_has_items = false;
+			atomic_store_explicit(&flow->resync_draining, false, memory_order_release);
+		}
 
 		if (flow->flow_auto_buffer_scaling) {
 			uint64_t now = timestampNTP_u64();
@@ -3175,12 +4363,16 @@ static PTHREAD_START_FUNC(receiver_pthread_dataout, arg)
 					}
 					next_buffer_adjust_step += ONE_SECOND;
 					uint64_t tmp_target_buffer_size = 0;
-					for (size_t i=0; i < flow->peer_lst_len; i++) {
-						struct rist_peer *p = flow->peer_lst[i];
+					unsigned epoch = rist_epoch_enter(&receiver_ctx->common.epoch);
+					size_t peer_lst_len;
+					struct rist_peer **peer_lst = rist_peer_lst_get(&flow->peer_lst, &flow->peer_lst_len, &peer_lst_len);
+					for (size_t i=0; i < peer_lst_len; i++) {
+						struct rist_peer *p = peer_lst[i];
 						if (p->recovery_buffer_ticks > tmp_target_buffer_size) {
 							tmp_target_buffer_size = p->recovery_buffer_ticks;
 						}
 					}
+					rist_epoch_leave(&receiver_ctx->common.epoch, epoch);
 
 					uint64_t diff = target_recovery_buffer_size - tmp_target_buffer_size;
 					if (tmp_target_buffer_size > target_recovery_buffer_size)
@@ -3231,7 +4423,8 @@ static void rist_peer_periodic(struct rist_peer *p, uint64_t now) {
 		}
 		if (get_cctx(p)->profile == RIST_PROFILE_MAIN && p->next_keepalive_packet <= now) {
 			p->next_keepalive_packet = now + ONE_SECOND;
-			_librist_proto_gre_send_keepalive(p, p->rist_gre_version);
+			if (rist_return_budget_take(p, RIST_RETURN_KEEPALIVE, sizeof(struct rist_gre_keepalive)))
+				_librist_proto_gre_send_keepalive(p, p->rist_gre_version);
 #if HAVE_SRP_SUPPORT
 			if (!p->child && !eap_is_authenticated(p->eap_ctx) && p->eap_authentication_state == 2 && p->parent && p->parent->multicast_sender)  {
 				p->eap_authentication_state = 1;
@@ -3276,6 +4469,8 @@ void rist_timeout_check(struct rist_common_ctx *cctx, uint64_t now)
 	while (peer)
 	{
 		struct rist_peer *next = peer->next;
+		if (peer->receiver_mode)
+			rist_receiver_preauth_expire(peer, now);
 		uint64_t last_rtcp_received = peer->last_pkt_received;
 		if (cctx->profile == RIST_PROFILE_SIMPLE &&
 			!peer->is_rtcp && peer->peer_rtcp != NULL &&
@@ -3311,6 +4506,8 @@ PTHREAD_START_FUNC(sender_pthread_protocol, arg)
 	// loop behavior parameters
 	int max_dataperloop = 100;
 	int max_oobperloop = 100;
+	// nacks that came in since the last oob pass
+	size_t oob_retry_mark = ctx->sender_retry_queue_write_index;
 
 	int max_jitter_ms = ctx->common.rist_max_jitter / RIST_CLOCK;
 	uint64_t rist_stats_interval = ctx->common.stats_report_time; // 1 second
@@ -3362,21 +4559,30 @@ PTHREAD_START_FUNC(sender_pthread_protocol, arg)
 			// sender_peer_delete(peer->sender_ctx, peer);
 		}
 
+		if (ctx->common.stats_shm) {
+			unsigned epoch = rist_epoch_enter(&ctx->common.epoch);
+			rist_stats_shm_sender_publish(ctx, now);
+			rist_epoch_leave(&ctx->common.epoch, epoch);
+		}
+
 		// socket polls (returns as fast as possible and processes the next 100 socket events)
-		pthread_mutex_lock(&ctx->common.peerlist_lock);
+		// from a read section, the handlers only take the peerlist_lock to change the lists
+		unsigned poll_epoch = rist_epoch_enter(&ctx->common.epoch);
 		evsocket_loop_single(ctx->common.evctx, 0, 100);
-		pthread_mutex_unlock(&ctx->common.peerlist_lock);
+		rist_epoch_leave(&ctx->common.epoch, poll_epoch);
 
 		// keepalive timer
 		sender_peer_events(ctx, now);
+		// free the peer lists retired by writers once no reader can see them
+		rist_epoch_reclaim(&ctx->common.epoch);
 
 
 		// Send data and process nacks
 		pthread_mutex_lock(&ctx->queue_lock);
 		if (ctx->sender_queue_bytesize > 0) {
-			pthread_mutex_lock(&ctx->common.peerlist_lock);
+			unsigned epoch = rist_epoch_enter(&ctx->common.epoch);
 			sender_send_data(ctx, max_dataperloop);
-			pthread_mutex_unlock(&ctx->common.peerlist_lock);
+			rist_epoch_leave(&ctx->common.epoch, epoch);
 			// Group nacks and send them all at rist_max_jitter intervals
 			if (now > nacks_next_time) {
 				sender_send_nacks(ctx);
@@ -3384,11 +4590,18 @@ PTHREAD_START_FUNC(sender_pthread_protocol, arg)
 			}
 			/* perform queue cleanup */
 			rist_clean_sender_enqueue(ctx);
+			rist_sender_history_spill(ctx);
 		}
 		pthread_mutex_unlock(&ctx->queue_lock);
-		// Send oob data
-		if (ctx->common.oob_queue_bytesize > 0)
-			rist_oob_dequeue(&ctx->common, max_oobperloop);
+		sender_flow_control_check(ctx);
+		// Send oob data, after pending data and retransmissions
+		if (ctx->common.oob_queue_bytesize > 0) {
+			// the retry queue read index points at the last retry sent, 1 is empty
+			bool media_busy = rist_get_sender_queue_pending(ctx) >= 10 || rist_get_sender_retry_queue_size(ctx) > 1;
+			bool media_loss = ctx->sender_retry_queue_write_index != oob_retry_mark;
+			rist_oob_dequeue(&ctx->common, max_oobperloop, now, media_busy, media_loss);
+		}
+		oob_retry_mark = ctx->sender_retry_queue_write_index;
 
 	}
 
@@ -3427,6 +4640,7 @@ int init_common_ctx(struct rist_common_ctx *ctx, enum rist_profile profile)
 
 	ctx->profile = profile;
 	ctx->stats_report_time = 0;
+	atomic_init(&ctx->oob_dropped, 0);
 
 	if (pthread_mutex_init(&ctx->peerlist_lock, NULL) != 0) {
 		rist_log_priv3( RIST_LOG_ERROR, "Failed to init ctx->peerlist_lock\n");
@@ -3440,6 +4654,14 @@ int init_common_ctx(struct rist_common_ctx *ctx, enum rist_profile profile)
 		rist_log_priv3( RIST_LOG_ERROR, "Failed to init ctx->flows_lock\n");
 		return -1;
 	}
+	if (rist_epoch_init(&ctx->epoch) != 0) {
+		rist_log_priv3( RIST_LOG_ERROR, "Failed to init ctx->epoch\n");
+		return -1;
+	}
+	if (rist_reaper_init(&ctx->reaper, &ctx->epoch) != 0) {
+		rist_log_priv3( RIST_LOG_ERROR, "Failed to init ctx->reaper\n");
+		return -1;
+	}
 	if (pthread_mutex_init(&ctx->stats_lock, NULL) != 0) {
 		rist_log_priv3( RIST_LOG_ERROR, "Failed to init ctx->stats_lock\n");
 		return -1;
@@ -3477,29 +4699,35 @@ static inline void peer_remove_linked_list(struct rist_peer *peer) {
 
 void remove_peer_from_flow(struct rist_peer *peer)
 {
-	bool found = false;
-	for (size_t i = 0; i < peer->flow->peer_lst_len; i++)
-	{
-		if (peer->flow->peer_lst[i] == peer)
-		{
-			peer->flow->peer_lst[i] = peer->flow->peer_lst[(peer->flow->peer_lst_len -1)];
-			found = true;
-			break;
-		}
-	}
-	if (found)
+	rist_peer_lst_remove(get_cctx(peer), &peer->flow->peer_lst, &peer->flow->peer_lst_len, peer);
+}
+
+/* Last part of rist_peer_remove, once no reader can hold the peer anymore */
+static void peer_free(void *arg)
+{
+	struct rist_peer *peer = arg;
+	/* striped source port sockets */
+	if (!peer->parent && peer->stripe_count)
+		rist_stripe_sockets_close(peer);
+	if (!peer->parent && peer->sd > -1)
 	{
-		if (peer->flow->peer_lst_len > 1)
-		{
-			peer->flow->peer_lst = realloc(peer->flow->peer_lst, sizeof(peer) * (peer->flow->peer_lst_len -1));
-			peer->flow->peer_lst_len--;
-		} else
-		{
-			free(peer->flow->peer_lst);
-			peer->flow->peer_lst_len = 0;
-			peer->flow->peer_lst = NULL;
-		}
+		rist_log_priv2(get_cctx(peer)->logging_settings, RIST_LOG_INFO, "[CLEANUP] Closing peer socket on port %d\n", peer->local_port);
+		udpsocket_close(peer->sd);
+		peer->sd = -1;
 	}
+	_librist_crypto_psk_rist_key_destroy(&peer->key_rx);
+	_librist_crypto_psk_rist_key_destroy(&peer->key_rx_odd);
+	_librist_crypto_psk_rist_key_destroy(&peer->key_tx);
+	_librist_crypto_psk_rist_key_destroy(&peer->key_tx_odd);
+#if HAVE_SRP_SUPPORT
+	eap_delete_ctx(&peer->eap_ctx);
+#endif
+	if (peer->url)
+		free(peer->url);
+	rist_receiver_preauth_flush(peer);
+	/* a handler that was still running may have attached the path again */
+	rist_path_detach(get_cctx(peer), peer);
+	free(peer);
 }
 
 int rist_peer_remove(struct rist_common_ctx *ctx, struct rist_peer *peer, struct rist_peer **next)
@@ -3543,53 +4771,25 @@ int rist_peer_remove(struct rist_common_ctx *ctx, struct rist_peer *peer, struct
 		remove_peer_from_flow(peer);
 	}
 
-	if (peer->sender_ctx && peer->sender_ctx->peer_lst_len > 0) {
-		bool found = false;
-        for (size_t i = 0; i < peer->sender_ctx->peer_lst_len; i++) {
-            if (peer->sender_ctx->peer_lst[i] == peer) {
-              peer->sender_ctx->peer_lst[i] = peer->sender_ctx->peer_lst[(peer->sender_ctx->peer_lst_len -1)];
-              found = true;
-              break;
-            }
-		}
-		if (found) {
-			if (peer->sender_ctx->peer_lst_len > 1)
-			{
-				peer->sender_ctx->peer_lst = realloc(peer->sender_ctx->peer_lst, sizeof(peer) * (peer->sender_ctx->peer_lst_len -1));
-				peer->sender_ctx->peer_lst_len--;
-			} else
-			{
-				free(peer->sender_ctx->peer_lst);
-				peer->sender_ctx->peer_lst_len = 0;
-				peer->sender_ctx->peer_lst = NULL;
-			}
-		}
-    }
+	if (peer->sender_ctx && peer->sender_ctx->peer_lst_len > 0)
+		rist_peer_lst_remove(ctx, &peer->sender_ctx->peer_lst, &peer->sender_ctx->peer_lst_len, peer);
 
-	if (peer->receiver_ctx != NULL && peer->flow != NULL) {
-		pthread_mutex_lock(&peer->flow->mutex);
-		bool found = false;
-		for (size_t i=0; i < peer->flow->peer_lst_len; i++) {
-			if (peer->flow->peer_lst[i] == peer) {
-				peer->flow->peer_lst[i] = peer->flow->peer_lst[(peer->flow->peer_lst_len -1)];
-				found = true;
-				break;
-			}
-		}
+	if (peer->receiver_ctx != NULL && peer->flow != NULL)
+		rist_peer_lst_remove(ctx, &peer->flow->peer_lst, &peer->flow->peer_lst_len, peer);
 
-		if (found) {
-			if (peer->flow->peer_lst_len > 1) {
-				peer->flow->peer_lst = realloc(peer->flow->peer_lst, sizeof(peer) * (peer->flow->peer_lst_len -1));
-				peer->flow->peer_lst_len--;
-			} else {
-				free(peer->flow->peer_lst);
-				peer->flow->peer_lst_len = 0;
-				peer->flow->peer_lst = NULL;
-			}
-		}
-		pthread_mutex_unlock(&peer->flow->mutex);
-	}
+	/* The peer is unreachable from PEERS and the peer lists now. The protocol
+	 * thread may still hold it in the read section it services the sockets
+	 * from, which can be waiting for our lock: only the events go here, the
+	 * sockets are closed and the peer freed by the reaper after the grace
+	 * period. */
 
+	/* shared multicast socket, closed with its last peer */
+	if (!peer->parent && peer->shared_socket)
+		rist_shared_socket_detach(peer);
+
+	/* receive events of the striped source ports */
+	if (!peer->parent && peer->stripe_count)
+		rist_stripe_events_remove(peer);
 
 	/* data receive event */
 	if (!peer->parent && peer->event_recv)
@@ -3597,6 +4797,7 @@ int rist_peer_remove(struct rist_common_ctx *ctx, struct rist_peer *peer, struct
 		rist_log_priv2(ctx->logging_settings, RIST_LOG_INFO, "[CLEANUP] Removing peer data received event\n");
 		struct evsocket_ctx *evctx = ctx->evctx;
 		evsocket_delevent(evctx, peer->event_recv);
+		peer->event_recv = NULL;
 	}
 
 	/* rtcp timer */
@@ -3606,23 +4807,6 @@ int rist_peer_remove(struct rist_common_ctx *ctx, struct rist_peer *peer, struct
 		peer->send_keepalive = false;
 	}
 
-
-	if (!peer->parent && peer->sd > -1)
-	{
-		rist_log_priv2(ctx->logging_settings, RIST_LOG_INFO, "[CLEANUP] Closing peer socket on port %d\n", peer->local_port);
-		udpsocket_close(peer->sd);
-		peer->sd = -1;
-	}
-	_librist_crypto_psk_rist_key_destroy(&peer->key_rx);
-	_librist_crypto_psk_rist_key_destroy(&peer->key_rx_odd);
-	_librist_crypto_psk_rist_key_destroy(&peer->key_tx);
-	_librist_crypto_psk_rist_key_destroy(&peer->key_tx_odd);
-#if HAVE_SRP_SUPPORT
-	eap_delete_ctx(&peer->eap_ctx);
-#endif
-	if (peer->url)
-		free(peer->url);
-
 	if (peer->parent != NULL && ctx->auth.disconn_cb) {
 		ctx->auth.disconn_cb(ctx->auth.arg, peer);
 	}
@@ -3633,8 +4817,9 @@ int rist_peer_remove(struct rist_common_ctx *ctx, struct rist_peer *peer, struct
 	if (ctx->oob_current_peer == peer) {
 		ctx->oob_current_peer = NULL;
 	}
+	rist_path_detach(ctx, peer);
 
-	free(peer);
+	rist_reaper_defer(&ctx->reaper, &peer->reap_job, peer, peer_free, sizeof(*peer));
 	return 0;
 }
 
@@ -3741,19 +4926,17 @@ struct rist_peer *rist_sender_peer_insert_local(struct rist_sender *ctx,
 
 void rist_empty_oob_queue(struct rist_common_ctx *ctx)
 {
-	uint16_t index = 0;
+	// Sent entries were freed by rist_oob_dequeue
+	uint16_t index = ctx->oob_queue_read_index;
 	while (1) {
 		if (index == ctx->oob_queue_write_index) {
 			break;
 		}
 		struct rist_buffer *oob_buffer = ctx->oob_queue[index];
-		if (oob_buffer->data) {
-			free(oob_buffer->data);
-			oob_buffer->data = NULL;
-		}
 		if (oob_buffer) {
+			free(oob_buffer->data);
 			free(oob_buffer);
-			oob_buffer = NULL;
+			ctx->oob_queue[index] = NULL;
 		}
 		index++;
 	}
@@ -3762,6 +4945,8 @@ void rist_empty_oob_queue(struct rist_common_ctx *ctx)
 
 void rist_receiver_destroy_local(struct rist_receiver *ctx)
 {
+	/* the protocol thread is gone, whatever is left is torn down inline */
+	rist_reaper_destroy(&ctx->common.reaper);
 
 	pthread_mutex_lock(&ctx->common.peerlist_lock);
 
@@ -3788,6 +4973,7 @@ void rist_receiver_destroy_local(struct rist_receiver *ctx)
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Peers cleanup complete\n");
 
 	pthread_mutex_unlock(&ctx->common.peerlist_lock);
+	rist_stats_shm_writer_close(&ctx->common);
 
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Freeing main data buffers\n");
 	struct rist_buffer *b = ctx->common.rist_free_buffer;
@@ -3801,6 +4987,18 @@ void rist_receiver_destroy_local(struct rist_receiver *ctx)
 
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Removing peerlist_lock\n");
 	pthread_mutex_destroy(&ctx->common.peerlist_lock);
+	rist_epoch_destroy(&ctx->common.epoch);
+	/* the readers belong to the context, the handles the application did not
+	 * close are invalid from here on */
+	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Freeing flow readers\n");
+	struct rist_flow_reader *reader = ctx->flow_readers;
+	while (reader) {
+		struct rist_flow_reader *next_reader = reader->next;
+		pthread_cond_destroy(&reader->condition);
+		pthread_mutex_destroy(&reader->mutex);
+		free(reader);
+		reader = next_reader;
+	}
 	if (ctx->common.oob_data_enabled) {
 		rist_log_priv(&ctx->common, RIST_LOG_INFO, "Freeing oob fifo queue\n");
 		rist_empty_oob_queue(&ctx->common);
@@ -3868,6 +5066,74 @@ void _librist_receiver_buffer_calc(struct rist_receiver *ctx) {
 	pthread_mutex_unlock(&ctx->common.peerlist_lock);
 }
 
+/* Overload shed tier: stop taking data from the remaining flow with the lowest
+ * weight (the newest one among equals), the last flow is always kept */
+static void receiver_overload_shed(struct rist_receiver *ctx)
+{
+	struct rist_flow *victim = NULL;
+	size_t active = 0;
+	for (struct rist_flow *f = ctx->common.FLOWS; f; f = f->next) {
+		if (f->overload_shed)
+			continue;
+		active++;
+		if (!victim || f->nack_weight <= victim->nack_weight)
+			victim = f;
+	}
+	if (active < 2)
+		return;
+	victim->overload_shed = true;
+	rist_log_priv(&ctx->common, RIST_LOG_WARN, "Overload: shedding flow %"PRIu32" (weight %"PRIu32")\n",
+			victim->flow_id, victim->nack_weight);
+}
+
+/* Feeds one loop iteration to the overload detector and applies tier changes */
+static void receiver_overload_update(struct rist_receiver *ctx, uint64_t now, uint64_t lag, bool backlog)
+{
+	struct rist_overload *o = &ctx->overload;
+	if (o->max_tier == RIST_OVERLOAD_TIER_NONE && o->tier == RIST_OVERLOAD_TIER_NONE)
+		return;
+
+	uint32_t queue_fill = 0;
+	for (struct rist_flow *f = ctx->common.FLOWS; f; f = f->next) {
+		uint32_t fill = 0;
+		if (f->missing_counter_max)
+			fill = f->missing_counter * 100 / f->missing_counter_max;
+		if (ctx->fifo_queue_size && !ctx->receiver_data_callback) {
+			uint32_t fifo_fill = receiver_fifo_count(ctx, f) * 100 / ctx->fifo_queue_size;
+			if (fifo_fill > fill)
+				fill = fifo_fill;
+		}
+		if (fill > queue_fill)
+			queue_fill = fill;
+	}
+
+	enum rist_overload_tier old_tier = o->tier;
+	rist_overload_sample(o, lag, backlog, queue_fill);
+	int change = rist_overload_evaluate(o, now);
+	if (o->tier > o->max_tier) {
+		/* max_tier was lowered */
+		o->exited[o->tier]++;
+		o->tier--;
+		change = -1;
+	}
+	if (change == 0)
+		return;
+
+	ctx->common.log_quiet = o->tier >= RIST_OVERLOAD_TIER_REDUCED;
+	if (change > 0) {
+		if (o->tier != old_tier)
+			rist_log_priv(&ctx->common, RIST_LOG_WARN, "Overload: protocol loop is falling behind, entering tier %d\n", o->tier);
+		if (o->tier == RIST_OVERLOAD_TIER_SHED)
+			receiver_overload_shed(ctx);
+	} else {
+		rist_log_priv(&ctx->common, RIST_LOG_WARN, "Overload: protocol loop keeps up again, leaving tier %d\n", old_tier);
+		if (old_tier == RIST_OVERLOAD_TIER_SHED) {
+			for (struct rist_flow *f = ctx->common.FLOWS; f; f = f->next)
+				f->overload_shed = false;
+		}
+	}
+}
+
 PTHREAD_START_FUNC(receiver_pthread_protocol, arg)
 {
 	struct rist_receiver *ctx = (struct rist_receiver *) arg;
@@ -3879,6 +5145,10 @@ PTHREAD_START_FUNC(receiver_pthread_protocol, arg)
 	ctx->common.nacks_next_time = timestampNTP_u64();
 	uint64_t checks_next_time = now;
 	uint64_t buffer_check_next_time = now + ONE_SECOND;
+	uint64_t loop_time = now;
+	int nacks_deferred = 0;
+	// overload is judged on 100ms windows, an iteration may overrun the poll timeout by one timer period
+	rist_overload_init(&ctx->overload, rist_nack_interval, (uint64_t)100 * RIST_CLOCK, now);
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Starting receiver protocol loop with %d ms timer\n", max_jitter_ms);
 
 	while (!atomic_load_explicit(&ctx->common.shutdown, memory_order_acquire)) {
@@ -3887,9 +5157,11 @@ PTHREAD_START_FUNC(receiver_pthread_protocol, arg)
 		if (ctx->common.PEERS == NULL) {
 			pthread_mutex_unlock(&ctx->common.peerlist_lock);
 			usleep(5000);
+			loop_time = timestampNTP_u64();
 			continue;
 		}
 		pthread_mutex_unlock(&ctx->common.peerlist_lock);
+		enum rist_overload_tier tier = ctx->overload.tier;
 
 		// Limit scope of `struct rist_flow *f` for clarity since it is used again later in this loop.
 		{
@@ -3943,6 +5215,9 @@ PTHREAD_START_FUNC(receiver_pthread_protocol, arg)
 				}
 				if (now > f->stats_next_time) {
 					f->stats_next_time += f->stats_report_time;
+					// overloaded: report every fourth period only
+					if (tier >= RIST_OVERLOAD_TIER_REDUCED)
+						f->stats_next_time += 3 * f->stats_report_time;
 					rist_receiver_flow_statistics(ctx, f);
 				}
 				pthread_mutex_unlock(&f->mutex);
@@ -3950,6 +5225,12 @@ PTHREAD_START_FUNC(receiver_pthread_protocol, arg)
 			}
 		}
 
+		if (ctx->common.stats_shm && tier < RIST_OVERLOAD_TIER_REDUCED) {
+			unsigned epoch = rist_epoch_enter(&ctx->common.epoch);
+			rist_stats_shm_receiver_publish(ctx, now);
+			rist_epoch_leave(&ctx->common.epoch, epoch);
+		}
+
 		// TODO: rist_max_jitter should be proportional to the max bitrate according to the
 		// following table
 		//Mbps  ms
@@ -3959,39 +5240,60 @@ PTHREAD_START_FUNC(receiver_pthread_protocol, arg)
 		//1000	1.00
 
 		// socket polls (returns in max_jitter_ms max and processes the next 100 socket events)
-		pthread_mutex_lock(&ctx->common.peerlist_lock);
+		ctx->common.recv_backlog = false;
+		// from a read section, the handlers only take the peerlist_lock to change the lists
+		unsigned poll_epoch = rist_epoch_enter(&ctx->common.epoch);
 		evsocket_loop_single(ctx->common.evctx, max_jitter_ms, 100);
-		pthread_mutex_unlock(&ctx->common.peerlist_lock);
+		bool backlog = ctx->common.recv_backlog;
+		// overloaded: a backlogged read round is followed by another one before the nacks
+		if (tier >= RIST_OVERLOAD_TIER_DRAIN && backlog)
+			evsocket_loop_single(ctx->common.evctx, 0, 100);
+		rist_epoch_leave(&ctx->common.epoch, poll_epoch);
 		// keepalive timer
 		receiver_peer_events(ctx, now);
+		// free the flows and peer lists retired by writers once no reader can see them
+		rist_epoch_reclaim(&ctx->common.epoch);
 
-		// nacks timer
-		if (now > ctx->common.nacks_next_time) {
+		// nacks timer, when overloaded a backlogged loop defers it by up to 4 periods
+		if (now > ctx->common.nacks_next_time &&
+			(tier < RIST_OVERLOAD_TIER_DRAIN || !backlog || nacks_deferred++ >= 4)) {
+			nacks_deferred = 0;
 			ctx->common.nacks_next_time += rist_nack_interval;
 			// process nacks on every loop (5 ms interval max)
 			struct rist_flow *f = ctx->common.FLOWS;
 			while (f) {
-				receiver_nack_output(ctx, f);
+				if (!f->overload_shed)
+					receiver_nack_output(ctx, f);
 				f = f->next;
 			}
 		}
 		/* marks peer as dead, run every second */
 		if (now > checks_next_time)
 		{
-			checks_next_time += (uint64_t)50 * (uint64_t)RIST_CLOCK;
+			checks_next_time += (uint64_t)(tier >= RIST_OVERLOAD_TIER_REDUCED ? 200 : 50) * (uint64_t)RIST_CLOCK;
 			pthread_mutex_lock(&ctx->common.peerlist_lock);
 			rist_timeout_check(&ctx->common, now);
 			pthread_mutex_unlock(&ctx->common.peerlist_lock);
 		}
-		// Send oob data
-		if (ctx->common.oob_queue_bytesize > 0)
-			rist_oob_dequeue(&ctx->common, max_oobperloop);
+		// Send oob data, backlogged sockets and outstanding losses on the flows hold it back
+		if (ctx->common.oob_queue_bytesize > 0) {
+			bool media_loss = false;
+			for (struct rist_flow *f = ctx->common.FLOWS; f != NULL && !media_loss; f = f->next)
+				media_loss = f->missing_counter > 0;
+			rist_oob_dequeue(&ctx->common, max_oobperloop, now, backlog || tier >= RIST_OVERLOAD_TIER_DRAIN, media_loss);
+		}
 
 		if (now >= buffer_check_next_time) {
-			_librist_receiver_buffer_calc(ctx);
+			if (tier < RIST_OVERLOAD_TIER_REDUCED)
+				_librist_receiver_buffer_calc(ctx);
 			buffer_check_next_time += 2 * ONE_SECOND;
 		}
 
+		uint64_t loop_end = timestampNTP_u64();
+		uint64_t loop_duration = loop_end - loop_time;
+		uint64_t poll_budget = (uint64_t)max_jitter_ms * RIST_CLOCK;
+		receiver_overload_update(ctx, loop_end, loop_duration > poll_budget ? loop_duration - poll_budget : 0, backlog);
+		loop_time = loop_end;
 	}
 #ifdef _WIN32
 	WSACleanup();
@@ -4004,6 +5306,9 @@ PTHREAD_START_FUNC(receiver_pthread_protocol, arg)
 
 void rist_sender_destroy_local(struct rist_sender *ctx)
 {
+	/* the protocol thread is gone, whatever is left is torn down inline */
+	rist_reaper_destroy(&ctx->common.reaper);
+
 	rist_log_priv(&ctx->common, RIST_LOG_INFO,
 			"Starting peers cleanup, count %d\n",
 			(unsigned) ctx->peer_lst_len);
@@ -4020,11 +5325,15 @@ void rist_sender_destroy_local(struct rist_sender *ctx)
 		rist_peer_remove(&ctx->common, peer, &next);
 		peer = next;
 	}
+	free(ctx->peer_lst);
+	ctx->peer_lst = NULL;
 	evsocket_destroy(ctx->common.evctx);
 
 	pthread_mutex_unlock(&ctx->common.peerlist_lock);
 	pthread_mutex_destroy(&ctx->common.peerlist_lock);
+	rist_epoch_destroy(&ctx->common.epoch);
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Peers cleanup complete\n");
+	rist_stats_shm_writer_close(&ctx->common);
 
 	if (ctx->common.oob_data_enabled) {
 		rist_log_priv(&ctx->common, RIST_LOG_INFO, "Freeing oob fifo queue\n");
@@ -4054,6 +5363,9 @@ void rist_sender_destroy_local(struct rist_sender *ctx)
 		}
 		ctx->sender_queue_delete_index = (ctx->sender_queue_delete_index + 1)& (ctx->sender_queue_max -1);
 	}
+	rist_history_store_close(&ctx->history);
+	free(ctx->history_scratch);
+	pthread_cond_destroy(&ctx->write_ready_condition);
 	free(ctx);
 	ctx = NULL;
 }
@@ -27,6 +27,12 @@
 #include "librist.h"
 #include "udpsocket.h"
 #include "crypto/psk.h"
+#include "epoch.h"
+#include "reaper.h"
+#include "overload.h"
+#include "oob_sched.h"
+#include "history_store.h"
+#include "socket_filter.h"
 #include <errno.h>
 #include <stdatomic.h>
 #include "librist/logging.h"
@@ -40,13 +46,32 @@
 #define RIST_RETRY_QUEUE_BUFFERS ((UINT16_SIZE) * 4)
 #define RIST_OOB_QUEUE_BUFFERS ((UINT16_SIZE) * 2)
 #define RIST_DATAOUT_QUEUE_BUFFERS (1024)
+#define RIST_DATAOUT_QUEUE_GROW_BUFFERS ((UINT16_SIZE))
+#define RIST_PREAUTH_QUEUE_BUFFERS (1024)
+// Pre-authentication packets parked over all peers of a receiver, spoofed sources each get a peer
+#define RIST_PREAUTH_CTX_MAX_BUFFERS (4 * RIST_PREAUTH_QUEUE_BUFFERS)
+#define RIST_PREAUTH_CTX_MAX_BYTES (8 * 1024 * 1024)
 // This will restrict the use of the library to the configured maximum packet size
 #define RIST_MAX_PACKET_SIZE (10000)
+// Frame writes (rist_sender_data_write_frame): default fragment payload and receiver reassembly limit
+#define RIST_FRAME_FRAGMENT_SIZE_DEFAULT (1316)
+#define RIST_FRAME_MAX_SIZE_DEFAULT (16 * 1024 * 1024)
 #define RIST_RTT_MIN (3)
+// Discontinuity detection: packets in a row that confirm a new sequence/timestamp space,
+// number of packets a sender flags with the restart marker after it started
+#define RIST_RESYNC_CONFIRM_PACKETS (4)
+#define RIST_RESTART_MARKER_PACKETS (64)
+// Cut-through relay: downstream nacks for packets the relay sender does not hold (power of 2)
+#define RIST_RELAY_REQUESTS (256)
+// Early re-nack: nack packets per flow whose repairs are checked for gaps
+#define RIST_NACK_BATCHES (8)
+// Sender history store: packets moved out of the heap per protocol loop
+#define RIST_HISTORY_SPILL_MAX (256)
 
 /* nack requests are sent every time a data packet is received. */
 /* this timer will be triggered to ensure we output nacks even when there is no data coming in */
 #define RIST_MAX_JITTER (5) /* In milliseconds */
+#define RIST_MAX_STRIPE_PORTS (16)
 #define RIST_PING_INTERVAL (100)  /* In milliseconds, how long to space ping requests */
 #define RIST_PBKDF2_HMAC_SHA256_ITERATIONS (1024)
 #define RIST_AES_KEY_REUSE_TIMES UINT32_MAX
@@ -77,6 +102,7 @@ enum rist_peer_state {
 	RIST_PEER_STATE_PING = 1,
 	RIST_PEER_STATE_CONNECT = 2
 };
+struct rist_wire_image;
 struct rist_buffer {
 	void *data;
 	size_t size;
@@ -92,8 +118,10 @@ struct rist_buffer {
 	uint64_t packet_time;//Timestamp based on the RTP time of the packet
 	uint64_t target_output_time;//packet_time + buffer
 
-	uint8_t fragment_number;
-	uint8_t fragment_final;
+	uint8_t frame_flags;//RIST_RTP_EXT_FRAGMENT* bits of frame fragments, RIST_RTP_EXT_RESTART
+	struct rist_wire_image *wire;//Encrypted datagram as last sent (sender wire cache)
+	bool cold;//Payload moved to the sender history store at cold_pos, data is NULL
+	uint64_t cold_pos;
 	// TODO: These three are only used by sender ... do I split buffer into sender and receiver?
 	uint64_t last_retry_request;
 	uint8_t transmit_count;
@@ -114,6 +142,14 @@ struct rist_missing_buffer {
 	struct rist_missing_buffer *next;
 };
 
+/* data packet received before its peer completed the handshake */
+struct rist_preauth_packet {
+	struct rist_buffer *buffer;
+	uint32_t flow_id;
+	uint64_t recv_time;
+	uint8_t payload_type;
+};
+
 struct rist_bandwidth_estimation {
 	size_t bytes;
 	size_t bytes_fast;
@@ -148,6 +184,21 @@ struct rist_peer_flow_stats {
 	uint32_t recovered_average;
 	int32_t  recovered_slope;
 	uint32_t recovered_slope_inverted;
+	/* nacks held back or abandoned by the return path budget */
+	uint32_t return_nacks_deferred;
+	uint32_t return_nacks_dropped;
+	/* rounds in which the nack budget ran out before the missing queue end */
+	uint32_t nack_throttled;
+	/* frames dropped or output partially by the reassembly */
+	uint32_t frames_incomplete;
+	/* overload control: nacks skipped close to the deadline, data discarded while shed */
+	uint32_t overload_nacks_dropped;
+	uint32_t overload_shed;
+	/* cut-through relay: packets forwarded, nacks sent early on downstream request */
+	uint32_t relay_forwarded;
+	uint32_t relay_expedited;
+	/* nacks resent early because a later repair of the same batch arrived first */
+	uint32_t early_renacks;
 
 	/* Inter-packet spacing */
 	uint64_t min_ips;
@@ -164,17 +215,74 @@ struct rist_peer_sender_stats {
 	uint32_t bloat_skip;
 	uint32_t bandwidth_skip;
 	uint32_t retrans_skip;
+	uint32_t retrans_cached;
+	uint32_t ecn_skip;
+	uint32_t ecn_ce;
+	uint32_t ecn_total;
 };
 
 struct rist_peer_receiver_stats {
 	uint32_t sent_rtcp;
 	uint32_t received_rtcp;
 	uint64_t received;
+	uint32_t ecn_ect;
+	uint32_t ecn_ce;
+	/* return path budget (recovery_maxbitrate_return) */
+	uint64_t return_bytes;
+	uint32_t return_skipped;
+};
+
+/* Cumulative counters published on the shared memory stats page */
+struct rist_peer_sender_totals {
+	uint64_t sent;
+	uint64_t received;
+	uint64_t retrans;
+	uint64_t bloat_skip;
+	uint64_t bandwidth_skip;
+	uint64_t retrans_skip;
+};
+
+struct rist_peer_receiver_totals {
+	uint64_t sent_rtcp;
+	uint64_t received_rtcp;
+	uint64_t received;
+};
+
+struct rist_flow_totals {
+	uint64_t lost;
+	uint64_t received;
+	uint64_t dupe;
+	uint64_t dropped_full;
+	uint64_t dropped_late;
+	uint64_t missing;
+	uint64_t retries;
+	uint64_t recovered;
+	uint64_t reordered;
+};
+
+struct rist_ecn_counters {
+	uint32_t ect0;
+	uint32_t ect1;
+	uint32_t ce;
+	uint32_t not_ect;
 };
 
 struct nacks {
 	uint32_t array[RIST_MAX_NACKS];
 	size_t counter;
+	/* sequence numbers the return path budget still allows, -1 when unlimited */
+	ssize_t allowance;
+	/* the group holds early re-nacks only */
+	bool early;
+};
+
+/* Sequence numbers of one nack packet, the sender repairs them in this
+ * order so over a single path their retransmissions arrive in this order
+ * too. next is the position of the first repair not seen yet. */
+struct rist_nack_batch {
+	uint32_t seq[RIST_MAX_NACKS];
+	size_t count;
+	size_t next;
 };
 
 struct rist_flow {
@@ -202,6 +310,7 @@ struct rist_flow {
 
 	struct rist_peer_flow_stats stats_instant;
 	struct rist_peer_flow_stats stats_total;//TODO: use the total stats!
+	struct rist_flow_totals totals;
 	struct rist_bandwidth_estimation bw;
 	uint64_t stats_next_time;
 	uint64_t checks_next_time;
@@ -209,6 +318,37 @@ struct rist_flow {
 	/* Missing queue max size */
 	uint32_t missing_counter_max;
 
+	/* Weighted round robin of the missing queue processing: share of
+	 * rist_receiver.flow_nack_budget and the entry after which the
+	 * current pass continues (NULL to start at the head) */
+	uint32_t nack_weight;
+	struct rist_missing_buffer *nack_resume;
+	/* Early re-nack (rist_receiver_early_renack_set): recent nack batches,
+	 * repair gaps found in them waiting for the next nack round and the
+	 * last time the data arrived out of order */
+	struct rist_nack_batch nack_batches[RIST_NACK_BATCHES];
+	size_t nack_batch_write;
+	uint32_t renack[RIST_MAX_NACKS];
+	size_t renack_count;
+	uint64_t reorder_time;
+	/* data is discarded by the overload shed tier */
+	bool overload_shed;
+	/* cut-through relay: another flow is relayed, reported once */
+	bool relay_ignored;
+	/* Discontinuity detection: packets in a row that did not fit the
+	 * sequence/timestamp space of the flow and the last of them, whether the
+	 * current space started with a sender restart marker (at resync_seq) */
+	uint32_t resync_candidates;
+	uint32_t resync_candidate_seq;
+	uint64_t resync_candidate_time;
+	bool resync_marked;
+	uint32_t resync_seq;
+	/* RIST_RESYNC_POLICY_DRAIN: the dataout thread releases everything queued
+	 * and then has the next packet rebase the flow, data is dropped meanwhile */
+	atomic_bool resync_draining;
+	/* rebases since the flow was created */
+	uint32_t resyncs;
+
 	uint32_t flow_id;
 	uint32_t flow_id_actual;
 	int dead;
@@ -253,10 +393,29 @@ struct rist_flow {
 
 	/* Receiver timed async data output */
 	struct rist_data_block **dataout_fifo_queue;
-	size_t dataout_fifo_queue_bytesize;
+	uint32_t dataout_fifo_queue_capacity;
+	atomic_size_t dataout_fifo_queue_bytesize;
 	atomic_ulong dataout_fifo_queue_read_index;
 	atomic_ulong dataout_fifo_queue_write_index;
 	atomic_bool fifo_overflow;
+	/* dedicated consumer of the fifo (rist_receiver_flow_reader_open), set
+	 * under flows_lock, read inside an epoch read section */
+	struct rist_flow_reader *reader;
+	/* handed to the reaper once unlinked */
+	struct rist_reaper_job reap_job;
+	bool fifo_above_high_watermark;
+	bool fifo_holding;
+	bool fifo_dropping;
+	bool fifo_hold_holes;
+
+	/* Frame reassembly, frame.data holds the fragments output so far with
+	 * RIST_MAX_PAYLOAD_OFFSET headroom, the rest describes the first one */
+	struct rist_buffer frame;
+	uint32_t frame_block_flags;
+	/* seq of the fragment that has to come next */
+	uint32_t frame_next_seq;
+	bool frame_active;
+	bool frame_incomplete;
 
 	/* Temporary buffer for grouping and sending nacks */
 	struct nacks nacks;
@@ -270,6 +429,30 @@ struct rist_retry {
 	bool active;//signal whether this retry has been consumed (false) or not
 };
 
+/* Peers of a shared socket hashed on their group address, open addressing
+ * with linear probing. Replaced as a whole on every join/leave and read
+ * inside an epoch section. */
+struct rist_shared_demux {
+	size_t mask;
+	size_t count;
+	struct rist_epoch_retired retired;
+	struct rist_peer *slot[];
+};
+
+/* Receive socket shared by multicast peers on the same port and interface,
+ * attach/detach run under the peerlist_lock */
+struct rist_shared_socket {
+	int sd;
+	uint16_t family;
+	uint16_t port;
+	char miface[RIST_MAX_STRING_SHORT];
+	struct rist_common_ctx *cctx;
+	struct evsocket_event *event_recv;
+	struct rist_shared_demux *demux;
+	struct rist_shared_socket *next;
+	struct rist_epoch_retired retired;
+};
+
 struct rist_common_ctx {
 	atomic_int shutdown;
 	atomic_bool startup_complete;
@@ -278,21 +461,35 @@ struct rist_common_ctx {
 	intptr_t sender_id;
 	intptr_t receiver_id;
 	struct rist_logging_settings *logging_settings;
+	/* only warnings and errors are logged (receiver overload control) */
+	bool log_quiet;
 
-
-	/* Flows */
+	/* Flows, flows_lock serializes writers, readers use the epoch */
 	struct rist_flow *FLOWS;
 	pthread_mutex_t flows_lock;
 
 	/* evsocket */
 	struct evsocket_ctx *evctx;
+	/* datagrams read per socket event before moving on to the other sockets,
+	 * RIST_OVERLOAD_RECV_BURST with overload control, 0 (drain it) otherwise */
+	int recv_burst;
+	/* a socket was still readable after recv_burst datagrams */
+	bool recv_backlog;
 
 	/* Timers */
 	int rist_max_jitter;
 
-	/* Peer list sync - RW locks */
+	/* Peer list sync, peerlist_lock serializes writers. The data path walks
+	 * PEERS, FLOWS and the peer_lst arrays inside an epoch read section,
+	 * removed peers are torn down after a grace period. */
 	struct rist_peer *PEERS;
 	pthread_mutex_t peerlist_lock;
+	struct rist_epoch epoch;
+	/* reclaims timed out flows and connection peers off the protocol thread */
+	struct rist_reaper reaper;
+
+	/* Shared multicast receive sockets (protected by peerlist_lock) */
+	struct rist_shared_socket *shared_sockets;
 
 	/* buffers */
 	/* these are pre-allocated buffers, not pre-allocated aligned stack */
@@ -336,12 +533,22 @@ struct rist_common_ctx {
 	int (*stats_callback)(void *arg, const struct rist_stats *stats_container);
 	void *stats_callback_argument;
 	pthread_mutex_t stats_lock;
+	struct rist_stats_shm_writer *stats_shm;
 
 	pthread_rwlock_t oob_queue_lock;
 	struct rist_buffer *oob_queue[RIST_OOB_QUEUE_BUFFERS]; /* oob queue */
 	size_t oob_queue_bytesize;
 	uint16_t oob_queue_read_index;
 	uint16_t oob_queue_write_index;
+	/* oob pacing (rist_oob_bandwidth_set) and its stats, protocol thread only
+	 * except for the drop counter */
+	struct rist_oob_sched oob_sched;
+	uint64_t oob_max_delay;
+	struct rist_bandwidth_estimation oob_bw;
+	uint64_t oob_sent;
+	uint64_t oob_eight_times_delay;
+	uint64_t oob_delay_max;
+	atomic_ulong oob_dropped;
 
 	bool debug;
 	uint32_t birthtime_rtp_offset;
@@ -352,6 +559,23 @@ struct rist_common_ctx {
 
 	rist_thread_callback_func_t thread_callback;
 	void *thread_callback_arg;
+
+	/* RIST_OPT_PATH_POLICY, NULL hooks keep the built-in heuristics */
+	rist_path_policy_t path_policy;
+	void *path_policy_arg;
+	bool path_policy_set;
+};
+
+/* Per flow consumer of the output fifo, owned by the application */
+struct rist_flow_reader {
+	struct rist_receiver *ctx;
+	uint32_t flow_id;
+	/* attached flow, NULL while it does not exist, written under flows_lock */
+	struct rist_flow *flow;
+	pthread_cond_t condition;
+	pthread_mutex_t mutex;
+	int notify_fd;
+	struct rist_flow_reader *next;
 };
 
 struct rist_receiver {
@@ -378,7 +602,39 @@ struct rist_receiver {
 
 	bool simulate_loss;
 	uint16_t loss_percentage;
+	/* soft limit (fifo size) and allocated ring size of the output fifos */
 	uint32_t fifo_queue_size;
+	uint32_t fifo_queue_capacity;
+	enum rist_fifo_policy fifo_policy;
+	size_t fifo_max_bytes;
+	uint32_t fifo_high_watermark;
+	uint32_t fifo_low_watermark;
+	receiver_fifo_event_callback_t fifo_event_callback;
+	void *fifo_event_callback_argument;
+	/* missing queue entries each flow may process per nack round and unit of weight, 0 = unlimited */
+	uint32_t flow_nack_budget;
+	/* resend nacks as soon as a repair gap shows a retransmission got lost */
+	bool early_renack;
+	/* reassembly of rist_sender_data_write_frame fragments */
+	enum rist_frame_policy frame_policy;
+	size_t frame_max_size;
+	/* protocol loop overload detection and degradation tier */
+	struct rist_overload overload;
+	/* what happens to the buffered data when a flow is rebased after a discontinuity */
+	enum rist_resync_policy resync_policy;
+	/* in-kernel filter of datagrams that cannot belong to a peer */
+	enum rist_socket_filter socket_filter;
+	/* cut-through relay: packets are handed to this sender as they arrive,
+	 * relay_flow is the flow being forwarded */
+	struct rist_sender *relay_sender;
+	struct rist_flow *relay_flow;
+	/* open flow readers (flows_lock) and the new flow notification */
+	struct rist_flow_reader *flow_readers;
+	receiver_flow_callback_t flow_callback;
+	void *flow_callback_argument;
+	/* data parked by peers that are not authenticated yet, over all peers */
+	atomic_size_t preauth_buffers;
+	atomic_size_t preauth_bytes;
 };
 
 struct rist_sender {
@@ -389,6 +645,28 @@ struct rist_sender {
 	uint32_t recovery_maxbitrate_max;
 	uint32_t max_nacksperloop;
 	bool null_packet_suppression;
+	bool ts_stuffing_suppression;
+	bool wire_cache;
+	/* flag the first RIST_RESTART_MARKER_PACKETS data packets, restart_marked counts them */
+	bool restart_marker;
+	uint32_t restart_marked;
+	/* fed by a cut-through relay receiver, nacks for packets that did not
+	 * make it to the relay yet are handed upstream through this ring */
+	bool relay;
+	uint32_t relay_requests[RIST_RELAY_REQUESTS];
+	atomic_ulong relay_request_write;
+	atomic_ulong relay_request_read;
+	/* tiered history (rist_sender_history_set), sent packets older than
+	 * history_hot_ms have their payload in the store, history_spill_index
+	 * is the next queue entry to move, history_scratch holds a payload read
+	 * back for a retransmission */
+	struct rist_history_store history;
+	uint32_t history_hot_ms;
+	size_t history_spill_index;
+	uint8_t *history_scratch;
+	uint64_t history_moved;
+	uint64_t history_retrans;
+	uint64_t history_overwritten;
 
 	/* Sender thread variables */
 	bool protocol_running;
@@ -440,6 +718,18 @@ struct rist_sender {
 
 	/* Queue lock for fifo buffer */
 	pthread_mutex_t queue_lock;
+
+	/* Write flow control */
+	uint32_t write_high_watermark;
+	uint32_t write_low_watermark;
+	int write_timeout;
+	atomic_bool write_backpressure;
+	atomic_ulong writes_refused;
+	atomic_ulong writes_blocked;
+	pthread_cond_t write_ready_condition;
+	sender_write_ready_callback_t write_ready_callback;
+	void *write_ready_callback_argument;
+	int write_ready_notify_fd;
 };
 
 enum rist_ctx_mode {
@@ -559,6 +849,23 @@ struct rist_peer {
 	uint16_t state;
 	char miface[128];
 
+	/* multicast reception on a shared socket */
+	bool multicast_shared;
+	char multicast_source[128];
+	struct sockaddr_storage multicast_source_addr;
+	struct rist_shared_socket *shared_socket;
+
+	/* ECN, counted on the receiver and reported back in RTCP XR */
+	struct rist_ecn_counters ecn_rx;
+	struct rist_ecn_counters ecn_last_report;
+	bool ecn_reported;
+	uint64_t ecn_congested_until;
+
+	/* source port striping, stripe_sd[0] is sd */
+	int stripe_sd[RIST_MAX_STRIPE_PORTS];
+	struct evsocket_event *stripe_event[RIST_MAX_STRIPE_PORTS];
+	size_t stripe_count;
+
 	/* Events */
 	struct timeval expire;
 	bool send_keepalive;
@@ -569,6 +876,8 @@ struct rist_peer {
 	/* multicast */
 	bool multicast_sender;
 	bool multicast_receiver;
+	/* a receive filter is attached to sd */
+	bool socket_filter_attached;
 
 	/* rist ctx */
 	struct rist_sender *sender_ctx;
@@ -579,12 +888,16 @@ struct rist_peer {
 
 	/* Statistics Sender */
 	struct rist_peer_sender_stats stats_sender_instant;
-	struct rist_peer_sender_stats stats_sender_total;
+	struct rist_peer_sender_totals stats_sender_total;
+
 
+	/* Return path token bucket (bytes), enforces recovery_maxbitrate_return */
+	int64_t return_tokens;
+	uint64_t return_last_refill;
 
 	/* Statistics Receiver */
 	struct rist_peer_receiver_stats stats_receiver_instant;
-	struct rist_peer_receiver_stats stats_receiver_total;
+	struct rist_peer_receiver_totals stats_receiver_total;
 
 	int dead;
 	int timed_out;
@@ -598,6 +911,8 @@ struct rist_peer {
 
 	/* shutting down flag */
 	atomic_bool shutdown;
+	/* handed to the reaper once unlinked */
+	struct rist_reaper_job reap_job;
 
 	/* Timers */
 	uint32_t rtcp_keepalive_interval;
@@ -615,7 +930,16 @@ struct rist_peer {
 
 	uint64_t log_repeat_timer;
 
+	/* Data received before authentication, replayed into the flow once authenticated */
+	struct rist_preauth_packet *preauth_queue;
+	size_t preauth_queue_read_idx;
+	size_t preauth_queue_count;
+
 	struct rist_keepalive_data data;
+
+	/* view handed to the path policy, see path_policy.h */
+	struct rist_path path;
+	bool path_attached;
 };
 
 static inline struct rist_common_ctx *rist_struct_get_common(struct rist_ctx *ctx) {
@@ -632,6 +956,12 @@ static inline struct rist_common_ctx *rist_struct_get_common(struct rist_ctx *ct
 /* defined in flow.c */
 RIST_PRIV void rist_receiver_flow_statistics(struct rist_receiver *ctx, struct rist_flow *flow);
 RIST_PRIV void rist_sender_peer_statistics(struct rist_peer *peer);
+
+/* defined in stats_shm.c */
+RIST_PRIV int rist_stats_shm_writer_open(struct rist_common_ctx *cctx, const char *path, int interval_ms);
+RIST_PRIV void rist_stats_shm_writer_close(struct rist_common_ctx *cctx);
+RIST_PRIV void rist_stats_shm_sender_publish(struct rist_sender *ctx, uint64_t now);
+RIST_PRIV void rist_stats_shm_receiver_publish(struct rist_receiver *ctx, uint64_t now);
 RIST_PRIV void rist_delete_flow(struct rist_receiver *ctx, struct rist_flow *f);
 RIST_PRIV void rist_receiver_missing(struct rist_flow *f, struct rist_peer *peer,uint64_t nack_time, uint32_t seq, uint64_t rtt);
 RIST_PRIV int rist_receiver_associate_flow(struct rist_peer *p, uint32_t flow_id);
@@ -649,6 +979,7 @@ RIST_PRIV void rist_print_inet_info(char *prefix, struct rist_peer *peer);
 RIST_PRIV void rist_peer_rtcp(struct evsocket_ctx *ctx, void *arg);
 RIST_PRIV void rist_populate_cname(struct rist_peer *peer);
 RIST_PRIV void free_data_block(struct rist_data_block **const block);
+RIST_PRIV void rist_peer_socket_filter_update(struct rist_peer *peer);
 
 /* needed after splitting up */
 RIST_PRIV PTHREAD_START_FUNC(sender_pthread_protocol, arg);
@@ -675,12 +1006,30 @@ RIST_PRIV void sender_peer_append(struct rist_sender *ctx, struct rist_peer *pee
 /* Get common context */
 RIST_PRIV struct rist_common_ctx *get_cctx(struct rist_peer *peer);
 
+/* Copy on write peer_lst helpers (ctx->peer_lst and flow->peer_lst) */
+static inline int rist_peer_lst_add(struct rist_common_ctx *cctx, struct rist_peer ***lst, size_t *len, struct rist_peer *p)
+{
+	return rist_epoch_array_add(&cctx->epoch, (void ***)lst, len, p);
+}
+
+static inline bool rist_peer_lst_remove(struct rist_common_ctx *cctx, struct rist_peer ***lst, size_t *len, struct rist_peer *p)
+{
+	return rist_epoch_array_remove(&cctx->epoch, (void ***)lst, len, p);
+}
+
+static inline struct rist_peer **rist_peer_lst_get(struct rist_peer **const *lst, const size_t *len, size_t *out_len)
+{
+	return (struct rist_peer **)rist_epoch_array_get((void **const *)lst, len, out_len);
+}
+
 /*static inline in header file */
 static inline void peer_append(struct rist_peer *p)
 {
 	struct rist_common_ctx *cctx = get_cctx(p);
 	struct rist_peer **PEERS = &cctx->PEERS;
 	struct rist_peer *plist = *PEERS;
+	/* lock free readers may follow the links below as soon as they are set */
+	atomic_thread_fence(memory_order_release);
 	if (!plist)
 	{
 		*PEERS = p;
@@ -58,6 +58,7 @@ int rist_receiver_create(struct rist_ctx **_ctx, enum rist_profile profile,
 	ctx->common.logging_settings = logging_settings;
 	ctx->common.stats_report_time = (uint64_t)1000 * (uint64_t)RIST_CLOCK;
 	ctx->fifo_queue_size = RIST_DATAOUT_QUEUE_BUFFERS;
+	ctx->fifo_queue_capacity = RIST_DATAOUT_QUEUE_BUFFERS;
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "RIST Receiver Library version:%s \n", LIBRIST_VERSION);
 
 	if (logging_settings && logging_settings->log_level == RIST_LOG_SIMULATE)
@@ -117,19 +118,24 @@ int rist_receiver_nack_type_set(struct rist_ctx *rist_ctx, enum rist_nack_type n
 	return 0;
 }
 
+/* Must be called inside an epoch read section, the returned flow stays valid until it ends */
 static struct rist_flow *rist_get_longest_flow(struct rist_receiver *ctx, ssize_t *num)
 {
 	// Select the flow with highest queue count
 	ssize_t num_loop = 0;
 	struct rist_flow *f = NULL;
-	pthread_mutex_lock(&ctx->common.flows_lock);
 	struct rist_flow *f_loop = ctx->common.FLOWS;
 	while (f_loop) {
 		struct rist_flow *nextflow = f_loop->next;
+		// Flows with their own reader are not ours
+		if (f_loop->reader) {
+			f_loop = nextflow;
+			continue;
+		}
 		unsigned long reader_index = atomic_load_explicit(&f_loop->dataout_fifo_queue_read_index, memory_order_relaxed);
 		unsigned long write_index = atomic_load_explicit(&f_loop->dataout_fifo_queue_write_index, memory_order_acquire);
 
-		num_loop = (write_index - reader_index)&(ctx->fifo_queue_size -1);
+		num_loop = (write_index - reader_index)&(ctx->fifo_queue_capacity -1);
 		if (num_loop > *num)
 		{
 			f = f_loop;
@@ -137,10 +143,52 @@ static struct rist_flow *rist_get_longest_flow(struct rist_receiver *ctx, ssize_
 		}
 		f_loop = nextflow;
 	}
-	pthread_mutex_unlock(&ctx->common.flows_lock);
 	return f;
 }
 
+/* Pops the oldest block of the output fifo of f, returns the fifo count
+ * before the pop. Must be called inside an epoch read section. */
+static int rist_flow_fifo_pop(struct rist_receiver *ctx, struct rist_flow *f, struct rist_data_block **data_buffer)
+{
+	struct rist_data_block *data_block = NULL;
+	ssize_t num = 0;
+	*data_buffer = NULL;
+	if (!f)
+		return 0;
+
+	unsigned long dataout_read_index = atomic_load_explicit(&f->dataout_fifo_queue_read_index, memory_order_relaxed);
+	size_t write_index = atomic_load_explicit(&f->dataout_fifo_queue_write_index, memory_order_acquire);
+	if (write_index != dataout_read_index)
+	{
+		// Other readers (and the drop oldest fifo policy) may pop concurrently
+		do {
+			num = (atomic_load_explicit(&f->dataout_fifo_queue_write_index, memory_order_acquire) - dataout_read_index) &(ctx->fifo_queue_capacity -1);
+			if (atomic_compare_exchange_weak(&f->dataout_fifo_queue_read_index, &dataout_read_index, (dataout_read_index +1)&(ctx->fifo_queue_capacity -1)))
+			{
+				data_block = f->dataout_fifo_queue[dataout_read_index];
+				f->dataout_fifo_queue[dataout_read_index] = NULL;
+				if (data_block)
+					atomic_fetch_sub_explicit(&f->dataout_fifo_queue_bytesize, data_block->payload_len, memory_order_relaxed);
+				break;
+			}
+		} while (num > 0);
+	}
+	assert(!(data_block == NULL && num > 0));
+	if (!data_block)
+		return (int)num;
+
+	*data_buffer = data_block;
+
+	bool overflow = false;
+	while (!atomic_compare_exchange_weak(&f->fifo_overflow, &overflow, false)) {
+		//
+	}
+	if (overflow)
+		data_block->flags |= RIST_DATA_FLAGS_OVERFLOW;
+
+	return (int)num;
+}
+
 int rist_receiver_data_read(struct rist_ctx *ctx, const struct rist_data_block **data_block, int timeout)
 {
 	return rist_receiver_data_read2(ctx, (struct rist_data_block **)data_block, timeout);
@@ -161,56 +209,39 @@ int rist_receiver_data_read2(struct rist_ctx *rist_ctx, struct rist_data_block *
 
 	struct rist_receiver *ctx = rist_ctx->receiver_ctx;
 
-	struct rist_data_block *data_block = NULL;
 	/* We could enter the lock now, to read the counter. However performance penalties apply.
 	   The risks for not entering the lock are either sleeping too much (a packet gets added while we read)
 	   or not at all when we should (i.e.: the calling application is reading from multiple threads). Both
 	   risks are tolerable */
 
 	ssize_t num = 0;
+	// Flows are deleted by the protocol thread, the read section keeps ours alive without a lock
+	unsigned epoch = rist_epoch_enter(&ctx->common.epoch);
 	// Select the flow with highest queue count to minimize jitter for calling app
 	struct rist_flow *f = rist_get_longest_flow(ctx, &num);
 	if (!num && timeout > 0)
 	{
+		rist_epoch_leave(&ctx->common.epoch, epoch);
 		pthread_mutex_lock(&(ctx->mutex));
 		pthread_cond_timedwait_ms(&(ctx->condition), &(ctx->mutex), timeout);
 		pthread_mutex_unlock(&(ctx->mutex));
+		epoch = rist_epoch_enter(&ctx->common.epoch);
 		f = rist_get_longest_flow(ctx, &num);
 	}
 
 	if (RIST_UNLIKELY(!num || !f))
 	{
+		rist_epoch_leave(&ctx->common.epoch, epoch);
 		//No need to log, these can be triggered by gaps in data or low bitrate stream with low timeout values
 		//rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_data_read call with no flow data, %d/%"PRIu32"\n", num, f);
+		*data_buffer = NULL;
 		return 0;
 	}
 
-	unsigned long dataout_read_index = atomic_load_explicit(&f->dataout_fifo_queue_read_index, memory_order_relaxed);
-	size_t write_index = atomic_load_explicit(&f->dataout_fifo_queue_write_index, memory_order_acquire);
-	if (write_index != dataout_read_index)
-	{
-		do {
-			num = (atomic_load_explicit(&f->dataout_fifo_queue_write_index, memory_order_acquire) - dataout_read_index) &(ctx->fifo_queue_size -1);
-			if (atomic_compare_exchange_weak(&f->dataout_fifo_queue_read_index, &dataout_read_index, (dataout_read_index +1)&(ctx->fifo_queue_size -1)))
-			{
-				data_block = f->dataout_fifo_queue[dataout_read_index];
-				f->dataout_fifo_queue[dataout_read_index] = NULL;
-				break;
-			}
-		} while (num > 0);
-	}
-	assert(!(data_block == NULL && num > 0));
-
-	*data_buffer = data_block;
-
-	bool overflow = false;
-	while (!atomic_compare_exchange_weak(&f->fifo_overflow, &overflow, false)) {
-		//
-	}
-	if (overflow)
-		data_block->flags |= RIST_DATA_FLAGS_OVERFLOW;
+	int ret = rist_flow_fifo_pop(ctx, f, data_buffer);
+	rist_epoch_leave(&ctx->common.epoch, epoch);
 
-	return (int)num;
+	return ret;
 }
 
 void rist_receiver_data_block_free(struct rist_data_block **const block)
@@ -250,6 +281,157 @@ int rist_receiver_data_notify_fd_set(struct rist_ctx *rist_ctx, int fd)
 	return 0;
 }
 
+int rist_receiver_flow_callback_set(struct rist_ctx *rist_ctx, receiver_flow_callback_t callback, void *arg)
+{
+	if (RIST_UNLIKELY(!rist_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "ctx is null on rist_receiver_flow_callback_set call!\n");
+		return -1;
+	}
+	if (RIST_UNLIKELY(rist_ctx->mode != RIST_RECEIVER_MODE || !rist_ctx->receiver_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_flow_callback_set call with CTX not set up for receiving\n");
+		return -2;
+	}
+	struct rist_receiver *ctx = rist_ctx->receiver_ctx;
+	ctx->flow_callback_argument = arg;
+	ctx->flow_callback = callback;
+	return 0;
+}
+
+int rist_receiver_flow_reader_open(struct rist_ctx *rist_ctx, uint32_t flow_id, struct rist_flow_reader **reader)
+{
+	if (RIST_UNLIKELY(!rist_ctx || !reader))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "ctx or reader is null on rist_receiver_flow_reader_open call!\n");
+		return -1;
+	}
+	if (RIST_UNLIKELY(rist_ctx->mode != RIST_RECEIVER_MODE || !rist_ctx->receiver_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_flow_reader_open call with CTX not set up for receiving\n");
+		return -2;
+	}
+	struct rist_receiver *ctx = rist_ctx->receiver_ctx;
+	struct rist_flow_reader *r = calloc(1, sizeof(*r));
+	if (!r)
+	{
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Could not create flow reader, OOM!\n");
+		return -1;
+	}
+	r->ctx = ctx;
+	r->flow_id = flow_id;
+	int ret = pthread_cond_init(&r->condition, NULL);
+	if (ret)
+	{
+		free(r);
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Error %d calling pthread_cond_init\n", ret);
+		return -1;
+	}
+	ret = pthread_mutex_init(&r->mutex, NULL);
+	if (ret)
+	{
+		pthread_cond_destroy(&r->condition);
+		free(r);
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Error %d calling pthread_mutex_init\n", ret);
+		return -1;
+	}
+
+	pthread_mutex_lock(&ctx->common.flows_lock);
+	for (struct rist_flow_reader *other = ctx->flow_readers; other != NULL; other = other->next)
+	{
+		if (other->flow_id == flow_id)
+		{
+			pthread_mutex_unlock(&ctx->common.flows_lock);
+			pthread_mutex_destroy(&r->mutex);
+			pthread_cond_destroy(&r->condition);
+			free(r);
+			rist_log_priv(&ctx->common, RIST_LOG_ERROR, "A reader for flow %"PRIu32" is already open\n", flow_id);
+			return -4;
+		}
+	}
+	for (struct rist_flow *f = ctx->common.FLOWS; f != NULL; f = f->next)
+	{
+		if (f->flow_id == flow_id)
+		{
+			r->flow = f;
+			f->reader = r;
+			break;
+		}
+	}
+	r->next = ctx->flow_readers;
+	ctx->flow_readers = r;
+	pthread_mutex_unlock(&ctx->common.flows_lock);
+
+	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Opened reader for flow %"PRIu32"%s\n", flow_id, r->flow ? "" : " (not created yet)");
+	*reader = r;
+	return 0;
+}
+
+int rist_receiver_flow_reader_read(struct rist_flow_reader *reader, struct rist_data_block **data_buffer, int timeout)
+{
+	if (RIST_UNLIKELY(!reader))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "reader is null on rist_receiver_flow_reader_read call!\n");
+		return -1;
+	}
+	struct rist_receiver *ctx = reader->ctx;
+	// The read section keeps the attached flow alive, there is no flow scan and no other reader to wait with
+	unsigned epoch = rist_epoch_enter(&ctx->common.epoch);
+	int num = rist_flow_fifo_pop(ctx, reader->flow, data_buffer);
+	if (!num && timeout > 0)
+	{
+		rist_epoch_leave(&ctx->common.epoch, epoch);
+		pthread_mutex_lock(&reader->mutex);
+		pthread_cond_timedwait_ms(&reader->condition, &reader->mutex, timeout);
+		pthread_mutex_unlock(&reader->mutex);
+		epoch = rist_epoch_enter(&ctx->common.epoch);
+		num = rist_flow_fifo_pop(ctx, reader->flow, data_buffer);
+	}
+	rist_epoch_leave(&ctx->common.epoch, epoch);
+	return num;
+}
+
+int rist_receiver_flow_reader_notify_fd_set(struct rist_flow_reader *reader, int fd)
+{
+	if (RIST_UNLIKELY(!reader))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "reader is null on rist_receiver_flow_reader_notify_fd_set call!\n");
+		return -1;
+	}
+	reader->notify_fd = fd;
+	return 0;
+}
+
+int rist_receiver_flow_reader_close(struct rist_flow_reader **reader)
+{
+	if (RIST_UNLIKELY(!reader || !*reader))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "reader is null on rist_receiver_flow_reader_close call!\n");
+		return -1;
+	}
+	struct rist_flow_reader *r = *reader;
+	struct rist_receiver *ctx = r->ctx;
+	pthread_mutex_lock(&ctx->common.flows_lock);
+	struct rist_flow_reader **prev = &ctx->flow_readers;
+	while (*prev && *prev != r)
+		prev = &(*prev)->next;
+	if (*prev)
+		*prev = r->next;
+	if (r->flow)
+		r->flow->reader = NULL;
+	pthread_mutex_unlock(&ctx->common.flows_lock);
+	// The protocol thread may still be signalling it
+	rist_epoch_synchronize(&ctx->common.epoch);
+	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Closed reader for flow %"PRIu32"\n", r->flow_id);
+	pthread_mutex_destroy(&r->mutex);
+	pthread_cond_destroy(&r->condition);
+	free(r);
+	*reader = NULL;
+	// Whatever is left in the fifo is up to the data readers again
+	pthread_cond_signal(&ctx->condition);
+	return 0;
+}
+
 int rist_connection_status_callback_set(struct rist_ctx *ctx, connection_status_callback_t connection_status_callback,
 										void *arg)
 {
@@ -412,6 +594,16 @@ int rist_sender_create(struct rist_ctx **_ctx, enum rist_profile profile,
 		goto free_ctx_and_ret;
 	}
 
+	ret = pthread_cond_init(&ctx->write_ready_condition, NULL);
+	if (ret)
+	{
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Error %d initializing pthread_condition\n", ret);
+		goto free_ctx_and_ret;
+	}
+	atomic_init(&ctx->write_backpressure, false);
+	atomic_init(&ctx->writes_refused, 0);
+	atomic_init(&ctx->writes_blocked, 0);
+
 	ctx->sender_initialized = true;
 
 	*_ctx = rist_ctx;
@@ -477,6 +669,157 @@ int rist_sender_npd_disable(struct rist_ctx *rist_ctx)
 	return 0;
 }
 
+int rist_sender_ts_stuffing_enable(struct rist_ctx *rist_ctx)
+{
+	if (RIST_UNLIKELY(!rist_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_ts_stuffing_enable call with null context");
+		return -1;
+	}
+	if (RIST_UNLIKELY(rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_ts_stuffing_enable call with ctx not set up for sending\n");
+		return -1;
+	}
+	struct rist_sender *ctx = rist_ctx->sender_ctx;
+	ctx->ts_stuffing_suppression = true;
+	rist_log_priv2(ctx->common.logging_settings, RIST_LOG_INFO, "Enabled TS adaptation field stuffing suppression\n");
+	return 0;
+}
+
+int rist_sender_ts_stuffing_disable(struct rist_ctx *rist_ctx)
+{
+	if (RIST_UNLIKELY(!rist_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_ts_stuffing_disable call with null context");
+		return -1;
+	}
+	if (RIST_UNLIKELY(rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_ts_stuffing_disable call with ctx not set up for sending\n");
+		return -1;
+	}
+	struct rist_sender *ctx = rist_ctx->sender_ctx;
+	ctx->ts_stuffing_suppression = false;
+	rist_log_priv2(ctx->common.logging_settings, RIST_LOG_INFO, "Disabled TS adaptation field stuffing suppression\n");
+	return 0;
+}
+
+int rist_sender_wire_cache_enable(struct rist_ctx *rist_ctx)
+{
+	if (RIST_UNLIKELY(!rist_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_wire_cache_enable call with null context");
+		return -1;
+	}
+	if (RIST_UNLIKELY(rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_wire_cache_enable call with ctx not set up for sending\n");
+		return -1;
+	}
+	struct rist_sender *ctx = rist_ctx->sender_ctx;
+	ctx->wire_cache = true;
+	rist_log_priv2(ctx->common.logging_settings, RIST_LOG_INFO, "Enabled wire image cache for retransmissions\n");
+	return 0;
+}
+
+int rist_sender_wire_cache_disable(struct rist_ctx *rist_ctx)
+{
+	if (RIST_UNLIKELY(!rist_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_wire_cache_disable call with null context");
+		return -1;
+	}
+	if (RIST_UNLIKELY(rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_wire_cache_disable call with ctx not set up for sending\n");
+		return -1;
+	}
+	struct rist_sender *ctx = rist_ctx->sender_ctx;
+	ctx->wire_cache = false;
+	rist_log_priv2(ctx->common.logging_settings, RIST_LOG_INFO, "Disabled wire image cache for retransmissions\n");
+	return 0;
+}
+
+int rist_sender_restart_marker_enable(struct rist_ctx *rist_ctx)
+{
+	if (RIST_UNLIKELY(!rist_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_restart_marker_enable call with null context");
+		return -1;
+	}
+	if (RIST_UNLIKELY(rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_restart_marker_enable call with ctx not set up for sending\n");
+		return -1;
+	}
+	struct rist_sender *ctx = rist_ctx->sender_ctx;
+	ctx->restart_marker = true;
+	ctx->restart_marked = 0;
+	rist_log_priv2(ctx->common.logging_settings, RIST_LOG_INFO, "Enabled sender restart marker\n");
+	return 0;
+}
+
+int rist_sender_restart_marker_disable(struct rist_ctx *rist_ctx)
+{
+	if (RIST_UNLIKELY(!rist_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_restart_marker_disable call with null context");
+		return -1;
+	}
+	if (RIST_UNLIKELY(rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_restart_marker_disable call with ctx not set up for sending\n");
+		return -1;
+	}
+	struct rist_sender *ctx = rist_ctx->sender_ctx;
+	ctx->restart_marker = false;
+	rist_log_priv2(ctx->common.logging_settings, RIST_LOG_INFO, "Disabled sender restart marker\n");
+	return 0;
+}
+
+int rist_sender_history_set(struct rist_ctx *rist_ctx, uint32_t hot_ms, size_t store_bytes, const char *dir)
+{
+	if (RIST_UNLIKELY(!rist_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_history_set call with null context");
+		return -1;
+	}
+	if (RIST_UNLIKELY(rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_history_set call with ctx not set up for sending\n");
+		return -1;
+	}
+	struct rist_sender *ctx = rist_ctx->sender_ctx;
+	if (ctx->sender_thread != 0)
+	{
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "rist_sender_history_set must be called before starting\n");
+		return -3;
+	}
+	rist_history_store_close(&ctx->history);
+	free(ctx->history_scratch);
+	ctx->history_scratch = NULL;
+	if (store_bytes == 0)
+	{
+		rist_log_priv(&ctx->common, RIST_LOG_INFO, "Sender history kept in memory\n");
+		return 0;
+	}
+	ctx->history_scratch = malloc(RIST_MAX_PAYLOAD_OFFSET + RIST_MAX_PACKET_SIZE);
+	if (!ctx->history_scratch || rist_history_store_open(&ctx->history, store_bytes, dir) != 0)
+	{
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Could not set up a sender history store of %zu bytes%s%s: %s\n",
+			store_bytes, dir ? " in " : "", dir ? dir : "", strerror(errno));
+		free(ctx->history_scratch);
+		ctx->history_scratch = NULL;
+		return -4;
+	}
+	ctx->history_hot_ms = hot_ms;
+	ctx->history_spill_index = ctx->sender_queue_delete_index;
+	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Sender history older than %"PRIu32" ms moves to a %zu byte %s\n",
+		hot_ms, ctx->history.capacity, dir ? "file" : ctx->history.hugepages ? "hugepage arena" : "memory arena");
+	return 0;
+}
+
 int rist_sender_flow_id_set(struct rist_ctx *rist_ctx, uint32_t flow_id)
 {
 	if (RIST_UNLIKELY(!rist_ctx))
@@ -500,6 +843,33 @@ int rist_sender_flow_id_set(struct rist_ctx *rist_ctx, uint32_t flow_id)
 	return 0;
 }
 
+/* Hold back the application while the protocol thread is behind, the
+ * protocol thread clears the back-pressure state at the low watermark */
+static int rist_sender_flow_control(struct rist_sender *ctx)
+{
+	if (!atomic_load_explicit(&ctx->write_backpressure, memory_order_acquire)) {
+		if (rist_get_sender_queue_pending(ctx) < ctx->write_high_watermark)
+			return 0;
+		atomic_store_explicit(&ctx->write_backpressure, true, memory_order_release);
+	}
+	if (ctx->write_timeout > 0) {
+		uint64_t deadline = timestampNTP_u64() + (uint64_t)ctx->write_timeout * RIST_CLOCK;
+		atomic_fetch_add_explicit(&ctx->writes_blocked, 1, memory_order_relaxed);
+		pthread_mutex_lock(&ctx->queue_lock);
+		while (atomic_load_explicit(&ctx->write_backpressure, memory_order_acquire)) {
+			uint64_t now = timestampNTP_u64();
+			if (now >= deadline)
+				break;
+			pthread_cond_timedwait_ms(&ctx->write_ready_condition, &ctx->queue_lock, (uint32_t)((deadline - now) / RIST_CLOCK) + 1);
+		}
+		pthread_mutex_unlock(&ctx->queue_lock);
+		if (!atomic_load_explicit(&ctx->write_backpressure, memory_order_acquire))
+			return 0;
+	}
+	atomic_fetch_add_explicit(&ctx->writes_refused, 1, memory_order_relaxed);
+	return -EAGAIN;
+}
+
 int rist_sender_data_write(struct rist_ctx *rist_ctx, const struct rist_data_block *data_block)
 {
 	if (RIST_UNLIKELY(!rist_ctx))
@@ -523,6 +893,12 @@ int rist_sender_data_write(struct rist_ctx *rist_ctx, const struct rist_data_blo
 		return -1;
 	}
 
+	if (ctx->write_high_watermark) {
+		int ret = rist_sender_flow_control(ctx);
+		if (ret < 0)
+			return ret;
+	}
+
 	uint64_t ts_ntp = data_block->ts_ntp == 0 ? timestampNTP_u64() : data_block->ts_ntp;
 	uint32_t seq_rtp;
 	if (data_block->flags & RIST_DATA_FLAGS_USE_SEQ)
@@ -543,6 +919,125 @@ int rist_sender_data_write(struct rist_ctx *rist_ctx, const struct rist_data_blo
 		return (int)data_block->payload_len;
 }
 
+static struct rist_sender *rist_sender_ctx_get(struct rist_ctx *rist_ctx, const char *caller)
+{
+	if (RIST_UNLIKELY(!rist_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "%s call with null context\n", caller);
+		return NULL;
+	}
+	if (RIST_UNLIKELY(rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "%s call with ctx not set up for sending\n", caller);
+		return NULL;
+	}
+	return rist_ctx->sender_ctx;
+}
+
+int rist_sender_data_write_frame(struct rist_ctx *rist_ctx, const struct rist_data_block *data_block, size_t fragment_size)
+{
+	struct rist_sender *ctx = rist_sender_ctx_get(rist_ctx, "rist_sender_data_write_frame");
+	if (!ctx)
+		return -1;
+	if (fragment_size == 0)
+		fragment_size = RIST_FRAME_FRAGMENT_SIZE_DEFAULT;
+	// leave room for the header extension carrying the fragment flags
+	if (fragment_size > (RIST_MAX_PACKET_SIZE - 32 - sizeof(struct rist_rtp_hdr_ext)))
+	{
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Invalid fragment size %zu, max is %zu.\n",
+					  fragment_size, RIST_MAX_PACKET_SIZE - 32 - sizeof(struct rist_rtp_hdr_ext));
+		return -1;
+	}
+	if (data_block->payload_len == 0)
+	{
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Dropping empty frame.\n");
+		return -1;
+	}
+
+	if (ctx->write_high_watermark) {
+		int ret = rist_sender_flow_control(ctx);
+		if (ret < 0)
+			return ret;
+	}
+
+	// all fragments share the timestamp of the frame
+	uint64_t ts_ntp = data_block->ts_ntp == 0 ? timestampNTP_u64() : data_block->ts_ntp;
+	size_t count = (data_block->payload_len + fragment_size - 1) / fragment_size;
+	uint32_t seq_rtp;
+	if (data_block->flags & RIST_DATA_FLAGS_USE_SEQ)
+		seq_rtp = (uint32_t)data_block->seq;
+	else {
+		// Taken whether or not the frame makes it into the queue, as with rist_sender_data_write
+		seq_rtp = ctx->common.seq_rtp;
+		ctx->common.seq_rtp += (uint16_t)count;
+	}
+	seq_rtp = seq_rtp & (UINT16_MAX);
+	int ret = rist_sender_enqueue_frame(ctx, data_block->payload, data_block->payload_len, fragment_size, ts_ntp, data_block->virt_src_port, data_block->virt_dst_port, seq_rtp);
+	// One wake up for the whole frame
+	if (pthread_cond_signal(&ctx->condition))
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Call to pthread_cond_signal failed.\n");
+
+	if (ret < 0)
+		return ret;
+	else
+		return (int)data_block->payload_len;
+}
+
+int rist_sender_flow_control_set(struct rist_ctx *rist_ctx, uint32_t high_watermark, uint32_t low_watermark, int timeout)
+{
+	struct rist_sender *ctx = rist_sender_ctx_get(rist_ctx, "rist_sender_flow_control_set");
+	if (!ctx)
+		return -1;
+	if (high_watermark && (low_watermark >= high_watermark || high_watermark >= ctx->sender_queue_max))
+	{
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Invalid flow control watermarks %"PRIu32"/%"PRIu32", must be low < high < %zu\n",
+					  low_watermark, high_watermark, ctx->sender_queue_max);
+		return -1;
+	}
+	pthread_mutex_lock(&ctx->queue_lock);
+	ctx->write_high_watermark = high_watermark;
+	ctx->write_low_watermark = low_watermark;
+	ctx->write_timeout = timeout > 0 ? timeout : 0;
+	atomic_store_explicit(&ctx->write_backpressure, false, memory_order_release);
+	pthread_cond_broadcast(&ctx->write_ready_condition);
+	pthread_mutex_unlock(&ctx->queue_lock);
+	return 0;
+}
+
+int rist_sender_write_ready_callback_set(struct rist_ctx *rist_ctx, sender_write_ready_callback_t callback, void *arg)
+{
+	struct rist_sender *ctx = rist_sender_ctx_get(rist_ctx, "rist_sender_write_ready_callback_set");
+	if (!ctx)
+		return -1;
+	ctx->write_ready_callback_argument = arg;
+	ctx->write_ready_callback = callback;
+	return 0;
+}
+
+int rist_sender_write_ready_notify_fd_set(struct rist_ctx *rist_ctx, int fd)
+{
+	struct rist_sender *ctx = rist_sender_ctx_get(rist_ctx, "rist_sender_write_ready_notify_fd_set");
+	if (!ctx)
+		return -1;
+	ctx->write_ready_notify_fd = fd;
+	return 0;
+}
+
+int rist_sender_queue_info_get(struct rist_ctx *rist_ctx, struct rist_sender_queue_info *info)
+{
+	struct rist_sender *ctx = rist_sender_ctx_get(rist_ctx, "rist_sender_queue_info_get");
+	if (!ctx || !info)
+		return -1;
+	info->pending = (uint32_t)rist_get_sender_queue_pending(ctx);
+	info->capacity = (uint32_t)ctx->sender_queue_max;
+	info->high_watermark = ctx->write_high_watermark;
+	info->low_watermark = ctx->write_low_watermark;
+	info->backpressure = atomic_load_explicit(&ctx->write_backpressure, memory_order_acquire);
+	info->writes_refused = atomic_load_explicit(&ctx->writes_refused, memory_order_relaxed);
+	info->writes_blocked = atomic_load_explicit(&ctx->writes_blocked, memory_order_relaxed);
+	return 0;
+}
+
 /* Shared OOB functions -> Tunneled IP packets within GRE */
 int rist_oob_read(struct rist_ctx *ctx, const struct rist_oob_block **oob_block)
 {
@@ -621,6 +1116,35 @@ int rist_oob_callback_set(struct rist_ctx *ctx,
 	return 0;
 }
 
+int rist_oob_bandwidth_set(struct rist_ctx *ctx, uint32_t max_kbps, uint32_t max_delay_ms)
+{
+	if (RIST_UNLIKELY(!ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_oob_bandwidth_set call with null ctx!\n");
+		return -1;
+	}
+	struct rist_common_ctx *cctx = rist_struct_get_common(ctx);
+	if (RIST_UNLIKELY(!cctx))
+		return -1;
+	bool started = ctx->mode == RIST_RECEIVER_MODE ? ctx->receiver_ctx->receiver_thread != 0 : ctx->sender_ctx->sender_thread != 0;
+	if (started)
+	{
+		rist_log_priv(cctx, RIST_LOG_ERROR, "rist_oob_bandwidth_set must be called before starting\n");
+		return -3;
+	}
+	// 10 Gbps, keeps the token arithmetic in range
+	if (max_kbps > 10000000)
+	{
+		rist_log_priv(cctx, RIST_LOG_ERROR, "Out-of-band rate of %"PRIu32" kbps is out of range\n", max_kbps);
+		return -4;
+	}
+	uint64_t now = timestampNTP_u64();
+	rist_oob_sched_init(&cctx->oob_sched, (uint64_t)max_kbps * 1000 / 8, ONE_SECOND, now);
+	cctx->oob_max_delay = (uint64_t)max_delay_ms * RIST_CLOCK;
+	rist_log_priv(cctx, RIST_LOG_INFO, "Out-of-band data paced at %"PRIu32" kbps, %"PRIu32" ms deadline\n", max_kbps, max_delay_ms);
+	return 0;
+}
+
 /* Shared functions */
 
 int rist_jitter_max_set(struct rist_ctx *ctx, int t)
@@ -747,12 +1271,14 @@ int rist_stats_callback_set(struct rist_ctx *ctx, int statsinterval, int (*stats
 		cctx->stats_report_time = statsinterval * RIST_CLOCK;
 		if (ctx->mode == RIST_RECEIVER_MODE)
 		{
+			unsigned epoch = rist_epoch_enter(&cctx->epoch);
 			struct rist_flow *f = cctx->FLOWS;
 			while (f)
 			{
 				f->stats_report_time = statsinterval * RIST_CLOCK;
 				f = f->next;
 			}
+			rist_epoch_leave(&cctx->epoch, epoch);
 		}
 	}
 	pthread_mutex_unlock(&cctx->stats_lock);
@@ -868,7 +1394,10 @@ static int rist_receiver_peer_create(struct rist_receiver *ctx,
 		if (p->local_port % 2 != 0)
 		{
 			rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Could not create peer, port must be even!\n");
-			udpsocket_close(p->sd);
+			if (p->shared_socket)
+				rist_shared_socket_detach(p);
+			else
+				udpsocket_close(p->sd);
 			free(p);
 			return -1;
 		}
@@ -878,7 +1407,10 @@ static int rist_receiver_peer_create(struct rist_receiver *ctx,
 		p_rtcp->peer_ssrc = p->peer_ssrc;
 		if (!p_rtcp)
 		{
-			udpsocket_close(p->sd);
+			if (p->shared_socket)
+				rist_shared_socket_detach(p);
+			else
+				udpsocket_close(p->sd);
 			free(p);
 			return -1;
 		}
@@ -1068,6 +1600,13 @@ static int rist_sender_start(struct rist_sender *ctx)
 {
 	pthread_mutex_lock(&ctx->mutex);
 	if (!ctx->protocol_running) {
+		// Peers and flows removed while the protocol thread runs can only be torn down by the reaper
+		if (rist_thread_create(&ctx->common, &ctx->common.reaper.thread, NULL, rist_reaper_thread, &ctx->common.reaper) != 0)
+		{
+			rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Could not create reaper thread.\n");
+			goto unlock_failed;
+		}
+		ctx->common.reaper.running = true;
 		if (rist_thread_create(&ctx->common, &ctx->sender_thread, NULL, sender_pthread_protocol, (void *)ctx) != 0)
 		{
 			rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Could not created sender thread.\n");
@@ -1097,6 +1636,13 @@ static int rist_receiver_start(struct rist_receiver *ctx)
 	pthread_mutex_lock(&ctx->mutex);
 	if (!ctx->protocol_running)
 	{
+		// Peers and flows removed while the protocol thread runs can only be torn down by the reaper
+		if (rist_thread_create(&ctx->common, &ctx->common.reaper.thread, NULL, rist_reaper_thread, &ctx->common.reaper) != 0)
+		{
+			rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Could not create reaper thread.\n");
+			goto unlock_failed;
+		}
+		ctx->common.reaper.running = true;
 		if (rist_thread_create(&ctx->common, &ctx->receiver_thread, NULL, receiver_pthread_protocol, (void *)ctx) != 0)
 		{
 			rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Could not create receiver protocol thread.\n");
@@ -1181,6 +1727,15 @@ int rist_destroy(struct rist_ctx *ctx) {
 	return 0;
 }
 
+/* The ring is allocated once per flow, growing only moves the soft limit so
+ * lock-free readers never see it reallocated */
+static void receiver_fifo_capacity_update(struct rist_receiver *ctx)
+{
+	ctx->fifo_queue_capacity = ctx->fifo_queue_size;
+	if (ctx->fifo_policy == RIST_FIFO_POLICY_GROW && ctx->fifo_queue_size && ctx->fifo_queue_size < RIST_DATAOUT_QUEUE_GROW_BUFFERS)
+		ctx->fifo_queue_capacity = RIST_DATAOUT_QUEUE_GROW_BUFFERS;
+}
+
 int rist_receiver_set_output_fifo_size(struct rist_ctx *ctx, uint32_t desired_size)
 {
 	if (!ctx)
@@ -1204,9 +1759,267 @@ int rist_receiver_set_output_fifo_size(struct rist_ctx *ctx, uint32_t desired_si
 		return -4;
 	}
 	ctx->receiver_ctx->fifo_queue_size = desired_size;
+	receiver_fifo_capacity_update(ctx->receiver_ctx);
+	return 0;
+}
+
+int rist_receiver_set_output_fifo_policy(struct rist_ctx *ctx, enum rist_fifo_policy policy, size_t max_bytes)
+{
+	if (!ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_set_output_fifo_policy called with null ctx\n");
+		return -1;
+	}
+	if (ctx->mode != RIST_RECEIVER_MODE || !ctx->receiver_ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_set_output_fifo_policy can only be called on receiver\n");
+		return -2;
+	}
+	if (ctx->receiver_ctx->receiver_thread)
+	{
+		rist_log_priv2(ctx->receiver_ctx->common.logging_settings, RIST_LOG_ERROR, "rist_receiver_set_output_fifo_policy must be called before starting\n");
+		return -3;
+	}
+	if (policy > RIST_FIFO_POLICY_GROW)
+	{
+		rist_log_priv2(ctx->receiver_ctx->common.logging_settings, RIST_LOG_ERROR, "Invalid fifo policy %d\n", policy);
+		return -4;
+	}
+	ctx->receiver_ctx->fifo_policy = policy;
+	ctx->receiver_ctx->fifo_max_bytes = policy == RIST_FIFO_POLICY_GROW ? max_bytes : 0;
+	receiver_fifo_capacity_update(ctx->receiver_ctx);
+	return 0;
+}
+
+int rist_receiver_output_fifo_event_callback_set(struct rist_ctx *ctx, uint32_t high_watermark, uint32_t low_watermark,
+			receiver_fifo_event_callback_t callback, void *arg)
+{
+	if (!ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_output_fifo_event_callback_set called with null ctx\n");
+		return -1;
+	}
+	if (ctx->mode != RIST_RECEIVER_MODE || !ctx->receiver_ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_output_fifo_event_callback_set can only be called on receiver\n");
+		return -2;
+	}
+	if (ctx->receiver_ctx->receiver_thread)
+	{
+		rist_log_priv2(ctx->receiver_ctx->common.logging_settings, RIST_LOG_ERROR, "rist_receiver_output_fifo_event_callback_set must be called before starting\n");
+		return -3;
+	}
+	if (high_watermark && low_watermark >= high_watermark)
+	{
+		rist_log_priv2(ctx->receiver_ctx->common.logging_settings, RIST_LOG_ERROR, "Fifo low watermark must be below the high watermark\n");
+		return -4;
+	}
+	ctx->receiver_ctx->fifo_high_watermark = high_watermark;
+	ctx->receiver_ctx->fifo_low_watermark = low_watermark;
+	ctx->receiver_ctx->fifo_event_callback = callback;
+	ctx->receiver_ctx->fifo_event_callback_argument = arg;
+	return 0;
+}
+
+int rist_receiver_frame_reassembly_set(struct rist_ctx *ctx, enum rist_frame_policy policy, size_t max_frame_size)
+{
+	if (!ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_frame_reassembly_set called with null ctx\n");
+		return -1;
+	}
+	if (ctx->mode != RIST_RECEIVER_MODE || !ctx->receiver_ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_frame_reassembly_set can only be called on receiver\n");
+		return -2;
+	}
+	if (ctx->receiver_ctx->receiver_thread)
+	{
+		rist_log_priv2(ctx->receiver_ctx->common.logging_settings, RIST_LOG_ERROR, "rist_receiver_frame_reassembly_set must be called before starting\n");
+		return -3;
+	}
+	if (policy > RIST_FRAME_POLICY_DELIVER_INCOMPLETE)
+	{
+		rist_log_priv2(ctx->receiver_ctx->common.logging_settings, RIST_LOG_ERROR, "Invalid frame policy %d\n", policy);
+		return -4;
+	}
+	ctx->receiver_ctx->frame_policy = policy;
+	ctx->receiver_ctx->frame_max_size = max_frame_size ? max_frame_size : RIST_FRAME_MAX_SIZE_DEFAULT;
+	return 0;
+}
+
+int rist_receiver_flow_nack_budget_set(struct rist_ctx *ctx, uint32_t budget)
+{
+	if (!ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_flow_nack_budget_set called with null ctx\n");
+		return -1;
+	}
+	if (ctx->mode != RIST_RECEIVER_MODE || !ctx->receiver_ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_flow_nack_budget_set can only be called on receiver\n");
+		return -2;
+	}
+	ctx->receiver_ctx->flow_nack_budget = budget;
+	return 0;
+}
+
+int rist_receiver_early_renack_set(struct rist_ctx *ctx, bool enable)
+{
+	if (!ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_early_renack_set called with null ctx\n");
+		return -1;
+	}
+	if (ctx->mode != RIST_RECEIVER_MODE || !ctx->receiver_ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_early_renack_set can only be called on receiver\n");
+		return -2;
+	}
+	ctx->receiver_ctx->early_renack = enable;
+	return 0;
+}
+
+int rist_receiver_overload_control_set(struct rist_ctx *ctx, enum rist_overload_tier max_tier)
+{
+	if (!ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_overload_control_set called with null ctx\n");
+		return -1;
+	}
+	if (ctx->mode != RIST_RECEIVER_MODE || !ctx->receiver_ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_overload_control_set can only be called on receiver\n");
+		return -2;
+	}
+	if (max_tier < RIST_OVERLOAD_TIER_NONE || max_tier > RIST_OVERLOAD_TIER_SHED)
+	{
+		rist_log_priv2(ctx->receiver_ctx->common.logging_settings, RIST_LOG_ERROR, "Invalid overload tier %d\n", max_tier);
+		return -4;
+	}
+	ctx->receiver_ctx->overload.max_tier = max_tier;
+	// without overload control a socket is drained on every event, as it always was
+	ctx->receiver_ctx->common.recv_burst = max_tier == RIST_OVERLOAD_TIER_NONE ? 0 : RIST_OVERLOAD_RECV_BURST;
 	return 0;
 }
 
+int rist_receiver_resync_policy_set(struct rist_ctx *ctx, enum rist_resync_policy policy)
+{
+	if (!ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_resync_policy_set called with null ctx\n");
+		return -1;
+	}
+	if (ctx->mode != RIST_RECEIVER_MODE || !ctx->receiver_ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_resync_policy_set can only be called on receiver\n");
+		return -2;
+	}
+	if (policy < RIST_RESYNC_POLICY_DISABLED || policy > RIST_RESYNC_POLICY_DRAIN)
+	{
+		rist_log_priv2(ctx->receiver_ctx->common.logging_settings, RIST_LOG_ERROR, "Invalid resync policy %d\n", policy);
+		return -4;
+	}
+	ctx->receiver_ctx->resync_policy = policy;
+	return 0;
+}
+
+int rist_receiver_socket_filter_set(struct rist_ctx *ctx, enum rist_socket_filter mode)
+{
+	if (!ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_socket_filter_set called with null ctx\n");
+		return -1;
+	}
+	if (ctx->mode != RIST_RECEIVER_MODE || !ctx->receiver_ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_socket_filter_set can only be called on receiver\n");
+		return -2;
+	}
+	struct rist_receiver *rctx = ctx->receiver_ctx;
+	if (mode < RIST_SOCKET_FILTER_DISABLED || mode > RIST_SOCKET_FILTER_PEERS)
+	{
+		rist_log_priv2(rctx->common.logging_settings, RIST_LOG_ERROR, "Invalid socket filter mode %d\n", mode);
+		return -4;
+	}
+#ifndef __linux__
+	if (mode != RIST_SOCKET_FILTER_DISABLED)
+	{
+		rist_log_priv2(rctx->common.logging_settings, RIST_LOG_ERROR, "Socket filters are not available on this platform\n");
+		return -4;
+	}
+#endif
+	pthread_mutex_lock(&rctx->common.peerlist_lock);
+	rctx->socket_filter = mode;
+	for (struct rist_peer *peer = rctx->common.PEERS; peer != NULL; peer = peer->next)
+		rist_peer_socket_filter_update(peer);
+	pthread_mutex_unlock(&rctx->common.peerlist_lock);
+	return 0;
+}
+
+int rist_receiver_relay_set(struct rist_ctx *ctx, struct rist_ctx *sender_ctx)
+{
+	if (!ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_relay_set called with null ctx\n");
+		return -1;
+	}
+	if (ctx->mode != RIST_RECEIVER_MODE || !ctx->receiver_ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_relay_set can only be called on receiver\n");
+		return -2;
+	}
+	struct rist_receiver *rctx = ctx->receiver_ctx;
+	if (rctx->receiver_thread)
+	{
+		rist_log_priv2(rctx->common.logging_settings, RIST_LOG_ERROR, "rist_receiver_relay_set must be called before starting\n");
+		return -3;
+	}
+	if (sender_ctx && (sender_ctx->mode != RIST_SENDER_MODE || !sender_ctx->sender_ctx))
+	{
+		rist_log_priv2(rctx->common.logging_settings, RIST_LOG_ERROR, "rist_receiver_relay_set needs a sender context to relay to\n");
+		return -4;
+	}
+	if (rctx->relay_sender)
+		rctx->relay_sender->relay = false;
+	rctx->relay_sender = sender_ctx ? sender_ctx->sender_ctx : NULL;
+	rctx->relay_flow = NULL;
+	if (rctx->relay_sender)
+		rctx->relay_sender->relay = true;
+	rist_log_priv2(rctx->common.logging_settings, RIST_LOG_INFO, "Cut-through relay %s\n", rctx->relay_sender ? "enabled" : "disabled");
+	return 0;
+}
+
+int rist_receiver_flow_weight_set(struct rist_ctx *ctx, uint32_t flow_id, uint32_t weight)
+{
+	if (!ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_flow_weight_set called with null ctx\n");
+		return -1;
+	}
+	if (ctx->mode != RIST_RECEIVER_MODE || !ctx->receiver_ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_flow_weight_set can only be called on receiver\n");
+		return -2;
+	}
+	struct rist_common_ctx *cctx = &ctx->receiver_ctx->common;
+	int ret = -3;
+	unsigned epoch = rist_epoch_enter(&cctx->epoch);
+	for (struct rist_flow *f = cctx->FLOWS; f != NULL; f = f->next)
+	{
+		if (f->flow_id == flow_id)
+		{
+			f->nack_weight = weight ? weight : 1;
+			ret = 0;
+			break;
+		}
+	}
+	rist_epoch_leave(&cctx->epoch, epoch);
+	if (ret != 0)
+		rist_log_priv2(cctx->logging_settings, RIST_LOG_ERROR, "rist_receiver_flow_weight_set: no flow with id %"PRIu32"\n", flow_id);
+	return ret;
+}
+
 int rist_set_opt(struct rist_ctx *ctx, enum rist_opt opt, void* optval1, void* optval2, void* optval3)
 {
 	struct rist_common_ctx *cctx = NULL;
@@ -1228,6 +2041,24 @@ int rist_set_opt(struct rist_ctx *ctx, enum rist_opt opt, void* optval1, void* o
 		cctx->thread_callback = thread_callback->thread_callback;
 		cctx->thread_callback_arg = optval2;
 		break;
+	case RIST_OPT_STATS_SHM:
+		if (optval1 == NULL || optval3 != NULL)
+			return -1;
+		if (atomic_load_explicit(&cctx->startup_complete, memory_order_acquire))
+			return -1;
+		return rist_stats_shm_writer_open(cctx, optval1, optval2 ? *(int *)optval2 : 0);
+	case RIST_OPT_PATH_POLICY:
+		;
+		rist_path_policy_t *path_policy = optval1;
+		if (path_policy == NULL || optval3 != NULL)
+			return -1;
+		/* the hooks are read without locking by the protocol thread */
+		if (ctx->mode == RIST_RECEIVER_MODE ? ctx->receiver_ctx->receiver_thread != 0 : ctx->sender_ctx->sender_thread != 0)
+			return -1;
+		cctx->path_policy = *path_policy;
+		cctx->path_policy_arg = optval2;
+		cctx->path_policy_set = true;
+		break;
 	default:
 		return -1;
 	}
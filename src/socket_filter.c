@@ -0,0 +1,220 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "socket_filter.h"
+#include "socket-shim.h"
+#include "proto/gre.h"
+#include <string.h>
+#include <errno.h>
+
+int rist_socket_filter_add_source(struct rist_socket_filter_spec *spec, const struct sockaddr *addr)
+{
+	if (spec->source_count >= RIST_SOCKET_FILTER_MAX_SOURCES)
+		return -1;
+	struct rist_socket_filter_source *src = &spec->sources[spec->source_count];
+	memset(src, 0, sizeof(*src));
+	if (addr->sa_family == AF_INET) {
+		const struct sockaddr_in *in = (const struct sockaddr_in *)addr;
+		src->version = 4;
+		memcpy(src->addr, &in->sin_addr, 4);
+	} else if (addr->sa_family == AF_INET6) {
+		const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)addr;
+		static const uint8_t v4mapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+		/* dual stack sockets see the IPv4 header for mapped peers */
+		if (memcmp(&in6->sin6_addr, v4mapped, sizeof(v4mapped)) == 0) {
+			src->version = 4;
+			memcpy(src->addr, (const uint8_t *)&in6->sin6_addr + 12, 4);
+		} else {
+			src->version = 6;
+			memcpy(src->addr, &in6->sin6_addr, 16);
+		}
+	} else
+		return -1;
+	for (size_t i = 0; i < spec->source_count; i++) {
+		if (memcmp(&spec->sources[i], src, sizeof(*src)) == 0)
+			return 0;
+	}
+	spec->source_count++;
+	return 0;
+}
+
+#ifdef __linux__
+#include <linux/filter.h>
+#include <linux/sock_diag.h>
+
+/* the filter of a UDP socket sees the UDP header at offset 0 */
+#define PAYLOAD_OFF 8
+#define ACCEPT 0xffffffff
+#define DROP 0
+
+struct bpf_builder {
+	struct sock_filter *prog;
+	size_t len;
+	size_t max;
+};
+
+static void emit(struct bpf_builder *b, uint16_t code, uint8_t jt, uint8_t jf, uint32_t k)
+{
+	if (b->len < b->max)
+		b->prog[b->len] = (struct sock_filter)BPF_JUMP(code, k, jt, jf);
+	b->len++;
+}
+
+static uint32_t load_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void emit_shape(struct bpf_builder *b, const struct rist_socket_filter_spec *spec)
+{
+	if (!spec->gre) {
+		/* rtp or rtcp version 2 */
+		emit(b, BPF_LD | BPF_W | BPF_LEN, 0, 0, 0);
+		emit(b, BPF_JMP | BPF_JGE | BPF_K, 1, 0, PAYLOAD_OFF + 8);
+		emit(b, BPF_RET | BPF_K, 0, 0, DROP);
+		emit(b, BPF_LD | BPF_B | BPF_ABS, 0, 0, PAYLOAD_OFF);
+		emit(b, BPF_ALU | BPF_AND | BPF_K, 0, 0, 0xc0);
+		emit(b, BPF_JMP | BPF_JEQ | BPF_K, 1, 0, 0x80);
+		emit(b, BPF_RET | BPF_K, 0, 0, DROP);
+		return;
+	}
+	static const uint16_t protocols[] = {
+		RIST_GRE_PROTOCOL_TYPE_REDUCED, RIST_GRE_PROTOCOL_TYPE_KEEPALIVE, RIST_GRE_PROTOCOL_TYPE_FULL,
+		RIST_GRE_PROTOCOL_TYPE_VSF, RIST_GRE_PROTOCOL_TYPE_EAPOL,
+	};
+	const size_t protocol_count = sizeof(protocols) / sizeof(protocols[0]);
+	emit(b, BPF_LD | BPF_W | BPF_LEN, 0, 0, 0);
+	emit(b, BPF_JMP | BPF_JGE | BPF_K, 1, 0, PAYLOAD_OFF + 4);
+	emit(b, BPF_RET | BPF_K, 0, 0, DROP);
+	/* reserved bits of both flag bytes */
+	emit(b, BPF_LD | BPF_B | BPF_ABS, 0, 0, PAYLOAD_OFF);
+	emit(b, BPF_JMP | BPF_JSET | BPF_K, 0, 1, 0x40);
+	emit(b, BPF_RET | BPF_K, 0, 0, DROP);
+	emit(b, BPF_LD | BPF_B | BPF_ABS, 0, 0, PAYLOAD_OFF + 1);
+	emit(b, BPF_JMP | BPF_JSET | BPF_K, 0, 1, 0x07);
+	emit(b, BPF_RET | BPF_K, 0, 0, DROP);
+	emit(b, BPF_LD | BPF_H | BPF_ABS, 0, 0, PAYLOAD_OFF + 2);
+	for (size_t i = 0; i < protocol_count; i++)
+		emit(b, BPF_JMP | BPF_JEQ | BPF_K, (uint8_t)(protocol_count - i), 0, protocols[i]);
+	emit(b, BPF_RET | BPF_K, 0, 0, DROP);
+	if (!spec->check_key)
+		return;
+	/* key and sequence have to match the peer, except for eap */
+	emit(b, BPF_LD | BPF_B | BPF_ABS, 0, 0, PAYLOAD_OFF);
+	emit(b, BPF_ALU | BPF_AND | BPF_K, 0, 0, 0x30);
+	if (spec->encrypted)
+		emit(b, BPF_JMP | BPF_JEQ | BPF_K, 3, 0, 0x30);
+	else
+		emit(b, BPF_JMP | BPF_JEQ | BPF_K, 0, 3, 0x30);
+	emit(b, BPF_LD | BPF_H | BPF_ABS, 0, 0, PAYLOAD_OFF + 2);
+	emit(b, BPF_JMP | BPF_JEQ | BPF_K, 1, 0, RIST_GRE_PROTOCOL_TYPE_EAPOL);
+	emit(b, BPF_RET | BPF_K, 0, 0, DROP);
+}
+
+static void emit_sources(struct bpf_builder *b, const struct rist_socket_filter_spec *spec)
+{
+	size_t v4 = 0, v6 = 0;
+	for (size_t i = 0; i < spec->source_count; i++) {
+		if (spec->sources[i].version == 4)
+			v4++;
+		else
+			v6++;
+	}
+	/* the accept return is the last instruction, every match jumps there */
+	size_t accept = b->len + 3 + (v4 + 2) + 1 + v6 * 8 + 1;
+	emit(b, BPF_LD | BPF_B | BPF_ABS, 0, 0, (uint32_t)SKF_NET_OFF);
+	emit(b, BPF_ALU | BPF_RSH | BPF_K, 0, 0, 4);
+	emit(b, BPF_JMP | BPF_JEQ | BPF_K, 0, (uint8_t)(v4 + 2), 4);
+	emit(b, BPF_LD | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_NET_OFF + 12));
+	for (size_t i = 0; i < spec->source_count; i++) {
+		if (spec->sources[i].version == 4)
+			emit(b, BPF_JMP | BPF_JEQ | BPF_K, (uint8_t)(accept - b->len - 1), 0, load_be32(spec->sources[i].addr));
+	}
+	emit(b, BPF_RET | BPF_K, 0, 0, DROP);
+	emit(b, BPF_JMP | BPF_JEQ | BPF_K, 0, (uint8_t)(v6 * 8), 6);
+	for (size_t i = 0; i < spec->source_count; i++) {
+		if (spec->sources[i].version != 6)
+			continue;
+		for (int w = 0; w < 4; w++) {
+			emit(b, BPF_LD | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_NET_OFF + 8 + w * 4));
+			uint32_t word = load_be32(&spec->sources[i].addr[w * 4]);
+			if (w < 3)
+				emit(b, BPF_JMP | BPF_JEQ | BPF_K, 0, (uint8_t)(6 - w * 2), word);
+			else
+				emit(b, BPF_JMP | BPF_JEQ | BPF_K, (uint8_t)(accept - b->len - 1), 0, word);
+		}
+	}
+	emit(b, BPF_RET | BPF_K, 0, 0, DROP);
+}
+
+int rist_socket_filter_build(const struct rist_socket_filter_spec *spec, void *prog, size_t max_insns)
+{
+	struct bpf_builder b = { .prog = prog, .len = 0, .max = max_insns };
+	emit_shape(&b, spec);
+	if (spec->source_count > 0 && spec->source_count <= RIST_SOCKET_FILTER_MAX_SOURCES)
+		emit_sources(&b, spec);
+	emit(&b, BPF_RET | BPF_K, 0, 0, ACCEPT);
+	return b.len <= max_insns ? (int)b.len : -1;
+}
+
+int rist_socket_filter_attach(int sd, const struct rist_socket_filter_spec *spec)
+{
+	struct sock_filter insns[RIST_SOCKET_FILTER_MAX_INSNS];
+	int len = rist_socket_filter_build(spec, insns, RIST_SOCKET_FILTER_MAX_INSNS);
+	if (len < 0)
+		return -1;
+	struct sock_fprog fprog = { .len = (unsigned short)len, .filter = insns };
+	/* replaces the previous program atomically */
+	return setsockopt(sd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog));
+}
+
+int rist_socket_filter_detach(int sd)
+{
+	int dummy = 0;
+	if (setsockopt(sd, SOL_SOCKET, SO_DETACH_FILTER, &dummy, sizeof(dummy)) != 0 && errno != ENOENT)
+		return -1;
+	return 0;
+}
+
+uint32_t rist_socket_filter_drops(int sd)
+{
+	uint32_t meminfo[SK_MEMINFO_VARS];
+	socklen_t len = sizeof(meminfo);
+	if (getsockopt(sd, SOL_SOCKET, SO_MEMINFO, meminfo, &len) != 0 || len <= SK_MEMINFO_DROPS * sizeof(uint32_t))
+		return 0;
+	return meminfo[SK_MEMINFO_DROPS];
+}
+
+#else
+
+int rist_socket_filter_build(const struct rist_socket_filter_spec *spec, void *prog, size_t max_insns)
+{
+	(void)spec;
+	(void)prog;
+	(void)max_insns;
+	return -1;
+}
+
+int rist_socket_filter_attach(int sd, const struct rist_socket_filter_spec *spec)
+{
+	(void)sd;
+	(void)spec;
+	return -1;
+}
+
+int rist_socket_filter_detach(int sd)
+{
+	(void)sd;
+	return 0;
+}
+
+uint32_t rist_socket_filter_drops(int sd)
+{
+	(void)sd;
+	return 0;
+}
+
+#endif
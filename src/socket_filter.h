@@ -0,0 +1,66 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_SOCKET_FILTER_H
+#define RIST_SOCKET_FILTER_H
+
+#include "common/attributes.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+struct sockaddr;
+
+/*
+ * In-kernel receive filter for the UDP sockets of a receiver (Linux classic
+ * BPF, SO_ATTACH_FILTER).
+ *
+ * The program checks the shape of the first header: RTP/RTCP version 2 for
+ * the simple profile, a GRE header with the reserved bits clear and a known
+ * protocol type for main/advanced. Once the key state of the peer is known,
+ * everything but EAP must carry the key and sequence fields on encrypted
+ * peers, on clear peers nothing but EAP may. An optional allowlist then
+ * restricts the IPv4/IPv6 source address. Datagrams failing a check never
+ * get queued on the socket, they show up in the socket drop counter instead.
+ */
+
+/* the allowlist is compiled into the program, beyond this only the shape is checked */
+#define RIST_SOCKET_FILTER_MAX_SOURCES 16
+/* upper bound of the generated program length */
+#define RIST_SOCKET_FILTER_MAX_INSNS (40 + RIST_SOCKET_FILTER_MAX_SOURCES * 8)
+
+struct rist_socket_filter_source {
+	/* 4 (IPv4) or 6 (IPv6) */
+	uint8_t version;
+	/* network byte order, IPv4 uses the first 4 bytes */
+	uint8_t addr[16];
+};
+
+struct rist_socket_filter_spec {
+	/* main/advanced profile (GRE), rtp otherwise */
+	bool gre;
+	/* whether the GRE key and sequence fields are checked: present on
+	 * encrypted peers, absent otherwise (eap is always let through) */
+	bool check_key;
+	bool encrypted;
+	size_t source_count;
+	struct rist_socket_filter_source sources[RIST_SOCKET_FILTER_MAX_SOURCES];
+};
+
+/* Adds the address of a sockaddr_in/sockaddr_in6 (IPv4 mapped addresses are
+ * added as IPv4) to the allowlist. Returns -1 when the list is full or the
+ * family is not supported. */
+RIST_PRIV int rist_socket_filter_add_source(struct rist_socket_filter_spec *spec, const struct sockaddr *addr);
+/* Returns the program length in instructions, -1 when filters are not
+ * supported on this platform. */
+RIST_PRIV int rist_socket_filter_build(const struct rist_socket_filter_spec *spec, void *prog, size_t max_insns);
+RIST_PRIV int rist_socket_filter_attach(int sd, const struct rist_socket_filter_spec *spec);
+RIST_PRIV int rist_socket_filter_detach(int sd);
+/* Datagrams the kernel dropped on this socket (filter or full receive
+ * buffer) since it was created, 0 when unknown. */
+RIST_PRIV uint32_t rist_socket_filter_drops(int sd);
+
+#endif
@@ -10,6 +10,7 @@
 #include "rist-private.h"
 #include "log-private.h"
 #include "udp-private.h"
+#include "path_policy.h"
 #include "proto/rist_time.h"
 #include <string.h>
 #include "cjson/cJSON.h"
@@ -20,6 +21,55 @@ static double round_two_digits(double number)
 	return (double)(new_number) / 100;
 }
 
+/* Totals are kept for the shared memory stats page, the instant counters
+ * are cleared after every report */
+static void sender_stats_accumulate(struct rist_peer_sender_totals *total, const struct rist_peer_sender_stats *instant)
+{
+	total->sent += instant->sent;
+	total->received += instant->received;
+	total->retrans += instant->retrans;
+	total->bloat_skip += instant->bloat_skip;
+	total->bandwidth_skip += instant->bandwidth_skip;
+	total->retrans_skip += instant->retrans_skip;
+}
+
+static void receiver_stats_accumulate(struct rist_peer_receiver_totals *total, const struct rist_peer_receiver_stats *instant)
+{
+	total->sent_rtcp += instant->sent_rtcp;
+	total->received_rtcp += instant->received_rtcp;
+	total->received += instant->received;
+}
+
+static void flow_stats_accumulate(struct rist_flow_totals *total, const struct rist_peer_flow_stats *instant)
+{
+	total->lost += instant->lost;
+	total->received += instant->received;
+	total->dupe += instant->dupe;
+	total->dropped_full += instant->dropped_full;
+	total->dropped_late += instant->dropped_late;
+	total->missing += instant->missing;
+	total->retries += instant->retries;
+	total->recovered += instant->recovered;
+	total->reordered += instant->reordered;
+}
+
+/* Out-of-band totals of the context, every peer/flow report carries them */
+static void stats_add_oob(cJSON *json_stats, struct rist_common_ctx *cctx)
+{
+	if (!cctx->oob_data_enabled)
+		return;
+	rist_calculate_bitrate(0, &cctx->oob_bw);
+	cJSON *oob = cJSON_AddObjectToObject(json_stats, "oob");
+	cJSON_AddNumberToObject(oob, "bitrate", (double)(cctx->oob_bw.eight_times_bitrate_fast / 8));
+	cJSON_AddNumberToObject(oob, "rate_limit", (double)(cctx->oob_sched.rate * 8));
+	cJSON_AddNumberToObject(oob, "backoffs", (double)cctx->oob_sched.backoffs);
+	cJSON_AddNumberToObject(oob, "queued", (double)(uint16_t)(cctx->oob_queue_write_index - cctx->oob_queue_read_index));
+	cJSON_AddNumberToObject(oob, "queue_delay", (double)(cctx->oob_eight_times_delay / 8) / RIST_CLOCK);
+	cJSON_AddNumberToObject(oob, "queue_delay_max", (double)cctx->oob_delay_max / RIST_CLOCK);
+	cJSON_AddNumberToObject(oob, "sent", (double)cctx->oob_sent);
+	cJSON_AddNumberToObject(oob, "dropped", (double)atomic_load_explicit(&cctx->oob_dropped, memory_order_relaxed));
+}
+
 void rist_sender_peer_statistics(struct rist_peer *peer)
 {
 	// TODO: print warning here?? stale flow?
@@ -32,8 +82,6 @@ void rist_sender_peer_statistics(struct rist_peer *peer)
 	stats_container->stats_type = RIST_STATS_SENDER_PEER;
 	stats_container->version = RIST_STATS_VERSION;
 
-	peer->stats_sender_total.received += peer->stats_sender_instant.received;
-
 	size_t retry_buf_size = rist_get_sender_retry_queue_size(peer->sender_ctx);
 
 	struct rist_bandwidth_estimation *cli_bw = &peer->bw;
@@ -60,6 +108,11 @@ void rist_sender_peer_statistics(struct rist_peer *peer)
 	size_t retry_bitrate = retry_bw->eight_times_bitrate_fast / 8;
 	double avg_rtt = ((double)peer->eight_times_rtt / 8);
 
+	// fraction of the packets reported by the receiver that were CE marked
+	double ecn_ce_ratio = 0;
+	if (peer->stats_sender_instant.ecn_total > 0)
+		ecn_ce_ratio = round_two_digits((double)peer->stats_sender_instant.ecn_ce / (double)peer->stats_sender_instant.ecn_total);
+
 	struct rist_common_ctx *cctx = get_cctx(peer);
 
 	cJSON *stats = cJSON_CreateObject();
@@ -79,10 +132,24 @@ void rist_sender_peer_statistics(struct rist_peer *peer)
 	cJSON_AddNumberToObject(json_stats, "bandwidth_skipped", (double)peer->stats_sender_instant.bandwidth_skip);
 	cJSON_AddNumberToObject(json_stats, "bloat_skipped", (double)peer->stats_sender_instant.bloat_skip);
 	cJSON_AddNumberToObject(json_stats, "retransmit_skipped", (double)peer->stats_sender_instant.retrans_skip);
+	cJSON_AddNumberToObject(json_stats, "retransmitted_cached", (double)peer->stats_sender_instant.retrans_cached);
+	cJSON_AddNumberToObject(json_stats, "ecn_skipped", (double)peer->stats_sender_instant.ecn_skip);
+	cJSON_AddNumberToObject(json_stats, "ecn_ce", (double)peer->stats_sender_instant.ecn_ce);
+	cJSON_AddNumberToObject(json_stats, "ecn_ce_ratio", ecn_ce_ratio);
 	cJSON_AddNumberToObject(json_stats, "rtt", (double)peer->last_rtt / RIST_CLOCK);
 	cJSON_AddNumberToObject(json_stats, "avg_rtt", (double)avg_rtt / RIST_CLOCK);
 	cJSON_AddNumberToObject(json_stats, "retry_buffer_size", (double)retry_buf_size);
 	cJSON_AddNumberToObject(json_stats, "cooldown_time", (double)time_left);
+	struct rist_sender *sender = peer->sender_ctx;
+	if (sender->history.base) {
+		cJSON *history = cJSON_AddObjectToObject(json_stats, "history");
+		cJSON_AddNumberToObject(history, "store_size", (double)sender->history.capacity);
+		cJSON_AddNumberToObject(history, "store_used", (double)(sender->history.head < sender->history.capacity ? sender->history.head : sender->history.capacity));
+		cJSON_AddNumberToObject(history, "moved", (double)sender->history_moved);
+		cJSON_AddNumberToObject(history, "retransmitted", (double)sender->history_retrans);
+		cJSON_AddNumberToObject(history, "overwritten", (double)sender->history_overwritten);
+	}
+	stats_add_oob(json_stats, cctx);
 	char *stats_string = cJSON_PrintUnformatted(stats);
 	cJSON_Delete(stats);
 
@@ -104,6 +171,10 @@ void rist_sender_peer_statistics(struct rist_peer *peer)
 	else
 		rist_stats_free(stats_container);
 
+	if (peer->is_data && peer->stats_sender_instant.sent > 0)
+		rist_path_loss_update(cctx, peer, (uint32_t)(peer->stats_sender_instant.retrans * 1000 / peer->stats_sender_instant.sent));
+
+	sender_stats_accumulate(&peer->stats_sender_total, &peer->stats_sender_instant);
 	memset(&peer->stats_sender_instant, 0, sizeof(peer->stats_sender_instant));
 	pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
 }
@@ -162,8 +233,19 @@ void rist_receiver_flow_statistics(struct rist_receiver *ctx, struct rist_flow *
 		cJSON_AddNumberToObject(peer_stats, "avg_rtt", (double)avg_rtt / RIST_CLOCK);
 		cJSON_AddNumberToObject(peer_stats, "bitrate", (double)bitrate);
 		cJSON_AddNumberToObject(peer_stats, "avg_bitrate", (double)avg_bitrate);
+		cJSON_AddNumberToObject(peer_stats, "ecn_ect", (double)peer->stats_receiver_instant.ecn_ect);
+		cJSON_AddNumberToObject(peer_stats, "ecn_ce", (double)peer->stats_receiver_instant.ecn_ce);
+		cJSON_AddNumberToObject(peer_stats, "return_bytes", (double)peer->stats_receiver_instant.return_bytes);
+		cJSON_AddNumberToObject(peer_stats, "return_skipped", (double)peer->stats_receiver_instant.return_skipped);
+		/* kernel side drops (socket filter, full receive buffer) since the socket was opened */
+		int sd = peer->parent ? peer->parent->sd : peer->sd;
+		cJSON_AddNumberToObject(peer_stats, "socket_drops", (double)rist_socket_filter_drops(sd));
 		cJSON_AddItemToArray(peers, peer_obj);
+		if (flow->stats_instant.received + flow->stats_instant.missing > 0)
+			rist_path_loss_update(&ctx->common, peer, (uint32_t)((uint64_t)flow->stats_instant.missing * 1000 /
+				(flow->stats_instant.received + flow->stats_instant.missing)));
 		// Clear peer instant stats
+		receiver_stats_accumulate(&peer->stats_receiver_total, &peer->stats_receiver_instant);
 		memset(&peer->stats_receiver_instant, 0, sizeof(peer->stats_receiver_instant));
 	}
 
@@ -236,10 +318,36 @@ void rist_receiver_flow_statistics(struct rist_receiver *ctx, struct rist_flow *
 	cJSON_AddNumberToObject(json_stats, "duplicates", (double)flow->stats_instant.dupe);
 	cJSON_AddNumberToObject(json_stats, "missing_queue", (double)flow->missing_counter);
 	cJSON_AddNumberToObject(json_stats, "missing_queue_max", (double)flow->missing_counter_max);
+	cJSON_AddNumberToObject(json_stats, "return_nacks_deferred", (double)flow->stats_instant.return_nacks_deferred);
+	cJSON_AddNumberToObject(json_stats, "return_nacks_dropped", (double)flow->stats_instant.return_nacks_dropped);
+	cJSON_AddNumberToObject(json_stats, "nack_throttled", (double)flow->stats_instant.nack_throttled);
+	if (ctx->early_renack)
+		cJSON_AddNumberToObject(json_stats, "early_renacks", (double)flow->stats_instant.early_renacks);
+	cJSON_AddNumberToObject(json_stats, "frames_incomplete", (double)flow->stats_instant.frames_incomplete);
+	cJSON_AddNumberToObject(json_stats, "resyncs", (double)flow->resyncs);
+	if (ctx->relay_sender) {
+		cJSON *relay = cJSON_AddObjectToObject(json_stats, "relay");
+		cJSON_AddBoolToObject(relay, "relayed", ctx->relay_flow == flow);
+		cJSON_AddNumberToObject(relay, "forwarded", (double)flow->stats_instant.relay_forwarded);
+		cJSON_AddNumberToObject(relay, "expedited_nacks", (double)flow->stats_instant.relay_expedited);
+	}
+	cJSON *overload = cJSON_AddObjectToObject(json_stats, "overload");
+	cJSON_AddNumberToObject(overload, "tier", ctx->overload.tier);
+	cJSON_AddNumberToObject(overload, "shed", flow->overload_shed);
+	cJSON_AddNumberToObject(overload, "shed_packets", (double)flow->stats_instant.overload_shed);
+	cJSON_AddNumberToObject(overload, "nacks_dropped", (double)flow->stats_instant.overload_nacks_dropped);
+	// receiver wide transition counts since start, index is the tier
+	cJSON *entered = cJSON_AddArrayToObject(overload, "entered");
+	cJSON *exited = cJSON_AddArrayToObject(overload, "exited");
+	for (int i = 0; i < RIST_OVERLOAD_TIERS; i++) {
+		cJSON_AddItemToArray(entered, cJSON_CreateNumber((double)ctx->overload.entered[i]));
+		cJSON_AddItemToArray(exited, cJSON_CreateNumber((double)ctx->overload.exited[i]));
+	}
 	cJSON_AddNumberToObject(json_stats, "min_inter_packet_spacing", (double)flow->stats_instant.min_ips);
 	cJSON_AddNumberToObject(json_stats, "cur_inter_packet_spacing", (double)flow->stats_instant.cur_ips);
 	cJSON_AddNumberToObject(json_stats, "max_inter_packet_spacing", (double)flow->stats_instant.max_ips);
 	cJSON_AddNumberToObject(json_stats, "bitrate", (double)flow->bw.bitrate);
+	stats_add_oob(json_stats, &ctx->common);
 
 	char *stats_string = cJSON_PrintUnformatted(stats);
 	cJSON_Delete(stats);
@@ -274,6 +382,7 @@ void rist_receiver_flow_statistics(struct rist_receiver *ctx, struct rist_flow *
 	else
 		rist_stats_free(stats_container);
 
+	flow_stats_accumulate(&flow->totals, &flow->stats_instant);
 	memset(&flow->stats_instant, 0, sizeof(flow->stats_instant));
 	flow->stats_instant.min_ips = 0xFFFFFFFFFFFFFFFFULL;
 	pthread_mutex_unlock(&ctx->common.stats_lock);
@@ -0,0 +1,317 @@
+/* librist. Copyright © 2019-2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "rist-private.h"
+#include "log-private.h"
+#include "proto/rist_time.h"
+#include "librist/stats_shm.h"
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define RIST_STATS_SHM_DEFAULT_INTERVAL (100)
+#define RIST_STATS_SHM_READ_RETRIES (1000)
+
+struct rist_stats_shm_writer {
+	struct rist_stats_shm *page;
+	int fd;
+	uint64_t interval;
+	uint64_t next_time;
+};
+
+struct rist_stats_shm_reader {
+	const struct rist_stats_shm *page;
+	int fd;
+};
+
+static inline atomic_uint *shm_seq(const struct rist_stats_shm *page)
+{
+	return (atomic_uint *)&page->seq;
+}
+
+static uint64_t ticks_to_us(uint64_t ticks)
+{
+	return ticks * 1000 / RIST_CLOCK;
+}
+
+#ifndef _WIN32
+int rist_stats_shm_writer_open(struct rist_common_ctx *cctx, const char *path, int interval_ms)
+{
+	if (cctx->stats_shm) {
+		rist_log_priv(cctx, RIST_LOG_ERROR, "Stats page is already configured\n");
+		return -1;
+	}
+	// Never follow a link planted at the path, only owner and group may read the counters
+	int fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0640);
+	if (fd < 0) {
+		rist_log_priv(cctx, RIST_LOG_ERROR, "Could not open stats page %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		rist_log_priv(cctx, RIST_LOG_ERROR, "Stats page %s is not a regular file\n", path);
+		close(fd);
+		return -1;
+	}
+	// The page is rewritten from scratch, drop whatever an earlier run left
+	if (ftruncate(fd, 0) != 0) {
+		rist_log_priv(cctx, RIST_LOG_ERROR, "Could not size stats page %s: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	if (ftruncate(fd, sizeof(struct rist_stats_shm)) != 0) {
+		rist_log_priv(cctx, RIST_LOG_ERROR, "Could not size stats page %s: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	void *map = mmap(NULL, sizeof(struct rist_stats_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		rist_log_priv(cctx, RIST_LOG_ERROR, "Could not map stats page %s: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	struct rist_stats_shm_writer *w = calloc(1, sizeof(*w));
+	if (!w) {
+		munmap(map, sizeof(struct rist_stats_shm));
+		close(fd);
+		return -1;
+	}
+	w->page = map;
+	w->fd = fd;
+	w->interval = (uint64_t)(interval_ms > 0 ? interval_ms : RIST_STATS_SHM_DEFAULT_INTERVAL) * RIST_CLOCK;
+	w->page->size = sizeof(struct rist_stats_shm);
+	w->page->version = RIST_STATS_SHM_VERSION;
+	w->page->profile = cctx->profile;
+	atomic_store_explicit(shm_seq(w->page), 0, memory_order_relaxed);
+	//Magic last, readers reject the page until it is set
+	atomic_thread_fence(memory_order_release);
+	w->page->magic = RIST_STATS_SHM_MAGIC;
+	cctx->stats_shm = w;
+	rist_log_priv(cctx, RIST_LOG_INFO, "Publishing stats to %s every %d ms\n", path, (int)(w->interval / RIST_CLOCK));
+	return 0;
+}
+
+void rist_stats_shm_writer_close(struct rist_common_ctx *cctx)
+{
+	struct rist_stats_shm_writer *w = cctx->stats_shm;
+	if (!w)
+		return;
+	w->page->closed = 1;
+	munmap(w->page, sizeof(struct rist_stats_shm));
+	close(w->fd);
+	free(w);
+	cctx->stats_shm = NULL;
+}
+#else
+int rist_stats_shm_writer_open(struct rist_common_ctx *cctx, const char *path, int interval_ms)
+{
+	RIST_MARK_UNUSED(path);
+	RIST_MARK_UNUSED(interval_ms);
+	rist_log_priv(cctx, RIST_LOG_ERROR, "Stats page is not supported on this platform\n");
+	return -1;
+}
+
+void rist_stats_shm_writer_close(struct rist_common_ctx *cctx)
+{
+	RIST_MARK_UNUSED(cctx);
+}
+#endif
+
+static struct rist_stats_shm *writer_begin(struct rist_stats_shm_writer *w, uint64_t now)
+{
+	if (now < w->next_time)
+		return NULL;
+	w->next_time = now + w->interval;
+	atomic_uint *seq = shm_seq(w->page);
+	atomic_store_explicit(seq, atomic_load_explicit(seq, memory_order_relaxed) + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	return w->page;
+}
+
+static void writer_end(struct rist_stats_shm_writer *w, uint64_t now)
+{
+	w->page->updates++;
+	w->page->timestamp = ticks_to_us(now);
+	atomic_uint *seq = shm_seq(w->page);
+	atomic_store_explicit(seq, atomic_load_explicit(seq, memory_order_relaxed) + 1, memory_order_release);
+}
+
+static void fill_peer(struct rist_stats_shm_peer *sp, struct rist_peer *peer)
+{
+	memset(sp, 0, sizeof(*sp));
+	sp->peer_id = peer->adv_peer_id;
+	sp->flow_id = peer->adv_flow_id;
+	sp->flags = (peer->authenticated ? RIST_STATS_SHM_PEER_AUTHENTICATED : 0) |
+				(peer->dead ? RIST_STATS_SHM_PEER_DEAD : 0) |
+				(peer->is_data ? RIST_STATS_SHM_PEER_DATA : 0);
+	sp->rtt = (uint32_t)ticks_to_us(peer->last_rtt);
+	sp->avg_rtt = (uint32_t)ticks_to_us(peer->eight_times_rtt / 8);
+	sp->bandwidth = peer->bw.eight_times_bitrate_fast / 8;
+	sp->retry_bandwidth = peer->retry_bw.eight_times_bitrate_fast / 8;
+}
+
+/* Called from the sender protocol thread with the peerlist lock held */
+void rist_stats_shm_sender_publish(struct rist_sender *ctx, uint64_t now)
+{
+	struct rist_stats_shm *page = writer_begin(ctx->common.stats_shm, now);
+	if (!page)
+		return;
+	page->mode = RIST_STATS_SHM_MODE_SENDER;
+	uint32_t count = 0;
+	page->truncated = ctx->peer_lst_len > RIST_STATS_SHM_MAX_PEERS ? RIST_STATS_SHM_TRUNCATED_PEERS : 0;
+	for (size_t i = 0; i < ctx->peer_lst_len && count < RIST_STATS_SHM_MAX_PEERS; i++) {
+		struct rist_peer *peer = ctx->peer_lst[i];
+		struct rist_stats_shm_peer *sp = &page->peers[count++];
+		const struct rist_peer_sender_totals *total = &peer->stats_sender_total;
+		const struct rist_peer_sender_stats *instant = &peer->stats_sender_instant;
+		fill_peer(sp, peer);
+		sp->sent = total->sent + instant->sent;
+		sp->received = total->received + instant->received;
+		sp->retransmitted = total->retrans + instant->retrans;
+		sp->bandwidth_skipped = total->bandwidth_skip + instant->bandwidth_skip;
+		sp->bloat_skipped = total->bloat_skip + instant->bloat_skip;
+		sp->retransmit_skipped = total->retrans_skip + instant->retrans_skip;
+		snprintf(sp->cname, sizeof(sp->cname), "%s", peer->receiver_name);
+	}
+	page->peer_count = count;
+	page->flow_count = 0;
+	writer_end(ctx->common.stats_shm, now);
+}
+
+/* Called from the receiver protocol thread with the peerlist lock held */
+void rist_stats_shm_receiver_publish(struct rist_receiver *ctx, uint64_t now)
+{
+	struct rist_stats_shm *page = writer_begin(ctx->common.stats_shm, now);
+	if (!page)
+		return;
+	page->mode = RIST_STATS_SHM_MODE_RECEIVER;
+	uint32_t peer_count = 0;
+	uint32_t flow_count = 0;
+	uint32_t truncated = 0;
+	for (struct rist_flow *f = ctx->common.FLOWS; f; f = f->next) {
+		if (flow_count == RIST_STATS_SHM_MAX_FLOWS) {
+			truncated |= RIST_STATS_SHM_TRUNCATED_FLOWS;
+			break;
+		}
+		struct rist_stats_shm_flow *sf = &page->flows[flow_count++];
+		const struct rist_flow_totals *total = &f->totals;
+		const struct rist_peer_flow_stats *instant = &f->stats_instant;
+		memset(sf, 0, sizeof(*sf));
+		sf->flow_id = f->flow_id;
+		sf->peer_count = (uint32_t)f->peer_lst_len;
+		sf->dead = f->dead;
+		sf->bitrate = f->bw.bitrate;
+		sf->received = total->received + instant->received;
+		sf->missing = total->missing + instant->missing;
+		sf->reordered = total->reordered + instant->reordered;
+		sf->recovered = total->recovered + instant->recovered;
+		sf->retries = total->retries + instant->retries;
+		sf->lost = total->lost + instant->lost;
+		sf->duplicates = total->dupe + instant->dupe;
+		sf->dropped_late = total->dropped_late + instant->dropped_late;
+		sf->dropped_full = total->dropped_full + instant->dropped_full;
+		sf->missing_queue = f->missing_counter;
+		for (size_t i = 0; i < f->peer_lst_len; i++) {
+			if (peer_count == RIST_STATS_SHM_MAX_PEERS) {
+				truncated |= RIST_STATS_SHM_TRUNCATED_PEERS;
+				break;
+			}
+			struct rist_peer *peer = f->peer_lst[i];
+			if (!peer->is_data && peer->peer_data)
+				peer = peer->peer_data;
+			struct rist_stats_shm_peer *sp = &page->peers[peer_count++];
+			fill_peer(sp, peer);
+			sp->flow_id = f->flow_id;
+			sp->received_data = peer->stats_receiver_total.received + peer->stats_receiver_instant.received;
+			sp->received_rtcp = peer->stats_receiver_total.received_rtcp + peer->stats_receiver_instant.received_rtcp;
+			sp->sent_rtcp = peer->stats_receiver_total.sent_rtcp + peer->stats_receiver_instant.sent_rtcp;
+			snprintf(sp->cname, sizeof(sp->cname), "%s", peer->receiver_name);
+		}
+	}
+	page->peer_count = peer_count;
+	page->flow_count = flow_count;
+	page->truncated = truncated;
+	writer_end(ctx->common.stats_shm, now);
+}
+
+int rist_stats_shm_reader_open(struct rist_stats_shm_reader **reader, const char *path)
+{
+#ifndef _WIN32
+	if (!reader || !path)
+		return -1;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct rist_stats_shm)) {
+		close(fd);
+		return -1;
+	}
+	void *map = mmap(NULL, sizeof(struct rist_stats_shm), PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		close(fd);
+		return -1;
+	}
+	const struct rist_stats_shm *page = map;
+	if (page->magic != RIST_STATS_SHM_MAGIC || page->version != RIST_STATS_SHM_VERSION ||
+		page->size != sizeof(struct rist_stats_shm)) {
+		munmap(map, sizeof(struct rist_stats_shm));
+		close(fd);
+		return -1;
+	}
+	struct rist_stats_shm_reader *r = calloc(1, sizeof(*r));
+	if (!r) {
+		munmap(map, sizeof(struct rist_stats_shm));
+		close(fd);
+		return -1;
+	}
+	r->page = page;
+	r->fd = fd;
+	*reader = r;
+	return 0;
+#else
+	RIST_MARK_UNUSED(reader);
+	RIST_MARK_UNUSED(path);
+	return -1;
+#endif
+}
+
+int rist_stats_shm_reader_snapshot(struct rist_stats_shm_reader *reader, struct rist_stats_shm *snapshot)
+{
+	if (!reader || !snapshot)
+		return -1;
+	atomic_uint *seq = shm_seq(reader->page);
+	for (int i = 0; i < RIST_STATS_SHM_READ_RETRIES; i++) {
+		unsigned start = atomic_load_explicit(seq, memory_order_acquire);
+		if (start & 1)
+			continue;
+		memcpy(snapshot, reader->page, sizeof(*snapshot));
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(seq, memory_order_relaxed) == start) {
+			snapshot->seq = start;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+void rist_stats_shm_reader_close(struct rist_stats_shm_reader **reader)
+{
+	if (!reader || !*reader)
+		return;
+#ifndef _WIN32
+	munmap((void *)(*reader)->page, sizeof(struct rist_stats_shm));
+	close((*reader)->fd);
+#endif
+	free(*reader);
+	*reader = NULL;
+}
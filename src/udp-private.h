@@ -26,9 +26,29 @@
 // Maximum offset before the payload that the code can use to put in headers
 #define RIST_MAX_PAYLOAD_OFFSET (sizeof(struct rist_gre_key_seq) + sizeof(struct rist_protocol_hdr))
 
+// Shared multicast receive sockets need the destination address of each datagram
+#if !defined(_WIN32) && defined(IP_PKTINFO) && defined(IPV6_RECVPKTINFO) && defined(MCAST_JOIN_SOURCE_GROUP)
+#define HAVE_MCAST_PKTINFO 1
+#else
+#define HAVE_MCAST_PKTINFO 0
+#endif
+
+// ECN field of the IP header (RFC 3168)
+#define RIST_ECN_MASK    0x03
+#define RIST_ECN_NOT_ECT 0x00
+#define RIST_ECN_ECT1    0x01
+#define RIST_ECN_ECT0    0x02
+#define RIST_ECN_CE      0x03
+
+#if !defined(_WIN32) && defined(IP_RECVTOS) && defined(IPV6_RECVTCLASS)
+#define HAVE_ECN 1
+#else
+#define HAVE_ECN 0
+#endif
+
 /* shared functions in udp.c */
 RIST_PRIV void rist_send_nacks(struct rist_flow *f, struct rist_peer *peer);
-RIST_PRIV int rist_receiver_send_nacks(struct rist_peer *peer, uint32_t seq_array[], size_t array_len);
+RIST_PRIV int rist_receiver_send_nacks(struct rist_peer *peer, uint32_t seq_array[], size_t array_len, bool early);
 RIST_PRIV int rist_receiver_periodic_rtcp(struct rist_peer *peer);
 RIST_PRIV void rist_sender_periodic_rtcp(struct rist_peer *peer);
 RIST_PRIV int rist_respond_echoreq(struct rist_peer *peer, const uint64_t echo_request_time, uint32_t ssrc);
@@ -36,12 +56,32 @@ RIST_PRIV int rist_request_echo(struct rist_peer *peer);
 RIST_PRIV int rist_send_common_rtcp(struct rist_peer *p, uint8_t payload_type, uint8_t *payload, size_t payload_len, uint64_t source_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp);
 RIST_PRIV void rist_sender_send_data_balanced(struct rist_sender *ctx, struct rist_buffer *buffer);
 RIST_PRIV int rist_sender_enqueue(struct rist_sender *ctx, const void *data, size_t len, uint64_t datagram_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp);
+RIST_PRIV int rist_sender_enqueue_frame(struct rist_sender *ctx, const void *data, size_t len, size_t fragment_size, uint64_t datagram_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp);
 RIST_PRIV void rist_clean_sender_enqueue(struct rist_sender *ctx);
-RIST_PRIV void rist_retry_enqueue(struct rist_sender *ctx, uint32_t seq, struct rist_peer *peer);
+RIST_PRIV void rist_sender_history_spill(struct rist_sender *ctx);
+RIST_PRIV void rist_retry_enqueue(struct rist_sender *ctx, uint32_t seq, struct rist_peer *peer, bool early);
 RIST_PRIV ssize_t rist_retry_dequeue(struct rist_sender *ctx);
 RIST_PRIV int rist_set_url(struct rist_peer *peer);
 RIST_PRIV void rist_create_socket(struct rist_peer *peer);
+RIST_PRIV void rist_stripe_events_remove(struct rist_peer *peer);
+RIST_PRIV void rist_stripe_sockets_close(struct rist_peer *peer);
+RIST_PRIV int rist_shared_socket_attach(struct rist_peer *peer, uint16_t port);
+RIST_PRIV void rist_shared_socket_detach(struct rist_peer *peer);
+RIST_PRIV ssize_t rist_shared_socket_recv(struct rist_shared_socket *s, uint8_t *buf, size_t len, struct sockaddr_storage *src, socklen_t *srclen, struct sockaddr_storage *dst, uint8_t *ecn);
+RIST_PRIV ssize_t rist_recvfrom_ecn(int sd, uint8_t *buf, size_t len, struct sockaddr *addr, socklen_t *addrlen, uint8_t *ecn);
+RIST_PRIV struct rist_peer *rist_shared_socket_demux(struct rist_shared_socket *s, const struct sockaddr_storage *dst, const struct sockaddr_storage *src);
 RIST_PRIV size_t rist_get_sender_retry_queue_size(struct rist_sender *ctx);
+RIST_PRIV size_t rist_get_sender_queue_pending(struct rist_sender *ctx);
+
+/* Receiver to sender traffic classes charged against the return path budget */
+enum rist_return_class {
+	RIST_RETURN_NACK = 0,
+	RIST_RETURN_ECHO,
+	RIST_RETURN_RR,
+	RIST_RETURN_KEEPALIVE,
+};
+RIST_PRIV bool rist_return_budget_take(struct rist_peer *peer, enum rist_return_class cls, size_t len);
+RIST_PRIV ssize_t rist_return_budget_nack_allowance(struct rist_peer *peer);
 
 
 #endif
@@ -21,6 +21,7 @@
 #endif
 #include "crypto/psk.h"
 #include "mpegts.h"
+#include "path_policy.h"
 #include <stdlib.h>
 #include <stddef.h>
 #include <errno.h>
@@ -75,7 +76,37 @@ void rist_clean_sender_enqueue(struct rist_sender *ctx)
 
 }
 
-size_t rist_send_seq_rtcp(struct rist_peer *p, uint16_t seq_rtp, uint8_t payload_type, uint8_t *payload, size_t payload_len, uint64_t source_time, uint16_t src_port, uint16_t dst_port, bool retry)
+/* Moves the payload of packets sent more than history_hot_ms ago to the history store */
+void rist_sender_history_spill(struct rist_sender *ctx)
+{
+	if (!ctx->history.base)
+		return;
+	size_t mask = ctx->sender_queue_max - 1;
+	/* everything from the delete index up to the read index has been sent,
+	 * the cleanup may have deleted past our position */
+	size_t end = ((size_t)atomic_load_explicit(&ctx->sender_queue_read_index, memory_order_acquire) + 1) & mask;
+	if (((ctx->history_spill_index - ctx->sender_queue_delete_index) & mask) > ((end - ctx->sender_queue_delete_index) & mask))
+		ctx->history_spill_index = ctx->sender_queue_delete_index;
+	uint64_t now = timestampNTP_u64();
+	for (int i = 0; i < RIST_HISTORY_SPILL_MAX && ctx->history_spill_index != end; i++) {
+		struct rist_buffer *b = ctx->sender_queue[ctx->history_spill_index];
+		if (b && !b->cold) {
+			if ((now - b->time) / RIST_CLOCK < ctx->history_hot_ms)
+				break;
+			b->cold_pos = rist_history_store_append(&ctx->history, (uint8_t *)b->data + RIST_MAX_PAYLOAD_OFFSET, b->size);
+			b->cold = true;
+			free(b->data);
+			b->data = NULL;
+			/* the cached wire image would keep the memory around all the same */
+			free(b->wire);
+			b->wire = NULL;
+			ctx->history_moved++;
+		}
+		ctx->history_spill_index = (ctx->history_spill_index + 1) & mask;
+	}
+}
+
+size_t rist_send_seq_rtcp(struct rist_peer *p, uint16_t seq_rtp, uint8_t payload_type, uint8_t *payload, size_t payload_len, uint64_t source_time, uint16_t src_port, uint16_t dst_port, bool retry, struct rist_wire_image **wire)
 {
 	struct rist_common_ctx *ctx = get_cctx(p);
 	uint8_t *data;
@@ -83,6 +114,25 @@ size_t rist_send_seq_rtcp(struct rist_peer *p, uint16_t seq_rtp, uint8_t payload
 	size_t hdr_len = 0;
 	ssize_t ret = 0;
 
+	/* With arrival timing the original carries its send time, not the source
+	 * time a retransmission is built with */
+	if (wire && (ctx->profile == RIST_PROFILE_SIMPLE || p->config.timing_mode == RIST_TIMING_MODE_ARRIVAL))
+		wire = NULL;
+	/* The image belongs to the peer it was built for, other peers encrypt their
+	 * own copy and leave it be rather than replacing it back and forth */
+	if (wire && *wire && (*wire)->peer != p)
+		wire = NULL;
+	/* Retransmission of an already encrypted datagram, skip header build and encryption */
+	if (wire && *wire && retry && !_librist_proto_gre_wire_valid(p, *wire)) {
+		free(*wire);
+		*wire = NULL;
+	}
+	bool cached = wire && *wire && retry;
+	if (cached) {
+		len = payload_len;
+		goto send;
+	}
+
 	uint8_t *_payload = NULL;
 	_payload = payload;
 
@@ -130,6 +180,7 @@ size_t rist_send_seq_rtcp(struct rist_peer *p, uint16_t seq_rtp, uint8_t payload
 	}
 
 
+send:
 	// TODO: compare p->sender_ctx->sender_queue_read_index and p->sender_ctx->sender_queue_write_index
 	// and warn when the difference is a multiple of 10 (slow CPU or overtaxed algorithm)
 	// The difference should always stay very low < 10
@@ -144,10 +195,17 @@ size_t rist_send_seq_rtcp(struct rist_peer *p, uint16_t seq_rtp, uint8_t payload
 		}
 	}
 
-	if (ctx->profile == RIST_PROFILE_SIMPLE)
-		ret = sendto(p->sd,(const char*)data, len, 0, &(p->u.address), p->address_len);
+	if (cached) {
+		ret = _librist_proto_gre_send_wire(p, *wire, retry);
+		if (ret > 0) {
+			ret = len;
+			p->stats_sender_instant.retrans_cached++;
+		}
+	} else if (ctx->profile == RIST_PROFILE_SIMPLE)
+		ret = sendto(p->stripe_count > 1 ? p->stripe_sd[seq_rtp % p->stripe_count] : p->sd,
+				(const char*)data, len, 0, &(p->u.address), p->address_len);
 	else
-		ret = _librist_proto_gre_send_data(p, payload_type, proto_type, data, len, src_port, dst_port, p->rist_gre_version);
+		ret = _librist_proto_gre_send_data_wire(p, payload_type, proto_type, data, len, src_port, dst_port, p->rist_gre_version, wire);
 
 out:
 	if (RIST_UNLIKELY(ret <= 0)) {
@@ -160,8 +218,7 @@ out:
 	return ret;
 }
 
-/* This function is used by receiver for all and by sender only for rist-data and oob-data */
-int rist_send_common_rtcp(struct rist_peer *p, uint8_t payload_type, uint8_t *payload, size_t payload_len, uint64_t source_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp)
+static int rist_send_common(struct rist_peer *p, uint8_t payload_type, uint8_t *payload, size_t payload_len, uint64_t source_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp, struct rist_wire_image **wire)
 {
 	// This can only and will most likely be zero for data packets. RTCP should always have a value.
 	assert(payload_type != RIST_PAYLOAD_TYPE_DATA_RAW && payload_type != RIST_PAYLOAD_TYPE_DATA_RAW_RTP_EXT && payload_type != RIST_PAYLOAD_TYPE_DATA_OOB ? dst_port != 0 : 1);
@@ -185,7 +242,7 @@ int rist_send_common_rtcp(struct rist_peer *p, uint8_t payload_type, uint8_t *pa
 	if (RIST_UNLIKELY(p->config.timing_mode == RIST_TIMING_MODE_ARRIVAL) && !p->receiver_mode)
 		source_time = timestampNTP_u64();
 
-	size_t ret = rist_send_seq_rtcp(p, (uint16_t)seq_rtp, payload_type, payload, payload_len, source_time, src_port, dst_port, false);
+	size_t ret = rist_send_seq_rtcp(p, (uint16_t)seq_rtp, payload_type, payload, payload_len, source_time, src_port, dst_port, false, wire);
 
 	if ((!p->compression && ret < payload_len) || ret <= 0)
 	{
@@ -218,6 +275,12 @@ int rist_send_common_rtcp(struct rist_peer *p, uint8_t payload_type, uint8_t *pa
 	return 0;
 }
 
+/* This function is used by receiver for all and by sender only for rist-data and oob-data */
+int rist_send_common_rtcp(struct rist_peer *p, uint8_t payload_type, uint8_t *payload, size_t payload_len, uint64_t source_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp)
+{
+	return rist_send_common(p, payload_type, payload, payload_len, source_time, src_port, dst_port, seq_rtp, NULL);
+}
+
 int rist_set_url(struct rist_peer *peer)
 {
 	char host[512];
@@ -323,6 +386,158 @@ void rist_populate_cname(struct rist_peer *peer)
 	}
 }
 
+#if HAVE_ECN
+static bool rist_cmsg_ecn(struct cmsghdr *cmsg, uint8_t *ecn)
+{
+	if (cmsg->cmsg_level == IPPROTO_IP && (cmsg->cmsg_type == IP_TOS || cmsg->cmsg_type == IP_RECVTOS)) {
+		*ecn = *(uint8_t *)CMSG_DATA(cmsg) & RIST_ECN_MASK;
+		return true;
+	} else if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_TCLASS) {
+		int tclass;
+		memcpy(&tclass, CMSG_DATA(cmsg), sizeof(tclass));
+		*ecn = (uint8_t)tclass & RIST_ECN_MASK;
+		return true;
+	}
+	return false;
+}
+#endif
+
+static void rist_socket_set_ecn(struct rist_peer *peer, int sd)
+{
+#if HAVE_ECN
+	const int yes = 1;
+	const int ect = RIST_ECN_ECT0;
+	int ret;
+	if (peer->receiver_mode) {
+		// Deliver the TOS/traffic class byte with every datagram
+		if (peer->address_family == AF_INET6) {
+			ret = setsockopt(sd, IPPROTO_IPV6, IPV6_RECVTCLASS, (const char *)&yes, sizeof(yes));
+			// v4 mapped traffic on a dual stack socket
+			setsockopt(sd, IPPROTO_IP, IP_RECVTOS, (const char *)&yes, sizeof(yes));
+		} else
+			ret = setsockopt(sd, IPPROTO_IP, IP_RECVTOS, (const char *)&yes, sizeof(yes));
+	} else {
+		if (peer->address_family == AF_INET6)
+			ret = setsockopt(sd, IPPROTO_IPV6, IPV6_TCLASS, (const char *)&ect, sizeof(ect));
+		else
+			ret = setsockopt(sd, IPPROTO_IP, IP_TOS, (const char *)&ect, sizeof(ect));
+	}
+	if (ret < 0)
+		rist_log_priv(get_cctx(peer), RIST_LOG_WARN, "Unable to enable ECN on socket %d: %s\n", sd, strerror(errno));
+	else
+		rist_log_priv(get_cctx(peer), RIST_LOG_INFO, "ECN %s enabled on socket %d\n",
+				peer->receiver_mode ? "reporting" : "marking", sd);
+#else
+	rist_log_priv(get_cctx(peer), RIST_LOG_WARN, "ECN is not supported on this platform\n");
+#endif
+}
+
+ssize_t rist_recvfrom_ecn(int sd, uint8_t *buf, size_t len, struct sockaddr *addr, socklen_t *addrlen, uint8_t *ecn)
+{
+	*ecn = RIST_ECN_NOT_ECT;
+#if HAVE_ECN
+	union {
+		struct cmsghdr align;
+		uint8_t buf[CMSG_SPACE(sizeof(int)) * 2];
+	} control;
+	struct iovec iov = { .iov_base = buf, .iov_len = len };
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = addr;
+	msg.msg_namelen = *addrlen;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	ssize_t ret = recvmsg(sd, &msg, MSG_DONTWAIT);
+	if (ret < 0)
+		return ret;
+	*addrlen = msg.msg_namelen;
+	for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (rist_cmsg_ecn(cmsg, ecn))
+			break;
+	}
+	return ret;
+#else
+	return recvfrom(sd, (char *)buf, len, MSG_DONTWAIT, addr, addrlen);
+#endif
+}
+
+/* Open the extra sockets of a striped sender. They bind to the same local
+ * address as peer->sd with an ephemeral port picked by the OS, every port
+ * shows up as a separate peer on the receiver and is merged back into the
+ * flow by its flow id, just like bonded paths. */
+static int rist_stripe_sockets_open(struct rist_peer *peer)
+{
+	struct rist_common_ctx *cctx = get_cctx(peer);
+	size_t count = peer->config.stripe_ports;
+
+	struct sockaddr_storage ss;
+	socklen_t addrlen = sizeof(ss);
+	memset(&ss, 0, sizeof(ss));
+	if (getsockname(peer->sd, (struct sockaddr *)&ss, &addrlen) != 0) {
+		ss.ss_family = peer->address_family;
+		addrlen = peer->address_family == AF_INET ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
+	}
+	if (ss.ss_family == AF_INET)
+		((struct sockaddr_in *)&ss)->sin_port = 0;
+	else
+		((struct sockaddr_in6 *)&ss)->sin6_port = 0;
+
+	peer->stripe_sd[0] = peer->sd;
+	size_t i;
+	for (i = 1; i < count; i++) {
+		int sd = udpsocket_open(peer->address_family);
+		if (sd < 0)
+			break;
+#ifdef __linux__
+		if (peer->miface[0] != '\0') {
+			struct ifreq ifr = {0};
+			socklen_t len = IF_NAMESIZE;
+			// Follow the device binding of the main socket, if it has one
+			if (getsockopt(peer->sd, SOL_SOCKET, SO_BINDTODEVICE, ifr.ifr_name, &len) == 0 && ifr.ifr_name[0] != '\0')
+				setsockopt(sd, SOL_SOCKET, SO_BINDTODEVICE, &ifr, sizeof(ifr));
+		}
+#endif
+		if (bind(sd, (struct sockaddr *)&ss, addrlen) != 0) {
+			udpsocket_close(sd);
+			break;
+		}
+		udpsocket_set_optimal_buffer_size(sd);
+		udpsocket_set_optimal_buffer_send_size(sd);
+#ifndef _WIN32
+		fcntl(sd, F_SETFD, FD_CLOEXEC);
+#endif
+		peer->stripe_sd[i] = sd;
+	}
+	if (i == count) {
+		peer->stripe_count = count;
+		return 0;
+	}
+	rist_log_priv(cctx, RIST_LOG_ERROR, "Could not open %zu source ports for striping: %s\n", count, strerror(errno));
+	while (--i > 0)
+		udpsocket_close(peer->stripe_sd[i]);
+	return -1;
+}
+
+void rist_stripe_events_remove(struct rist_peer *peer)
+{
+	for (size_t i = 1; i < peer->stripe_count; i++) {
+		if (peer->stripe_event[i])
+			evsocket_delevent(get_cctx(peer)->evctx, peer->stripe_event[i]);
+		peer->stripe_event[i] = NULL;
+	}
+}
+
+void rist_stripe_sockets_close(struct rist_peer *peer)
+{
+	// stripe_sd[0] is peer->sd, which is closed with the peer
+	for (size_t i = 1; i < peer->stripe_count; i++)
+		udpsocket_close(peer->stripe_sd[i]);
+	peer->stripe_count = 0;
+}
+
 void rist_create_socket(struct rist_peer *peer)
 {
 	if(!peer->address_family && rist_set_url(peer)) {
@@ -359,8 +574,21 @@ void rist_create_socket(struct rist_peer *peer)
 			peer->multicast_receiver = IN6_IS_ADDR_MULTICAST(&addrv6->sin6_addr);
 		}
 
-		peer->sd = udpsocket_open_bind(host, port, peer->miface);
-		if (peer->sd >= 0) {
+		if (peer->multicast_receiver && peer->multicast_shared) {
+			int ret = rist_shared_socket_attach(peer, port);
+			if (ret > 0) {
+				// Socket already set up by the first peer on it
+				if (peer->cname[0] == 0)
+					rist_populate_cname(peer);
+				return;
+			} else if (ret < 0) {
+				rist_log_priv(get_cctx(peer), RIST_LOG_WARN, "Could not use a shared multicast socket for %s:%u, using a dedicated one\n", host, port);
+			}
+		}
+
+		if (peer->shared_socket) {
+			rist_log_priv(get_cctx(peer), RIST_LOG_INFO, "Starting in URL listening mode on shared multicast socket (socket# %d)\n", peer->sd);
+		} else if ((peer->sd = udpsocket_open_bind(host, port, peer->miface)) >= 0) {
 			rist_log_priv(get_cctx(peer), RIST_LOG_INFO, "Starting in URL listening mode (socket# %d)\n", peer->sd);
 		} else {
 			rist_log_priv(get_cctx(peer), RIST_LOG_ERROR, "Could not start in URL listening mode. %s\n", strerror(errno));
@@ -434,6 +662,9 @@ void rist_create_socket(struct rist_peer *peer)
 			}
 #endif
 		}
+		if (peer->sd >= 0 && peer->config.stripe_ports > 1 && !peer->receiver_mode && !peer->multicast_sender &&
+			rist_stripe_sockets_open(peer) == 0)
+			rist_log_priv(get_cctx(peer), RIST_LOG_INFO, "Striping over %zu source ports\n", peer->stripe_count);
 		peer->local_port = 32768 + (get_cctx(peer)->peer_counter % 28232);
 	}
 
@@ -456,6 +687,12 @@ void rist_create_socket(struct rist_peer *peer)
 			current_sendbuf);
 	}
 
+	if (peer->config.ecn) {
+		rist_socket_set_ecn(peer, peer->sd);
+		for (size_t i = 1; i < peer->stripe_count; i++)
+			rist_socket_set_ecn(peer, peer->stripe_sd[i]);
+	}
+
 	if (peer->cname[0] == 0)
 		rist_populate_cname(peer);
 	rist_log_priv(get_cctx(peer), RIST_LOG_INFO, "Peer cname is %s\n", peer->cname);
@@ -468,6 +705,451 @@ void rist_create_socket(struct rist_peer *peer)
 #endif
 }
 
+#if HAVE_MCAST_PKTINFO
+static int rist_mcast_membership(struct rist_peer *peer, int sd, bool join)
+{
+	struct sockaddr *group = &peer->u.address;
+	struct sockaddr *source = peer->multicast_source[0] != '\0' ? (struct sockaddr *)&peer->multicast_source_addr : NULL;
+	socklen_t addrlen = group->sa_family == AF_INET ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
+	int level = group->sa_family == AF_INET ? IPPROTO_IP : IPPROTO_IPV6;
+	unsigned int ifindex = 0;
+	struct in_addr ifaddr = { .s_addr = htonl(INADDR_ANY) };
+
+	if (peer->miface[0] != '\0' && inet_pton(AF_INET, peer->miface, &ifaddr) != 1) {
+		ifaddr.s_addr = htonl(INADDR_ANY);
+		ifindex = if_nametoindex(peer->miface);
+		if (!ifindex)
+			rist_log_priv(get_cctx(peer), RIST_LOG_ERROR, "Failed to get interface index for %s, using default route\n", peer->miface);
+	}
+
+	if (group->sa_family == AF_INET6 || ifindex) {
+		if (source) {
+			struct group_source_req gsr;
+			memset(&gsr, 0, sizeof(gsr));
+			gsr.gsr_interface = ifindex;
+			memcpy(&gsr.gsr_group, group, addrlen);
+			memcpy(&gsr.gsr_source, source, addrlen);
+			return setsockopt(sd, level, join ? MCAST_JOIN_SOURCE_GROUP : MCAST_LEAVE_SOURCE_GROUP, (const char *)&gsr, sizeof(gsr));
+		}
+		struct group_req gr;
+		memset(&gr, 0, sizeof(gr));
+		gr.gr_interface = ifindex;
+		memcpy(&gr.gr_group, group, addrlen);
+		return setsockopt(sd, level, join ? MCAST_JOIN_GROUP : MCAST_LEAVE_GROUP, (const char *)&gr, sizeof(gr));
+	}
+
+	if (source) {
+		struct ip_mreq_source mreq;
+		memset(&mreq, 0, sizeof(mreq));
+		mreq.imr_multiaddr = ((struct sockaddr_in *)group)->sin_addr;
+		mreq.imr_interface = ifaddr;
+		mreq.imr_sourceaddr = ((struct sockaddr_in *)source)->sin_addr;
+		return setsockopt(sd, IPPROTO_IP, join ? IP_ADD_SOURCE_MEMBERSHIP : IP_DROP_SOURCE_MEMBERSHIP, (const char *)&mreq, sizeof(mreq));
+	}
+	struct ip_mreq mreq;
+	mreq.imr_multiaddr = ((struct sockaddr_in *)group)->sin_addr;
+	mreq.imr_interface = ifaddr;
+	return setsockopt(sd, IPPROTO_IP, join ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP, (const char *)&mreq, sizeof(mreq));
+}
+
+static struct rist_shared_socket *rist_shared_socket_open(struct rist_common_ctx *cctx, uint16_t family, uint16_t port, const char *miface)
+{
+	struct rist_shared_socket *s = calloc(1, sizeof(*s));
+	if (!s)
+		return NULL;
+	s->sd = udpsocket_open(family);
+	if (s->sd < 0) {
+		free(s);
+		return NULL;
+	}
+	const int yes = 1;
+	if (setsockopt(s->sd, SOL_SOCKET, SO_REUSEADDR, (const char *)&yes, sizeof(yes)) < 0)
+		rist_log_priv(cctx, RIST_LOG_ERROR, "Cannot set SO_REUSEADDR: %s\n", strerror(errno));
+
+	struct sockaddr_storage any;
+	socklen_t addrlen;
+	memset(&any, 0, sizeof(any));
+	if (family == AF_INET) {
+		struct sockaddr_in *sin = (struct sockaddr_in *)&any;
+		sin->sin_family = AF_INET;
+		sin->sin_port = htons(port);
+		addrlen = sizeof(*sin);
+#ifdef IP_RECVPKTINFO
+		int ret = setsockopt(s->sd, IPPROTO_IP, IP_RECVPKTINFO, (const char *)&yes, sizeof(yes));
+#else
+		int ret = setsockopt(s->sd, IPPROTO_IP, IP_PKTINFO, (const char *)&yes, sizeof(yes));
+#endif
+		if (ret < 0)
+			goto fail;
+#ifdef IP_MULTICAST_ALL
+		// Only deliver the groups joined on this socket
+		const int no = 0;
+		setsockopt(s->sd, IPPROTO_IP, IP_MULTICAST_ALL, (const char *)&no, sizeof(no));
+#endif
+#if HAVE_ECN
+		setsockopt(s->sd, IPPROTO_IP, IP_RECVTOS, (const char *)&yes, sizeof(yes));
+#endif
+	} else {
+		struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&any;
+		sin6->sin6_family = AF_INET6;
+		sin6->sin6_port = htons(port);
+		addrlen = sizeof(*sin6);
+		if (setsockopt(s->sd, IPPROTO_IPV6, IPV6_RECVPKTINFO, (const char *)&yes, sizeof(yes)) < 0)
+			goto fail;
+#if HAVE_ECN
+		setsockopt(s->sd, IPPROTO_IPV6, IPV6_RECVTCLASS, (const char *)&yes, sizeof(yes));
+#endif
+	}
+	if (bind(s->sd, (struct sockaddr *)&any, addrlen) < 0) {
+		rist_log_priv(cctx, RIST_LOG_ERROR, "Could not bind shared multicast socket to port %u: %s\n", port, strerror(errno));
+		goto fail;
+	}
+	s->family = family;
+	s->port = port;
+	snprintf(s->miface, sizeof(s->miface), "%s", miface);
+	s->cctx = cctx;
+	s->next = cctx->shared_sockets;
+	cctx->shared_sockets = s;
+	return s;
+
+fail:
+	udpsocket_close(s->sd);
+	free(s);
+	return NULL;
+}
+
+static void rist_shared_socket_close(void *arg)
+{
+	struct rist_shared_socket *s = arg;
+	udpsocket_close(s->sd);
+	free(s);
+}
+
+static void rist_shared_socket_free(struct rist_shared_socket *s)
+{
+	struct rist_shared_socket **prev = &s->cctx->shared_sockets;
+	while (*prev && *prev != s)
+		prev = &(*prev)->next;
+	if (*prev)
+		*prev = s->next;
+	if (s->event_recv)
+		evsocket_delevent(s->cctx->evctx, s->event_recv);
+	// The protocol thread may still be demultiplexing a datagram of this socket
+	if (s->demux)
+		rist_epoch_retire_embedded(&s->cctx->epoch, &s->demux->retired, s->demux, free);
+	rist_epoch_retire_embedded(&s->cctx->epoch, &s->retired, s, rist_shared_socket_close);
+}
+
+static size_t rist_shared_demux_hash(const struct sockaddr *group)
+{
+	uint32_t h;
+	if (group->sa_family == AF_INET) {
+		h = ((const struct sockaddr_in *)group)->sin_addr.s_addr;
+	} else {
+		uint32_t w[4];
+		memcpy(w, &((const struct sockaddr_in6 *)group)->sin6_addr, sizeof(w));
+		h = w[0] ^ w[1] ^ w[2] ^ w[3];
+	}
+	return (size_t)((h * UINT32_C(2654435761)) >> 7);
+}
+
+// Slot of a peer that left while no new table could be allocated
+#define RIST_SHARED_DEMUX_GONE ((struct rist_peer *)(uintptr_t)1)
+
+static void rist_shared_demux_insert(struct rist_shared_demux *d, struct rist_peer *peer)
+{
+	size_t idx = rist_shared_demux_hash(&peer->u.address) & d->mask;
+	while (d->slot[idx])
+		idx = (idx + 1) & d->mask;
+	d->slot[idx] = peer;
+	d->count++;
+}
+
+/* New table with the peers of the current one, plus add, minus remove */
+static struct rist_shared_demux *rist_shared_demux_rebuild(const struct rist_shared_demux *cur, struct rist_peer *add, struct rist_peer *remove)
+{
+	size_t count = (cur ? cur->count : 0) + (add ? 1 : 0);
+	size_t size = 8;
+	while (size < count * 2)
+		size *= 2;
+	struct rist_shared_demux *d = calloc(1, sizeof(*d) + size * sizeof(d->slot[0]));
+	if (!d)
+		return NULL;
+	d->mask = size - 1;
+	for (size_t i = 0; cur && i <= cur->mask; i++) {
+		struct rist_peer *peer = cur->slot[i];
+		if (peer && peer != RIST_SHARED_DEMUX_GONE && peer != remove)
+			rist_shared_demux_insert(d, peer);
+	}
+	if (add)
+		rist_shared_demux_insert(d, add);
+	return d;
+}
+
+/* Swap in the rebuilt table, readers still on the old one are waited for by
+ * the epoch. Returns the peer count or -1. */
+static ssize_t rist_shared_demux_update(struct rist_shared_socket *s, struct rist_peer *add, struct rist_peer *remove)
+{
+	struct rist_shared_demux *cur = s->demux;
+	struct rist_shared_demux *d = rist_shared_demux_rebuild(cur, add, remove);
+	if (!d)
+		return -1;
+	atomic_thread_fence(memory_order_release);
+	*(struct rist_shared_demux *volatile *)&s->demux = d;
+	if (cur)
+		rist_epoch_retire_embedded(&s->cctx->epoch, &cur->retired, cur, free);
+	return (ssize_t)d->count;
+}
+#endif
+
+/* Join the peer's multicast group on the socket shared by all peers with the
+ * same family, port and interface, creating that socket when needed.
+ * Returns 0 when a new socket was created, 1 when an existing one was reused
+ * and -1 when the peer has to use a dedicated socket. */
+int rist_shared_socket_attach(struct rist_peer *peer, uint16_t port)
+{
+#if HAVE_MCAST_PKTINFO
+	struct rist_common_ctx *cctx = get_cctx(peer);
+	uint16_t family = peer->u.address.sa_family;
+	if (peer->multicast_source[0] != '\0') {
+		memset(&peer->multicast_source_addr, 0, sizeof(peer->multicast_source_addr));
+		if (udpsocket_resolve_host(peer->multicast_source, 0, (struct sockaddr *)&peer->multicast_source_addr) < 0 ||
+			peer->multicast_source_addr.ss_family != family) {
+			rist_log_priv(cctx, RIST_LOG_ERROR, "Invalid multicast source address %s\n", peer->multicast_source);
+			return -1;
+		}
+	}
+
+	struct rist_shared_socket *s = cctx->shared_sockets;
+	while (s) {
+		if (s->family == family && s->port == port && strcmp(s->miface, peer->miface) == 0)
+			break;
+		s = s->next;
+	}
+	bool created = false;
+	if (!s) {
+		s = rist_shared_socket_open(cctx, family, port, peer->miface);
+		if (!s)
+			return -1;
+		created = true;
+	}
+
+	if (rist_mcast_membership(peer, s->sd, true) != 0) {
+		rist_log_priv(cctx, RIST_LOG_ERROR, "Failed to join multicast group on shared socket: %s\n", strerror(errno));
+		if (created)
+			rist_shared_socket_free(s);
+		return -1;
+	}
+	ssize_t groups = rist_shared_demux_update(s, peer, NULL);
+	if (groups < 0) {
+		rist_mcast_membership(peer, s->sd, false);
+		if (created)
+			rist_shared_socket_free(s);
+		return -1;
+	}
+	peer->shared_socket = s;
+	peer->sd = s->sd;
+	if (s->event_recv)
+		peer->event_recv = s->event_recv;
+	rist_log_priv(cctx, RIST_LOG_INFO, "Joined multicast group on shared socket %d (%zd groups)\n", s->sd, groups);
+	return created ? 0 : 1;
+#else
+	RIST_MARK_UNUSED(port);
+	rist_log_priv(get_cctx(peer), RIST_LOG_WARN, "Shared multicast sockets are not supported on this platform\n");
+	return -1;
+#endif
+}
+
+/* Leave the peer's group, the socket is closed together with its last peer */
+void rist_shared_socket_detach(struct rist_peer *peer)
+{
+#if HAVE_MCAST_PKTINFO
+	struct rist_shared_socket *s = peer->shared_socket;
+	if (!s)
+		return;
+	ssize_t groups = rist_shared_demux_update(s, NULL, peer);
+	if (groups < 0) {
+		// Out of memory, mark the slot in place, a reader sees the peer or nothing
+		struct rist_shared_demux *d = s->demux;
+		for (size_t i = 0; i <= d->mask; i++) {
+			if (d->slot[i] == peer)
+				d->slot[i] = RIST_SHARED_DEMUX_GONE;
+		}
+		groups = (ssize_t)--d->count;
+	}
+	rist_mcast_membership(peer, s->sd, false);
+	if (groups == 0) {
+		rist_log_priv(s->cctx, RIST_LOG_INFO, "[CLEANUP] Closing shared multicast socket on port %u\n", s->port);
+		rist_shared_socket_free(s);
+	}
+	peer->shared_socket = NULL;
+	peer->event_recv = NULL;
+	peer->sd = -1;
+#else
+	RIST_MARK_UNUSED(peer);
+#endif
+}
+
+ssize_t rist_shared_socket_recv(struct rist_shared_socket *s, uint8_t *buf, size_t len, struct sockaddr_storage *src, socklen_t *srclen, struct sockaddr_storage *dst, uint8_t *ecn)
+{
+	*ecn = RIST_ECN_NOT_ECT;
+#if HAVE_MCAST_PKTINFO
+	union {
+		struct cmsghdr align;
+		uint8_t buf[CMSG_SPACE(sizeof(struct in_pktinfo)) + CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(int))];
+	} control;
+	struct iovec iov = { .iov_base = buf, .iov_len = len };
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = src;
+	msg.msg_namelen = sizeof(*src);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	ssize_t ret = recvmsg(s->sd, &msg, MSG_DONTWAIT);
+	if (ret < 0)
+		return ret;
+	*srclen = msg.msg_namelen;
+	memset(dst, 0, sizeof(*dst));
+	for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
+			struct in_pktinfo info;
+			memcpy(&info, CMSG_DATA(cmsg), sizeof(info));
+			struct sockaddr_in *sin = (struct sockaddr_in *)dst;
+			sin->sin_family = AF_INET;
+			sin->sin_addr = info.ipi_addr;
+		} else if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO) {
+			struct in6_pktinfo info;
+			memcpy(&info, CMSG_DATA(cmsg), sizeof(info));
+			struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)dst;
+			sin6->sin6_family = AF_INET6;
+			sin6->sin6_addr = info.ipi6_addr;
+		}
+#if HAVE_ECN
+		else
+			rist_cmsg_ecn(cmsg, ecn);
+#endif
+	}
+	return ret;
+#else
+	RIST_MARK_UNUSED(s);
+	RIST_MARK_UNUSED(buf);
+	RIST_MARK_UNUSED(len);
+	RIST_MARK_UNUSED(src);
+	RIST_MARK_UNUSED(srclen);
+	RIST_MARK_UNUSED(dst);
+	errno = EAGAIN;
+	return -1;
+#endif
+}
+
+static bool rist_address_equal(const struct sockaddr *a, const struct sockaddr *b)
+{
+	if (a->sa_family != b->sa_family)
+		return false;
+	if (a->sa_family == AF_INET)
+		return ((const struct sockaddr_in *)a)->sin_addr.s_addr == ((const struct sockaddr_in *)b)->sin_addr.s_addr;
+	return memcmp(&((const struct sockaddr_in6 *)a)->sin6_addr, &((const struct sockaddr_in6 *)b)->sin6_addr, sizeof(struct in6_addr)) == 0;
+}
+
+/* Pick the peer whose group (and source, for SSM) matches the datagram, the
+ * caller is inside an epoch read section */
+struct rist_peer *rist_shared_socket_demux(struct rist_shared_socket *s, const struct sockaddr_storage *dst, const struct sockaddr_storage *src)
+{
+#if HAVE_MCAST_PKTINFO
+	const struct rist_shared_demux *d = *(struct rist_shared_demux *const volatile *)&s->demux;
+	atomic_thread_fence(memory_order_acquire);
+	if (!d || (dst->ss_family != AF_INET && dst->ss_family != AF_INET6))
+		return NULL;
+	size_t idx = rist_shared_demux_hash((const struct sockaddr *)dst) & d->mask;
+	for (size_t n = 0; n <= d->mask; n++, idx = (idx + 1) & d->mask) {
+		struct rist_peer *peer = d->slot[idx];
+		if (!peer)
+			break;
+		if (peer == RIST_SHARED_DEMUX_GONE || !rist_address_equal(&peer->u.address, (const struct sockaddr *)dst))
+			continue;
+		if (peer->multicast_source[0] != '\0' &&
+			!rist_address_equal((const struct sockaddr *)&peer->multicast_source_addr, (const struct sockaddr *)src))
+			continue;
+		return peer;
+	}
+#else
+	RIST_MARK_UNUSED(s);
+	RIST_MARK_UNUSED(dst);
+	RIST_MARK_UNUSED(src);
+#endif
+	return NULL;
+}
+
+/* Return path budget: a token bucket per receiver peer filled at
+ * recovery_maxbitrate_return. NACKs may only spend what is above a reserve
+ * kept for the messages that keep the session alive: RR and keepalives are
+ * always sent and paid from that reserve, echoes only go out while there are
+ * tokens left. A burst of loss can delay recovery but never time out the
+ * session on the sender. */
+#define RIST_RETURN_BUCKET_MS (100)
+#define RIST_RETURN_BUCKET_MIN (2 * 1500)
+#define RIST_RETURN_PACKET_OVERHEAD (44) /* IPv4/UDP plus GRE headers */
+#define RIST_RETURN_NACK_HEADER (64) /* RR + SDES + feedback header */
+#define RIST_RETURN_CONTROL_RESERVE(depth) ((depth) / 4)
+
+static bool rist_return_budget_refill(struct rist_peer *peer, int64_t *depth)
+{
+	if (!peer->receiver_mode || peer->config.recovery_maxbitrate_return == 0)
+		return false;
+	uint64_t rate = (uint64_t)peer->config.recovery_maxbitrate_return * 1000 / 8;
+	*depth = (int64_t)(rate * RIST_RETURN_BUCKET_MS / 1000);
+	if (*depth < RIST_RETURN_BUCKET_MIN)
+		*depth = RIST_RETURN_BUCKET_MIN;
+	uint64_t now = timestampNTP_u64();
+	if (peer->return_last_refill == 0) {
+		peer->return_tokens = *depth;
+	} else if (now > peer->return_last_refill) {
+		uint64_t elapsed = now - peer->return_last_refill;
+		if (elapsed > ONE_SECOND)
+			elapsed = ONE_SECOND;
+		peer->return_tokens += (int64_t)(elapsed * rate / ONE_SECOND);
+		if (peer->return_tokens > *depth)
+			peer->return_tokens = *depth;
+	}
+	peer->return_last_refill = now;
+	return true;
+}
+
+bool rist_return_budget_take(struct rist_peer *peer, enum rist_return_class cls, size_t len)
+{
+	int64_t depth;
+	if (!rist_return_budget_refill(peer, &depth))
+		return true;
+	int64_t cost = (int64_t)len + RIST_RETURN_PACKET_OVERHEAD;
+	// NACKs were already limited by rist_return_budget_nack_allowance, RR and
+	// keepalives use the control reserve, all of them are charged regardless
+	if (cls == RIST_RETURN_ECHO && peer->return_tokens < cost) {
+		peer->stats_receiver_instant.return_skipped++;
+		return false;
+	}
+	peer->return_tokens -= cost;
+	if (peer->return_tokens < -depth)
+		peer->return_tokens = -depth;
+	peer->stats_receiver_instant.return_bytes += (uint64_t)cost;
+	return true;
+}
+
+ssize_t rist_return_budget_nack_allowance(struct rist_peer *peer)
+{
+	int64_t depth;
+	if (!rist_return_budget_refill(peer, &depth))
+		return -1;
+	int64_t avail = peer->return_tokens - RIST_RETURN_CONTROL_RESERVE(depth) - RIST_RETURN_PACKET_OVERHEAD - RIST_RETURN_NACK_HEADER;
+	if (avail <= 0)
+		return 0;
+	// Worst case every sequence number needs its own 4 byte record
+	avail /= RTCP_FB_FCI_GENERIC_NACK_SIZE;
+	return avail > RIST_MAX_NACKS ? RIST_MAX_NACKS : (ssize_t)avail;
+}
+
 int rist_receiver_periodic_rtcp(struct rist_peer *peer) {
 	uint8_t payload_type = RIST_PAYLOAD_TYPE_RTCP;
 	uint8_t *rtcp_buf = get_cctx(peer)->buf.rtcp;
@@ -478,10 +1160,17 @@ int rist_receiver_periodic_rtcp(struct rist_peer *peer) {
 	if (peer->echo_enabled == false)
 		rist_rtcp_write_xr_echoreq(rtcp_buf, &payload_len, peer);
 	rist_rtcp_write_echoreq(rtcp_buf, &payload_len, peer->peer_ssrc);
+	if (peer->config.ecn) {
+		// Data may arrive on a different peer (simple profile)
+		struct rist_peer *data_peer = peer->peer_data ? peer->peer_data : peer;
+		rist_rtcp_write_xr_ecn(rtcp_buf, &payload_len, peer->adv_flow_id, &data_peer->ecn_rx);
+	}
+	if (!rist_return_budget_take(peer, RIST_RETURN_RR, payload_len))
+		return 0;
 	return rist_send_common_rtcp(peer, payload_type, &rtcp_buf[RIST_MAX_PAYLOAD_OFFSET], payload_len, 0, peer->local_port, peer->remote_port, 0);
 }
 
-int rist_receiver_send_nacks(struct rist_peer *peer, uint32_t seq_array[], size_t array_len)
+int rist_receiver_send_nacks(struct rist_peer *peer, uint32_t seq_array[], size_t array_len, bool early)
 {
 	if (get_cctx(peer)->debug)
 		rist_log_priv(get_cctx(peer), RIST_LOG_DEBUG, "Sending %d nacks starting with %"PRIu32"\n",
@@ -497,6 +1186,16 @@ int rist_receiver_send_nacks(struct rist_peer *peer, uint32_t seq_array[], size_
 		struct rist_rtp_nack_record *rec;
 		uint32_t fci_count = 1;
 
+		if (early) {
+			struct rist_rtcp_nack_range *marker = (struct rist_rtcp_nack_range *)(rtcp_buf + RIST_MAX_PAYLOAD_OFFSET + payload_len);
+			marker->flags = RTCP_NACK_EARLY_FLAGS;
+			marker->ptype = PTYPE_NACK_CUSTOM;
+			marker->len = htons(2);
+			marker->ssrc_source = htobe32(peer->adv_flow_id);
+			memcpy(marker->name, "RIST", 4);
+			payload_len += sizeof(*marker);
+		}
+
 		// Now the NACK message
 		if (peer->receiver_ctx->nack_type == RIST_NACK_BITMASK)
 		{
@@ -570,6 +1269,7 @@ int rist_receiver_send_nacks(struct rist_peer *peer, uint32_t seq_array[], size_
 		payload_type = RIST_PAYLOAD_TYPE_RTCP_NACK;
 	}
 
+	rist_return_budget_take(peer, RIST_RETURN_NACK, payload_len);
 	// We use direct send from receiver to sender (no fifo to keep track of seq/idx)
 	return rist_send_common_rtcp(peer, payload_type, &rtcp_buf[RIST_MAX_PAYLOAD_OFFSET], payload_len, 0, peer->local_port, peer->remote_port, 0);
 }
@@ -599,6 +1299,8 @@ int rist_respond_echoreq(struct rist_peer *peer, const uint64_t echo_request_tim
 	rist_rtcp_write_echoresp(rtcp_buf, &payload_len, echo_request_time, ssrc);
 	if (peer->receiver_mode) {
 		uint8_t payload_type = RIST_PAYLOAD_TYPE_RTCP;
+		if (!rist_return_budget_take(peer, RIST_RETURN_ECHO, payload_len))
+			return 0;
 		return rist_send_common_rtcp(peer, payload_type, &rtcp_buf[RIST_MAX_PAYLOAD_OFFSET], payload_len, 0, peer->local_port, peer->remote_port, 0);
 	} else {
 		/* I do this to not break advanced mode, however echo responses should really NOT be resend when lost ymmv */
@@ -616,6 +1318,8 @@ int rist_request_echo(struct rist_peer *peer) {
 	if (peer->receiver_mode)
 	{
 		uint8_t payload_type = RIST_PAYLOAD_TYPE_RTCP;
+		if (!rist_return_budget_take(peer, RIST_RETURN_ECHO, payload_len))
+			return 0;
 		return rist_send_common_rtcp(peer, payload_type, &rtcp_buf[RIST_MAX_PAYLOAD_OFFSET], payload_len, 0, peer->local_port, peer->remote_port, 0);
 	}
 	else
@@ -625,6 +1329,40 @@ int rist_request_echo(struct rist_peer *peer) {
 	}
 }
 
+/* Build a sender buffer in place: RI header extension carrying the flags
+ * (frame fragment bits, restart marker) followed by the data */
+static struct rist_buffer *rist_sender_new_ext_buffer(struct rist_sender *ctx, const uint8_t *data, size_t len, uint8_t ext_flags, uint64_t datagram_time, uint16_t src_port, uint16_t dst_port)
+{
+	struct rist_rtp_hdr_ext hdr_ext;
+	memset(&hdr_ext, 0, sizeof(hdr_ext));
+	memcpy(&hdr_ext.identifier, "RI", 2);
+	hdr_ext.length = htobe16(1);
+	hdr_ext.flags = ext_flags;
+	struct rist_buffer *b = rist_new_buffer(&ctx->common, NULL, 0, RIST_PAYLOAD_TYPE_DATA_RAW_RTP_EXT, 0, datagram_time, src_port, dst_port);
+	if (RIST_UNLIKELY(!b))
+		return NULL;
+	b->data = malloc(RIST_MAX_PAYLOAD_OFFSET + sizeof(hdr_ext) + len);
+	if (RIST_UNLIKELY(!b->data)) {
+		free(b);
+		return NULL;
+	}
+	uint8_t *payload = (uint8_t *)b->data + RIST_MAX_PAYLOAD_OFFSET;
+	memcpy(payload, &hdr_ext, sizeof(hdr_ext));
+	memcpy(&payload[sizeof(hdr_ext)], data, len);
+	b->size = sizeof(hdr_ext) + len;
+	b->alloc_size = b->size;
+	return b;
+}
+
+/* RIST_RTP_EXT_RESTART while the first packets after enabling the marker are written */
+static uint8_t rist_sender_restart_flag(struct rist_sender *ctx)
+{
+	if (RIST_LIKELY(!ctx->restart_marker) || ctx->restart_marked >= RIST_RESTART_MARKER_PACKETS)
+		return 0;
+	ctx->restart_marked++;
+	return RIST_RTP_EXT_RESTART;
+}
+
 int rist_sender_enqueue(struct rist_sender *ctx, const void *data, size_t len, uint64_t datagram_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp)
 {
 	uint8_t payload_type = RIST_PAYLOAD_TYPE_DATA_RAW;
@@ -635,18 +1373,40 @@ int rist_sender_enqueue(struct rist_sender *ctx, const void *data, size_t len, u
 	}
 
 	ctx->last_datagram_time = datagram_time;
-	uint8_t tmp_buf[6 * 204 + 4];//Max size needed with at least 1 pkt suppressed
-	if (ctx->null_packet_suppression && len <= 7 * 204)
+	uint8_t ext_flags = rist_sender_restart_flag(ctx);
+	//Max size needed: both extension headers and 7 packets, the headers end right before the TS data
+	uint8_t tmp_buf[sizeof(struct rist_rtp_hdr_ext) + sizeof(struct rist_rtp_hdr_ext_stuffing) + 7 * 204];
+	if ((ctx->null_packet_suppression || ctx->ts_stuffing_suppression) && len <= 7 * 204)
 	{
-
-		struct rist_rtp_hdr_ext *hdr_ext = (struct rist_rtp_hdr_ext *)&tmp_buf;
-		memset(tmp_buf, 0, sizeof(*hdr_ext));//hdr_ext
-		if (suppress_null_packets(data, &tmp_buf[sizeof(*hdr_ext)], &len, hdr_ext) > 0)
+		struct rist_rtp_hdr_ext hdr_ext;
+		struct rist_rtp_hdr_ext_stuffing stuffing;
+		uint8_t *ts_buf = &tmp_buf[sizeof(hdr_ext) + sizeof(stuffing)];
+		const uint8_t *ts = data;
+		memset(&hdr_ext, 0, sizeof(hdr_ext));
+		if (ctx->null_packet_suppression)
+		{
+			if (suppress_null_packets(data, ts_buf, &len, &hdr_ext) > 0)
+				ts = ts_buf;
+			else
+				memset(&hdr_ext, 0, sizeof(hdr_ext));
+		}
+		if (ctx->ts_stuffing_suppression && suppress_ts_stuffing(ts, ts_buf, &len, &hdr_ext, &stuffing) > 0)
+			ts = ts_buf;
+		if (ts == ts_buf)
 		{
-			memcpy(&hdr_ext->identifier, "RI", 2);
-			hdr_ext->length = htobe16(1);
-			len += sizeof(*hdr_ext);
-			payload = tmp_buf;
+			size_t ext_len = sizeof(hdr_ext);
+			if (CHECK_BIT(hdr_ext.flags, 6))
+				ext_len += sizeof(stuffing);
+			uint8_t *ext = ts_buf - ext_len;
+			memcpy(&hdr_ext.identifier, "RI", 2);
+			hdr_ext.length = htobe16((uint16_t)(ext_len / 4 - 1));
+			hdr_ext.flags |= ext_flags;
+			ext_flags = 0;
+			memcpy(ext, &hdr_ext, sizeof(hdr_ext));
+			if (CHECK_BIT(hdr_ext.flags, 6))
+				memcpy(&ext[sizeof(hdr_ext)], &stuffing, sizeof(stuffing));
+			len += ext_len;
+			payload = ext;
 			payload_type = RIST_PAYLOAD_TYPE_DATA_RAW_RTP_EXT;
 		}
 	}
@@ -654,7 +1414,10 @@ int rist_sender_enqueue(struct rist_sender *ctx, const void *data, size_t len, u
 	/* insert into sender fifo queue */
 	pthread_mutex_lock(&ctx->queue_lock);
 	size_t sender_write_index = atomic_load_explicit(&ctx->sender_queue_write_index, memory_order_acquire);
-	ctx->sender_queue[sender_write_index] = rist_new_buffer(&ctx->common, payload, len, payload_type, 0, datagram_time, src_port, dst_port);
+	if (RIST_UNLIKELY(ext_flags))
+		ctx->sender_queue[sender_write_index] = rist_sender_new_ext_buffer(ctx, payload, len, ext_flags, datagram_time, src_port, dst_port);
+	else
+		ctx->sender_queue[sender_write_index] = rist_new_buffer(&ctx->common, payload, len, payload_type, 0, datagram_time, src_port, dst_port);
 	if (RIST_UNLIKELY(!ctx->sender_queue[sender_write_index])) {
 		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "\t Could not create packet buffer inside sender buffer, OOM, decrease max bitrate or buffer time length\n");
 		pthread_mutex_unlock(&ctx->queue_lock);
@@ -668,6 +1431,123 @@ int rist_sender_enqueue(struct rist_sender *ctx, const void *data, size_t len, u
 	return 0;
 }
 
+int rist_sender_enqueue_frame(struct rist_sender *ctx, const void *data, size_t len, size_t fragment_size, uint64_t datagram_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp)
+{
+	if (ctx->common.PEERS == NULL) {
+		// Do not cache data if the lib user has not added peers
+		return -1;
+	}
+	size_t count = (len + fragment_size - 1) / fragment_size;
+	// Keep the frame and the retransmission history of its head inside the queue
+	if (count >= ctx->sender_queue_max / 2 || rist_get_sender_queue_pending(ctx) + count >= ctx->sender_queue_max / 2) {
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Frame of %zu bytes (%zu fragments) does not fit the sender queue\n", len, count);
+		return -1;
+	}
+	struct rist_buffer *stack_fragments[64];
+	struct rist_buffer **fragments = stack_fragments;
+	if (count > 64) {
+		fragments = malloc(count * sizeof(*fragments));
+		if (!fragments)
+			return -1;
+	}
+
+	// All allocations and copies happen outside of the queue lock
+	const uint8_t *p = data;
+	size_t i;
+	for (i = 0; i < count; i++) {
+		size_t offset = i * fragment_size;
+		size_t fragment_len = len - offset < fragment_size ? len - offset : fragment_size;
+		uint8_t frame_flags = RIST_RTP_EXT_FRAGMENT | rist_sender_restart_flag(ctx);
+		if (i == 0)
+			frame_flags |= RIST_RTP_EXT_FRAGMENT_FIRST;
+		if (i == count - 1)
+			frame_flags |= RIST_RTP_EXT_FRAGMENT_LAST;
+		fragments[i] = rist_sender_new_ext_buffer(ctx, &p[offset], fragment_len, frame_flags, datagram_time, src_port, dst_port);
+		if (RIST_UNLIKELY(!fragments[i]))
+			break;
+		fragments[i]->seq_rtp = (uint16_t)(seq_rtp + i);
+	}
+	if (RIST_UNLIKELY(i < count)) {
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "\t Could not create packet buffer inside sender buffer, OOM, decrease max bitrate or buffer time length\n");
+		while (i-- > 0)
+			free_rist_buffer(&ctx->common, fragments[i]);
+		if (fragments != stack_fragments)
+			free(fragments);
+		return -1;
+	}
+
+	ctx->last_datagram_time = datagram_time;
+	/* insert the whole frame into the sender fifo queue at once */
+	pthread_mutex_lock(&ctx->queue_lock);
+	size_t sender_write_index = atomic_load_explicit(&ctx->sender_queue_write_index, memory_order_acquire);
+	for (i = 0; i < count; i++) {
+		ctx->sender_queue[sender_write_index] = fragments[i];
+		ctx->sender_queue_bytesize += fragments[i]->size;
+		sender_write_index = (sender_write_index + 1) & (ctx->sender_queue_max - 1);
+	}
+	atomic_store_explicit(&ctx->sender_queue_write_index, sender_write_index, memory_order_release);
+	pthread_mutex_unlock(&ctx->queue_lock);
+
+	if (fragments != stack_fragments)
+		free(fragments);
+	return 0;
+}
+
+/* Sends the packet on peer, or on each connected receiver when peer is listening */
+static void rist_sender_send_peer(struct rist_peer *peer, struct rist_buffer *buffer, uint64_t now, struct rist_wire_image **wire)
+{
+	uint8_t *payload = buffer->data;
+	if (peer->listening) {
+		struct rist_peer *child = peer->child;
+		while (child) {
+#if HAVE_SRP_SUPPORT
+			if (!eap_is_authenticated(child->eap_ctx))
+			{
+				//do nothing
+			} else
+#endif
+			if (child->authenticated && child->is_data && (!child->dead || (child->dead && (child->dead_since + peer->recovery_buffer_ticks) < now))) {
+				rist_send_common(child, buffer->type, &payload[RIST_MAX_PAYLOAD_OFFSET], buffer->size, buffer->source_time, buffer->src_port, buffer->dst_port, buffer->seq_rtp, wire);
+			}
+			child = child->sibling_next;
+		}
+	} else if (!peer->dead || (peer->dead && (peer->dead_since + peer->recovery_buffer_ticks) < now)) {
+		rist_send_common(peer, buffer->type, &payload[RIST_MAX_PAYLOAD_OFFSET], buffer->size, buffer->source_time, buffer->src_port, buffer->dst_port, buffer->seq_rtp, wire);
+	}
+}
+
+/* select_data hook in place of the weighted round robin */
+static void rist_sender_send_data_policy(struct rist_sender *ctx, struct rist_buffer *buffer, uint64_t now, struct rist_wire_image **wire)
+{
+	const struct rist_path *paths[RIST_PATH_POLICY_MAX_PATHS];
+	struct rist_peer *peers[RIST_PATH_POLICY_MAX_PATHS];
+	bool send[RIST_PATH_POLICY_MAX_PATHS] = { false };
+	size_t count = 0;
+
+	for (struct rist_peer *peer = ctx->common.PEERS; peer && count < RIST_PATH_POLICY_MAX_PATHS; peer = peer->next) {
+		if (!peer->is_data || peer->parent)
+			continue;
+#if HAVE_SRP_SUPPORT
+		if (!peer->listening && !peer->multicast_sender && !eap_is_authenticated(peer->eap_ctx))
+			continue;
+#endif
+		if ((!peer->listening && !peer->authenticated) || peer->dead
+			|| (peer->listening && !peer->child_alive_count))
+			continue;
+		peers[count] = peer;
+		paths[count] = rist_path_get(&ctx->common, peer);
+		count++;
+	}
+	if (count == 0)
+		return;
+
+	ctx->common.path_policy.select_data(ctx->common.path_policy_arg, paths, count, buffer->seq, send);
+	for (size_t i = 0; i < count; i++) {
+		if (send[i])
+			rist_sender_send_peer(peers[i], buffer, now, wire);
+	}
+}
+
 void rist_sender_send_data_balanced(struct rist_sender *ctx, struct rist_buffer *buffer)
 {
 	struct rist_peer *peer;
@@ -679,6 +1559,12 @@ void rist_sender_send_data_balanced(struct rist_sender *ctx, struct rist_buffer
 	//We can do it safely here, since this function is only to be called once per packet
 	buffer->seq = ctx->common.seq++;
 	uint64_t now = timestampNTP_u64();
+	struct rist_wire_image **wire = ctx->wire_cache ? &buffer->wire : NULL;
+
+	if (RIST_UNLIKELY(ctx->common.path_policy.select_data != NULL)) {
+		rist_sender_send_data_policy(ctx, buffer, now, wire);
+		return;
+	}
 
 peer_select:
 
@@ -709,25 +1595,7 @@ peer_select:
 		/*************************************/
 
 		if (peer->config.weight == 0 && !looped) {
-			if (peer->listening) {
-				struct rist_peer *child = peer->child;
-				while (child) {
-#if HAVE_SRP_SUPPORT
-					if (!eap_is_authenticated(child->eap_ctx))
-					{
-						//do nothing
-					} else
-#endif
-					if (child->authenticated && child->is_data && (!child->dead || (child->dead && (child->dead_since + peer->recovery_buffer_ticks) < now))) {
-						uint8_t *payload = buffer->data;
-						rist_send_common_rtcp(child, buffer->type, &payload[RIST_MAX_PAYLOAD_OFFSET], buffer->size, buffer->source_time, buffer->src_port, buffer->dst_port, buffer->seq_rtp);
-					}
-					child = child->sibling_next;
-				}
-			} else if (!peer->dead || (peer->dead && (peer->dead_since + peer->recovery_buffer_ticks) < now)) {
-				uint8_t *payload = buffer->data;
-				rist_send_common_rtcp(peer, buffer->type, &payload[RIST_MAX_PAYLOAD_OFFSET], buffer->size, buffer->source_time, buffer->src_port, buffer->dst_port, buffer->seq_rtp);
-			}
+			rist_sender_send_peer(peer, buffer, now, wire);
 		} else {
 			/* Election of next peer */
 			// printf("peer election: considering %p, count=%d (wc: %d)\n",
@@ -741,25 +1609,7 @@ peer_select:
 	looped = true;
 	if (selected_peer_by_weight) {
 		peer = selected_peer_by_weight;
-		if (peer->listening) {
-			struct rist_peer *child = peer->child;
-			while (child) {
-#if HAVE_SRP_SUPPORT
-					if (!eap_is_authenticated(child->eap_ctx))
-					{
-						//do nothing
-					} else
-#endif
-				if (child->authenticated && child->is_data && (!child->dead || (child->dead && (child->dead_since + peer->recovery_buffer_ticks) < now))) {
-					uint8_t *payload = buffer->data;
-					rist_send_common_rtcp(child, buffer->type, &payload[RIST_MAX_PAYLOAD_OFFSET], buffer->size, buffer->source_time, buffer->src_port, buffer->dst_port,  buffer->seq_rtp);
-				}
-				child = child->sibling_next;
-			}
-		} else if (!peer->dead || (peer->dead && (peer->dead_since + peer->recovery_buffer_ticks) < now)) {
-			uint8_t *payload = buffer->data;
-			rist_send_common_rtcp(peer, buffer->type, &payload[RIST_MAX_PAYLOAD_OFFSET], buffer->size, buffer->source_time, buffer->src_port, buffer->dst_port, buffer->seq_rtp);
-		}
+		rist_sender_send_peer(peer, buffer, now, wire);
 		ctx->weight_counter--;
 		peer->w_count--;
 	}
@@ -788,6 +1638,15 @@ size_t rist_get_sender_retry_queue_size(struct rist_sender *ctx)
 	return retry_queue_size;
 }
 
+/* Packets written by the application and not yet picked up by the protocol thread,
+ * the read index points at the last packet sent */
+size_t rist_get_sender_queue_pending(struct rist_sender *ctx)
+{
+	size_t write_index = atomic_load_explicit(&ctx->sender_queue_write_index, memory_order_acquire);
+	size_t read_index = atomic_load_explicit(&ctx->sender_queue_read_index, memory_order_acquire);
+	return (write_index - read_index - 1) & (ctx->sender_queue_max - 1);
+}
+
 /* This function must return, 0 when there is nothing to send, < 0 on error and > 0 for bytes sent */
 ssize_t rist_retry_dequeue(struct rist_sender *ctx)
 {
@@ -851,7 +1710,26 @@ ssize_t rist_retry_dequeue(struct rist_sender *ctx)
 	}
 	current_bitrate =  data_bitrate + retry_bitrate;
 	size_t max_bitrate = retry->peer->config.recovery_maxbitrate * 1000;
-	if (current_bitrate > max_bitrate) {
+	// Path reported congestion experienced marks: halve the headroom left for retries
+	bool ecn_congested = retry->peer->ecn_congested_until > timestampNTP_u64();
+	if (ecn_congested && max_bitrate > data_bitrate)
+		max_bitrate = data_bitrate + (max_bitrate - data_bitrate) / 2;
+	uint64_t now = timestampNTP_u64();
+	/* queue_time holds the original insertion time for this seq */
+	uint64_t data_age = (now - ctx->sender_queue[idx]->time) / RIST_CLOCK;
+	bool admit = current_bitrate <= max_bitrate;
+	if (RIST_UNLIKELY(ctx->common.path_policy.admit_retransmit != NULL)) {
+		struct rist_path *path = rist_path_get(&ctx->common, retry->peer);
+		bool builtin = admit;
+		admit = ctx->common.path_policy.admit_retransmit(ctx->common.path_policy_arg, path, retry->seq,
+			ctx->sender_queue[idx]->transmit_count, (uint32_t)data_age, builtin);
+		if (!admit && builtin) {
+			rist_log_priv(&ctx->common, RIST_LOG_DEBUG, "Path policy refused to resend packet %"PRIu32".\n", retry->seq);
+			retry->peer->stats_sender_instant.bandwidth_skip++;
+			return -2;
+		}
+	}
+	if (!admit) {
 		rist_log_priv(&ctx->common, RIST_LOG_DEBUG, "Max bandwidth exceeded: (%zu + %zu) > %zu, not resending packet %"PRIu64".\n",
 			data_bitrate, retry_bitrate, max_bitrate, idx);
 		retry->peer->stats_sender_instant.bandwidth_skip++;
@@ -859,9 +1737,6 @@ ssize_t rist_retry_dequeue(struct rist_sender *ctx)
 	}
 
 	// Check buffer element age
-	uint64_t now = timestampNTP_u64();
-	/* queue_time holds the original insertion time for this seq */
-	uint64_t data_age = (now - ctx->sender_queue[idx]->time) / RIST_CLOCK;
 	uint64_t retry_age = (now - retry->insert_time) / RIST_CLOCK;
 	if (RIST_UNLIKELY(retry_age > retry->peer->config.recovery_length_max)) {
 		rist_log_priv(&ctx->common, RIST_LOG_DEBUG,
@@ -883,6 +1758,12 @@ ssize_t rist_retry_dequeue(struct rist_sender *ctx)
 	uint8_t *payload = buffer->data;
 
 	size_t ret = 0;
+	if (ecn_congested && buffer->transmit_count >= retry->peer->config.min_retries) {
+		rist_log_priv(&ctx->common, RIST_LOG_DEBUG, "Path is congested (ECN), not resending packet %"PRIu32" again after %u retries\n",
+			retry->seq, buffer->transmit_count);
+		retry->peer->stats_sender_instant.ecn_skip++;
+		return -1;
+	}
 	if (buffer->transmit_count >= retry->peer->config.max_retries) {
 		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Datagram %"PRIu32
 			" is missing, but nack count is too large (%u), age is %"PRIu64"ms, retry #%lu\n",
@@ -891,10 +1772,23 @@ ssize_t rist_retry_dequeue(struct rist_sender *ctx)
 			return -1;
 	}
 
+	if (buffer->cold) {
+		if (rist_history_store_read(&ctx->history, buffer->cold_pos, &ctx->history_scratch[RIST_MAX_PAYLOAD_OFFSET], buffer->size) != 0) {
+			rist_log_priv(&ctx->common, RIST_LOG_DEBUG,
+				"Datagram %"PRIu32" was overwritten in the history store after %"PRIu64"ms, consider a larger store\n",
+				retry->seq, data_age);
+			ctx->history_overwritten++;
+			retry->peer->stats_sender_instant.retrans_skip++;
+			return -1;
+		}
+		payload = ctx->history_scratch;
+		ctx->history_retrans++;
+	}
+
 	uint16_t src_port = buffer->src_port;
 	if (src_port == 0)
 		src_port = 32768 + retry->peer->peer_data->adv_peer_id;
-	ret = (size_t)rist_send_seq_rtcp(retry->peer->peer_data, buffer->seq_rtp, buffer->type, &payload[RIST_MAX_PAYLOAD_OFFSET], buffer->size, buffer->source_time, src_port, (retry->peer->peer_data->config.virt_dst_port & ~1UL), true);
+	ret = (size_t)rist_send_seq_rtcp(retry->peer->peer_data, buffer->seq_rtp, buffer->type, &payload[RIST_MAX_PAYLOAD_OFFSET], buffer->size, buffer->source_time, src_port, (retry->peer->peer_data->config.virt_dst_port & ~1UL), true, ctx->wire_cache && !buffer->cold ? &buffer->wire : NULL);
 	// update bandwidth value
 	rist_calculate_bitrate(ret, retry_bw);
 
@@ -913,7 +1807,20 @@ ssize_t rist_retry_dequeue(struct rist_sender *ctx)
 	return ret;
 }
 
-void rist_retry_enqueue(struct rist_sender *ctx, uint32_t seq, struct rist_peer *peer)
+/* Cut-through relay: hand a nack for a packet that did not reach the relay
+ * yet to its receiver, drained by the receiver protocol thread */
+static void rist_sender_relay_request(struct rist_sender *ctx, uint32_t seq)
+{
+	size_t write = atomic_load_explicit(&ctx->relay_request_write, memory_order_relaxed);
+	size_t next = (write + 1) & (RIST_RELAY_REQUESTS - 1);
+	/* full: the relay receiver still nacks the packet on its own schedule */
+	if (next == atomic_load_explicit(&ctx->relay_request_read, memory_order_acquire))
+		return;
+	ctx->relay_requests[write] = seq;
+	atomic_store_explicit(&ctx->relay_request_write, next, memory_order_release);
+}
+
+void rist_retry_enqueue(struct rist_sender *ctx, uint32_t seq, struct rist_peer *peer, bool early)
 {
 	uint64_t now = timestampNTP_u64();
 	size_t idx = rist_sender_index_get(ctx, seq);
@@ -931,6 +1838,9 @@ void rist_retry_enqueue(struct rist_sender *ctx, uint32_t seq, struct rist_peer
 	// bloat_mode aggressive mode = we enforce 2*rtt spacing and allow duplicates
 	// This is a safety check to protect against buggy or non compliant receivers that request the
 	// same seq number without waiting one RTT.
+	// Early re-nacks (the receiver saw a later repair of the same nack arrive first, so this
+	// retransmission was lost) skip the rtt spacing, they are still never queued twice and
+	// max_retries still applies at the dequeue.
 
 	if (peer->config.recovery_mode == RIST_RECOVERY_MODE_DISABLED) {
 		rist_log_priv(&ctx->common, RIST_LOG_DEBUG,
@@ -938,6 +1848,13 @@ void rist_retry_enqueue(struct rist_sender *ctx, uint32_t seq, struct rist_peer
 			peer->stats_sender_instant.retrans_skip++;
 		return;
 	}
+	else if (ctx->relay && (!buffer || buffer->seq_rtp != (uint16_t)seq)) {
+		rist_log_priv(&ctx->common, RIST_LOG_DEBUG,
+			"Nack request for seq %"PRIu32" not relayed yet, passing it upstream\n", seq);
+		rist_sender_relay_request(ctx, seq);
+		peer->stats_sender_instant.retrans_skip++;
+		return;
+	}
 	else if (!buffer) {
 		rist_log_priv(&ctx->common, RIST_LOG_DEBUG,
 			"Nack request for seq %"PRIu32" but we do not have it in the buffer (%zu ms)\n", seq,
@@ -975,7 +1892,7 @@ void rist_retry_enqueue(struct rist_sender *ctx, uint32_t seq, struct rist_peer
 					// Aggressive congestion control only allows every two RTTs
 					rtt = rtt * 2;
 				}
-				if (delta < rtt)
+				if (delta < rtt && !early)
 				{
 					rist_log_priv(&ctx->common, RIST_LOG_DEBUG,
 						"Nack request for seq %" PRIu32 ", age %"PRIu64"ms, is already queued (too soon to add another one), skipped, %" PRIu64 " < %" PRIu64 " ms\n",
@@ -983,7 +1900,6 @@ void rist_retry_enqueue(struct rist_sender *ctx, uint32_t seq, struct rist_peer
 					peer->stats_sender_instant.bloat_skip++;
 					return;
 				}
-				buffer->retry_queued = true;
 			}
 			else
 			{
@@ -1019,7 +1935,7 @@ void rist_retry_enqueue(struct rist_sender *ctx, uint32_t seq, struct rist_peer
 				/* this retry hasn't been handled yet, it makes no sense to insert a duplicate */
 				if (retry->active)
 					return;
-				if (delta < rtt)
+				if (delta < rtt && !early)
 				{
 					rist_log_priv(&ctx->common, RIST_LOG_DEBUG,
 						"Nack request for seq %" PRIu32 " with delta %" PRIu64 "ms (age %"PRIu64"ms) is already queued (too soon to add another one), skipped, peer #%d '%s'\n",
@@ -1037,6 +1953,7 @@ void rist_retry_enqueue(struct rist_sender *ctx, uint32_t seq, struct rist_peer
 	}
 	// Now insert into the missing queue
 	buffer->last_retry_request = now;
+	buffer->retry_queued = true;
 	retry = &ctx->sender_retry_queue[ctx->sender_retry_queue_write_index];
 	retry->seq = seq;
 	retry->peer = peer;
@@ -0,0 +1,197 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "helpers.h"
+
+atomic_ulong failed;
+atomic_ulong stop;
+struct rist_logging_settings *logging_settings = NULL;
+
+static const char *const *log_expected;
+static test_log_hook log_hook;
+static bool log_stop_on_error;
+
+static int log_callback(void *arg, enum rist_log_level level, const char *msg) {
+	(void)arg;
+	if (log_hook && log_hook(level, msg))
+		return 0;
+	if (level > RIST_LOG_ERROR)
+		return 0;
+	for (const char *const *e = log_expected; e && *e; e++) {
+		if (strstr(msg, *e))
+			return 0;
+	}
+	fprintf(stdout, "[ERROR] %s", msg);
+	atomic_store(&failed, 1);
+	if (log_stop_on_error)
+		atomic_store(&stop, 1);
+	return 0;
+}
+
+int test_logging_init(enum rist_log_level level, const char *const *expected, test_log_hook hook, bool stop_on_error) {
+	atomic_init(&failed, 0);
+	atomic_init(&stop, 0);
+	log_expected = expected;
+	log_hook = hook;
+	log_stop_on_error = stop_on_error;
+	return rist_logging_set(&logging_settings, level, log_callback, NULL, NULL, stderr);
+}
+
+int test_add_peer(struct rist_ctx *ctx, const char *url, struct rist_peer **peer) {
+	struct rist_peer_config *peer_config = NULL;
+	if (rist_parse_address2(url, (void *)&peer_config))
+		return -1;
+	struct rist_peer *created;
+	int ret = rist_peer_create(ctx, peer ? peer : &created, peer_config);
+	free((void *)peer_config);
+	return ret;
+}
+
+unsigned long test_json_count(const char *json, const char *key) {
+	const char *c = strstr(json, key);
+	unsigned long count = 0;
+	if (c)
+		sscanf(c + strlen(key), "%lu", &count);
+	return count;
+}
+
+int test_sender_write(struct test_sender *s, int i) {
+	char buffer[TEST_PAYLOAD_SIZE] = { 0 };
+	struct rist_data_block data = { 0 };
+	if (s->fill)
+		s->fill(buffer, sizeof(buffer), s->index, i);
+	else
+		snprintf(buffer, sizeof(buffer), "%s %d PACKET #%i", s->tag ? s->tag : "SENDER", s->index, i);
+	data.payload = &buffer;
+	data.payload_len = sizeof(buffer);
+	if (s->use_seq) {
+		data.seq = (uint16_t)(s->seq_base + i);
+		data.flags = RIST_DATA_FLAGS_USE_SEQ;
+	}
+	if (rist_sender_data_write(s->ctx, &data) != (int)data.payload_len) {
+		atomic_store(&failed, 1);
+		return -1;
+	}
+	return 0;
+}
+
+static PTHREAD_START_FUNC(send_data, arg) {
+	struct test_sender *s = arg;
+	for (int i = 0; (!s->count || i < s->count) && !atomic_load(&s->stop) && !atomic_load(&stop); i++) {
+		if (test_sender_write(s, i) != 0)
+			break;
+		usleep(s->interval_us ? s->interval_us : 1000);
+	}
+	return 0;
+}
+
+int test_sender_start(struct test_sender *s) {
+	atomic_init(&s->stop, 0);
+	if (pthread_create(&s->thread, NULL, send_data, s) != 0)
+		return -1;
+	s->running = true;
+	return 0;
+}
+
+void test_sender_wait(struct test_sender *s) {
+	if (s->running)
+		pthread_join(s->thread, NULL);
+	s->running = false;
+}
+
+void test_sender_stop(struct test_sender *s) {
+	atomic_store(&s->stop, 1);
+	test_sender_wait(s);
+}
+
+int test_payload_seq(const struct rist_data_block *b, const char *tag, int *index) {
+	char format[64];
+	int i = -1;
+	int seq = -1;
+	snprintf(format, sizeof(format), "%s %%d PACKET #%%d", tag ? tag : "SENDER");
+	if (b->payload_len == 0 || sscanf(b->payload, format, &i, &seq) != 2 || seq < 0)
+		return -1;
+	if (index)
+		*index = i;
+	return seq;
+}
+
+static PTHREAD_START_FUNC(send_sdes, arg) {
+	struct test_raw_source *s = arg;
+	struct sockaddr_in to = s->to;
+	uint8_t pkt[16] = { RTCP_SDES_FLAGS, PTYPE_SDES, 0, 3 };
+	uint32_t ssrc = htonl(s->ssrc);
+	memcpy(&pkt[4], &ssrc, sizeof(ssrc));
+	pkt[8] = 1;
+	pkt[9] = 4;
+	memcpy(&pkt[10], "test", 4);
+	to.sin_port = htons((uint16_t)(ntohs(s->to.sin_port) + 1));
+	while (!atomic_load(&s->stop)) {
+		sendto(s->sd, (void *)pkt, sizeof(pkt), 0, (const struct sockaddr *)&to, sizeof(to));
+		usleep(50000);
+	}
+	return 0;
+}
+
+int test_raw_source_open(struct test_raw_source *s, int port, uint32_t ssrc) {
+	s->ssrc = ssrc;
+	s->running = false;
+	atomic_init(&s->stop, 0);
+	s->sd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (s->sd < 0)
+		return -1;
+	memset(&s->to, 0, sizeof(s->to));
+	s->to.sin_family = AF_INET;
+	s->to.sin_port = htons((uint16_t)port);
+	s->to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (pthread_create(&s->sdes_thread, NULL, send_sdes, s) != 0) {
+		close(s->sd);
+		s->sd = -1;
+		return -1;
+	}
+	s->running = true;
+	return 0;
+}
+
+void test_raw_source_close(struct test_raw_source *s) {
+	atomic_store(&s->stop, 1);
+	if (s->running)
+		pthread_join(s->sdes_thread, NULL);
+	s->running = false;
+	if (s->sd >= 0)
+		close(s->sd);
+	s->sd = -1;
+}
+
+void test_raw_send(const struct test_raw_source *s, uint16_t seq, uint32_t ts, uint8_t ext_flags, const void *payload, size_t len) {
+	uint8_t buf[sizeof(struct rist_rtp_hdr) + sizeof(struct rist_rtp_hdr_ext) + TEST_PAYLOAD_SIZE];
+	struct rist_rtp_hdr *rtp = (void *)buf;
+	struct rist_rtp_hdr_ext *ext = (void *)&buf[sizeof(*rtp)];
+	if (len > TEST_PAYLOAD_SIZE)
+		len = TEST_PAYLOAD_SIZE;
+	memset(buf, 0, sizeof(*rtp) + sizeof(*ext));
+	rtp->flags = RTP_MPEGTS_FLAGS | (1 << 4);
+	rtp->payload_type = RTP_PTYPE_MPEGTS;
+	rtp->seq = htons(seq);
+	rtp->ts = htonl(ts);
+	rtp->ssrc = htonl(s->ssrc);
+	memcpy(&ext->identifier, "RI", 2);
+	ext->length = htons(1);
+	ext->flags = ext_flags;
+	memcpy(&buf[sizeof(*rtp) + sizeof(*ext)], payload, len);
+	sendto(s->sd, (void *)buf, sizeof(*rtp) + sizeof(*ext) + len, 0, (const struct sockaddr *)&s->to, sizeof(s->to));
+}
+
+int test_finish(int ret) {
+	free(logging_settings);
+	logging_settings = NULL;
+	if (ret == 77)
+		return ret;
+	if (ret > 0) {
+		fprintf(stderr, "FAIL\n");
+		return ret;
+	}
+	fprintf(stdout, "OK\n");
+	return 0;
+}
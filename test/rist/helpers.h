@@ -0,0 +1,93 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Scaffolding shared by the loopback tests of this directory: logging that
+ * fails the test on errors, peers from urls, sender threads and the exit
+ * report. Each test keeps its scenario and its checks. */
+
+#ifndef RIST_TEST_HELPERS_H
+#define RIST_TEST_HELPERS_H
+
+#include "librist/librist.h"
+#include "rist-private.h"
+#include "proto/rtp.h"
+#include <stdatomic.h>
+#include <time.h>
+#include "socket-shim.h"
+
+#define TEST_PAYLOAD_SIZE 1316
+
+/* Set on the first unexpected error, and by the checks of the test */
+extern atomic_ulong failed;
+/* Ends the sender threads and the loops of the test */
+extern atomic_ulong stop;
+extern struct rist_logging_settings *logging_settings;
+
+/* Sees each message before the error check, returns true for the ones the
+ * test accounts for itself */
+typedef bool (*test_log_hook)(int level, const char *msg);
+
+/* Logs at level into the test callback. An error fails the test unless it
+ * contains one of the NULL terminated expected strings or the hook takes it,
+ * with stop_on_error it also stops the test. */
+int test_logging_init(enum rist_log_level level, const char *const *expected, test_log_hook hook, bool stop_on_error);
+
+/* Adds the peer of url to ctx, peer may be NULL */
+int test_add_peer(struct rist_ctx *ctx, const char *url, struct rist_peer **peer);
+
+/* The number following key in a stats json, 0 if it is not there */
+unsigned long test_json_count(const char *json, const char *key);
+
+/* A thread writing "<tag> <index> PACKET #<i>" payloads to ctx */
+struct test_sender {
+	struct rist_ctx *ctx;
+	const char *tag;	/* "SENDER" when NULL */
+	int index;
+	int count;	/* packets to write, 0 until stopped */
+	unsigned interval_us;	/* between two writes, 1000 when 0 */
+	bool use_seq;	/* write with RIST_DATA_FLAGS_USE_SEQ from seq_base */
+	uint16_t seq_base;
+	/* writes the payload of packet i instead of the text */
+	void (*fill)(char *payload, size_t len, int index, int i);
+	atomic_ulong stop;
+	pthread_t thread;
+	bool running;
+};
+
+/* Writes packet i of s from the calling thread, fails the test on an error */
+int test_sender_write(struct test_sender *s, int i);
+int test_sender_start(struct test_sender *s);
+/* Stops and joins the thread, the context is left to the caller */
+void test_sender_stop(struct test_sender *s);
+/* Joins the thread once it wrote its count of packets */
+void test_sender_wait(struct test_sender *s);
+
+/* Packet number of a test_sender payload with the given tag (NULL for
+ * "SENDER"), -1 if it is not one. index is set when not NULL. */
+int test_payload_seq(const struct rist_data_block *b, const char *tag, int *index);
+
+/* A simple profile source on a plain UDP socket, for the streams the library
+ * senders can't be made to write */
+struct test_raw_source {
+	int sd;
+	uint32_t ssrc;
+	struct sockaddr_in to;
+	atomic_ulong stop;
+	pthread_t sdes_thread;
+	bool running;
+};
+
+/* Opens the socket towards port on the loopback and keeps the session up
+ * with an SDES on the rtcp port every 50 ms: the receiver takes no data
+ * before it has seen one */
+int test_raw_source_open(struct test_raw_source *s, int port, uint32_t ssrc);
+void test_raw_source_close(struct test_raw_source *s);
+/* One RTP packet with the RI extension, ext_flags 0 for plain data */
+void test_raw_send(const struct test_raw_source *s, uint16_t seq, uint32_t ts, uint8_t ext_flags, const void *payload, size_t len);
+
+/* Frees the logging settings and reports the result: 0 and 77 as they are,
+ * anything above 0 as a failure */
+int test_finish(int ret);
+
+#endif
@@ -0,0 +1,152 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Peers and flows come and go through the API while a stream keeps flowing.
+ * The protocol threads service their sockets without the peerlist lock, the
+ * removals from the application threads must neither stall them nor pull a
+ * peer from under them: the main flow has to come through complete and the
+ * removed peers have to be reaped. */
+
+#include "helpers.h"
+
+#define RUN_SECONDS 6
+#define MAIN_FLOW_ID 0x4000
+#define CHURN_FLOW_ID 0x4100
+
+struct churn {
+	struct rist_ctx *receiver;
+	struct rist_ctx *sender;
+	int port;
+	int rounds;
+};
+
+/* A second listening peer on the receiver gets a sender of its own (a new
+ * connection peer and flow), which is cut off by removing the listening peer
+ * while it sends. The main sender gains and loses a peer meanwhile. */
+static PTHREAD_START_FUNC(churn_peers, arg) {
+	struct churn *c = arg;
+	char url[256];
+	for (int round = 0; !atomic_load(&stop); round++) {
+		struct rist_peer *listening = NULL;
+		struct rist_peer *extra = NULL;
+		struct rist_peer *sender_peer = NULL;
+		struct test_sender churned = { .tag = "CHURN" };
+		struct rist_ctx *sender = NULL;
+		snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1", c->port + 2);
+		if (test_add_peer(c->receiver, url, &listening) != 0)
+			goto fail;
+		snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1", c->port + 4);
+		if (test_add_peer(c->sender, url, &extra) != 0)
+			goto fail;
+		snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1", c->port + 2);
+		if (rist_sender_create(&sender, RIST_PROFILE_MAIN, CHURN_FLOW_ID + 2 * (round % 64), logging_settings) != 0 ||
+			test_add_peer(sender, url, &sender_peer) != 0 || rist_start(sender) != 0)
+			goto fail;
+		churned.ctx = sender;
+		for (int i = 0; i < 150 && !atomic_load(&stop); i++) {
+			test_sender_write(&churned, i);
+			usleep(1000);
+		}
+		if (rist_peer_destroy(c->receiver, listening) != 0 || rist_peer_destroy(c->sender, extra) != 0)
+			goto fail;
+		rist_destroy(sender);
+		c->rounds++;
+		continue;
+fail:
+		fprintf(stdout, "Churn round %d failed\n", round);
+		if (sender)
+			rist_destroy(sender);
+		atomic_store(&failed, 1);
+		break;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3)
+		return 99;
+	int profile = atoi(argv[1]);
+	int port = atoi(argv[2]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct rist_ctx *sender_ctx = NULL;
+	struct rist_peer *peer = NULL;
+	struct test_sender main_sender = { .tag = "MAIN" };
+	char url[256];
+
+	if (test_logging_init(RIST_LOG_WARN, NULL, NULL, true) != 0)
+		return 99;
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+	if (rist_receiver_create(&receiver_ctx, profile, logging_settings) != 0 ||
+		test_add_peer(receiver_ctx, url, &peer) != 0 || rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+	if (rist_sender_create(&sender_ctx, profile, MAIN_FLOW_ID, logging_settings) != 0 ||
+		test_add_peer(sender_ctx, url, &peer) != 0 || rist_start(sender_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	main_sender.ctx = sender_ctx;
+	if (test_sender_start(&main_sender) != 0) {
+		ret = 99;
+		goto out;
+	}
+	struct churn churn = { .receiver = receiver_ctx, .sender = sender_ctx, .port = port };
+	pthread_t churn_loop;
+	if (pthread_create(&churn_loop, NULL, churn_peers, &churn) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	int received = 0;
+	int churned = 0;
+	int next = 0;
+	int gaps = 0;
+	struct rist_data_block *b = NULL;
+	time_t end = time(NULL) + RUN_SECONDS;
+	while (!atomic_load(&stop) && time(NULL) < end) {
+		if (rist_receiver_data_read2(receiver_ctx, &b, 100) <= 0 || !b)
+			continue;
+		int seq = -1;
+		if (b->flow_id == MAIN_FLOW_ID && (seq = test_payload_seq(b, "MAIN", NULL)) >= 0) {
+			if (received && seq != next)
+				gaps++;
+			next = seq + 1;
+			received++;
+		} else {
+			churned++;
+		}
+		rist_receiver_data_block_free2(&b);
+	}
+	atomic_store(&stop, 1);
+	pthread_join(churn_loop, NULL);
+	test_sender_stop(&main_sender);
+
+	fprintf(stdout, "%d churn rounds, main flow %d packets with %d gaps, %d packets from the churned flows\n",
+		churn.rounds, received, gaps, churned);
+	if (churn.rounds < 4 || received < RUN_SECONDS * 500 || gaps > 0 || churned == 0)
+		atomic_store(&failed, 1);
+
+	// Every removed peer is handed to the reaper, none may be left behind
+	struct rist_common_ctx *cctx = &receiver_ctx->receiver_ctx->common;
+	for (int i = 0; i < 200 && atomic_load(&cctx->reaper.pending) > 0; i++)
+		usleep(10000);
+	if (atomic_load(&cctx->reaper.pending) > 0) {
+		fprintf(stdout, "%zu peers and flows left with the reaper\n", atomic_load(&cctx->reaper.pending));
+		atomic_store(&failed, 1);
+	}
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	atomic_store(&stop, 1);
+	test_sender_stop(&main_sender);
+	if (sender_ctx)
+		rist_destroy(sender_ctx);
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
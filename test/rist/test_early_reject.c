@@ -0,0 +1,100 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* The sender transmits every packet over two paths, so the receiver gets each
+ * one twice. The second copy must be dropped (early when possible) and counted
+ * as a duplicate, while the output stays complete and in order. */
+
+#include "helpers.h"
+
+#define PACKET_COUNT 4000
+
+atomic_ulong duplicates;
+
+static int stats_callback(void *arg, const struct rist_stats *stats) {
+	(void)arg;
+	if (stats->stats_type == RIST_STATS_RECEIVER_FLOW && stats->stats_json) {
+		atomic_fetch_add(&duplicates, test_json_count(stats->stats_json, "\"duplicates\":"));
+	}
+	rist_stats_free(stats);
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 6)
+		return 99;
+	int profile = atoi(argv[1]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct rist_ctx *sender_ctx = NULL;
+	struct test_sender sender = { .count = PACKET_COUNT, .interval_us = 500 };
+
+	atomic_init(&duplicates, 0);
+
+	if (test_logging_init(RIST_LOG_WARN, NULL, NULL, true) != 0)
+		return 99;
+	if (rist_receiver_create(&receiver_ctx, profile, logging_settings) != 0 ||
+		test_add_peer(receiver_ctx, argv[2], NULL) != 0 || test_add_peer(receiver_ctx, argv[3], NULL) != 0 ||
+		rist_stats_callback_set(receiver_ctx, 100, stats_callback, NULL) != 0 ||
+		rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	if (rist_sender_create(&sender_ctx, profile, 0, logging_settings) != 0 ||
+		test_add_peer(sender_ctx, argv[4], NULL) != 0 || test_add_peer(sender_ctx, argv[5], NULL) != 0 ||
+		rist_start(sender_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	sender.ctx = sender_ctx;
+	if (test_sender_start(&sender) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	struct rist_data_block *b = NULL;
+	char rcompare[1316];
+	int expected = -1;
+	int received = 0;
+	int idle = 0;
+	while (!atomic_load(&stop) && idle < 5) {
+		int queue_length = rist_receiver_data_read2(receiver_ctx, &b, 1000);
+		if (queue_length <= 0 || !b) {
+			idle++;
+			continue;
+		}
+		idle = 0;
+		const char *payload = b->payload;
+		if (expected < 0)
+			expected = test_payload_seq(b, NULL, NULL);
+		snprintf(rcompare, sizeof(rcompare), "SENDER 0 PACKET #%i", expected);
+		if (strcmp(rcompare, payload)) {
+			fprintf(stderr, "Got %s, expected %s\n", payload, rcompare);
+			atomic_store(&failed, 1);
+		}
+		expected++;
+		received++;
+		rist_receiver_data_block_free2(&b);
+		if (expected == PACKET_COUNT)
+			break;
+	}
+	atomic_store(&stop, 1);
+	test_sender_stop(&sender);
+	//Let the last stats interval come in
+	usleep(250000);
+	fprintf(stdout, "Received %d packets, %lu duplicates dropped\n", received, atomic_load(&duplicates));
+	if (received < PACKET_COUNT * 9 / 10 || atomic_load(&duplicates) < (unsigned long)received / 2)
+		atomic_store(&failed, 1);
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	atomic_store(&stop, 1);
+	test_sender_stop(&sender);
+	if (sender_ctx)
+		rist_destroy(sender_ctx);
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
@@ -0,0 +1,118 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Early re-nack against a sender that loses retransmissions as well. The
+ * re-nacks go out well within one rtt of the nack they repeat: the sender has
+ * to take them as early re-nacks and not skip them as duplicates, the flow
+ * has to come through. Run with range and bitmask nacks. */
+
+#include "helpers.h"
+
+#define PACKET_COUNT 3000
+#define LOSS_PERMILLE 100
+#define FLOW_ID 0x6500
+
+static const char *const expected_errors[] = { "Lost ", NULL };
+
+atomic_ulong early_renacks;
+atomic_ulong bloat_skipped;
+atomic_ulong retransmitted;
+
+static int stats_callback(void *arg, const struct rist_stats *stats) {
+	(void)arg;
+	if (stats->stats_type == RIST_STATS_RECEIVER_FLOW) {
+		atomic_fetch_add(&early_renacks, test_json_count(stats->stats_json, "\"early_renacks\":"));
+	} else if (stats->stats_type == RIST_STATS_SENDER_PEER) {
+		atomic_fetch_add(&bloat_skipped, test_json_count(stats->stats_json, "\"bloat_skipped\":"));
+		atomic_fetch_add(&retransmitted, stats->stats.sender_peer.retransmitted);
+	}
+	rist_stats_free(stats);
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3)
+		return 99;
+	enum rist_nack_type nack_type = (enum rist_nack_type)atoi(argv[1]);
+	int port = atoi(argv[2]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct rist_ctx *sender_ctx = NULL;
+	struct test_sender sender = { 0 };
+	char url[256];
+	static uint8_t seen[PACKET_COUNT];
+
+	atomic_init(&early_renacks, 0);
+	atomic_init(&bloat_skipped, 0);
+	atomic_init(&retransmitted, 0);
+
+	if (test_logging_init(RIST_LOG_WARN, expected_errors, NULL, false) != 0)
+		return 99;
+	// on loopback the rtt floors set the intervals: regular retries every
+	// 66 ms, well clear of the 40 ms duplicate guard of the sender, which
+	// the early re-nacks come in far below
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=60&rtt-min=60&buffer=1000", port);
+	if (rist_receiver_create(&receiver_ctx, RIST_PROFILE_MAIN, logging_settings) != 0 ||
+		rist_receiver_nack_type_set(receiver_ctx, nack_type) != 0 ||
+		rist_receiver_early_renack_set(receiver_ctx, true) != 0 ||
+		rist_stats_callback_set(receiver_ctx, 100, stats_callback, NULL) != 0 ||
+		test_add_peer(receiver_ctx, url, NULL) != 0 || rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=40&rtt-min=40&buffer=1000", port);
+	if (rist_sender_create(&sender_ctx, RIST_PROFILE_MAIN, FLOW_ID, logging_settings) != 0 ||
+		rist_stats_callback_set(sender_ctx, 100, stats_callback, NULL) != 0 ||
+		test_add_peer(sender_ctx, url, NULL) != 0) {
+		ret = 99;
+		goto out;
+	}
+	// retransmissions are lost as often as the data
+	sender_ctx->sender_ctx->simulate_loss = true;
+	sender_ctx->sender_ctx->loss_percentage = LOSS_PERMILLE;
+	if (rist_start(sender_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	// Keeps going past PACKET_COUNT, so that a lost tail is noticed and repaired
+	sender.ctx = sender_ctx;
+	if (test_sender_start(&sender) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	int received = 0;
+	struct rist_data_block *b = NULL;
+	time_t end = time(NULL) + PACKET_COUNT / 1000 + 5;
+	while (time(NULL) < end && received < PACKET_COUNT) {
+		if (rist_receiver_data_read2(receiver_ctx, &b, 100) <= 0 || !b)
+			continue;
+		int seq = test_payload_seq(b, NULL, NULL);
+		if (seq >= 0 && seq < PACKET_COUNT && !seen[seq]) {
+			seen[seq] = 1;
+			received++;
+		}
+		rist_receiver_data_block_free2(&b);
+	}
+	// the last stats round
+	usleep(200000);
+	atomic_store(&stop, 1);
+	test_sender_stop(&sender);
+
+	fprintf(stdout, "%s nacks: %d of %d packets, %lu retransmitted, %lu early re-nacks, %lu skipped as duplicates\n",
+		nack_type == RIST_NACK_BITMASK ? "bitmask" : "range", received, PACKET_COUNT, atomic_load(&retransmitted),
+		atomic_load(&early_renacks), atomic_load(&bloat_skipped));
+	if (received < PACKET_COUNT * 99 / 100 || atomic_load(&early_renacks) == 0 || atomic_load(&bloat_skipped) != 0)
+		atomic_store(&failed, 1);
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	atomic_store(&stop, 1);
+	test_sender_stop(&sender);
+	if (sender_ctx)
+		rist_destroy(sender_ctx);
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
@@ -0,0 +1,143 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* ECN over a lossy main profile link, both ends with ecn=1. The sender socket
+ * has to mark its data ECT(0) and the receiver has to count it from the
+ * IP_TOS of every datagram:
+ * - ect: the marks go through as they are, no congestion anywhere
+ * - ce: the test marks the sender socket CE as a congested path would, the
+ *   receiver counts the marks and reports them in its RTCP XR ECN blocks, the
+ *   sender has to parse them and stop resending past the minimum retries */
+
+#include "helpers.h"
+#include "udp-private.h"
+
+#define FLOW_ID 0x6700
+#define PACKET_COUNT 2000
+// every retransmission is lost as often, some packets need a few of them
+#define LOSS_PERMILLE 300
+
+static const char *const expected_errors[] = { "Lost ", "nack count is too large", NULL };
+
+static atomic_ulong receiver_ect;
+static atomic_ulong receiver_ce;
+static atomic_ulong sender_ce;
+static atomic_ulong sender_ecn_skipped;
+
+static int stats_callback(void *arg, const struct rist_stats *stats) {
+	(void)arg;
+	if (stats->stats_type == RIST_STATS_RECEIVER_FLOW) {
+		atomic_fetch_add(&receiver_ect, test_json_count(stats->stats_json, "\"ecn_ect\":"));
+		atomic_fetch_add(&receiver_ce, test_json_count(stats->stats_json, "\"ecn_ce\":"));
+	} else if (stats->stats_type == RIST_STATS_SENDER_PEER) {
+		atomic_fetch_add(&sender_ce, test_json_count(stats->stats_json, "\"ecn_ce\":"));
+		atomic_fetch_add(&sender_ecn_skipped, test_json_count(stats->stats_json, "\"ecn_skipped\":"));
+	}
+	rist_stats_free(stats);
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3)
+		return 99;
+	bool congested;
+	if (strcmp(argv[1], "ect") == 0)
+		congested = false;
+	else if (strcmp(argv[1], "ce") == 0)
+		congested = true;
+	else
+		return 99;
+	int port = atoi(argv[2]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct rist_ctx *sender_ctx = NULL;
+	struct test_sender source = { .count = PACKET_COUNT, .interval_us = 500 };
+	char url[256];
+
+	atomic_init(&receiver_ect, 0);
+	atomic_init(&receiver_ce, 0);
+	atomic_init(&sender_ce, 0);
+	atomic_init(&sender_ecn_skipped, 0);
+	if (test_logging_init(RIST_LOG_WARN, expected_errors, NULL, false) != 0)
+		return 99;
+	if (!HAVE_ECN) {
+		fprintf(stdout, "ECN is not supported on this platform\n");
+		return test_finish(77);
+	}
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1&ecn=1", port);
+	if (rist_receiver_create(&receiver_ctx, RIST_PROFILE_MAIN, logging_settings) != 0 ||
+		rist_stats_callback_set(receiver_ctx, 100, stats_callback, NULL) != 0 ||
+		test_add_peer(receiver_ctx, url, NULL) != 0 || rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	// congestion stops the resends from the second one on
+	snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1&ecn=1&min-retries=2", port);
+	struct rist_peer *peer = NULL;
+	if (rist_sender_create(&sender_ctx, RIST_PROFILE_MAIN, FLOW_ID, logging_settings) != 0 ||
+		rist_stats_callback_set(sender_ctx, 100, stats_callback, NULL) != 0 ||
+		test_add_peer(sender_ctx, url, &peer) != 0) {
+		ret = 99;
+		goto out;
+	}
+	sender_ctx->sender_ctx->simulate_loss = true;
+	sender_ctx->sender_ctx->loss_percentage = LOSS_PERMILLE;
+
+	int tos = 0;
+	socklen_t len = sizeof(tos);
+	if (getsockopt(peer->sd, IPPROTO_IP, IP_TOS, &tos, &len) != 0 || (tos & RIST_ECN_MASK) != RIST_ECN_ECT0) {
+		fprintf(stdout, "The sender socket is not marked ECT(0): %x\n", tos);
+		atomic_store(&failed, 1);
+	}
+	if (congested) {
+		// as a router would remark it on a congested path
+		tos = (tos & ~RIST_ECN_MASK) | RIST_ECN_CE;
+		if (setsockopt(peer->sd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos)) != 0) {
+			ret = 99;
+			goto out;
+		}
+	}
+	source.ctx = sender_ctx;
+	if (rist_start(sender_ctx) != 0 || test_sender_start(&source) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	int received = 0;
+	struct rist_data_block *b = NULL;
+	time_t end = time(NULL) + PACKET_COUNT / 1000 + 5;
+	while (time(NULL) < end && received < PACKET_COUNT) {
+		if (rist_receiver_data_read2(receiver_ctx, &b, 100) <= 0 || !b)
+			continue;
+		if (test_payload_seq(b, NULL, NULL) >= 0)
+			received++;
+		rist_receiver_data_block_free2(&b);
+	}
+	test_sender_wait(&source);
+	// the last stats round
+	usleep(300000);
+
+	unsigned long ect = atomic_load(&receiver_ect);
+	unsigned long ce = atomic_load(&receiver_ce);
+	unsigned long reported = atomic_load(&sender_ce);
+	unsigned long skipped = atomic_load(&sender_ecn_skipped);
+	fprintf(stdout, "%s: %d packets received, %lu ECT and %lu CE counted, %lu CE reported back, %lu resends skipped\n",
+			argv[1], received, ect, ce, reported, skipped);
+	if (congested) {
+		// the reports are cumulative, the first one only sets the baseline
+		if (ce < PACKET_COUNT / 2 || reported == 0 || reported > ce || skipped == 0)
+			atomic_store(&failed, 1);
+	} else if (ect < PACKET_COUNT / 2 || ce != 0 || reported != 0 || skipped != 0 || received < PACKET_COUNT * 9 / 10) {
+		atomic_store(&failed, 1);
+	}
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	test_sender_stop(&source);
+	if (sender_ctx)
+		rist_destroy(sender_ctx);
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
@@ -0,0 +1,205 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* The output fifo policies against an application that stops reading. Each
+ * round the sender writes a burst while nothing is read, then the fifo is
+ * drained:
+ * - drop-oldest: what is left is the newest end of the burst, in sequence
+ * - hold: the burst is held back in the recovery buffer and comes out whole
+ * - grow: the fifo grows beyond its size, up to the byte cap and no further
+ * Every round crosses the high watermark on the way up and the low one on
+ * the way down, each event has to fire once per crossing. */
+
+#include "helpers.h"
+
+#define FLOW_ID 0x6200
+#define FIFO_SIZE 64
+#define HIGH_WATERMARK 32
+#define LOW_WATERMARK 8
+#define ROUNDS 2
+#define ROUND_PACKETS 300
+#define GROW_PACKETS 100
+#define GROW_MAX_BYTES (GROW_PACKETS * TEST_PAYLOAD_SIZE)
+#define WARMUP_INDEX 99
+
+// Loopback losses that are not repaired in time are not what is tested
+static const char *const expected_errors[] = { "Lost ", NULL };
+
+static atomic_ulong events[RIST_FIFO_EVENT_DROP + 1];
+static atomic_ulong round_index;
+static atomic_ulong round_output;
+
+static void fifo_event(void *arg, uint32_t flow_id, enum rist_fifo_event event, uint32_t count) {
+	(void)arg;
+	fprintf(stdout, "Flow %u fifo event %d with %u packets\n", flow_id, event, count);
+	if (event <= RIST_FIFO_EVENT_DROP)
+		atomic_fetch_add(&events[event], 1);
+}
+
+/* Sees every packet leave the buffer, whether or not the fifo keeps it */
+static int data_callback(void *arg, struct rist_data_block *b) {
+	(void)arg;
+	int index = -1;
+	if (test_payload_seq(b, NULL, &index) >= 0 && index == (int)atomic_load(&round_index))
+		atomic_fetch_add(&round_output, 1);
+	rist_receiver_data_block_free2(&b);
+	return 0;
+}
+
+static bool wait_for(atomic_ulong *value, unsigned long expected, int seconds) {
+	time_t end = time(NULL) + seconds;
+	while (atomic_load(value) < expected && time(NULL) < end)
+		usleep(1000);
+	return atomic_load(value) >= expected;
+}
+
+/* Reads the round's packets out of the fifo until it stays empty, seqs gets
+ * the packet numbers in the order read */
+static int drain(struct rist_ctx *ctx, int round, int *seqs, size_t *bytes) {
+	int count = 0;
+	struct rist_data_block *b = NULL;
+	time_t end = time(NULL) + 10;
+	*bytes = 0;
+	while (time(NULL) < end && rist_receiver_data_read2(ctx, &b, 200) > 0 && b) {
+		int index = -1;
+		int seq = test_payload_seq(b, NULL, &index);
+		if (index == round && seq >= 0 && count < ROUND_PACKETS) {
+			seqs[count++] = seq;
+			*bytes += b->payload_len;
+		}
+		rist_receiver_data_block_free2(&b);
+	}
+	return count;
+}
+
+static bool in_sequence(const int *seqs, int count, int first) {
+	for (int i = 0; i < count; i++) {
+		if (seqs[i] != first + i) {
+			fprintf(stdout, "Read packet %d where %d was due\n", seqs[i], first + i);
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3)
+		return 99;
+	enum rist_fifo_policy policy;
+	if (strcmp(argv[1], "drop-oldest") == 0)
+		policy = RIST_FIFO_POLICY_DROP_OLDEST;
+	else if (strcmp(argv[1], "hold") == 0)
+		policy = RIST_FIFO_POLICY_HOLD;
+	else if (strcmp(argv[1], "grow") == 0)
+		policy = RIST_FIFO_POLICY_GROW;
+	else
+		return 99;
+	int port = atoi(argv[2]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct rist_ctx *sender_ctx = NULL;
+	struct test_sender source = { .count = ROUND_PACKETS };
+	int seqs[ROUND_PACKETS];
+	char url[256];
+
+	for (int i = 0; i <= RIST_FIFO_EVENT_DROP; i++)
+		atomic_init(&events[i], 0);
+	atomic_init(&round_index, 0);
+	atomic_init(&round_output, 0);
+	if (test_logging_init(RIST_LOG_WARN, expected_errors, NULL, false) != 0)
+		return 99;
+	// Holding is bounded by the buffer, it has to outlast a whole burst
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1&buffer=%d", port,
+			policy == RIST_FIFO_POLICY_HOLD ? 2000 : 200);
+	if (rist_receiver_create(&receiver_ctx, RIST_PROFILE_MAIN, logging_settings) != 0 ||
+		rist_receiver_set_output_fifo_size(receiver_ctx, FIFO_SIZE) != 0 ||
+		rist_receiver_set_output_fifo_policy(receiver_ctx, policy, GROW_MAX_BYTES) != 0 ||
+		rist_receiver_output_fifo_event_callback_set(receiver_ctx, HIGH_WATERMARK, LOW_WATERMARK, fifo_event, NULL) != 0 ||
+		// the hold policy only applies to the fifo alone
+		(policy != RIST_FIFO_POLICY_HOLD && rist_receiver_data_callback_set2(receiver_ctx, data_callback, NULL) != 0) ||
+		test_add_peer(receiver_ctx, url, NULL) != 0 || rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1&buffer=%d", port,
+			policy == RIST_FIFO_POLICY_HOLD ? 2000 : 200);
+	if (rist_sender_create(&sender_ctx, RIST_PROFILE_MAIN, FLOW_ID, logging_settings) != 0 ||
+		test_add_peer(sender_ctx, url, NULL) != 0 || rist_start(sender_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	// no burst before the flow is up
+	struct test_sender warmup = { .ctx = sender_ctx, .index = WARMUP_INDEX };
+	struct rist_data_block *b = NULL;
+	time_t end = time(NULL) + 5;
+	for (int i = 0; !b && time(NULL) < end; i++) {
+		if (test_sender_write(&warmup, i) != 0 || rist_receiver_data_read2(receiver_ctx, &b, 20) <= 0)
+			b = NULL;
+	}
+	if (!b) {
+		fprintf(stdout, "The flow did not come up\n");
+		ret = 1;
+		goto out;
+	}
+	rist_receiver_data_block_free2(&b);
+	size_t bytes;
+	drain(receiver_ctx, WARMUP_INDEX, seqs, &bytes);
+
+	for (int round = 0; round < ROUNDS && !atomic_load(&failed); round++) {
+		atomic_store(&round_index, round);
+		atomic_store(&round_output, 0);
+		source.ctx = sender_ctx;
+		source.index = round;
+		if (test_sender_start(&source) != 0) {
+			ret = 99;
+			goto out;
+		}
+		test_sender_wait(&source);
+		int count;
+		if (policy == RIST_FIFO_POLICY_HOLD) {
+			// the output stays paused until the application reads again
+			if (!wait_for(&events[RIST_FIFO_EVENT_HOLD], round + 1, 5))
+				fprintf(stdout, "Round %d: output not held\n", round);
+			count = drain(receiver_ctx, round, seqs, &bytes);
+			fprintf(stdout, "Round %d: %d packets read after the hold\n", round, count);
+			if (count != ROUND_PACKETS || !in_sequence(seqs, count, 0))
+				atomic_store(&failed, 1);
+		} else {
+			// the fifo has seen the whole burst before it is read
+			if (!wait_for(&round_output, ROUND_PACKETS, 10))
+				fprintf(stdout, "Round %d: %lu packets output\n", round, atomic_load(&round_output));
+			count = drain(receiver_ctx, round, seqs, &bytes);
+			fprintf(stdout, "Round %d: %d packets, %zu bytes left in the fifo\n", round, count, bytes);
+			if (policy == RIST_FIFO_POLICY_DROP_OLDEST) {
+				// the fifo keeps one slot free
+				if (count != FIFO_SIZE - 1 || !in_sequence(seqs, count, ROUND_PACKETS - count))
+					atomic_store(&failed, 1);
+			} else if (count != GROW_PACKETS || bytes > GROW_MAX_BYTES || !in_sequence(seqs, count, 0)) {
+				atomic_store(&failed, 1);
+			}
+		}
+		if (!wait_for(&events[RIST_FIFO_EVENT_LOW_WATERMARK], round + 1, 2))
+			fprintf(stdout, "Round %d: no low watermark event\n", round);
+	}
+
+	unsigned long high = atomic_load(&events[RIST_FIFO_EVENT_HIGH_WATERMARK]);
+	unsigned long low = atomic_load(&events[RIST_FIFO_EVENT_LOW_WATERMARK]);
+	unsigned long hold = atomic_load(&events[RIST_FIFO_EVENT_HOLD]);
+	unsigned long drop = atomic_load(&events[RIST_FIFO_EVENT_DROP]);
+	fprintf(stdout, "Events over %d rounds: %lu high, %lu low, %lu hold, %lu drop\n", ROUNDS, high, low, hold, drop);
+	if (high != ROUNDS || low != ROUNDS)
+		atomic_store(&failed, 1);
+	if (policy == RIST_FIFO_POLICY_HOLD ? (hold != ROUNDS || drop != 0) : (hold != 0 || drop != ROUNDS))
+		atomic_store(&failed, 1);
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	test_sender_stop(&source);
+	if (sender_ctx)
+		rist_destroy(sender_ctx);
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
@@ -0,0 +1,166 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Write flow control of a sender whose receiver never shows up. Until the
+ * sender is started nothing drains its queue:
+ * - non-blocking writes go in up to the high watermark, then get -EAGAIN
+ * - a blocking write waits out its timeout and gets -EAGAIN as well
+ * - a blocking write with a longer timeout is let through once the protocol
+ *   thread starts and drains the queue to the low watermark, which also fires
+ *   the write ready callback and the notify fd, once
+ * The queue info has to follow all along. */
+
+#include "helpers.h"
+#include <errno.h>
+#include <poll.h>
+
+#define FLOW_ID 0x6300
+#define HIGH_WATERMARK 200
+#define LOW_WATERMARK 50
+#define SHORT_TIMEOUT_MS 100
+#define LONG_TIMEOUT_MS 5000
+
+static atomic_ulong write_ready;
+
+static int write_ready_callback(void *arg) {
+	(void)arg;
+	atomic_fetch_add(&write_ready, 1);
+	return 0;
+}
+
+static uint64_t now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+struct blocked_write {
+	struct rist_ctx *ctx;
+	int ret;
+	uint64_t returned_ms;
+};
+
+static PTHREAD_START_FUNC(write_blocking, arg) {
+	struct blocked_write *w = arg;
+	char buffer[TEST_PAYLOAD_SIZE] = "BLOCKED WRITE";
+	struct rist_data_block data = { .payload = buffer, .payload_len = sizeof(buffer) };
+	w->ret = rist_sender_data_write(w->ctx, &data);
+	w->returned_ms = now_ms();
+	return 0;
+}
+
+static bool check_info(struct rist_ctx *ctx, const char *when, uint32_t pending, uint32_t backpressure, uint64_t refused, uint64_t blocked) {
+	struct rist_sender_queue_info info;
+	if (rist_sender_queue_info_get(ctx, &info) != 0)
+		return false;
+	fprintf(stdout, "%s: %u pending, watermarks %u/%u, backpressure %u, %" PRIu64 " refused, %" PRIu64 " blocked\n", when,
+			info.pending, info.high_watermark, info.low_watermark, info.backpressure, info.writes_refused, info.writes_blocked);
+	return info.pending <= pending && info.high_watermark == HIGH_WATERMARK && info.low_watermark == LOW_WATERMARK &&
+		info.backpressure == backpressure && info.writes_refused == refused && info.writes_blocked == blocked;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 2)
+		return 99;
+	int port = atoi(argv[1]);
+	int ret = 0;
+	struct rist_ctx *sender_ctx = NULL;
+	int fds[2] = { -1, -1 };
+	char url[256];
+
+	atomic_init(&write_ready, 0);
+	if (test_logging_init(RIST_LOG_WARN, NULL, NULL, false) != 0)
+		return 99;
+	// nothing listens on the port
+	snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+	if (rist_sender_create(&sender_ctx, RIST_PROFILE_MAIN, FLOW_ID, logging_settings) != 0 ||
+		test_add_peer(sender_ctx, url, NULL) != 0 || pipe(fds) != 0 ||
+		rist_sender_flow_control_set(sender_ctx, HIGH_WATERMARK, LOW_WATERMARK, 0) != 0 ||
+		rist_sender_write_ready_callback_set(sender_ctx, write_ready_callback, NULL) != 0 ||
+		rist_sender_write_ready_notify_fd_set(sender_ctx, fds[1]) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	int written = 0;
+	int w;
+	for (;;) {
+		char buffer[TEST_PAYLOAD_SIZE] = { 0 };
+		struct rist_data_block data = { .payload = buffer, .payload_len = sizeof(buffer) };
+		snprintf(buffer, sizeof(buffer), "SENDER 0 PACKET #%d", written);
+		w = rist_sender_data_write(sender_ctx, &data);
+		if (w != (int)data.payload_len || written > HIGH_WATERMARK)
+			break;
+		written++;
+	}
+	fprintf(stdout, "%d packets written before the write returned %d\n", written, w);
+	if (written != HIGH_WATERMARK || w != -EAGAIN || !check_info(sender_ctx, "Non-blocking", HIGH_WATERMARK, 1, 1, 0))
+		atomic_store(&failed, 1);
+
+	// the timeout runs out, nothing drains the queue
+	if (rist_sender_flow_control_set(sender_ctx, HIGH_WATERMARK, LOW_WATERMARK, SHORT_TIMEOUT_MS) != 0) {
+		ret = 99;
+		goto out;
+	}
+	struct blocked_write timed_out = { .ctx = sender_ctx };
+	uint64_t start = now_ms();
+	write_blocking(&timed_out);
+	fprintf(stdout, "Blocking write returned %d after %" PRIu64 " ms\n", timed_out.ret, timed_out.returned_ms - start);
+	if (timed_out.ret != -EAGAIN || timed_out.returned_ms - start < SHORT_TIMEOUT_MS ||
+		!check_info(sender_ctx, "Timed out", HIGH_WATERMARK, 1, 2, 1))
+		atomic_store(&failed, 1);
+	if (atomic_load(&write_ready) != 0) {
+		fprintf(stdout, "Write ready before the queue drained\n");
+		atomic_store(&failed, 1);
+	}
+
+	// the protocol thread lets the next one through
+	if (rist_sender_flow_control_set(sender_ctx, HIGH_WATERMARK, LOW_WATERMARK, LONG_TIMEOUT_MS) != 0) {
+		ret = 99;
+		goto out;
+	}
+	struct blocked_write released = { .ctx = sender_ctx };
+	pthread_t writer;
+	if (pthread_create(&writer, NULL, write_blocking, &released) != 0) {
+		ret = 99;
+		goto out;
+	}
+	struct rist_sender_queue_info info = { 0 };
+	time_t end = time(NULL) + 2;
+	while (time(NULL) < end && rist_sender_queue_info_get(sender_ctx, &info) == 0 && info.writes_blocked < 2)
+		usleep(1000);
+	start = now_ms();
+	if (info.writes_blocked != 2 || rist_start(sender_ctx) != 0) {
+		fprintf(stdout, "The write did not block\n");
+		atomic_store(&failed, 1);
+		pthread_join(writer, NULL);
+		goto out;
+	}
+	pthread_join(writer, NULL);
+	fprintf(stdout, "Blocking write returned %d %" PRIu64 " ms after the start\n", released.ret, released.returned_ms - start);
+	if (released.ret != TEST_PAYLOAD_SIZE || released.returned_ms - start >= LONG_TIMEOUT_MS)
+		atomic_store(&failed, 1);
+	struct pollfd pfd = { .fd = fds[0], .events = POLLIN };
+	char byte;
+	if (poll(&pfd, 1, 1000) != 1 || read(fds[0], &byte, 1) != 1) {
+		fprintf(stdout, "Nothing on the notify fd\n");
+		atomic_store(&failed, 1);
+	}
+	if (poll(&pfd, 1, 100) != 0 || atomic_load(&write_ready) != 1) {
+		fprintf(stdout, "Write ready signalled %lu times\n", atomic_load(&write_ready));
+		atomic_store(&failed, 1);
+	}
+	if (!check_info(sender_ctx, "Released", LOW_WATERMARK, 0, 2, 2))
+		atomic_store(&failed, 1);
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	if (sender_ctx)
+		rist_destroy(sender_ctx);
+	for (int i = 0; i < 2; i++) {
+		if (fds[i] >= 0)
+			close(fds[i]);
+	}
+	return test_finish(ret);
+}
@@ -0,0 +1,216 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Three flows into one receiver:
+ * - A has a reader opened before the flow exists, which is closed half way:
+ *   its data has to go on through rist_receiver_data_read2, none lost and
+ *   none twice
+ * - B gets its reader from the new flow callback and keeps it until the
+ *   receiver is destroyed, which frees it
+ * - C has no reader and only ever comes out of rist_receiver_data_read2 */
+
+#include "helpers.h"
+
+#define FLOWS 3
+#define PACKET_COUNT 3000
+#define HANDOVER 1000
+#define FLOW_ID_BASE 0x6400
+
+// the second reader for flow A is refused on purpose
+static const char *const expected_errors[] = { "is already open", NULL };
+
+atomic_ulong a_closing;
+atomic_ulong b_open;
+atomic_ulong b_received;
+
+struct rist_flow_reader *reader_b = NULL;
+
+static void flow_callback(void *arg, uint32_t flow_id) {
+	struct rist_ctx *ctx = arg;
+	if (flow_id != FLOW_ID_BASE + 2)
+		return;
+	if (rist_receiver_flow_reader_open(ctx, flow_id, &reader_b) != 0)
+		atomic_store(&failed, 1);
+	else
+		atomic_store(&b_open, 1);
+}
+
+/* seen counts per packet of flow A, filled by both of its readers */
+static uint8_t seen_a[PACKET_COUNT];
+
+static int check_block(const struct rist_data_block *b, int index) {
+	int flow = -1;
+	int seq = test_payload_seq(b, NULL, &flow);
+	if (seq < 0 || flow != index || b->flow_id != (uint32_t)(FLOW_ID_BASE + 2 * index)) {
+		fprintf(stdout, "Packet %s came out on flow %u, expected flow %d\n", (const char *)b->payload, b->flow_id, index);
+		atomic_store(&failed, 1);
+		return -1;
+	}
+	return seq;
+}
+
+struct reader_a {
+	struct rist_flow_reader *reader;
+	pthread_t thread;
+	int received;
+};
+
+/* Reads flow A until the handover, then gives the flow back */
+static PTHREAD_START_FUNC(read_a, arg) {
+	struct reader_a *r = arg;
+	struct rist_data_block *b = NULL;
+	while (!atomic_load(&stop) && r->received < HANDOVER) {
+		if (rist_receiver_flow_reader_read(r->reader, &b, 100) <= 0 || !b)
+			continue;
+		int seq = check_block(b, 0);
+		if (seq >= 0 && seq < PACKET_COUNT) {
+			seen_a[seq]++;
+			r->received++;
+		}
+		rist_receiver_data_block_free2(&b);
+	}
+	atomic_store(&a_closing, 1);
+	if (rist_receiver_flow_reader_close(&r->reader) != 0 || r->reader)
+		atomic_store(&failed, 1);
+	return 0;
+}
+
+/* Reads flow B through the reader of the new flow callback */
+static PTHREAD_START_FUNC(read_b, arg) {
+	(void)arg;
+	static uint8_t seen_b[PACKET_COUNT];
+	struct rist_data_block *b = NULL;
+	while (!atomic_load(&stop)) {
+		if (!atomic_load(&b_open)) {
+			usleep(1000);
+			continue;
+		}
+		if (rist_receiver_flow_reader_read(reader_b, &b, 100) <= 0 || !b)
+			continue;
+		int seq = check_block(b, 1);
+		if (seq >= 0 && seq < PACKET_COUNT && !seen_b[seq]) {
+			seen_b[seq] = 1;
+			atomic_fetch_add(&b_received, 1);
+		}
+		rist_receiver_data_block_free2(&b);
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 2)
+		return 99;
+	int port = atoi(argv[1]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct test_sender senders[FLOWS] = { 0 };
+	struct reader_a reader_a = { 0 };
+	bool readers_started = false;
+	pthread_t read_b_loop;
+	char url[256];
+
+	atomic_init(&a_closing, 0);
+	atomic_init(&b_open, 0);
+	atomic_init(&b_received, 0);
+
+	if (test_logging_init(RIST_LOG_WARN, expected_errors, NULL, false) != 0)
+		return 99;
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+	if (rist_receiver_create(&receiver_ctx, RIST_PROFILE_MAIN, logging_settings) != 0 ||
+		rist_receiver_flow_callback_set(receiver_ctx, flow_callback, receiver_ctx) != 0 ||
+		rist_receiver_flow_reader_open(receiver_ctx, FLOW_ID_BASE, &reader_a.reader) != 0 ||
+		test_add_peer(receiver_ctx, url, NULL) != 0 || rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	struct rist_flow_reader *duplicate = NULL;
+	if (rist_receiver_flow_reader_open(receiver_ctx, FLOW_ID_BASE, &duplicate) != -4 || duplicate) {
+		fprintf(stdout, "A second reader for the same flow was opened\n");
+		atomic_store(&failed, 1);
+	}
+	if (pthread_create(&reader_a.thread, NULL, read_a, &reader_a) != 0) {
+		ret = 99;
+		goto out;
+	}
+	if (pthread_create(&read_b_loop, NULL, read_b, NULL) != 0) {
+		atomic_store(&stop, 1);
+		pthread_join(reader_a.thread, NULL);
+		ret = 99;
+		goto out;
+	}
+	readers_started = true;
+	for (int i = 0; i < FLOWS; i++) {
+		senders[i].index = i;
+		snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+		if (rist_sender_create(&senders[i].ctx, RIST_PROFILE_MAIN, FLOW_ID_BASE + 2 * i, logging_settings) != 0 ||
+			test_add_peer(senders[i].ctx, url, NULL) != 0 || rist_start(senders[i].ctx) != 0 ||
+			test_sender_start(&senders[i]) != 0) {
+			ret = 99;
+			goto stop;
+		}
+	}
+
+	int a_after = 0;
+	int a_early = 0;
+	int c_received = 0;
+	struct rist_data_block *b = NULL;
+	time_t end = time(NULL) + PACKET_COUNT / 1000 + 5;
+	while (time(NULL) < end && (reader_a.received + a_after < PACKET_COUNT || c_received < PACKET_COUNT ||
+		atomic_load(&b_received) < PACKET_COUNT)) {
+		if (rist_receiver_data_read2(receiver_ctx, &b, 100) <= 0 || !b)
+			continue;
+		if (b->flow_id == FLOW_ID_BASE) {
+			// flow A is handed back once its reader is closed
+			if (!atomic_load(&a_closing))
+				a_early++;
+			int seq = check_block(b, 0);
+			if (seq >= 0 && seq < PACKET_COUNT) {
+				seen_a[seq]++;
+				a_after++;
+			}
+		} else if (b->flow_id == FLOW_ID_BASE + 4) {
+			int seq = check_block(b, 2);
+			if (seq >= 0 && seq < PACKET_COUNT)
+				c_received++;
+		} else {
+			fprintf(stdout, "Packet %s of a flow with a reader came out of rist_receiver_data_read2\n", (const char *)b->payload);
+			atomic_store(&failed, 1);
+		}
+		rist_receiver_data_block_free2(&b);
+	}
+
+	int a_missing = 0;
+	int a_twice = 0;
+	for (int i = 0; i < PACKET_COUNT; i++) {
+		if (seen_a[i] == 0)
+			a_missing++;
+		else if (seen_a[i] > 1)
+			a_twice++;
+	}
+	fprintf(stdout, "Flow A: %d packets through the reader, %d after it was closed (%d early), %d missing, %d twice\n",
+		reader_a.received, a_after, a_early, a_missing, a_twice);
+	fprintf(stdout, "Flow B: %lu packets through the reader, flow C: %d packets\n", atomic_load(&b_received), c_received);
+	if (reader_a.received != HANDOVER || a_early || a_missing || a_twice ||
+		atomic_load(&b_received) != PACKET_COUNT || c_received < PACKET_COUNT)
+		atomic_store(&failed, 1);
+	if (atomic_load(&failed))
+		ret = 1;
+stop:
+	atomic_store(&stop, 1);
+	for (int i = 0; i < FLOWS; i++)
+		test_sender_stop(&senders[i]);
+	if (readers_started) {
+		pthread_join(reader_a.thread, NULL);
+		pthread_join(read_b_loop, NULL);
+	}
+out:
+	for (int i = 0; i < FLOWS; i++) {
+		if (senders[i].ctx)
+			rist_destroy(senders[i].ctx);
+	}
+	// the reader of flow B is still open, rist_destroy frees it
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
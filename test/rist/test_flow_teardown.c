@@ -0,0 +1,171 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* A flow with a reader through the deferred teardowns of the receiver:
+ * - one of its two listening peers is removed with rist_peer_destroy while
+ *   data flows, the reader has to go on getting the data of the other path
+ * - the sender goes away and the flow times out, the reader is closed as soon
+ *   as rist_delete_flow let go of it, while the output thread of the flow is
+ *   left to the reaper
+ * - a new reader for the same flow id gets the data of the next sender */
+
+#include "helpers.h"
+
+#define PACKET_COUNT 500
+#define FLOW_ID 0x6600
+
+atomic_ulong flow_deleted;
+
+static bool deletion_hook(int level, const char *msg) {
+	(void)level;
+	if (strstr(msg, "deleting flow with id"))
+		atomic_store(&flow_deleted, 1);
+	return false;
+}
+
+static int sender_start(struct test_sender *s, int index, int port, bool both_paths) {
+	char url[256];
+	struct rist_peer *peer;
+	s->index = index;
+	if (rist_sender_create(&s->ctx, RIST_PROFILE_MAIN, FLOW_ID, logging_settings) != 0)
+		return -1;
+	snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1", port + 2);
+	if (test_add_peer(s->ctx, url, &peer) != 0)
+		return -1;
+	snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+	if (both_paths && test_add_peer(s->ctx, url, &peer) != 0)
+		return -1;
+	if (rist_start(s->ctx) != 0 || test_sender_start(s) != 0)
+		return -1;
+	return 0;
+}
+
+static void sender_stop(struct test_sender *s) {
+	test_sender_stop(s);
+	if (s->ctx)
+		rist_destroy(s->ctx);
+	s->ctx = NULL;
+}
+
+/* Reads count new packets of the given sender through the reader */
+static int read_packets(struct rist_flow_reader *reader, int index, int count) {
+	int received = 0;
+	int last = -1;
+	struct rist_data_block *b = NULL;
+	time_t end = time(NULL) + count / 1000 + 5;
+	while (time(NULL) < end && received < count && !atomic_load(&failed)) {
+		if (rist_receiver_flow_reader_read(reader, &b, 100) <= 0 || !b)
+			continue;
+		int sender = -1;
+		int seq = test_payload_seq(b, NULL, &sender);
+		if (seq < 0 || b->flow_id != FLOW_ID) {
+			fprintf(stdout, "Packet %s came out of the reader on flow %u\n", (const char *)b->payload, b->flow_id);
+			atomic_store(&failed, 1);
+		} else if (sender == index && seq > last) {
+			last = seq;
+			received++;
+		}
+		rist_receiver_data_block_free2(&b);
+	}
+	return received;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 2)
+		return 99;
+	int port = atoi(argv[1]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct rist_flow_reader *reader = NULL;
+	struct rist_peer *first_path = NULL;
+	struct rist_peer *second_path = NULL;
+	struct test_sender senders[2] = { 0 };
+	char url[256];
+
+	atomic_init(&flow_deleted, 0);
+	if (test_logging_init(RIST_LOG_INFO, NULL, deletion_hook, false) != 0)
+		return 99;
+	if (rist_receiver_create(&receiver_ctx, RIST_PROFILE_MAIN, logging_settings) != 0 ||
+		rist_receiver_flow_reader_open(receiver_ctx, FLOW_ID, &reader) != 0) {
+		ret = 99;
+		goto out;
+	}
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+	if (test_add_peer(receiver_ctx, url, &first_path) != 0) {
+		ret = 99;
+		goto out;
+	}
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1", port + 2);
+	if (test_add_peer(receiver_ctx, url, &second_path) != 0 || rist_start(receiver_ctx) != 0 ||
+		sender_start(&senders[0], 0, port, true) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	int before_removal = read_packets(reader, 0, PACKET_COUNT);
+	// the peer goes to the reaper, the flow keeps its other path
+	if (rist_peer_destroy(receiver_ctx, first_path) != 0) {
+		fprintf(stdout, "Could not remove the first listening peer\n");
+		atomic_store(&failed, 1);
+	}
+	int after_removal = read_packets(reader, 0, PACKET_COUNT);
+	fprintf(stdout, "Sender 0: %d packets before the peer removal, %d after\n", before_removal, after_removal);
+	if (before_removal != PACKET_COUNT || after_removal != PACKET_COUNT)
+		atomic_store(&failed, 1);
+
+	// the flow times out once the sender is gone
+	sender_stop(&senders[0]);
+	time_t end = time(NULL) + RIST_DEFAULT_SESSION_TIMEOUT / 1000 * 2 + 5;
+	struct rist_data_block *b = NULL;
+	while (time(NULL) < end && !atomic_load(&flow_deleted)) {
+		// drains what is left of the flow
+		if (rist_receiver_flow_reader_read(reader, &b, 100) > 0 && b)
+			rist_receiver_data_block_free2(&b);
+	}
+	if (!atomic_load(&flow_deleted)) {
+		fprintf(stdout, "The flow did not time out\n");
+		atomic_store(&failed, 1);
+		ret = 1;
+		goto out;
+	}
+	// rist_delete_flow lets go of the reader before its flow is reaped
+	end = time(NULL) + 2;
+	for (;;) {
+		pthread_mutex_lock(&receiver_ctx->receiver_ctx->common.flows_lock);
+		bool detached = reader->flow == NULL;
+		pthread_mutex_unlock(&receiver_ctx->receiver_ctx->common.flows_lock);
+		if (detached)
+			break;
+		if (time(NULL) >= end) {
+			fprintf(stdout, "The reader is still attached to the deleted flow\n");
+			atomic_store(&failed, 1);
+			break;
+		}
+		usleep(1000);
+	}
+	if (rist_receiver_flow_reader_close(&reader) != 0 || reader)
+		atomic_store(&failed, 1);
+
+	// the flow id comes back, to a new reader and on the remaining path only
+	if (rist_receiver_flow_reader_open(receiver_ctx, FLOW_ID, &reader) != 0 ||
+		sender_start(&senders[1], 1, port, false) != 0) {
+		ret = 99;
+		goto out;
+	}
+	int returned = read_packets(reader, 1, PACKET_COUNT);
+	fprintf(stdout, "Sender 1: %d packets through the new reader\n", returned);
+	if (returned != PACKET_COUNT)
+		atomic_store(&failed, 1);
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	atomic_store(&stop, 1);
+	for (int i = 0; i < 2; i++)
+		sender_stop(&senders[i]);
+	if (reader)
+		rist_receiver_flow_reader_close(&reader);
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
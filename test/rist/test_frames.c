@@ -0,0 +1,286 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Frame reassembly. First a raw simple profile stream with hand made
+ * fragments, once plain packets got the flow going: a complete frame, one
+ * that lost a fragment in the middle, a plain packet, another complete frame
+ * and last a frame whose tail never arrives and that nothing follows. The
+ * receiver has to output each of them by the policy without waiting for more
+ * data. Then frames of all sizes mixed with plain packets through
+ * rist_sender_data_write_frame over a lossy main profile link: every frame
+ * whole, every packet in sequence. */
+
+#include "helpers.h"
+
+#define FRAGMENT_SIZE 100
+#define FLOW_ID 0x6000
+#define FRAMES 300
+#define FRAME_MAX 20000
+#define LOSS_PERMILLE 50
+
+// The hand made stream has holes that are never repaired
+static const char *const expected_errors[] = { "Lost ", "Discontinuity", NULL };
+
+static struct rist_ctx *start_receiver(int profile, int port, enum rist_frame_policy policy) {
+	struct rist_ctx *ctx = NULL;
+	char url[256];
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1&buffer=200", port);
+	if (rist_receiver_create(&ctx, profile, logging_settings) != 0)
+		return NULL;
+	if (rist_receiver_frame_reassembly_set(ctx, policy, 0) != 0 || test_add_peer(ctx, url, NULL) != 0 || rist_start(ctx) != 0) {
+		rist_destroy(ctx);
+		return NULL;
+	}
+	return ctx;
+}
+
+/* A fragment or plain packet of len bytes of fill */
+static void send_raw(const struct test_raw_source *src, uint16_t seq, uint8_t frame_flags, uint8_t fill, size_t len) {
+	uint8_t payload[FRAGMENT_SIZE];
+	memset(payload, fill, len);
+	test_raw_send(src, seq, seq * 90, frame_flags, payload, len);
+}
+
+struct expected {
+	size_t size;
+	uint8_t fill;
+	bool incomplete;
+};
+
+static int test_raw(int port, enum rist_frame_policy policy) {
+	struct rist_ctx *receiver_ctx = start_receiver(RIST_PROFILE_SIMPLE, port, policy);
+	if (!receiver_ctx)
+		return 99;
+	struct test_raw_source src;
+	if (test_raw_source_open(&src, port, FLOW_ID) != 0) {
+		rist_destroy(receiver_ctx);
+		return 99;
+	}
+
+	const uint8_t frag = RIST_RTP_EXT_FRAGMENT;
+	const uint8_t first = frag | RIST_RTP_EXT_FRAGMENT_FIRST;
+	const uint8_t last = frag | RIST_RTP_EXT_FRAGMENT_LAST;
+	uint16_t seq = 0;
+	struct rist_data_block *b = NULL;
+	// plain packets until the flow is up and one comes out
+	time_t end = time(NULL) + 5;
+	while (!b && time(NULL) < end) {
+		send_raw(&src, seq++, 0, 0xa0, 50);
+		if (rist_receiver_data_read2(receiver_ctx, &b, 20) <= 0)
+			b = NULL;
+	}
+	if (!b) {
+		fprintf(stdout, "The flow did not come up\n");
+		atomic_store(&failed, 1);
+		goto out;
+	}
+	rist_receiver_data_block_free2(&b);
+	// complete frame
+	send_raw(&src, seq++, first, 1, FRAGMENT_SIZE);
+	send_raw(&src, seq++, frag, 1, FRAGMENT_SIZE);
+	send_raw(&src, seq++, frag, 1, FRAGMENT_SIZE);
+	send_raw(&src, seq++, last, 1, FRAGMENT_SIZE);
+	// lost in the middle
+	send_raw(&src, seq++, first, 2, FRAGMENT_SIZE);
+	seq++;
+	send_raw(&src, seq++, frag, 2, FRAGMENT_SIZE);
+	send_raw(&src, seq++, last, 2, FRAGMENT_SIZE);
+	send_raw(&src, seq++, 0, 0xb0, 50);
+	send_raw(&src, seq++, first, 3, FRAGMENT_SIZE);
+	send_raw(&src, seq++, last, 3, FRAGMENT_SIZE);
+	// the tail never comes, neither does anything else
+	send_raw(&src, seq++, first, 4, FRAGMENT_SIZE);
+	send_raw(&src, seq++, frag, 4, FRAGMENT_SIZE);
+
+	bool deliver = policy == RIST_FRAME_POLICY_DELIVER_INCOMPLETE;
+	struct expected expected[] = {
+		{ 4 * FRAGMENT_SIZE, 1, false },
+		{ 3 * FRAGMENT_SIZE, 2, true },
+		{ 50, 0xb0, false },
+		{ 2 * FRAGMENT_SIZE, 3, false },
+		{ 2 * FRAGMENT_SIZE, 4, true },
+	};
+	size_t count = sizeof(expected) / sizeof(expected[0]);
+	size_t next = 0;
+	// the last frame is only let go when its buffer time is up
+	end = time(NULL) + 5;
+	for (;;) {
+		while (next < count && expected[next].incomplete && !deliver)
+			next++;
+		if (next >= count || time(NULL) >= end)
+			break;
+		if (rist_receiver_data_read2(receiver_ctx, &b, 100) <= 0 || !b)
+			continue;
+		const uint8_t *p = b->payload;
+		bool incomplete = b->flags & RIST_DATA_FLAGS_INCOMPLETE_FRAME;
+		fprintf(stdout, "Block of %zu bytes, fill %02x%s\n", b->payload_len, p[0], incomplete ? ", incomplete" : "");
+		if (next == 0 && b->payload_len == 50 && p[0] == 0xa0) {
+			// the rest of the setup packets
+			rist_receiver_data_block_free2(&b);
+			continue;
+		}
+		if (b->payload_len != expected[next].size || p[0] != expected[next].fill ||
+			p[b->payload_len - 1] != expected[next].fill || incomplete != expected[next].incomplete) {
+			fprintf(stdout, "Unexpected block\n");
+			atomic_store(&failed, 1);
+		}
+		next++;
+		rist_receiver_data_block_free2(&b);
+	}
+	if (next != count) {
+		fprintf(stdout, "Got %zu of %zu blocks\n", next, count);
+		atomic_store(&failed, 1);
+	}
+out:
+	test_raw_source_close(&src);
+	rist_destroy(receiver_ctx);
+	return 0;
+}
+
+static size_t frame_size(int i) {
+	return 1 + (size_t)i * 7919 % FRAME_MAX;
+}
+
+static uint8_t frame_byte(int i, size_t offset) {
+	return (uint8_t)(i * 31 + offset);
+}
+
+/* A frame and a plain packet each round, once all frames are out the plain
+ * packets keep going so that a lost tail is noticed and repaired */
+static PTHREAD_START_FUNC(send_frames, arg) {
+	struct rist_ctx *ctx = arg;
+	static uint8_t frame[FRAME_MAX];
+	struct rist_data_block data = { 0 };
+	for (int i = 0; !atomic_load(&stop); i++) {
+		if (i < FRAMES) {
+			size_t size = frame_size(i);
+			for (size_t j = 0; j < size; j++)
+				frame[j] = frame_byte(i, j);
+			data.payload = frame;
+			data.payload_len = size;
+			if (rist_sender_data_write_frame(ctx, &data, 0) != (int)size) {
+				atomic_store(&failed, 1);
+				break;
+			}
+		}
+		char buffer[64] = { 0 };
+		snprintf(buffer, sizeof(buffer), "PACKET #%i", i);
+		data.payload = buffer;
+		data.payload_len = sizeof(buffer);
+		if (rist_sender_data_write(ctx, &data) != (int)data.payload_len) {
+			atomic_store(&failed, 1);
+			break;
+		}
+		usleep(2000);
+	}
+	return 0;
+}
+
+static int test_write(int port, enum rist_frame_policy policy) {
+	struct rist_ctx *receiver_ctx = start_receiver(RIST_PROFILE_MAIN, port, policy);
+	struct rist_ctx *sender_ctx = NULL;
+	char url[256];
+	int ret = 0;
+	if (!receiver_ctx)
+		return 99;
+	snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+	if (rist_sender_create(&sender_ctx, RIST_PROFILE_MAIN, FLOW_ID, logging_settings) != 0 || test_add_peer(sender_ctx, url, NULL) != 0) {
+		ret = 99;
+		goto out;
+	}
+	sender_ctx->sender_ctx->simulate_loss = true;
+	sender_ctx->sender_ctx->loss_percentage = LOSS_PERMILLE;
+	if (rist_start(sender_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	// the first frame must not go out before the flow is up
+	struct rist_data_block *b = NULL;
+	time_t end = time(NULL) + 5;
+	while (!b && time(NULL) < end) {
+		char warmup[64] = "WARMUP";
+		struct rist_data_block data = { .payload = warmup, .payload_len = sizeof(warmup) };
+		if (rist_sender_data_write(sender_ctx, &data) != (int)data.payload_len ||
+			rist_receiver_data_read2(receiver_ctx, &b, 20) <= 0)
+			b = NULL;
+	}
+	if (!b) {
+		fprintf(stdout, "The flow did not come up\n");
+		atomic_store(&failed, 1);
+		goto out;
+	}
+	rist_receiver_data_block_free2(&b);
+	pthread_t send_loop;
+	if (pthread_create(&send_loop, NULL, send_frames, sender_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	int frames = 0;
+	int packets = 0;
+	int next_frame = 0;
+	int next_packet = 0;
+	end = time(NULL) + 5;
+	while (time(NULL) < end && next_frame < FRAMES) {
+		if (rist_receiver_data_read2(receiver_ctx, &b, 100) <= 0 || !b)
+			continue;
+		const uint8_t *p = b->payload;
+		if (b->payload_len == 64 && strcmp(b->payload, "WARMUP") == 0) {
+			rist_receiver_data_block_free2(&b);
+			continue;
+		}
+		int seq = -1;
+		if (b->flags & (RIST_DATA_FLAGS_DISCONTINUITY | RIST_DATA_FLAGS_INCOMPLETE_FRAME)) {
+			fprintf(stdout, "Block of %zu bytes with flags %x\n", b->payload_len, b->flags);
+			atomic_store(&failed, 1);
+		}
+		if (b->payload_len == 64 && sscanf(b->payload, "PACKET #%d", &seq) == 1) {
+			// every plain packet follows its frame
+			if (seq != next_packet || (seq < FRAMES && next_frame != seq + 1)) {
+				fprintf(stdout, "Packet %d out of order\n", seq);
+				atomic_store(&failed, 1);
+			}
+			next_packet = seq + 1;
+			packets++;
+		} else {
+			bool ok = next_frame < FRAMES && b->payload_len == frame_size(next_frame);
+			for (size_t j = 0; ok && j < b->payload_len; j++)
+				ok = p[j] == frame_byte(next_frame, j);
+			if (!ok) {
+				fprintf(stdout, "Frame %d: %zu bytes, not what was sent\n", next_frame, b->payload_len);
+				atomic_store(&failed, 1);
+			}
+			next_frame++;
+			frames++;
+		}
+		rist_receiver_data_block_free2(&b);
+	}
+	atomic_store(&stop, 1);
+	pthread_join(send_loop, NULL);
+	fprintf(stdout, "%d frames and %d packets written through %u permille loss\n", frames, packets, LOSS_PERMILLE);
+	if (frames != FRAMES)
+		atomic_store(&failed, 1);
+out:
+	if (sender_ctx)
+		rist_destroy(sender_ctx);
+	rist_destroy(receiver_ctx);
+	return ret;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3)
+		return 99;
+	enum rist_frame_policy policy = atoi(argv[1]);
+	int port = atoi(argv[2]);
+	int ret = 0;
+
+	if (test_logging_init(RIST_LOG_WARN, expected_errors, NULL, false) != 0)
+		return 99;
+	ret = test_raw(port, policy);
+	if (!ret)
+		ret = test_write(port + 2, policy);
+	if (!ret && atomic_load(&failed))
+		ret = 1;
+	return test_finish(ret);
+}
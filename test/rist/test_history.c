@@ -0,0 +1,202 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* The cold tier of the sender history over a lossy loopback link. Sent
+ * packets move to the store after HOT_MS, so nearly every retransmission is
+ * read back from it and has to come out of the receiver byte for byte:
+ * - memory: anonymous store
+ * - file: file backed store in the working directory
+ * - wrap: anonymous store, the return path of the receiver is cut while more
+ *   than the whole store is sent, the nacks that come in for what the ring
+ *   wrapped over have to be counted as overwritten rather than resent */
+
+#include "helpers.h"
+
+#define FLOW_ID 0x6a00
+#define PACKET_COUNT 2000
+#define LOSS_PERMILLE 100
+#define HOT_MS 1
+/* rounded up to one chunk */
+#define STORE_BYTES 1
+/* twice what the store holds */
+#define WRAP_PACKETS (2 * RIST_HISTORY_STORE_CHUNK / TEST_PAYLOAD_SIZE)
+/* sent after the counted ones, so that a lost last packet is noticed */
+#define TRAILER 50
+#define MAX_PACKETS (PACKET_COUNT + WRAP_PACKETS + PACKET_COUNT + TRAILER)
+
+static const char *const expected_errors[] = { "Lost ", "nack count is too large", NULL };
+
+static atomic_ulong flow_up;
+static atomic_ulong received;
+static atomic_ulong corrupt;
+static atomic_long first;
+static atomic_ulong history_moved;
+static atomic_ulong history_retransmitted;
+static atomic_ulong history_overwritten;
+static atomic_uchar seen[MAX_PACKETS];
+
+/* Text for test_payload_seq, then a pattern over the whole payload */
+static void history_fill(char *payload, size_t len, int index, int i) {
+	int n = snprintf(payload, len, "SENDER %d PACKET #%d", index, i);
+	for (size_t j = (size_t)n + 1; j < len; j++)
+		payload[j] = (char)(i * 13 + j);
+}
+
+static int data_callback(void *arg, struct rist_data_block *b) {
+	(void)arg;
+	char expected[TEST_PAYLOAD_SIZE];
+	int seq = test_payload_seq(b, NULL, NULL);
+	if (seq >= 0 && seq < MAX_PACKETS && !atomic_load(&seen[seq])) {
+		history_fill(expected, sizeof(expected), 0, seq);
+		if (b->payload_len != sizeof(expected) || memcmp(b->payload, expected, sizeof(expected)) != 0) {
+			fprintf(stdout, "Packet %d came back different\n", seq);
+			atomic_fetch_add(&corrupt, 1);
+		}
+		atomic_store(&seen[seq], 1);
+		if (atomic_load(&first) < 0)
+			atomic_store(&first, seq);
+		atomic_fetch_add(&received, 1);
+	}
+	rist_receiver_data_block_free2(&b);
+	return 0;
+}
+
+/* The totals of the context, in the "history" object of every sender peer report */
+static int stats_callback(void *arg, const struct rist_stats *stats) {
+	(void)arg;
+	const char *history = strstr(stats->stats_json, "\"history\":");
+	if (stats->stats_type == RIST_STATS_RECEIVER_FLOW) {
+		atomic_store(&flow_up, 1);
+	} else if (stats->stats_type == RIST_STATS_SENDER_PEER && history) {
+		atomic_store(&history_moved, test_json_count(history, "\"moved\":"));
+		atomic_store(&history_retransmitted, test_json_count(history, "\"retransmitted\":"));
+		atomic_store(&history_overwritten, test_json_count(history, "\"overwritten\":"));
+	}
+	rist_stats_free(stats);
+	return 0;
+}
+
+/* Packets first to last - 1, spaced by interval_us */
+static int write_packets(struct test_sender *s, int first_seq, int last_seq, unsigned interval_us) {
+	for (int i = first_seq; i < last_seq; i++) {
+		if (test_sender_write(s, i) != 0)
+			return -1;
+		usleep(interval_us);
+	}
+	return last_seq;
+}
+
+static bool complete(int from, int to) {
+	for (int i = from; i < to; i++) {
+		if (!atomic_load(&seen[i]))
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3)
+		return 99;
+	const char *dir = NULL;
+	bool wrap = false;
+	if (strcmp(argv[1], "file") == 0)
+		dir = ".";
+	else if (strcmp(argv[1], "wrap") == 0)
+		wrap = true;
+	else if (strcmp(argv[1], "memory") != 0)
+		return 99;
+	int port = atoi(argv[2]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct rist_ctx *sender_ctx = NULL;
+	struct test_sender source = { .fill = history_fill };
+	char url[256];
+
+	atomic_init(&flow_up, 0);
+	atomic_init(&received, 0);
+	atomic_init(&corrupt, 0);
+	atomic_init(&first, -1);
+	atomic_init(&history_moved, 0);
+	atomic_init(&history_retransmitted, 0);
+	atomic_init(&history_overwritten, 0);
+	if (test_logging_init(RIST_LOG_WARN, expected_errors, NULL, false) != 0)
+		return 99;
+	/* With the return path cut the nacks have to keep coming for longer than
+	 * the outage, and the history has to reach back past it */
+	const char *params = wrap ? "rtt-max=100&rtt-min=100&buffer=3000" : "rtt-max=10&rtt-min=1";
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?%s", port, params);
+	if (rist_receiver_create(&receiver_ctx, RIST_PROFILE_MAIN, logging_settings) != 0 ||
+		rist_receiver_data_callback_set2(receiver_ctx, data_callback, NULL) != 0 ||
+		rist_stats_callback_set(receiver_ctx, 100, stats_callback, NULL) != 0 ||
+		test_add_peer(receiver_ctx, url, NULL) != 0 || rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	snprintf(url, sizeof(url), "rist://127.0.0.1:%d?%s", port, params);
+	if (rist_sender_create(&sender_ctx, RIST_PROFILE_MAIN, FLOW_ID, logging_settings) != 0 ||
+		rist_stats_callback_set(sender_ctx, 100, stats_callback, NULL) != 0 ||
+		rist_sender_history_set(sender_ctx, HOT_MS, STORE_BYTES, dir) != 0 ||
+		test_add_peer(sender_ctx, url, NULL) != 0) {
+		ret = 99;
+		goto out;
+	}
+	sender_ctx->sender_ctx->simulate_loss = true;
+	sender_ctx->sender_ctx->loss_percentage = LOSS_PERMILLE;
+	source.ctx = sender_ctx;
+	if (rist_start(sender_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	int seq = 0;
+	int tail = 0;
+	if (!wrap) {
+		seq = write_packets(&source, 0, PACKET_COUNT, 500);
+	} else {
+		time_t end = time(NULL) + 5;
+		while (seq >= 0 && time(NULL) < end && !atomic_load(&flow_up) && seq < PACKET_COUNT)
+			seq = write_packets(&source, seq, seq + 1, 1000);
+		// nothing gets back to the sender while the burst goes through the store
+		receiver_ctx->receiver_ctx->loss_percentage = 1000;
+		receiver_ctx->receiver_ctx->simulate_loss = true;
+		if (seq >= 0)
+			seq = write_packets(&source, seq, seq + WRAP_PACKETS, 50);
+		receiver_ctx->receiver_ctx->simulate_loss = false;
+		tail = seq;
+		if (seq >= 0)
+			seq = write_packets(&source, seq, seq + PACKET_COUNT, 500);
+	}
+	if (seq < 0 || write_packets(&source, seq, seq + TRAILER, 1000) < 0) {
+		ret = 99;
+		goto out;
+	}
+	// the output is a buffer behind, the repairs of the tail too
+	time_t end = time(NULL) + 10;
+	while (time(NULL) < end && (atomic_load(&first) < 0 || !complete((int)atomic_load(&first) > tail ? (int)atomic_load(&first) : tail, seq)))
+		usleep(10000);
+	// the last stats round
+	usleep(300000);
+
+	long from = atomic_load(&first);
+	unsigned long moved = atomic_load(&history_moved);
+	unsigned long retransmitted = atomic_load(&history_retransmitted);
+	unsigned long overwritten = atomic_load(&history_overwritten);
+	fprintf(stdout, "%s: %lu of %d packets from #%ld, %lu corrupt, %lu moved to the store, %lu resent from it, %lu overwritten\n",
+			argv[1], atomic_load(&received), seq + TRAILER, from, atomic_load(&corrupt), moved, retransmitted, overwritten);
+	if (atomic_load(&corrupt) != 0 || from < 0 || from > PACKET_COUNT / 10 || moved == 0 || retransmitted == 0)
+		atomic_store(&failed, 1);
+	// past the outage the stream is repaired as usual
+	else if (!complete(from > tail ? (int)from : tail, seq))
+		atomic_store(&failed, 1);
+	if (wrap ? overwritten == 0 : overwritten != 0)
+		atomic_store(&failed, 1);
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	if (sender_ctx)
+		rist_destroy(sender_ctx);
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
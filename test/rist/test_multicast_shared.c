@@ -0,0 +1,99 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Several multicast groups received on one shared socket. Every group has its
+ * own sender and flow id, each packet must come out on the flow of the group
+ * it was sent to. */
+
+#include "helpers.h"
+
+#define GROUPS 4
+#define PACKET_COUNT 2000
+#define FLOW_ID_BASE 0x2000
+
+int main(int argc, char *argv[]) {
+	if (argc != 3)
+		return 99;
+	int profile = atoi(argv[1]);
+	int port = atoi(argv[2]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct test_sender senders[GROUPS] = { 0 };
+	char url[256];
+
+	if (test_logging_init(RIST_LOG_WARN, NULL, NULL, true) != 0)
+		return 99;
+	if (rist_receiver_create(&receiver_ctx, profile, logging_settings) != 0) {
+		ret = 99;
+		goto out;
+	}
+	for (int g = 0; g < GROUPS; g++) {
+		snprintf(url, sizeof(url), "rist://@239.0.1.%d:%d?rtt-max=10&rtt-min=1&multicast-shared=1", g + 1, port);
+		if (test_add_peer(receiver_ctx, url, NULL) != 0) {
+			ret = 99;
+			goto out;
+		}
+	}
+	if (rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	for (int g = 0; g < GROUPS; g++) {
+		senders[g].tag = "GROUP";
+		senders[g].index = g;
+		senders[g].count = PACKET_COUNT;
+		snprintf(url, sizeof(url), "rist://239.0.1.%d:%d?rtt-max=10&rtt-min=1", g + 1, port);
+		if (rist_sender_create(&senders[g].ctx, profile, FLOW_ID_BASE + 2 * g, logging_settings) != 0 ||
+			test_add_peer(senders[g].ctx, url, NULL) != 0 || rist_start(senders[g].ctx) != 0) {
+			ret = 99;
+			goto out;
+		}
+	}
+	for (int g = 0; g < GROUPS; g++) {
+		if (test_sender_start(&senders[g]) != 0) {
+			ret = 99;
+			goto out;
+		}
+	}
+
+	int received[GROUPS] = { 0 };
+	int total = 0;
+	int idle = 0;
+	struct rist_data_block *b = NULL;
+	while (!atomic_load(&stop) && idle < 5 && total < GROUPS * PACKET_COUNT) {
+		if (rist_receiver_data_read2(receiver_ctx, &b, 1000) <= 0 || !b) {
+			idle++;
+			continue;
+		}
+		idle = 0;
+		int group = -1;
+		test_payload_seq(b, "GROUP", &group);
+		if (group < 0 || group >= GROUPS || b->flow_id != (uint32_t)(FLOW_ID_BASE + 2 * group)) {
+			fprintf(stderr, "Packet %s came out on flow %u\n", (const char *)b->payload, b->flow_id);
+			atomic_store(&failed, 1);
+		} else {
+			received[group]++;
+		}
+		total++;
+		rist_receiver_data_block_free2(&b);
+	}
+	for (int g = 0; g < GROUPS; g++) {
+		test_sender_stop(&senders[g]);
+		fprintf(stdout, "Group %d: %d packets\n", g, received[g]);
+		if (received[g] < PACKET_COUNT * 9 / 10)
+			atomic_store(&failed, 1);
+	}
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	atomic_store(&stop, 1);
+	for (int g = 0; g < GROUPS; g++) {
+		test_sender_stop(&senders[g]);
+		if (senders[g].ctx)
+			rist_destroy(senders[g].ctx);
+	}
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
@@ -0,0 +1,151 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Two flows into one receiver, one of them with heavy loss. With a per flow
+ * nack budget the lossy flow is throttled, its neighbour never is, and both
+ * are still recovered. Without a budget no flow is throttled. */
+
+#include "helpers.h"
+
+#define FLOWS 2
+#define PACKET_COUNT 3000
+#define FLOW_ID_BASE 0x5000
+
+static const uint16_t loss_permille[FLOWS] = { 400, 50 };
+
+atomic_ulong lost;
+atomic_ulong throttled[FLOWS];
+
+// A few packets of the lossy flow may run out of retries
+static bool lost_hook(int level, const char *msg) {
+	if (level > RIST_LOG_ERROR || !strstr(msg, "Lost "))
+		return false;
+	atomic_fetch_add(&lost, 1);
+	return true;
+}
+
+static int expected_total(const int *first) {
+	int total = 0;
+	for (int i = 0; i < FLOWS; i++)
+		total += PACKET_COUNT - (first[i] > 0 ? first[i] : 0);
+	return total;
+}
+
+static int stats_callback(void *arg, const struct rist_stats *stats) {
+	(void)arg;
+	if (stats->stats_type == RIST_STATS_RECEIVER_FLOW) {
+		uint32_t flow_id = stats->stats.receiver_flow.flow_id;
+		unsigned long count = test_json_count(stats->stats_json, "\"nack_throttled\":");
+		for (int i = 0; i < FLOWS; i++) {
+			if (flow_id == (uint32_t)(FLOW_ID_BASE + 2 * i))
+				atomic_fetch_add(&throttled[i], count);
+		}
+	}
+	rist_stats_free(stats);
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 4)
+		return 99;
+	int profile = atoi(argv[1]);
+	int port = atoi(argv[2]);
+	uint32_t budget = (uint32_t)atoi(argv[3]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct test_sender senders[FLOWS] = { 0 };
+	char url[256];
+	static uint8_t seen[FLOWS][PACKET_COUNT];
+
+	atomic_init(&lost, 0);
+	for (int i = 0; i < FLOWS; i++)
+		atomic_init(&throttled[i], 0);
+
+	if (test_logging_init(RIST_LOG_WARN, NULL, lost_hook, true) != 0)
+		return 99;
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+	if (rist_receiver_create(&receiver_ctx, profile, logging_settings) != 0 ||
+		rist_receiver_flow_nack_budget_set(receiver_ctx, budget) != 0 ||
+		rist_stats_callback_set(receiver_ctx, 100, stats_callback, NULL) != 0 ||
+		test_add_peer(receiver_ctx, url, NULL) != 0 || rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	for (int i = 0; i < FLOWS; i++) {
+		senders[i].tag = "FLOW";
+		senders[i].index = i;
+		snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+		if (rist_sender_create(&senders[i].ctx, profile, FLOW_ID_BASE + 2 * i, logging_settings) != 0 ||
+			test_add_peer(senders[i].ctx, url, NULL) != 0) {
+			ret = 99;
+			goto out;
+		}
+		senders[i].ctx->sender_ctx->simulate_loss = true;
+		senders[i].ctx->sender_ctx->loss_percentage = loss_permille[i];
+		if (rist_start(senders[i].ctx) != 0) {
+			ret = 99;
+			goto out;
+		}
+	}
+	for (int i = 0; i < FLOWS; i++) {
+		// Keeps going past PACKET_COUNT, so that a lost tail is noticed and repaired
+		if (test_sender_start(&senders[i]) != 0) {
+			ret = 99;
+			goto out;
+		}
+	}
+
+	int received[FLOWS] = { 0 };
+	// what goes before the receiver knows the flow can't be asked for
+	int first[FLOWS] = { -1, -1 };
+	int total = 0;
+	struct rist_data_block *b = NULL;
+	time_t end = time(NULL) + PACKET_COUNT / 1000 + 5;
+	while (!atomic_load(&stop) && time(NULL) < end && total < expected_total(first)) {
+		if (rist_receiver_data_read2(receiver_ctx, &b, 100) <= 0 || !b)
+			continue;
+		int index = -1;
+		int seq = test_payload_seq(b, "FLOW", &index);
+		if (index < 0 || index >= FLOWS || seq < 0 || b->flow_id != (uint32_t)(FLOW_ID_BASE + 2 * index)) {
+			fprintf(stderr, "Packet %s came out on flow %u\n", (const char *)b->payload, b->flow_id);
+			atomic_store(&failed, 1);
+		} else if (seq < PACKET_COUNT && !seen[index][seq]) {
+			if (first[index] < 0)
+				first[index] = seq;
+			seen[index][seq] = 1;
+			received[index]++;
+			total++;
+		}
+		rist_receiver_data_block_free2(&b);
+	}
+	atomic_store(&stop, 1);
+	// the last stats round
+	usleep(200000);
+	for (int i = 0; i < FLOWS; i++) {
+		test_sender_stop(&senders[i]);
+		fprintf(stdout, "Flow %d, %u permille loss: %d packets from #%d, throttled %lu times\n", i, loss_permille[i],
+			received[i], first[i], atomic_load(&throttled[i]));
+	}
+	fprintf(stdout, "%lu loss reports\n", atomic_load(&lost));
+	// the clean flow is complete, the lossy one (nearly) so
+	if (first[1] < 0 || first[1] > PACKET_COUNT / 10 || received[1] != PACKET_COUNT - first[1] ||
+		received[0] < PACKET_COUNT * 99 / 100)
+		atomic_store(&failed, 1);
+	if (budget && (atomic_load(&throttled[0]) == 0 || atomic_load(&throttled[1]) != 0))
+		atomic_store(&failed, 1);
+	if (!budget && (atomic_load(&throttled[0]) != 0 || atomic_load(&throttled[1]) != 0))
+		atomic_store(&failed, 1);
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	atomic_store(&stop, 1);
+	for (int i = 0; i < FLOWS; i++) {
+		test_sender_stop(&senders[i]);
+		if (senders[i].ctx)
+			rist_destroy(senders[i].ctx);
+	}
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
@@ -0,0 +1,216 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Out-of-band data written in a burst next to a main profile stream, the
+ * receiver checks every block byte for byte:
+ * - paced: rist_oob_bandwidth_set with a deadline, what goes out stays under
+ *   the rate and what can't make the deadline is dropped and counted in the
+ *   "oob" stats, nothing else is lost
+ * - unpaced: the whole burst goes through as it is
+ * Either way a last burst is still queued when the sender is destroyed, the
+ * sent and the queued blocks have to be freed once (run it under ASan). */
+
+#include "helpers.h"
+
+#define FLOW_ID 0x6800
+#define OOB_SIZE 1000
+/* what the sending side takes off the front of every oob payload, the size
+ * of the reduced GRE header it frames data with */
+#define OOB_SKIP 4
+#define OOB_WIRE_SIZE (OOB_SIZE - OOB_SKIP)
+#define OOB_BURST 200
+#define RATE_KBPS 800
+#define DEADLINE_MS 1000
+
+static atomic_ulong media_received;
+static atomic_ulong oob_received;
+static atomic_ulong oob_corrupt;
+static atomic_ulong oob_first_ms;
+static atomic_ulong oob_last_ms;
+static atomic_ulong stats_sent;
+static atomic_ulong stats_dropped;
+static atomic_ulong stats_queued;
+static atomic_ulong stats_seen;
+
+static uint64_t now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void oob_fill(uint8_t *payload, uint32_t i) {
+	memset(payload, 0, OOB_SKIP);
+	memcpy(&payload[OOB_SKIP], &i, sizeof(i));
+	for (size_t j = OOB_SKIP + sizeof(i); j < OOB_SIZE; j++)
+		payload[j] = (uint8_t)(i * 7 + j);
+}
+
+static int oob_callback(void *arg, const struct rist_oob_block *oob_block) {
+	(void)arg;
+	uint8_t expected[OOB_SIZE];
+	uint32_t i;
+	if (oob_block->payload_len != OOB_WIRE_SIZE) {
+		atomic_fetch_add(&oob_corrupt, 1);
+		return 0;
+	}
+	memcpy(&i, oob_block->payload, sizeof(i));
+	oob_fill(expected, i);
+	if (memcmp(oob_block->payload, &expected[OOB_SKIP], OOB_WIRE_SIZE) != 0) {
+		atomic_fetch_add(&oob_corrupt, 1);
+		return 0;
+	}
+	uint64_t now = now_ms();
+	if (atomic_fetch_add(&oob_received, 1) == 0)
+		atomic_store(&oob_first_ms, now);
+	atomic_store(&oob_last_ms, now);
+	return 0;
+}
+
+static int data_callback(void *arg, struct rist_data_block *b) {
+	(void)arg;
+	atomic_fetch_add(&media_received, 1);
+	rist_receiver_data_block_free2(&b);
+	return 0;
+}
+
+/* The totals of the context, in the "oob" object of every sender peer report */
+static int stats_callback(void *arg, const struct rist_stats *stats) {
+	(void)arg;
+	const char *oob = strstr(stats->stats_json, "\"oob\":");
+	if (stats->stats_type == RIST_STATS_SENDER_PEER && oob) {
+		atomic_store(&stats_sent, test_json_count(oob, "\"sent\":"));
+		atomic_store(&stats_dropped, test_json_count(oob, "\"dropped\":"));
+		atomic_store(&stats_queued, test_json_count(oob, "\"queued\":"));
+		atomic_fetch_add(&stats_seen, 1);
+	}
+	rist_stats_free(stats);
+	return 0;
+}
+
+static int oob_burst(struct rist_ctx *ctx, struct rist_peer *peer, uint32_t first, int count) {
+	uint8_t payload[OOB_SIZE];
+	struct rist_oob_block oob_block = { .peer = peer, .payload = payload, .payload_len = OOB_SIZE };
+	for (int i = 0; i < count; i++) {
+		oob_fill(payload, first + (uint32_t)i);
+		if (rist_oob_write(ctx, &oob_block) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/* Until the stats have caught up with everything written */
+static void wait_for_stats(int seconds) {
+	time_t end = time(NULL) + seconds;
+	unsigned long seen = atomic_load(&stats_seen);
+	while (time(NULL) < end && (atomic_load(&stats_seen) < seen + 2 ||
+			atomic_load(&stats_sent) + atomic_load(&stats_dropped) < OOB_BURST || atomic_load(&stats_queued) != 0))
+		usleep(10000);
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3)
+		return 99;
+	bool paced;
+	if (strcmp(argv[1], "paced") == 0)
+		paced = true;
+	else if (strcmp(argv[1], "unpaced") == 0)
+		paced = false;
+	else
+		return 99;
+	int port = atoi(argv[2]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct rist_ctx *sender_ctx = NULL;
+	struct test_sender media = { 0 };
+	char url[256];
+
+	atomic_init(&media_received, 0);
+	atomic_init(&oob_received, 0);
+	atomic_init(&oob_corrupt, 0);
+	atomic_init(&oob_first_ms, 0);
+	atomic_init(&oob_last_ms, 0);
+	atomic_init(&stats_sent, 0);
+	atomic_init(&stats_dropped, 0);
+	atomic_init(&stats_queued, 0);
+	atomic_init(&stats_seen, 0);
+	if (test_logging_init(RIST_LOG_WARN, NULL, NULL, false) != 0)
+		return 99;
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+	if (rist_receiver_create(&receiver_ctx, RIST_PROFILE_MAIN, logging_settings) != 0 ||
+		rist_oob_callback_set(receiver_ctx, oob_callback, NULL) != 0 ||
+		rist_receiver_data_callback_set2(receiver_ctx, data_callback, NULL) != 0 ||
+		test_add_peer(receiver_ctx, url, NULL) != 0 || rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+	struct rist_peer *peer = NULL;
+	if (rist_sender_create(&sender_ctx, RIST_PROFILE_MAIN, FLOW_ID, logging_settings) != 0 ||
+		rist_oob_callback_set(sender_ctx, NULL, NULL) != 0 ||
+		rist_stats_callback_set(sender_ctx, 100, stats_callback, NULL) != 0 ||
+		(paced && rist_oob_bandwidth_set(sender_ctx, RATE_KBPS, DEADLINE_MS) != 0) ||
+		test_add_peer(sender_ctx, url, &peer) != 0 || rist_start(sender_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	media.ctx = sender_ctx;
+	if (test_sender_start(&media) != 0) {
+		ret = 99;
+		goto out;
+	}
+	// no oob before the session is up
+	time_t end = time(NULL) + 5;
+	while (time(NULL) < end && atomic_load(&media_received) == 0)
+		usleep(1000);
+	if (atomic_load(&media_received) == 0) {
+		fprintf(stdout, "The flow did not come up\n");
+		ret = 1;
+		goto out;
+	}
+
+	if (oob_burst(sender_ctx, peer, 0, OOB_BURST) != 0) {
+		ret = 99;
+		goto out;
+	}
+	wait_for_stats(DEADLINE_MS / 1000 + 5);
+	// what was sent is on its way over the loopback
+	usleep(100000);
+
+	unsigned long received = atomic_load(&oob_received);
+	unsigned long corrupt = atomic_load(&oob_corrupt);
+	unsigned long sent = atomic_load(&stats_sent);
+	unsigned long dropped = atomic_load(&stats_dropped);
+	unsigned long queued = atomic_load(&stats_queued);
+	uint64_t elapsed = atomic_load(&oob_last_ms) - atomic_load(&oob_first_ms);
+	fprintf(stdout, "%s: %lu of %d oob blocks received over %" PRIu64 " ms, %lu corrupt, %lu sent, %lu dropped, %lu queued\n",
+			argv[1], received, OOB_BURST, elapsed, corrupt, sent, dropped, queued);
+	if (corrupt != 0 || queued != 0 || received != sent || sent + dropped != OOB_BURST)
+		atomic_store(&failed, 1);
+	if (paced) {
+		// the first block opens the window with a full bucket, which a block may
+		// overdraw, with a few ms of scheduling on either side
+		uint64_t bound = (uint64_t)RATE_KBPS * 1000 / 8 * (elapsed + 10) / 1000 + RIST_OOB_SCHED_MIN_BURST + 2 * OOB_SIZE;
+		fprintf(stdout, "%lu bytes within %" PRIu64 " bytes at the rate\n", received * OOB_SIZE, bound);
+		// the burst is twice what the rate lets through by the deadline
+		if (received * OOB_SIZE > bound || dropped == 0 || received < OOB_BURST / 4)
+			atomic_store(&failed, 1);
+	} else if (received != OOB_BURST || dropped != 0) {
+		atomic_store(&failed, 1);
+	}
+
+	// left in the queue for rist_destroy
+	if (oob_burst(sender_ctx, peer, OOB_BURST, OOB_BURST / 4) != 0) {
+		ret = 99;
+		goto out;
+	}
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	test_sender_stop(&media);
+	if (sender_ctx)
+		rist_destroy(sender_ctx);
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
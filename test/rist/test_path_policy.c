@@ -0,0 +1,279 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Path policy hooks (RIST_OPT_PATH_POLICY):
+ * - admit: on the sender select_data drops one packet in a hundred, the
+ *   receiver nacks them and admit_retransmit lets the repairs through, the
+ *   flow comes through complete
+ * - refuse: the same with admit_retransmit refusing those repairs, exactly
+ *   the dropped packets are missing
+ * - nack: a receiver with two paths and loss on both, select_nack_path sends
+ *   every nack over the second path, only that path carries retransmissions
+ * In all of them path_attach hands out the state, path_update sees it and
+ * path_detach gets every attached path back. */
+
+#include "helpers.h"
+
+#define PACKET_COUNT 3000
+#define DROP_RESIDUE 7
+#define FLOW_ID 0x6600
+#define PATHS 2
+
+static const char *const expected_errors[] = { "Lost ", NULL };
+
+atomic_ulong attached;
+atomic_ulong detached;
+atomic_ulong updates;
+atomic_ulong data_calls;
+atomic_ulong dropped;
+atomic_ulong admit_calls;
+atomic_ulong nack_calls;
+atomic_ulong retransmitted[PATHS];
+uint32_t peer_ids[PATHS];
+
+struct policy {
+	bool refuse;
+	/* listening peer of the receiver the nacks have to go out on */
+	struct rist_peer *nack_parent;
+};
+
+static int path_state;
+
+static void fail(const char *msg) {
+	fprintf(stdout, "%s\n", msg);
+	atomic_store(&failed, 1);
+}
+
+static void *path_attach(void *arg, const struct rist_path *path) {
+	(void)arg;
+	if (!path->peer || path->state)
+		fail("path_attach got a path without peer or already attached");
+	atomic_fetch_add(&attached, 1);
+	return &path_state;
+}
+
+static void path_detach(void *arg, const struct rist_path *path) {
+	(void)arg;
+	if (path->state != &path_state)
+		fail("path_detach got a path without its state");
+	atomic_fetch_add(&detached, 1);
+}
+
+static void path_update(void *arg, const struct rist_path *path) {
+	(void)arg;
+	if (path->state != &path_state || path->loss_permille > 1000)
+		fail("path_update got a path without its state or with a bad loss figure");
+	atomic_fetch_add(&updates, 1);
+}
+
+static void select_data(void *arg, const struct rist_path *const *paths, size_t count, uint32_t seq, bool *send) {
+	(void)arg;
+	(void)paths;
+	atomic_fetch_add(&data_calls, 1);
+	if ((uint16_t)seq % 100 == DROP_RESIDUE) {
+		atomic_fetch_add(&dropped, 1);
+		return;
+	}
+	for (size_t i = 0; i < count; i++)
+		send[i] = true;
+}
+
+static bool admit_retransmit(void *arg, const struct rist_path *path, uint32_t seq, uint32_t transmit_count, uint32_t age_ms, bool admit) {
+	struct policy *p = arg;
+	(void)path;
+	(void)transmit_count;
+	(void)age_ms;
+	atomic_fetch_add(&admit_calls, 1);
+	if (p->refuse && (uint16_t)seq % 100 == DROP_RESIDUE)
+		return false;
+	return admit;
+}
+
+static size_t select_nack_path(void *arg, const struct rist_path *const *paths, size_t count, uint32_t flow_id, size_t builtin) {
+	struct policy *p = arg;
+	atomic_fetch_add(&nack_calls, 1);
+	if (count == 0 || builtin > count || flow_id != FLOW_ID)
+		fail("select_nack_path got no paths, a builtin index out of range or another flow");
+	for (size_t i = 0; i < count; i++) {
+		if (paths[i]->peer->parent == p->nack_parent)
+			return i;
+	}
+	return count;
+}
+
+static int stats_callback(void *arg, const struct rist_stats *stats) {
+	(void)arg;
+	if (stats->stats_type == RIST_STATS_SENDER_PEER) {
+		for (int i = 0; i < PATHS; i++) {
+			if (stats->stats.sender_peer.peer_id == peer_ids[i])
+				atomic_fetch_add(&retransmitted[i], stats->stats.sender_peer.retransmitted);
+		}
+	}
+	rist_stats_free(stats);
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3)
+		return 99;
+	const char *mode = argv[1];
+	int port = atoi(argv[2]);
+	bool nack = strcmp(mode, "nack") == 0;
+	if (!nack && strcmp(mode, "admit") && strcmp(mode, "refuse"))
+		return 99;
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct rist_ctx *sender_ctx = NULL;
+	struct test_sender sender = { 0 };
+	struct rist_peer *peer = NULL;
+	struct policy policy = { .refuse = strcmp(mode, "refuse") == 0 };
+	rist_path_policy_t hooks = {
+		.path_attach = path_attach,
+		.path_detach = path_detach,
+		.path_update = path_update,
+		.select_data = nack ? NULL : select_data,
+		.admit_retransmit = nack ? NULL : admit_retransmit,
+		.select_nack_path = nack ? select_nack_path : NULL,
+	};
+	int paths = nack ? PATHS : 1;
+	char url[256];
+	static uint8_t seen[PACKET_COUNT];
+
+	atomic_init(&attached, 0);
+	atomic_init(&detached, 0);
+	atomic_init(&updates, 0);
+	atomic_init(&data_calls, 0);
+	atomic_init(&dropped, 0);
+	atomic_init(&admit_calls, 0);
+	atomic_init(&nack_calls, 0);
+	for (int i = 0; i < PATHS; i++)
+		atomic_init(&retransmitted[i], 0);
+
+	if (test_logging_init(RIST_LOG_WARN, expected_errors, NULL, false) != 0)
+		return 99;
+	if (rist_receiver_create(&receiver_ctx, RIST_PROFILE_MAIN, logging_settings) != 0 ||
+		(nack && rist_set_opt(receiver_ctx, RIST_OPT_PATH_POLICY, &hooks, &policy, NULL) != 0)) {
+		ret = 99;
+		goto out;
+	}
+	for (int i = 0; i < paths; i++) {
+		snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1&buffer=1000", port + 2 * i);
+		if (test_add_peer(receiver_ctx, url, &peer) != 0) {
+			ret = 99;
+			goto out;
+		}
+		policy.nack_parent = peer;
+	}
+	if (rist_start(receiver_ctx) != 0 ||
+		rist_sender_create(&sender_ctx, RIST_PROFILE_MAIN, FLOW_ID, logging_settings) != 0 ||
+		rist_stats_callback_set(sender_ctx, 100, stats_callback, NULL) != 0 ||
+		(!nack && rist_set_opt(sender_ctx, RIST_OPT_PATH_POLICY, &hooks, &policy, NULL) != 0)) {
+		ret = 99;
+		goto out;
+	}
+	for (int i = 0; i < paths; i++) {
+		snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1&buffer=1000", port + 2 * i);
+		if (test_add_peer(sender_ctx, url, &peer) != 0) {
+			ret = 99;
+			goto out;
+		}
+		peer_ids[i] = peer->adv_peer_id;
+	}
+	// the paths lose data independently, a packet lost on both has to be nacked
+	if (nack) {
+		sender_ctx->sender_ctx->simulate_loss = true;
+		sender_ctx->sender_ctx->loss_percentage = 200;
+	}
+	if (rist_start(sender_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	// Keeps going past PACKET_COUNT, so that a lost tail is noticed and repaired
+	sender.ctx = sender_ctx;
+	if (test_sender_start(&sender) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	// packets sent before the first one that arrives do not belong to the flow
+	int first = -1;
+	int received = 0;
+	struct rist_data_block *b = NULL;
+	time_t end = time(NULL) + PACKET_COUNT / 1000 + 5;
+	time_t tail_end = 0;
+	while (time(NULL) < end && (tail_end == 0 || time(NULL) < tail_end)) {
+		if (first >= 0 && received == PACKET_COUNT - first)
+			break;
+		if (rist_receiver_data_read2(receiver_ctx, &b, 100) <= 0 || !b)
+			continue;
+		int seq = test_payload_seq(b, NULL, NULL);
+		if (seq >= 0 && seq < PACKET_COUNT && !seen[seq]) {
+			if (first < 0)
+				first = seq;
+			seen[seq] = 1;
+			received++;
+			// repairs still due come within the buffer after the last packet
+			if (seq == PACKET_COUNT - 1)
+				tail_end = time(NULL) + 2;
+		}
+		rist_receiver_data_block_free2(&b);
+	}
+	// the last stats round
+	usleep(200000);
+	atomic_store(&stop, 1);
+	test_sender_stop(&sender);
+
+	int missing = 0;
+	int missing_other = 0;
+	int residue = -1;
+	for (int i = first < 0 ? PACKET_COUNT : first; i < PACKET_COUNT; i++) {
+		if (seen[i])
+			continue;
+		missing++;
+		if (residue < 0)
+			residue = i % 100;
+		else if (i % 100 != residue)
+			missing_other++;
+	}
+	int expected_missing = 0;
+	for (int i = first < 0 ? PACKET_COUNT : first; residue >= 0 && i < PACKET_COUNT; i++) {
+		if (i % 100 == residue)
+			expected_missing++;
+	}
+	fprintf(stdout, "%s: %d of %d packets (from #%d), %d missing, %lu attached, %lu detached, %lu updates, "
+		"%lu select_data (%lu dropped), %lu admit_retransmit, %lu select_nack_path\n",
+		mode, received, PACKET_COUNT - first, first, missing, atomic_load(&attached), atomic_load(&detached),
+		atomic_load(&updates), atomic_load(&data_calls), atomic_load(&dropped), atomic_load(&admit_calls),
+		atomic_load(&nack_calls));
+	if (first < 0 || atomic_load(&attached) == 0 || atomic_load(&updates) == 0)
+		atomic_store(&failed, 1);
+	if (strcmp(mode, "admit") == 0 &&
+		(missing || atomic_load(&dropped) == 0 || atomic_load(&admit_calls) == 0))
+		atomic_store(&failed, 1);
+	if (policy.refuse &&
+		(missing == 0 || missing_other || missing != expected_missing || atomic_load(&admit_calls) == 0))
+		atomic_store(&failed, 1);
+	if (nack) {
+		fprintf(stdout, "retransmitted %lu on the first path, %lu on the second\n",
+			atomic_load(&retransmitted[0]), atomic_load(&retransmitted[1]));
+		if (received < (PACKET_COUNT - first) * 99 / 100 || atomic_load(&nack_calls) == 0 ||
+			atomic_load(&retransmitted[0]) != 0 || atomic_load(&retransmitted[1]) == 0)
+			atomic_store(&failed, 1);
+	}
+out:
+	atomic_store(&stop, 1);
+	test_sender_stop(&sender);
+	if (sender_ctx)
+		rist_destroy(sender_ctx);
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	// all paths are detached once the contexts are gone
+	if (ret == 0 && atomic_load(&detached) != atomic_load(&attached)) {
+		fprintf(stdout, "%lu paths attached, %lu detached\n", atomic_load(&attached), atomic_load(&detached));
+		ret = 1;
+	}
+	if (ret == 0 && atomic_load(&failed))
+		ret = 1;
+	return test_finish(ret);
+}
@@ -0,0 +1,79 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Simple profile data from many source ports that never send RTCP. Every
+ * source becomes a peer that is waiting for its handshake, the data they park
+ * must stay under the receiver wide cap and be freed once it is too old. */
+
+#include "helpers.h"
+
+#define SOURCES 48
+#define PACKETS_PER_SOURCE 512
+
+int main(int argc, char *argv[]) {
+	if (argc != 3)
+		return 99;
+	const char *url = argv[1];
+	int port = atoi(argv[2]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+
+	if (test_logging_init(RIST_LOG_WARN, NULL, NULL, false) != 0)
+		return 99;
+	if (rist_receiver_create(&receiver_ctx, RIST_PROFILE_SIMPLE, logging_settings) != 0 ||
+		test_add_peer(receiver_ctx, url, NULL) != 0 || rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	struct rist_receiver *ctx = receiver_ctx->receiver_ctx;
+
+	struct sockaddr_in addr = { 0 };
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((uint16_t)port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	uint8_t packet[sizeof(struct rist_rtp_hdr) + TEST_PAYLOAD_SIZE] = { 0 };
+	struct rist_rtp_hdr *rtp = (struct rist_rtp_hdr *)packet;
+	rtp->flags = 0x80;
+	rtp->payload_type = 33;
+	size_t parked_max = 0;
+	size_t parked_bytes_max = 0;
+	for (int s = 0; s < SOURCES; s++) {
+		int fd = socket(AF_INET, SOCK_DGRAM, 0);
+		if (fd < 0) {
+			ret = 99;
+			goto out;
+		}
+		rtp->ssrc = htonl(0x1000 + 2 * s);
+		for (int i = 0; i < PACKETS_PER_SOURCE; i++) {
+			rtp->seq = htons((uint16_t)i);
+			rtp->ts = htonl(i * 90);
+			sendto(fd, packet, sizeof(packet), 0, (struct sockaddr *)&addr, sizeof(addr));
+			if (i % 64 == 63)
+				usleep(1000);
+		}
+		close(fd);
+		size_t parked = atomic_load(&ctx->preauth_buffers);
+		size_t parked_bytes = atomic_load(&ctx->preauth_bytes);
+		if (parked > parked_max)
+			parked_max = parked;
+		if (parked_bytes > parked_bytes_max)
+			parked_bytes_max = parked_bytes;
+	}
+	fprintf(stdout, "Parked at most %zu packets, %zu bytes\n", parked_max, parked_bytes_max);
+	if (parked_max == 0 || parked_max > RIST_PREAUTH_CTX_MAX_BUFFERS || parked_bytes_max > RIST_PREAUTH_CTX_MAX_BYTES)
+		atomic_store(&failed, 1);
+
+	// Nothing authenticates, the queues go once their data is older than the buffer
+	for (int i = 0; i < 50 && atomic_load(&ctx->preauth_buffers) > 0; i++)
+		usleep(100000);
+	fprintf(stdout, "%zu packets, %zu bytes left after expiry\n", atomic_load(&ctx->preauth_buffers), atomic_load(&ctx->preauth_bytes));
+	if (atomic_load(&ctx->preauth_buffers) != 0 || atomic_load(&ctx->preauth_bytes) != 0)
+		atomic_store(&failed, 1);
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
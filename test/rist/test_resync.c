@@ -0,0 +1,200 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Discontinuity detection on a raw simple profile stream. A first run of
+ * packets fills the buffer, then the stream continues in a new space:
+ * - marker: the sequence restarts with the sender restart marker set
+ * - restart: the sequence restarts, the source time goes on
+ * - jump: the sequence goes on, the source clock jumps 10 s ahead
+ * - back: the sequence goes on, the source clock jumps 10 s back
+ * With flush the buffered tail of the first run is dropped, with drain it is
+ * output before the new space, which has to come through in both cases.
+ * Disabled (the default) never rebases the flow. */
+
+#include "helpers.h"
+#include "proto/rist_time.h"
+
+#define FLOW_ID 0x6100
+#define FIRST_COUNT 1200
+#define SECOND_COUNT 400
+#define PAYLOAD_SIZE 100
+#define TS_BASE (90000 * 100)
+
+// without detection the new space is taken for late data and loss for a while
+static const char *const expected_errors[] = { "Lost ", "Discontinuity", "Too many old packets", "stream is dead", NULL };
+
+atomic_ulong resyncs;
+
+static int stats_callback(void *arg, const struct rist_stats *stats) {
+	(void)arg;
+	if (stats->stats_type == RIST_STATS_RECEIVER_FLOW) {
+		unsigned long count = test_json_count(stats->stats_json, "\"resyncs\":");
+		if (count > atomic_load(&resyncs))
+			atomic_store(&resyncs, count);
+	}
+	rist_stats_free(stats);
+	return 0;
+}
+
+/* The payload names the run and the index */
+static void send_raw(const struct test_raw_source *src, uint16_t seq, uint32_t ts, uint8_t flags, char run, int i) {
+	char payload[PAYLOAD_SIZE] = { 0 };
+	snprintf(payload, sizeof(payload), "%c #%d", run, i);
+	test_raw_send(src, seq, ts, flags, payload, sizeof(payload));
+}
+
+struct stream {
+	struct test_raw_source src;
+	const char *scenario;
+	// where the first run goes on from the warmup
+	uint16_t seq;
+	uint32_t ts;
+	uint64_t start;
+	atomic_ulong sent;
+};
+
+/* The source clock follows the wall clock, so that the buffer holds the
+ * same time of data however slow the sending gets */
+static uint32_t source_ts(const struct stream *s) {
+	return s->ts + (uint32_t)((timestampNTP_u64() - s->start) * 90 / RIST_CLOCK);
+}
+
+static PTHREAD_START_FUNC(send_stream, arg) {
+	struct stream *s = arg;
+	uint16_t seq = s->seq;
+	for (int i = 0; i < FIRST_COUNT && !atomic_load(&stop); i++) {
+		send_raw(&s->src, seq++, source_ts(s), 0, 'A', i);
+		usleep(1000);
+	}
+	bool restart = strcmp(s->scenario, "restart") == 0 || strcmp(s->scenario, "marker") == 0;
+	uint32_t jump = 0;
+	if (strcmp(s->scenario, "jump") == 0)
+		jump = 10 * 90000;
+	else if (strcmp(s->scenario, "back") == 0)
+		jump = (uint32_t)(-10 * 90000);
+	if (restart)
+		seq = 10;
+	for (int i = 0; i < SECOND_COUNT && !atomic_load(&stop); i++) {
+		uint8_t flags = strcmp(s->scenario, "marker") == 0 && i < RIST_RESTART_MARKER_PACKETS ? RIST_RTP_EXT_RESTART : 0;
+		send_raw(&s->src, seq++, source_ts(s) + jump, flags, 'B', i);
+		usleep(1000);
+	}
+	atomic_store(&s->sent, 1);
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 4)
+		return 99;
+	const char *scenario = argv[1];
+	enum rist_resync_policy policy = (enum rist_resync_policy)atoi(argv[2]);
+	int port = atoi(argv[3]);
+	if (strcmp(scenario, "marker") && strcmp(scenario, "restart") && strcmp(scenario, "jump") && strcmp(scenario, "back"))
+		return 99;
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	char url[256];
+	struct stream stream = { .src = { .sd = -1 }, .scenario = scenario, .seq = 1000, .ts = TS_BASE };
+
+	atomic_init(&resyncs, 0);
+	atomic_init(&stream.sent, 0);
+
+	if (test_logging_init(RIST_LOG_WARN, expected_errors, NULL, false) != 0)
+		return 99;
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1&buffer=300", port);
+	if (rist_receiver_create(&receiver_ctx, RIST_PROFILE_SIMPLE, logging_settings) != 0 ||
+		(policy != RIST_RESYNC_POLICY_DISABLED && rist_receiver_resync_policy_set(receiver_ctx, policy) != 0) ||
+		rist_stats_callback_set(receiver_ctx, 100, stats_callback, NULL) != 0 ||
+		test_add_peer(receiver_ctx, url, NULL) != 0 || rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	if (test_raw_source_open(&stream.src, port, FLOW_ID) != 0) {
+		ret = 99;
+		goto out;
+	}
+	// the first run must not start before the flow is up
+	struct rist_data_block *b = NULL;
+	time_t end = time(NULL) + 5;
+	stream.start = timestampNTP_u64();
+	for (int i = 0; !b && time(NULL) < end; i++) {
+		send_raw(&stream.src, stream.seq++, source_ts(&stream), 0, 'W', i);
+		if (rist_receiver_data_read2(receiver_ctx, &b, 20) <= 0)
+			b = NULL;
+	}
+	if (!b) {
+		fprintf(stdout, "The flow did not come up\n");
+		ret = 1;
+		goto out;
+	}
+	rist_receiver_data_block_free2(&b);
+	pthread_t send_loop;
+	if (pthread_create(&send_loop, NULL, send_stream, &stream) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	int first = 0;
+	int second = 0;
+	int next[2] = { 0 };
+	int out_of_order = 0;
+	// until the buffer had its time after the last packet, however long the
+	// sending took
+	end = time(NULL) + 30;
+	time_t sent_end = 0;
+	while (time(NULL) < end && (!sent_end || time(NULL) < sent_end)) {
+		if (!sent_end && atomic_load(&stream.sent))
+			sent_end = time(NULL) + 2;
+		if (rist_receiver_data_read2(receiver_ctx, &b, 100) <= 0 || !b)
+			continue;
+		char run = 0;
+		int i = -1;
+		if (sscanf(b->payload, "%c #%d", &run, &i) == 2 && run == 'W') {
+			rist_receiver_data_block_free2(&b);
+			continue;
+		}
+		if ((run != 'A' && run != 'B') || i < 0) {
+			fprintf(stdout, "Unexpected payload\n");
+			atomic_store(&failed, 1);
+		} else if (run == 'A') {
+			// nothing of the first run may come after the new space
+			if (second || i < next[0])
+				out_of_order++;
+			next[0] = i + 1;
+			first++;
+		} else {
+			if (i < next[1])
+				out_of_order++;
+			next[1] = i + 1;
+			second++;
+		}
+		rist_receiver_data_block_free2(&b);
+	}
+	atomic_store(&stop, 1);
+	pthread_join(send_loop, NULL);
+
+	fprintf(stdout, "%s, policy %d: %d of %d packets before, %d of %d after the discontinuity, %lu resyncs, %d out of order\n",
+		scenario, policy, first, FIRST_COUNT, second, SECOND_COUNT, atomic_load(&resyncs), out_of_order);
+	if (policy == RIST_RESYNC_POLICY_DISABLED) {
+		if (atomic_load(&resyncs) != 0)
+			atomic_store(&failed, 1);
+	} else {
+		// the heuristics drop the packets that confirm the discontinuity, the
+		// marker is trusted right away, a drain costs a few more
+		int min_second = SECOND_COUNT - RIST_RESYNC_CONFIRM_PACKETS - 20;
+		if (atomic_load(&resyncs) != 1 || out_of_order || second < min_second)
+			atomic_store(&failed, 1);
+		if (policy == RIST_RESYNC_POLICY_FLUSH && first >= FIRST_COUNT)
+			atomic_store(&failed, 1);
+		if (policy == RIST_RESYNC_POLICY_DRAIN && first != FIRST_COUNT)
+			atomic_store(&failed, 1);
+	}
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	test_raw_source_close(&stream.src);
+	return test_finish(ret);
+}
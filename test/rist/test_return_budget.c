@@ -0,0 +1,130 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Heavy loss towards a receiver whose return bandwidth is far too small for
+ * all the NACKs it wants to send. NACKs have to be cut, but the RR (which
+ * carries the echo request for the RTT) and keepalive messages must still get
+ * through: the sender may never time the receiver out and the receiver keeps
+ * measuring the RTT. */
+
+#include "helpers.h"
+#include "proto/rist_time.h"
+
+#define RUN_SECONDS 6
+#define LOSS_PERMILLE 300
+
+atomic_ulong timeouts;
+atomic_ulong lost;
+
+static bool budget_hook(int level, const char *msg) {
+	// Not every packet can be recovered with this little return bandwidth
+	if (level <= RIST_LOG_ERROR && strstr(msg, "Lost ")) {
+		atomic_fetch_add(&lost, 1);
+		return true;
+	}
+	if (level == RIST_LOG_WARN && strstr(msg, "timed out")) {
+		fprintf(stdout, "[WARN] %s", msg);
+		atomic_fetch_add(&timeouts, 1);
+	}
+	return false;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 4)
+		return 99;
+	int profile = atoi(argv[1]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct rist_ctx *sender_ctx = NULL;
+	struct test_sender source = { .interval_us = 250 };
+
+	atomic_init(&timeouts, 0);
+	atomic_init(&lost, 0);
+
+	if (test_logging_init(RIST_LOG_WARN, NULL, budget_hook, false) != 0)
+		return 99;
+	if (rist_receiver_create(&receiver_ctx, profile, logging_settings) != 0 ||
+		test_add_peer(receiver_ctx, argv[2], NULL) != 0 || rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	if (rist_sender_create(&sender_ctx, profile, 0, logging_settings) != 0 ||
+		test_add_peer(sender_ctx, argv[3], NULL) != 0) {
+		ret = 99;
+		goto out;
+	}
+	// Lose data on the way to the receiver only, the return path is the bottleneck
+	sender_ctx->sender_ctx->simulate_loss = true;
+	sender_ctx->sender_ctx->loss_percentage = LOSS_PERMILLE;
+	if (rist_start(sender_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	source.ctx = sender_ctx;
+	if (test_sender_start(&source) != 0) {
+		ret = 99;
+		goto out;
+	}
+	// Longest time the sender went without hearing from the receiver, and
+	// how often the receiver got a new RTT sample
+	struct rist_sender *sender = sender_ctx->sender_ctx;
+	struct rist_receiver *receiver = receiver_ctx->receiver_ctx;
+	uint64_t last_heard = 0;
+	uint64_t max_gap = 0;
+	uint64_t rtt = 0;
+	int rtt_samples = 0;
+	struct rist_data_block *b = NULL;
+	int received = 0;
+	time_t end = time(NULL) + RUN_SECONDS;
+	while (time(NULL) < end) {
+		if (rist_receiver_data_read2(receiver_ctx, &b, 20) > 0 && b) {
+			received++;
+			rist_receiver_data_block_free2(&b);
+		}
+		pthread_mutex_lock(&sender->common.peerlist_lock);
+		for (size_t i = 0; i < sender->peer_lst_len; i++) {
+			struct rist_peer *peer = sender->peer_lst[i];
+			if (peer->dead) {
+				fprintf(stdout, "Sender peer %zu died\n", i);
+				atomic_store(&failed, 1);
+			}
+			uint64_t heard = peer->last_pkt_received;
+			if (last_heard && heard > last_heard && heard - last_heard > max_gap)
+				max_gap = heard - last_heard;
+			if (heard > last_heard)
+				last_heard = heard;
+		}
+		pthread_mutex_unlock(&sender->common.peerlist_lock);
+		pthread_mutex_lock(&receiver->common.peerlist_lock);
+		for (struct rist_peer *peer = receiver->common.PEERS; peer; peer = peer->next) {
+			if (!peer->parent)
+				continue;
+			if (peer->eight_times_rtt != rtt) {
+				rtt = peer->eight_times_rtt;
+				rtt_samples++;
+			}
+			break;
+		}
+		pthread_mutex_unlock(&receiver->common.peerlist_lock);
+	}
+	atomic_store(&stop, 1);
+	test_sender_stop(&source);
+
+	fprintf(stdout, "Received %d packets, %lu loss reports, longest silence on the return path %"PRIu64" ms, %d rtt samples\n",
+		received, atomic_load(&lost), (uint64_t)(max_gap / RIST_CLOCK), rtt_samples);
+	if (received == 0 || last_heard == 0 || atomic_load(&timeouts) != 0 || max_gap > 500 * RIST_CLOCK ||
+		rtt_samples < 2 * RUN_SECONDS)
+		atomic_store(&failed, 1);
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	atomic_store(&stop, 1);
+	test_sender_stop(&source);
+	if (sender_ctx)
+		rist_destroy(sender_ctx);
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
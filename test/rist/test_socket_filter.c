@@ -0,0 +1,98 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* A listening receiver with the peers socket filter. A first sender
+ * authenticates, a second one from another address joins later on: the
+ * filter must not lock it out, both flows have to come through. */
+
+#include "helpers.h"
+
+#define FLOW_ID_BASE 0x6200
+#define SENDERS 2
+#define PACKET_COUNT 1500
+#define JOIN_AFTER_MS 500
+
+int main(int argc, char *argv[]) {
+	if (argc != 2)
+		return 99;
+	int port = atoi(argv[1]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct test_sender senders[SENDERS] = { 0 };
+	char url[256];
+	static uint8_t seen[SENDERS][PACKET_COUNT];
+
+	if (test_logging_init(RIST_LOG_WARN, NULL, NULL, false) != 0)
+		return 99;
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+	if (rist_receiver_create(&receiver_ctx, RIST_PROFILE_MAIN, logging_settings) != 0) {
+		ret = 99;
+		goto out;
+	}
+	int filter = rist_receiver_socket_filter_set(receiver_ctx, RIST_SOCKET_FILTER_PEERS);
+	if (filter == -4) {
+		fprintf(stdout, "Socket filters are not available here\n");
+		ret = 77;
+		goto out;
+	}
+	if (filter != 0 || test_add_peer(receiver_ctx, url, NULL) != 0 || rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	// the first sender is alone (and authenticated) when the second one,
+	// from another address of the loopback network, is created
+	for (int i = 0; i < SENDERS; i++) {
+		struct test_sender *s = &senders[i];
+		if (i)
+			usleep(JOIN_AFTER_MS * 1000);
+		s->index = i;
+		snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1&miface=127.0.0.%d", port, i + 1);
+		if (rist_sender_create(&s->ctx, RIST_PROFILE_MAIN, FLOW_ID_BASE + 2 * i, logging_settings) != 0 ||
+			test_add_peer(s->ctx, url, NULL) != 0 || rist_start(s->ctx) != 0 || test_sender_start(s) != 0) {
+			ret = 99;
+			break;
+		}
+	}
+
+	int received[SENDERS] = { 0 };
+	struct rist_data_block *b = NULL;
+	time_t end = time(NULL) + PACKET_COUNT / 1000 + 4;
+	while (!ret && time(NULL) < end && received[0] + received[1] < SENDERS * PACKET_COUNT) {
+		if (rist_receiver_data_read2(receiver_ctx, &b, 100) <= 0 || !b)
+			continue;
+		int index = -1;
+		int seq = test_payload_seq(b, NULL, &index);
+		if (index < 0 || index >= SENDERS || seq < 0 || b->flow_id != (uint32_t)(FLOW_ID_BASE + 2 * index)) {
+			fprintf(stdout, "Packet %s came out on flow %u\n", (const char *)b->payload, b->flow_id);
+			atomic_store(&failed, 1);
+		} else if (seq < PACKET_COUNT && !seen[index][seq]) {
+			seen[index][seq] = 1;
+			received[index]++;
+		}
+		rist_receiver_data_block_free2(&b);
+	}
+	atomic_store(&stop, 1);
+	for (int i = 0; i < SENDERS; i++)
+		test_sender_stop(&senders[i]);
+	if (ret)
+		goto out;
+
+	for (int i = 0; i < SENDERS; i++) {
+		fprintf(stdout, "Sender %d: %d of %d packets\n", i, received[i], PACKET_COUNT);
+		if (received[i] != PACKET_COUNT)
+			atomic_store(&failed, 1);
+	}
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	atomic_store(&stop, 1);
+	for (int i = 0; i < SENDERS; i++) {
+		test_sender_stop(&senders[i]);
+		if (senders[i].ctx)
+			rist_destroy(senders[i].ctx);
+	}
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
@@ -0,0 +1,103 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Two senders on the same host, each striped over several source ports, to one
+ * receiver peer. Every port is a peer of its own on the receiver, the packets
+ * must be joined back by flow id: each sender complete on its own flow. */
+
+#include "helpers.h"
+
+#define SENDERS 2
+#define PACKET_COUNT 2000
+#define FLOW_ID_BASE 0x3000
+#define STRIPE_PORTS 4
+
+int main(int argc, char *argv[]) {
+	if (argc != 3)
+		return 99;
+	int profile = atoi(argv[1]);
+	int port = atoi(argv[2]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct test_sender senders[SENDERS] = { 0 };
+	char url[256];
+
+	if (test_logging_init(RIST_LOG_WARN, NULL, NULL, true) != 0)
+		return 99;
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+	if (rist_receiver_create(&receiver_ctx, profile, logging_settings) != 0 ||
+		test_add_peer(receiver_ctx, url, NULL) != 0 || rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	for (int i = 0; i < SENDERS; i++) {
+		senders[i].index = i;
+		senders[i].count = PACKET_COUNT;
+		snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1&stripe-ports=%d", port, STRIPE_PORTS);
+		if (rist_sender_create(&senders[i].ctx, profile, FLOW_ID_BASE + 2 * i, logging_settings) != 0 ||
+			test_add_peer(senders[i].ctx, url, NULL) != 0 || rist_start(senders[i].ctx) != 0) {
+			ret = 99;
+			goto out;
+		}
+	}
+	for (int i = 0; i < SENDERS; i++) {
+		if (test_sender_start(&senders[i]) != 0) {
+			ret = 99;
+			goto out;
+		}
+	}
+
+	int received[SENDERS] = { 0 };
+	int total = 0;
+	int idle = 0;
+	struct rist_data_block *b = NULL;
+	while (!atomic_load(&stop) && idle < 5 && total < SENDERS * PACKET_COUNT) {
+		if (rist_receiver_data_read2(receiver_ctx, &b, 1000) <= 0 || !b) {
+			idle++;
+			continue;
+		}
+		idle = 0;
+		int index = -1;
+		test_payload_seq(b, NULL, &index);
+		if (index < 0 || index >= SENDERS || b->flow_id != (uint32_t)(FLOW_ID_BASE + 2 * index)) {
+			fprintf(stderr, "Packet %s came out on flow %u\n", (const char *)b->payload, b->flow_id);
+			atomic_store(&failed, 1);
+		} else {
+			received[index]++;
+		}
+		total++;
+		rist_receiver_data_block_free2(&b);
+	}
+	// One peer per source port, joined on the flow of their sender
+	struct rist_common_ctx *cctx = &receiver_ctx->receiver_ctx->common;
+	pthread_mutex_lock(&cctx->flows_lock);
+	int flows = 0;
+	for (struct rist_flow *f = cctx->FLOWS; f; f = f->next) {
+		fprintf(stdout, "Flow %u: %zu peers\n", f->flow_id, f->peer_lst_len);
+		if (f->peer_lst_len != STRIPE_PORTS)
+			atomic_store(&failed, 1);
+		flows++;
+	}
+	pthread_mutex_unlock(&cctx->flows_lock);
+	if (flows != SENDERS)
+		atomic_store(&failed, 1);
+	for (int i = 0; i < SENDERS; i++) {
+		test_sender_stop(&senders[i]);
+		fprintf(stdout, "Sender %d: %d packets\n", i, received[i]);
+		if (received[i] < PACKET_COUNT * 9 / 10)
+			atomic_store(&failed, 1);
+	}
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	atomic_store(&stop, 1);
+	for (int i = 0; i < SENDERS; i++) {
+		test_sender_stop(&senders[i]);
+		if (senders[i].ctx)
+			rist_destroy(senders[i].ctx);
+	}
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
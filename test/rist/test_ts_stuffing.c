@@ -0,0 +1,157 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* TS adaptation field stuffing suppression end to end, the sender strips the
+ * stuffing of 7 x 188 byte TS payloads and the receiver has to hand them back
+ * byte for byte:
+ * - stuffing: alone
+ * - stuffing-npd: combined with null packet deletion
+ * The sender queue has to hold the datagrams shorter than what was written,
+ * or nothing was suppressed on the way. */
+
+#include "helpers.h"
+#include "udp-private.h"
+
+#define FLOW_ID 0x6900
+#define PACKET_COUNT 500
+#define TS_PACKET_SIZE 188
+#define TS_PACKETS (TEST_PAYLOAD_SIZE / TS_PACKET_SIZE)
+
+/* PCR only adaptation fields padded with stuffing, some varying with i, next
+ * to plain and null packets. The packet with no adaptation field carries i. */
+static void ts_fill(char *payload, size_t len, int index, int i) {
+	(void)index;
+	const uint16_t pids[TS_PACKETS] = { 0x100, 0x101, 0x1FFF, 0x100, 0x100, 0x1FFF, 0x102 };
+	const uint8_t af_lens[TS_PACKETS] = { 183, 0, 0, (uint8_t)(7 + i % 100), 150, 0, 20 };
+	uint8_t *ts = (uint8_t *)payload;
+	memset(ts, 0, len);
+	for (int k = 0; k < TS_PACKETS; k++) {
+		uint8_t *pkt = &ts[k * TS_PACKET_SIZE];
+		pkt[0] = 0x47;
+		pkt[1] = (pids[k] >> 8) & 0x1F;
+		pkt[2] = pids[k] & 0xFF;
+		if (pids[k] == 0x1FFF) {
+			pkt[3] = 0x10;
+			memset(&pkt[4], 0xFF, TS_PACKET_SIZE - 4);
+			continue;
+		}
+		pkt[3] = (uint8_t)((af_lens[k] ? 0x30 : 0x10) | (i & 0x0F));
+		size_t payload_start = 4;
+		if (af_lens[k]) {
+			pkt[4] = af_lens[k];
+			pkt[5] = 0x10;
+			memset(&pkt[6], i & 0xFF, 6);
+			memset(&pkt[12], 0xFF, af_lens[k] - 7);
+			payload_start = 5 + af_lens[k];
+		}
+		for (size_t j = payload_start; j < TS_PACKET_SIZE; j++)
+			pkt[j] = (uint8_t)(i + k * 31 + j);
+		if (!af_lens[k]) {
+			uint32_t seq = htonl((uint32_t)i);
+			memcpy(&pkt[4], &seq, sizeof(seq));
+		}
+	}
+}
+
+/* Datagrams in the sender queue that went out shorter than written */
+static int count_suppressed(struct rist_sender *ctx, int *total) {
+	int suppressed = 0;
+	*total = 0;
+	pthread_mutex_lock(&ctx->queue_lock);
+	for (size_t i = 0; i < ctx->sender_queue_max; i++) {
+		const struct rist_buffer *b = ctx->sender_queue[i];
+		if (!b || b->type != RIST_PAYLOAD_TYPE_DATA_RAW_RTP_EXT)
+			continue;
+		(*total)++;
+		if (b->size < TEST_PAYLOAD_SIZE)
+			suppressed++;
+	}
+	pthread_mutex_unlock(&ctx->queue_lock);
+	return suppressed;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3)
+		return 99;
+	bool npd;
+	if (strcmp(argv[1], "stuffing") == 0)
+		npd = false;
+	else if (strcmp(argv[1], "stuffing-npd") == 0)
+		npd = true;
+	else
+		return 99;
+	int port = atoi(argv[2]);
+	int ret = 0;
+	struct rist_ctx *receiver_ctx = NULL;
+	struct rist_ctx *sender_ctx = NULL;
+	struct test_sender source = { .count = PACKET_COUNT, .fill = ts_fill };
+	char url[256];
+
+	if (test_logging_init(RIST_LOG_WARN, NULL, NULL, false) != 0)
+		return 99;
+	snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+	if (rist_receiver_create(&receiver_ctx, RIST_PROFILE_MAIN, logging_settings) != 0 ||
+		test_add_peer(receiver_ctx, url, NULL) != 0 || rist_start(receiver_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1", port);
+	if (rist_sender_create(&sender_ctx, RIST_PROFILE_MAIN, FLOW_ID, logging_settings) != 0 ||
+		rist_sender_ts_stuffing_enable(sender_ctx) != 0 || (npd && rist_sender_npd_enable(sender_ctx) != 0) ||
+		test_add_peer(sender_ctx, url, NULL) != 0 || rist_start(sender_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	source.ctx = sender_ctx;
+	if (test_sender_start(&source) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	int received = 0;
+	int corrupt = 0;
+	int last = -1;
+	char expected[TEST_PAYLOAD_SIZE];
+	struct rist_data_block *b = NULL;
+	time_t end = time(NULL) + PACKET_COUNT / 1000 + 5;
+	while (time(NULL) < end && last < PACKET_COUNT - 1) {
+		if (rist_receiver_data_read2(receiver_ctx, &b, 100) <= 0 || !b)
+			continue;
+		uint32_t seq = 0;
+		if (b->payload_len == TEST_PAYLOAD_SIZE)
+			memcpy(&seq, (const uint8_t *)b->payload + TS_PACKET_SIZE + 4, sizeof(seq));
+		int i = (int)ntohl(seq);
+		if (b->payload_len == TEST_PAYLOAD_SIZE && i > last && i < PACKET_COUNT) {
+			ts_fill(expected, sizeof(expected), 0, i);
+			if (memcmp(b->payload, expected, sizeof(expected)) == 0) {
+				received++;
+				last = i;
+			} else {
+				corrupt++;
+			}
+		} else {
+			fprintf(stdout, "Unexpected payload of %zu bytes\n", b->payload_len);
+			corrupt++;
+		}
+		rist_receiver_data_block_free2(&b);
+	}
+	test_sender_wait(&source);
+
+	int total;
+	int suppressed = count_suppressed(sender_ctx->sender_ctx, &total);
+	fprintf(stdout, "%s: %d of %d payloads restored, %d corrupt, %d of %d queued datagrams suppressed\n",
+			argv[1], received, PACKET_COUNT, corrupt, suppressed, total);
+	// the first few may go before the flow is up
+	if (corrupt != 0 || received < PACKET_COUNT * 9 / 10 || total == 0 || suppressed != total)
+		atomic_store(&failed, 1);
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	test_sender_stop(&source);
+	if (sender_ctx)
+		rist_destroy(sender_ctx);
+	if (receiver_ctx)
+		rist_destroy(receiver_ctx);
+	return test_finish(ret);
+}
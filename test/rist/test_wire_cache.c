@@ -0,0 +1,247 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* An encrypted sender with the wire cache, through a relay that loses data
+ * after it was sent (the simulated loss of the sender drops it before it is
+ * encrypted, the image would never exist). Every payload has to arrive
+ * intact, and the images must be used and dropped where they have to:
+ * - peers: two receivers, the images stay with the first peer, the second
+ *   peer encrypts its retransmissions itself
+ * - rotation: the key is rotated every few packets, images from before a
+ *   rotation are rebuilt
+ * - arrival: arrival timing, no images at all */
+
+#include "helpers.h"
+#include <poll.h>
+#include "socket-shim.h"
+
+#define PACKET_COUNT 3000
+#define LOSS_PERMILLE 100
+#define FLOW_ID 0x7000
+#define RECEIVERS 2
+
+static const char *const expected_errors[] = { "Lost ", NULL };
+
+atomic_ulong retransmitted[RECEIVERS];
+atomic_ulong cached[RECEIVERS];
+uint32_t peer_ids[RECEIVERS];
+
+static int stats_callback(void *arg, const struct rist_stats *stats) {
+	(void)arg;
+	if (stats->stats_type == RIST_STATS_SENDER_PEER) {
+		const char *c = strstr(stats->stats_json, "\"retransmitted_cached\":");
+		unsigned long count = 0;
+		if (c)
+			sscanf(c, "\"retransmitted_cached\":%lu", &count);
+		for (int i = 0; i < RECEIVERS; i++) {
+			if (stats->stats.sender_peer.peer_id == peer_ids[i]) {
+				atomic_fetch_add(&retransmitted[i], stats->stats.sender_peer.retransmitted);
+				atomic_fetch_add(&cached[i], count);
+			}
+		}
+	}
+	rist_stats_free(stats);
+	return 0;
+}
+
+struct relay {
+	int port;
+	int sd_in;
+	int sd_out;
+	pthread_t thread;
+};
+
+static int udp_socket(int port) {
+	int sd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sd < 0)
+		return -1;
+	struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port) };
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(sd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		close(sd);
+		return -1;
+	}
+	return sd;
+}
+
+/* Sender on port + 1 to receiver on port, every tenth datagram towards the
+ * receiver lost, the way back untouched */
+static PTHREAD_START_FUNC(relay_loop, arg) {
+	struct relay *r = arg;
+	struct sockaddr_in receiver = { .sin_family = AF_INET, .sin_port = htons((uint16_t)r->port) };
+	receiver.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	struct sockaddr_in sender = { 0 };
+	socklen_t sender_len = 0;
+	uint8_t buf[2048];
+	struct pollfd pfd[2] = { { .fd = r->sd_in, .events = POLLIN }, { .fd = r->sd_out, .events = POLLIN } };
+	while (!atomic_load(&stop)) {
+		if (poll(pfd, 2, 10) <= 0)
+			continue;
+		if (pfd[0].revents & POLLIN) {
+			struct sockaddr_in from;
+			socklen_t from_len = sizeof(from);
+			ssize_t len = recvfrom(r->sd_in, (void *)buf, sizeof(buf), 0, (struct sockaddr *)&from, &from_len);
+			if (len > 0) {
+				sender = from;
+				sender_len = from_len;
+				if (rand() % 1000 >= LOSS_PERMILLE)
+					sendto(r->sd_out, (void *)buf, (size_t)len, 0, (struct sockaddr *)&receiver, sizeof(receiver));
+			}
+		}
+		if (pfd[1].revents & POLLIN) {
+			ssize_t len = recv(r->sd_out, (void *)buf, sizeof(buf), 0);
+			if (len > 0 && sender_len)
+				sendto(r->sd_in, (void *)buf, (size_t)len, 0, (struct sockaddr *)&sender, sender_len);
+		}
+	}
+	return 0;
+}
+
+static void fill(char *buffer, size_t len, int index, int i) {
+	memset(buffer, 0, 64);
+	snprintf(buffer, len, "SENDER %d PACKET #%i", index, i);
+	for (size_t j = 64; j < len; j++)
+		buffer[j] = (char)(i + j);
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3)
+		return 99;
+	const char *mode = argv[1];
+	int port = atoi(argv[2]);
+	int receivers = strcmp(mode, "peers") == 0 ? RECEIVERS : 1;
+	const char *options = "";
+	if (strcmp(mode, "rotation") == 0)
+		options = "&key-rotation=64";
+	else if (strcmp(mode, "arrival") == 0)
+		options = "&timing-mode=1";
+	else if (strcmp(mode, "peers") != 0)
+		return 99;
+	int ret = 0;
+	struct rist_ctx *receiver_ctx[RECEIVERS] = { 0 };
+	struct rist_ctx *sender_ctx = NULL;
+	struct test_sender sender = { .fill = fill };
+	struct rist_peer *peer = NULL;
+	char url[256];
+	static uint8_t seen[RECEIVERS][PACKET_COUNT];
+	struct relay relays[RECEIVERS] = { 0 };
+	int relays_started = 0;
+
+	for (int i = 0; i < RECEIVERS; i++) {
+		atomic_init(&retransmitted[i], 0);
+		atomic_init(&cached[i], 0);
+	}
+
+	if (test_logging_init(RIST_LOG_WARN, expected_errors, NULL, false) != 0)
+		return 99;
+	for (int i = 0; i < receivers; i++) {
+		snprintf(url, sizeof(url), "rist://@127.0.0.1:%d?rtt-max=10&rtt-min=1&secret=12345678&aes-type=128", port + 2 * i);
+		if (rist_receiver_create(&receiver_ctx[i], RIST_PROFILE_MAIN, logging_settings) != 0 ||
+			test_add_peer(receiver_ctx[i], url, &peer) != 0 || rist_start(receiver_ctx[i]) != 0) {
+			ret = 99;
+			goto out;
+		}
+		relays[i].port = port + 2 * i;
+		relays[i].sd_in = udp_socket(port + 10 + 2 * i);
+		relays[i].sd_out = udp_socket(0);
+		if (relays[i].sd_in < 0 || relays[i].sd_out < 0 ||
+			pthread_create(&relays[i].thread, NULL, relay_loop, &relays[i]) != 0) {
+			ret = 99;
+			goto out;
+		}
+		relays_started++;
+	}
+	if (rist_sender_create(&sender_ctx, RIST_PROFILE_MAIN, FLOW_ID, logging_settings) != 0 ||
+		rist_sender_wire_cache_enable(sender_ctx) != 0 ||
+		rist_stats_callback_set(sender_ctx, 100, stats_callback, NULL) != 0) {
+		ret = 99;
+		goto out;
+	}
+	for (int i = 0; i < receivers; i++) {
+		snprintf(url, sizeof(url), "rist://127.0.0.1:%d?rtt-max=10&rtt-min=1&secret=12345678&aes-type=128%s", port + 10 + 2 * i, options);
+		if (test_add_peer(sender_ctx, url, &peer) != 0) {
+			ret = 99;
+			goto out;
+		}
+		peer_ids[i] = peer->adv_peer_id;
+	}
+	if (rist_start(sender_ctx) != 0) {
+		ret = 99;
+		goto out;
+	}
+	// Keeps going past PACKET_COUNT, so that a lost tail is noticed and repaired
+	sender.ctx = sender_ctx;
+	if (test_sender_start(&sender) != 0) {
+		ret = 99;
+		goto out;
+	}
+
+	int received[RECEIVERS] = { 0 };
+	int corrupt = 0;
+	char expected[TEST_PAYLOAD_SIZE] = { 0 };
+	struct rist_data_block *b = NULL;
+	time_t end = time(NULL) + PACKET_COUNT / 1000 + 5;
+	while (time(NULL) < end) {
+		bool complete = true;
+		for (int i = 0; i < receivers; i++) {
+			if (received[i] < PACKET_COUNT)
+				complete = false;
+			if (rist_receiver_data_read2(receiver_ctx[i], &b, 10) <= 0 || !b)
+				continue;
+			int seq = b->payload_len == sizeof(expected) ? test_payload_seq(b, NULL, NULL) : -1;
+			if (seq < 0) {
+				corrupt++;
+			} else if (seq < PACKET_COUNT && !seen[i][seq]) {
+				fill(expected, sizeof(expected), 0, seq);
+				if (memcmp(b->payload, expected, sizeof(expected)) != 0)
+					corrupt++;
+				seen[i][seq] = 1;
+				received[i]++;
+			}
+			rist_receiver_data_block_free2(&b);
+		}
+		if (complete)
+			break;
+	}
+	// the last stats round
+	usleep(200000);
+	atomic_store(&stop, 1);
+	test_sender_stop(&sender);
+
+	for (int i = 0; i < receivers; i++) {
+		fprintf(stdout, "Receiver %d: %d packets, %lu retransmitted, %lu of them from the cache\n", i, received[i],
+			atomic_load(&retransmitted[i]), atomic_load(&cached[i]));
+		if (received[i] < PACKET_COUNT * 99 / 100 || atomic_load(&retransmitted[i]) == 0)
+			atomic_store(&failed, 1);
+	}
+	if (corrupt) {
+		fprintf(stdout, "%d corrupt packets\n", corrupt);
+		atomic_store(&failed, 1);
+	}
+	if (strcmp(mode, "peers") == 0 && (atomic_load(&cached[0]) == 0 || atomic_load(&cached[1]) != 0))
+		atomic_store(&failed, 1);
+	if (strcmp(mode, "rotation") == 0 && (atomic_load(&cached[0]) == 0 || atomic_load(&cached[0]) >= atomic_load(&retransmitted[0])))
+		atomic_store(&failed, 1);
+	if (strcmp(mode, "arrival") == 0 && atomic_load(&cached[0]) != 0)
+		atomic_store(&failed, 1);
+	if (atomic_load(&failed))
+		ret = 1;
+out:
+	atomic_store(&stop, 1);
+	test_sender_stop(&sender);
+	atomic_store(&stop, 1);
+	for (int i = 0; i < relays_started; i++)
+		pthread_join(relays[i].thread, NULL);
+	if (sender_ctx)
+		rist_destroy(sender_ctx);
+	for (int i = 0; i < RECEIVERS; i++) {
+		if (receiver_ctx[i])
+			rist_destroy(receiver_ctx[i]);
+		if (relays[i].sd_in > 0)
+			close(relays[i].sd_in);
+		if (relays[i].sd_out > 0)
+			close(relays[i].sd_out);
+	}
+	return test_finish(ret);
+}
@@ -0,0 +1,140 @@
+//ChaCha20: RFC 8439 known answer vectors, large buffers and split calls.
+
+#include "unit.h"
+
+#include "src/crypto/chacha20.c"
+#include <stdio.h>
+#include <stdlib.h>
+
+static const uint8_t key_seq[RIST_CHACHA20_KEY_SIZE] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+};
+
+/* RFC 8439 2.4.2 */
+static const uint8_t sunscreen_nonce[RIST_CHACHA20_NONCE_SIZE] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4a, 0x00, 0x00, 0x00, 0x00,
+};
+
+static const char sunscreen_plain[] = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip "
+	"for the future, sunscreen would be it.";
+
+static const uint8_t sunscreen_cipher[114] = {
+	0x6e, 0x2e, 0x35, 0x9a, 0x25, 0x68, 0xf9, 0x80, 0x41, 0xba, 0x07, 0x28, 0xdd, 0x0d, 0x69, 0x81,
+	0xe9, 0x7e, 0x7a, 0xec, 0x1d, 0x43, 0x60, 0xc2, 0x0a, 0x27, 0xaf, 0xcc, 0xfd, 0x9f, 0xae, 0x0b,
+	0xf9, 0x1b, 0x65, 0xc5, 0x52, 0x47, 0x33, 0xab, 0x8f, 0x59, 0x3d, 0xab, 0xcd, 0x62, 0xb3, 0x57,
+	0x16, 0x39, 0xd6, 0x24, 0xe6, 0x51, 0x52, 0xab, 0x8f, 0x53, 0x0c, 0x35, 0x9f, 0x08, 0x61, 0xd8,
+	0x07, 0xca, 0x0d, 0xbf, 0x50, 0x0d, 0x6a, 0x61, 0x56, 0xa3, 0x8e, 0x08, 0x8a, 0x22, 0xb6, 0x5e,
+	0x52, 0xbc, 0x51, 0x4d, 0x16, 0xcc, 0xf8, 0x06, 0x81, 0x8c, 0xe9, 0x1a, 0xb7, 0x79, 0x37, 0x36,
+	0x5a, 0xf9, 0x0b, 0xbf, 0x74, 0xa3, 0x5b, 0xe6, 0xb4, 0x0b, 0x8e, 0xed, 0xf2, 0x78, 0x5e, 0x42,
+	0x87, 0x4d,
+};
+
+/* RFC 8439 2.3.2, the serialized block is the keystream */
+static const uint8_t block_nonce[RIST_CHACHA20_NONCE_SIZE] = {
+	0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x4a, 0x00, 0x00, 0x00, 0x00,
+};
+
+static const uint8_t block_keystream[RIST_CHACHA20_BLOCK_SIZE] = {
+	0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15, 0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+	0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03, 0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+	0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09, 0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+	0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9, 0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e,
+};
+
+/* RFC 8439 A.1 test vector #1, all zero key and nonce */
+static const uint8_t zero_keystream[RIST_CHACHA20_BLOCK_SIZE] = {
+	0x76, 0xb8, 0xe0, 0xad, 0xa0, 0xf1, 0x3d, 0x90, 0x40, 0x5d, 0x6a, 0xe5, 0x53, 0x86, 0xbd, 0x28,
+	0xbd, 0xd2, 0x19, 0xb8, 0xa0, 0x8d, 0xed, 0x1a, 0xa8, 0x36, 0xef, 0xcc, 0x8b, 0x77, 0x0d, 0xc7,
+	0xda, 0x41, 0x59, 0x7c, 0x51, 0x57, 0x48, 0x8d, 0x77, 0x24, 0xe0, 0x3f, 0xb8, 0xd8, 0x4a, 0x37,
+	0x6a, 0x43, 0xb8, 0xf4, 0x15, 0x18, 0xa1, 0x1c, 0xc3, 0x87, 0xb6, 0x69, 0xb2, 0xee, 0x65, 0x86,
+};
+
+static void crypt_once(const uint8_t key[RIST_CHACHA20_KEY_SIZE], const uint8_t nonce[RIST_CHACHA20_NONCE_SIZE],
+			uint32_t counter, const uint8_t *in, uint8_t *out, size_t len)
+{
+	struct rist_chacha20 ctx;
+	_librist_crypto_chacha20_init(&ctx);
+	_librist_crypto_chacha20_setkey(&ctx, key);
+	_librist_crypto_chacha20_starts(&ctx, nonce, counter);
+	_librist_crypto_chacha20_crypt(&ctx, in, out, len);
+}
+
+static void test_chacha20_block(void **state)
+{
+	(void)state;
+	uint8_t zero[RIST_CHACHA20_BLOCK_SIZE] = { 0 };
+	uint8_t out[RIST_CHACHA20_BLOCK_SIZE];
+	crypt_once(key_seq, block_nonce, 1, zero, out, sizeof(out));
+	assert_memory_equal(out, block_keystream, sizeof(out));
+
+	uint8_t zero_key[RIST_CHACHA20_KEY_SIZE] = { 0 };
+	uint8_t zero_nonce[RIST_CHACHA20_NONCE_SIZE] = { 0 };
+	crypt_once(zero_key, zero_nonce, 0, zero, out, sizeof(out));
+	assert_memory_equal(out, zero_keystream, sizeof(out));
+}
+
+static void test_chacha20_encrypt(void **state)
+{
+	(void)state;
+	uint8_t out[sizeof(sunscreen_cipher)];
+	assert_int_equal(strlen(sunscreen_plain), sizeof(sunscreen_cipher));
+	crypt_once(key_seq, sunscreen_nonce, 1, (const uint8_t *)sunscreen_plain, out, sizeof(out));
+	assert_memory_equal(out, sunscreen_cipher, sizeof(out));
+	// and back
+	uint8_t plain[sizeof(sunscreen_cipher)];
+	crypt_once(key_seq, sunscreen_nonce, 1, out, plain, sizeof(plain));
+	assert_memory_equal(plain, sunscreen_plain, sizeof(plain));
+}
+
+/* Long enough for the 8 and 4 lane block functions, the vector must still be
+ * its prefix and split calls must give the same stream */
+static void test_chacha20_long(void **state)
+{
+	(void)state;
+	size_t len = 32 * RIST_CHACHA20_BLOCK_SIZE + 13;
+	uint8_t *in = calloc(1, len);
+	uint8_t *whole = malloc(len);
+	uint8_t *split = malloc(len);
+	assert_non_null(in);
+	assert_non_null(whole);
+	assert_non_null(split);
+	memcpy(in, sunscreen_plain, sizeof(sunscreen_cipher));
+	for (size_t i = sizeof(sunscreen_cipher); i < len; i++)
+		in[i] = (uint8_t)(i * 7);
+	crypt_once(key_seq, sunscreen_nonce, 1, in, whole, len);
+	assert_memory_equal(whole, sunscreen_cipher, sizeof(sunscreen_cipher));
+
+	static const size_t pieces[] = { 1, 7, 56, 64, 65, 127, 3, 512, 300 };
+	struct rist_chacha20 ctx;
+	_librist_crypto_chacha20_init(&ctx);
+	_librist_crypto_chacha20_setkey(&ctx, key_seq);
+	_librist_crypto_chacha20_starts(&ctx, sunscreen_nonce, 1);
+	size_t off = 0;
+	for (size_t i = 0; off < len; i++) {
+		size_t n = pieces[i % (sizeof(pieces) / sizeof(pieces[0]))];
+		if (n > len - off)
+			n = len - off;
+		_librist_crypto_chacha20_crypt(&ctx, &in[off], &split[off], n);
+		off += n;
+	}
+	assert_memory_equal(split, whole, len);
+
+	// in place
+	_librist_crypto_chacha20_starts(&ctx, sunscreen_nonce, 1);
+	_librist_crypto_chacha20_crypt(&ctx, in, in, len);
+	assert_memory_equal(in, whole, len);
+	free(in);
+	free(whole);
+	free(split);
+}
+
+int main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_chacha20_block),
+		cmocka_unit_test(test_chacha20_encrypt),
+		cmocka_unit_test(test_chacha20_long),
+	};
+	fprintf(stderr, "ChaCha20 implementation: %s\n", _librist_crypto_chacha20_impl());
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,130 @@
+//Churn under load for the epoch reclaimed peer/flow lists: reader threads keep walking
+//a linked list and a copy on write array while a writer adds, removes and retires entries.
+
+#include "unit.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "src/epoch.c"
+
+#define CHURN_ITEM_ALIVE 0x600DF00D
+#define CHURN_ITEM_DEAD 0xDEADBEEF
+#define CHURN_READERS 4
+#define CHURN_ROUNDS 20000
+
+struct churn_item {
+	atomic_uint magic;
+	struct churn_item *next;
+};
+
+struct churn_state {
+	struct rist_epoch epoch;
+	struct churn_item *head;
+	void **array;
+	size_t array_len;
+	atomic_bool done;
+	atomic_ulong bad;
+	atomic_ulong walks;
+};
+
+static void churn_item_free(void *arg)
+{
+	struct churn_item *item = arg;
+	atomic_store(&item->magic, CHURN_ITEM_DEAD);
+	free(item);
+}
+
+static struct churn_item *churn_item_new(void)
+{
+	struct churn_item *item = calloc(1, sizeof(*item));
+	atomic_init(&item->magic, CHURN_ITEM_ALIVE);
+	return item;
+}
+
+static void *churn_reader(void *arg)
+{
+	struct churn_state *s = arg;
+	while (!atomic_load(&s->done)) {
+		unsigned slot = rist_epoch_enter(&s->epoch);
+		for (struct churn_item *item = *(struct churn_item *volatile *)&s->head; item; item = item->next) {
+			if (atomic_load(&item->magic) != CHURN_ITEM_ALIVE)
+				atomic_fetch_add(&s->bad, 1);
+		}
+		size_t len;
+		void **array = rist_epoch_array_get(&s->array, &s->array_len, &len);
+		for (size_t i = 0; i < len; i++) {
+			struct churn_item *item = array[i];
+			if (atomic_load(&item->magic) != CHURN_ITEM_ALIVE)
+				atomic_fetch_add(&s->bad, 1);
+		}
+		rist_epoch_leave(&s->epoch, slot);
+		atomic_fetch_add(&s->walks, 1);
+	}
+	return NULL;
+}
+
+static void test_epoch_churn(void **state)
+{
+	(void)state;
+	struct churn_state s = { 0 };
+	assert_int_equal(rist_epoch_init(&s.epoch), 0);
+	atomic_init(&s.done, false);
+	atomic_init(&s.bad, 0);
+	atomic_init(&s.walks, 0);
+
+	pthread_t readers[CHURN_READERS];
+	for (int i = 0; i < CHURN_READERS; i++)
+		assert_int_equal(pthread_create(&readers[i], NULL, churn_reader, &s), 0);
+
+	for (int round = 0; round < CHURN_ROUNDS; round++) {
+		/* list: push at the head, drop the second entry */
+		struct churn_item *item = churn_item_new();
+		item->next = s.head;
+		atomic_thread_fence(memory_order_release);
+		s.head = item;
+		if (item->next) {
+			struct churn_item *victim = item->next;
+			item->next = victim->next;
+			if (round & 1)
+				rist_epoch_retire(&s.epoch, victim, churn_item_free);
+			else {
+				rist_epoch_synchronize(&s.epoch);
+				churn_item_free(victim);
+			}
+		}
+		/* array: keep up to 8 entries */
+		struct churn_item *entry = churn_item_new();
+		assert_int_equal(rist_epoch_array_add(&s.epoch, &s.array, &s.array_len, entry), 0);
+		if (s.array_len > 8) {
+			struct churn_item *victim = s.array[round % s.array_len];
+			assert_true(rist_epoch_array_remove(&s.epoch, &s.array, &s.array_len, victim));
+			rist_epoch_retire(&s.epoch, victim, churn_item_free);
+		}
+		rist_epoch_reclaim(&s.epoch);
+	}
+
+	atomic_store(&s.done, true);
+	for (int i = 0; i < CHURN_READERS; i++)
+		pthread_join(readers[i], NULL);
+
+	assert_int_equal(atomic_load(&s.bad), 0);
+	assert_true(atomic_load(&s.walks) > 0);
+
+	while (s.head) {
+		struct churn_item *next = s.head->next;
+		churn_item_free(s.head);
+		s.head = next;
+	}
+	for (size_t i = 0; i < s.array_len; i++)
+		churn_item_free(s.array[i]);
+	free(s.array);
+	rist_epoch_destroy(&s.epoch);
+}
+
+int main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_epoch_churn),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,122 @@
+//Cold history store: sequential appends, reads across the ring wrap and overwrite detection.
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <cmocka.h>
+
+#include "src/history_store.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <dirent.h>
+
+#define RECORD 1316
+
+static void fill(uint8_t *buf, size_t len, uint32_t seq)
+{
+	for (size_t i = 0; i < len; i++)
+		buf[i] = (uint8_t)(seq * 31 + i);
+}
+
+/* Appends one chunk and a half worth of records to a one chunk ring */
+static void history_store_cycle(struct rist_history_store *s)
+{
+	assert_int_equal(s->capacity, RIST_HISTORY_STORE_CHUNK);
+	uint8_t in[RECORD], out[RECORD];
+	uint32_t count = RIST_HISTORY_STORE_CHUNK * 3 / 2 / RECORD;
+	uint64_t *pos = calloc(count, sizeof(*pos));
+	assert_non_null(pos);
+	for (uint32_t seq = 0; seq < count; seq++) {
+		fill(in, sizeof(in), seq);
+		pos[seq] = rist_history_store_append(s, in, sizeof(in));
+		assert_int_equal(pos[seq], (uint64_t)seq * RECORD);
+	}
+	uint32_t lost = 0;
+	for (uint32_t seq = 0; seq < count; seq++) {
+		if (rist_history_store_read(s, pos[seq], out, sizeof(out)) != 0) {
+			/* only the oldest records are gone */
+			assert_int_equal(lost, seq);
+			lost++;
+			continue;
+		}
+		fill(in, sizeof(in), seq);
+		assert_memory_equal(in, out, sizeof(out));
+	}
+	assert_int_equal(lost, (s->head - s->capacity + RECORD - 1) / RECORD);
+	/* nothing past the head */
+	assert_int_equal(rist_history_store_read(s, s->head, out, 1), -1);
+	free(pos);
+}
+
+static void test_history_store_anonymous(void **state)
+{
+	(void)state;
+	struct rist_history_store s;
+	assert_int_equal(rist_history_store_open(&s, 0, NULL), -1);
+	assert_int_equal(rist_history_store_open(&s, 1, NULL), 0);
+	assert_false(s.file);
+	history_store_cycle(&s);
+	rist_history_store_close(&s);
+	assert_null(s.base);
+	assert_int_equal(rist_history_store_read(&s, 0, NULL, 0), -1);
+}
+
+static int dir_entries(const char *dir)
+{
+	int count = 0;
+	DIR *d = opendir(dir);
+	assert_non_null(d);
+	for (struct dirent *e = readdir(d); e; e = readdir(d)) {
+		if (strcmp(e->d_name, ".") && strcmp(e->d_name, ".."))
+			count++;
+	}
+	closedir(d);
+	return count;
+}
+
+static void test_history_store_file(void **state)
+{
+	(void)state;
+	struct rist_history_store s;
+	char dir[] = "/tmp/rist_history_XXXXXX";
+	assert_non_null(mkdtemp(dir));
+	/* what is already in the directory is left alone */
+	char planted[sizeof(dir) + 16];
+	snprintf(planted, sizeof(planted), "%s/planted", dir);
+	FILE *f = fopen(planted, "w");
+	assert_non_null(f);
+	fputs("keep", f);
+	fclose(f);
+	assert_int_equal(rist_history_store_open(&s, RIST_HISTORY_STORE_CHUNK, dir), 0);
+	assert_true(s.file);
+	/* the backing file has no name */
+	assert_int_equal(dir_entries(dir), 1);
+	history_store_cycle(&s);
+	assert_int_equal(s.released, s.head / RIST_HISTORY_STORE_CHUNK);
+	rist_history_store_close(&s);
+	char keep[8] = { 0 };
+	f = fopen(planted, "r");
+	assert_non_null(f);
+	assert_non_null(fgets(keep, sizeof(keep), f));
+	fclose(f);
+	assert_string_equal(keep, "keep");
+
+	/* a file is not a directory */
+	assert_int_equal(rist_history_store_open(&s, 1, planted), -1);
+	assert_null(s.base);
+	unlink(planted);
+	rmdir(dir);
+
+	assert_int_equal(rist_history_store_open(&s, 1, "/nonexistent/rist_history"), -1);
+	assert_null(s.base);
+}
+
+int main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_history_store_anonymous),
+		cmocka_unit_test(test_history_store_file),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,91 @@
+//Token bucket pacing and loss backoff of the out-of-band scheduler.
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <cmocka.h>
+
+#include "src/oob_sched.c"
+
+#define TICKS 1000
+#define RATE 1000000
+
+/* Bytes sent in one second of 1 ms passes, packets of len bytes */
+static uint64_t oob_sched_second(struct rist_oob_sched *s, uint64_t *now, size_t len, bool loss)
+{
+	uint64_t sent = 0;
+	for (int i = 0; i < TICKS; i++) {
+		*now += 1;
+		rist_oob_sched_update(s, *now, loss);
+		while (rist_oob_sched_take(s, len))
+			sent += len;
+	}
+	return sent;
+}
+
+static void test_oob_sched_rate(void **state)
+{
+	(void)state;
+	struct rist_oob_sched s;
+	uint64_t now = 0;
+
+	/* not paced */
+	rist_oob_sched_init(&s, 0, TICKS, now);
+	for (int i = 0; i < 1000; i++)
+		assert_true(rist_oob_sched_take(&s, 1400));
+
+	/* the average holds, whatever the packet size */
+	rist_oob_sched_init(&s, RATE, TICKS, now);
+	uint64_t sent = oob_sched_second(&s, &now, 1400, false);
+	assert_in_range(sent, RATE * 98 / 100, RATE * 102 / 100);
+	sent = oob_sched_second(&s, &now, 9000, false);
+	assert_in_range(sent, RATE * 97 / 100, RATE * 103 / 100);
+
+	/* an idle bucket holds one burst only */
+	now += 10 * TICKS;
+	rist_oob_sched_update(&s, now, false);
+	assert_int_equal(s.tokens, RATE * RIST_OOB_SCHED_BURST_MS / 1000);
+}
+
+static void test_oob_sched_backoff(void **state)
+{
+	(void)state;
+	struct rist_oob_sched s;
+	uint64_t now = 0;
+	rist_oob_sched_init(&s, RATE, TICKS, now);
+
+	/* loss halves the rate every adjustment down to the floor */
+	oob_sched_second(&s, &now, 1400, true);
+	assert_int_equal(s.rate, RATE / RIST_OOB_SCHED_STEPS);
+	assert_int_equal(s.backoffs, 1000 / RIST_OOB_SCHED_ADJUST_MS);
+	uint64_t sent = oob_sched_second(&s, &now, 1400, true);
+	assert_true(sent <= RATE / RIST_OOB_SCHED_STEPS + RIST_OOB_SCHED_MIN_BURST);
+
+	/* a single lossy pass is remembered until the next adjustment */
+	rist_oob_sched_init(&s, RATE, TICKS, now);
+	rist_oob_sched_update(&s, now + 1, true);
+	rist_oob_sched_update(&s, now + TICKS * RIST_OOB_SCHED_ADJUST_MS / 1000, false);
+	assert_int_equal(s.rate, RATE / 2);
+
+	/* recovery is one step per clean adjustment */
+	s.rate = RATE / RIST_OOB_SCHED_STEPS;
+	now += TICKS * RIST_OOB_SCHED_ADJUST_MS / 1000;
+	for (int i = 2; i <= RIST_OOB_SCHED_STEPS; i++) {
+		now += TICKS * RIST_OOB_SCHED_ADJUST_MS / 1000;
+		rist_oob_sched_update(&s, now, false);
+		assert_int_equal(s.rate, (uint64_t)i * (RATE / RIST_OOB_SCHED_STEPS));
+	}
+	now += TICKS * RIST_OOB_SCHED_ADJUST_MS / 1000;
+	rist_oob_sched_update(&s, now, false);
+	assert_int_equal(s.rate, RATE);
+}
+
+int main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_oob_sched_rate),
+		cmocka_unit_test(test_oob_sched_backoff),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
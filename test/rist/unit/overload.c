@@ -0,0 +1,104 @@
+//Tier escalation and recovery of the receiver overload detector.
+
+#include "unit.h"
+
+#include "src/overload.c"
+
+#define LAG_UNIT 5
+#define WINDOW 100
+
+/* Runs one window worth of identical samples and closes it */
+static int overload_window(struct rist_overload *o, uint64_t *now, uint64_t lag, bool backlog, uint32_t queue_fill)
+{
+	for (int i = 0; i < 20; i++)
+		rist_overload_sample(o, lag, backlog, queue_fill);
+	*now += WINDOW;
+	return rist_overload_evaluate(o, *now);
+}
+
+static void test_overload_escalate_and_recover(void **state)
+{
+	(void)state;
+	struct rist_overload o = { .max_tier = RIST_OVERLOAD_TIER_SHED };
+	uint64_t now = 0;
+	rist_overload_init(&o, LAG_UNIT, WINDOW, now);
+
+	/* a single hot window is not enough */
+	assert_int_equal(overload_window(&o, &now, 10 * LAG_UNIT, false, 0), 0);
+	assert_int_equal(overload_window(&o, &now, 0, false, 0), 0);
+	assert_int_equal(o.tier, RIST_OVERLOAD_TIER_NONE);
+
+	/* every second hot window climbs one tier */
+	for (int tier = RIST_OVERLOAD_TIER_DRAIN; tier <= RIST_OVERLOAD_TIER_SHED; tier++) {
+		assert_int_equal(overload_window(&o, &now, 10 * LAG_UNIT, false, 0), 0);
+		assert_int_equal(overload_window(&o, &now, 10 * LAG_UNIT, false, 0), 1);
+		assert_int_equal(o.tier, tier);
+		assert_int_equal(o.entered[tier], 1);
+	}
+	/* at the top further hot windows ask for more shedding */
+	assert_int_equal(overload_window(&o, &now, 10 * LAG_UNIT, false, 0), 0);
+	assert_int_equal(overload_window(&o, &now, 10 * LAG_UNIT, false, 0), 1);
+	assert_int_equal(o.tier, RIST_OVERLOAD_TIER_SHED);
+
+	/* in between windows (some late loops) hold the tier */
+	for (int i = 0; i < 10; i++) {
+		for (int j = 0; j < 20; j++)
+			rist_overload_sample(&o, j % 4 == 0 ? 3 * LAG_UNIT : 0, false, 0);
+		now += WINDOW;
+		assert_int_equal(rist_overload_evaluate(&o, now), 0);
+	}
+	assert_int_equal(o.tier, RIST_OVERLOAD_TIER_SHED);
+
+	/* calm windows step down again */
+	for (int tier = RIST_OVERLOAD_TIER_SHED; tier > RIST_OVERLOAD_TIER_NONE; tier--) {
+		for (int i = 1; i < RIST_OVERLOAD_RECOVER_WINDOWS; i++)
+			assert_int_equal(overload_window(&o, &now, 0, false, 0), 0);
+		assert_int_equal(overload_window(&o, &now, 0, false, 0), -1);
+		assert_int_equal(o.tier, tier - 1);
+		assert_int_equal(o.exited[tier], 1);
+	}
+	assert_int_equal(overload_window(&o, &now, 0, false, 0), 0);
+}
+
+static void test_overload_signals(void **state)
+{
+	(void)state;
+	struct rist_overload o = { .max_tier = RIST_OVERLOAD_TIER_DRAIN };
+	uint64_t now = 0;
+	rist_overload_init(&o, LAG_UNIT, WINDOW, now);
+
+	/* a full missing queue on an idle loop is network loss, not overload */
+	for (int i = 0; i < 5; i++)
+		assert_int_equal(overload_window(&o, &now, 0, false, 100), 0);
+	assert_int_equal(o.tier, RIST_OVERLOAD_TIER_NONE);
+
+	/* an occasional backlogged read round is fine, a persistent backlog is not */
+	for (int i = 0; i < 5; i++) {
+		for (int j = 0; j < 20; j++)
+			rist_overload_sample(&o, 0, j % 5 == 0, 0);
+		now += WINDOW;
+		assert_int_equal(rist_overload_evaluate(&o, now), 0);
+	}
+	assert_int_equal(o.tier, RIST_OVERLOAD_TIER_NONE);
+	assert_int_equal(overload_window(&o, &now, 0, true, 0), 0);
+	assert_int_equal(overload_window(&o, &now, 0, true, 0), 1);
+	assert_int_equal(o.tier, RIST_OVERLOAD_TIER_DRAIN);
+
+	/* max_tier caps the escalation */
+	for (int i = 0; i < 6; i++)
+		assert_int_equal(overload_window(&o, &now, 10 * LAG_UNIT, false, 0), 0);
+	assert_int_equal(o.tier, RIST_OVERLOAD_TIER_DRAIN);
+
+	/* nothing happens before the window is over */
+	rist_overload_sample(&o, 10 * LAG_UNIT, false, 0);
+	assert_int_equal(rist_overload_evaluate(&o, now + WINDOW / 2), 0);
+}
+
+int main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_overload_escalate_and_recover),
+		cmocka_unit_test(test_overload_signals),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,126 @@
+//Deferred teardown: objects handed to the reaper are reclaimed on its thread after the
+//readers that may hold them are gone, inline when there is no thread. Handing over never
+//reaps inline while the thread runs, however long the backlog.
+
+#include "unit.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "src/epoch.c"
+#include "src/reaper.c"
+
+struct reap_item {
+	atomic_bool reaped;
+	pthread_t by;
+	struct rist_reaper_job job;
+};
+
+static void reap_item(void *arg)
+{
+	struct reap_item *item = arg;
+	item->by = pthread_self();
+	atomic_store(&item->reaped, true);
+}
+
+static atomic_bool hold;
+
+static void reap_item_held(void *arg)
+{
+	while (atomic_load(&hold))
+		usleep(1000);
+	reap_item(arg);
+}
+
+static void wait_idle(struct rist_reaper *r)
+{
+	for (int i = 0; i < 2000 && atomic_load(&r->pending) > 0; i++)
+		usleep(1000);
+	assert_int_equal(atomic_load(&r->pending), 0);
+	assert_int_equal(atomic_load(&r->pending_bytes), 0);
+}
+
+static void test_reaper_inline(void **state)
+{
+	(void)state;
+	struct rist_epoch epoch;
+	struct rist_reaper r;
+	struct reap_item item = { .reaped = false };
+	assert_int_equal(rist_epoch_init(&epoch), 0);
+	assert_int_equal(rist_reaper_init(&r, &epoch), 0);
+	/* no thread yet */
+	rist_reaper_defer(&r, &item.job, &item, reap_item, 100);
+	assert_true(atomic_load(&item.reaped));
+	assert_true(pthread_equal(item.by, pthread_self()));
+	rist_reaper_destroy(&r);
+	rist_epoch_destroy(&epoch);
+}
+
+static void test_reaper_thread(void **state)
+{
+	(void)state;
+	struct rist_epoch epoch;
+	struct rist_reaper r;
+	struct reap_item items[64];
+	assert_int_equal(rist_epoch_init(&epoch), 0);
+	assert_int_equal(rist_reaper_init(&r, &epoch), 0);
+	assert_int_equal(pthread_create(&r.thread, NULL, rist_reaper_thread, &r), 0);
+	r.running = true;
+
+	/* a reader inside its section holds back the batch */
+	unsigned slot = rist_epoch_enter(&epoch);
+	for (size_t i = 0; i < 8; i++) {
+		atomic_init(&items[i].reaped, false);
+		rist_reaper_defer(&r, &items[i].job, &items[i], reap_item, 100);
+	}
+	/* nothing is reaped while the reader is inside */
+	usleep(20000);
+	for (size_t i = 0; i < 8; i++)
+		assert_false(atomic_load(&items[i].reaped));
+	assert_int_equal(atomic_load(&r.pending_bytes), 800);
+	rist_epoch_leave(&epoch, slot);
+	wait_idle(&r);
+	for (size_t i = 0; i < 8; i++) {
+		assert_true(atomic_load(&items[i].reaped));
+		assert_false(pthread_equal(items[i].by, pthread_self()));
+	}
+
+	for (size_t i = 0; i < 64; i++) {
+		atomic_init(&items[i].reaped, false);
+		rist_reaper_defer(&r, &items[i].job, &items[i], reap_item, 10);
+	}
+	wait_idle(&r);
+
+	/* a reader inside its section with a batch held up behind it, the caller
+	 * never waits: it may be that reader */
+	atomic_store(&hold, true);
+	atomic_init(&items[0].reaped, false);
+	atomic_init(&items[1].reaped, false);
+	rist_reaper_defer(&r, &items[0].job, &items[0], reap_item_held, 1000);
+	usleep(20000);
+	slot = rist_epoch_enter(&epoch);
+	rist_reaper_defer(&r, &items[1].job, &items[1], reap_item, 100);
+	assert_false(atomic_load(&items[1].reaped));
+	assert_false(atomic_load(&items[0].reaped));
+	assert_int_equal(atomic_load(&r.pending), 2);
+	rist_epoch_leave(&epoch, slot);
+
+	/* destroy reaps what is left */
+	for (size_t i = 2; i < 8; i++) {
+		atomic_init(&items[i].reaped, false);
+		rist_reaper_defer(&r, &items[i].job, &items[i], reap_item, 1);
+	}
+	atomic_store(&hold, false);
+	rist_reaper_destroy(&r);
+	for (size_t i = 0; i < 8; i++)
+		assert_true(atomic_load(&items[i].reaped));
+	rist_epoch_destroy(&epoch);
+}
+
+int main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_reaper_inline),
+		cmocka_unit_test(test_reaper_thread),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
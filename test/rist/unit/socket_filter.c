@@ -0,0 +1,132 @@
+//Receive socket filter: header shape and source allowlist on a loopback socket pair.
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <cmocka.h>
+
+#include "src/socket_filter.c"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct socket_pair {
+	int rx;
+	int tx;
+	struct sockaddr_in rx_addr;
+};
+
+static int setup(void **state)
+{
+	static struct socket_pair p;
+	p.rx = socket(AF_INET, SOCK_DGRAM, 0);
+	p.tx = socket(AF_INET, SOCK_DGRAM, 0);
+	assert_true(p.rx >= 0 && p.tx >= 0);
+	memset(&p.rx_addr, 0, sizeof(p.rx_addr));
+	p.rx_addr.sin_family = AF_INET;
+	p.rx_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	assert_int_equal(bind(p.rx, (struct sockaddr *)&p.rx_addr, sizeof(p.rx_addr)), 0);
+	socklen_t len = sizeof(p.rx_addr);
+	assert_int_equal(getsockname(p.rx, (struct sockaddr *)&p.rx_addr, &len), 0);
+	struct timeval tv = { .tv_sec = 0, .tv_usec = 100000 };
+	setsockopt(p.rx, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	*state = &p;
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	struct socket_pair *p = *state;
+	close(p->rx);
+	close(p->tx);
+	return 0;
+}
+
+/* Sends one datagram and tells whether it made it through the filter */
+static bool passes(struct socket_pair *p, const uint8_t *buf, size_t len)
+{
+	uint8_t rx[64];
+	assert_int_equal(sendto(p->tx, buf, len, 0, (struct sockaddr *)&p->rx_addr, sizeof(p->rx_addr)), (ssize_t)len);
+	return recv(p->rx, rx, sizeof(rx), 0) == (ssize_t)len;
+}
+
+static void test_socket_filter_gre(void **state)
+{
+	struct socket_pair *p = *state;
+	struct rist_socket_filter_spec spec = { .gre = true, .check_key = true, .encrypted = true };
+	assert_int_equal(rist_socket_filter_attach(p->rx, &spec), 0);
+
+	uint8_t keyed[16] = { 0x30, 0x10, 0x88, 0xb6 };
+	uint8_t eap[8] = { 0x00, 0x10, 0x88, 0x8e };
+	uint8_t clear[8] = { 0x00, 0x10, 0x88, 0xb6 };
+	uint8_t reserved[16] = { 0x70, 0x10, 0x88, 0xb6 };
+	uint8_t version[16] = { 0x30, 0x11, 0x88, 0xb6 };
+	uint8_t protocol[16] = { 0x30, 0x10, 0x12, 0x34 };
+	uint8_t rtp[16] = { 0x80, 0x21 };
+	uint32_t drops = rist_socket_filter_drops(p->rx);
+	assert_true(passes(p, keyed, sizeof(keyed)));
+	assert_true(passes(p, eap, sizeof(eap)));
+	assert_false(passes(p, clear, sizeof(clear)));
+	assert_false(passes(p, reserved, sizeof(reserved)));
+	assert_false(passes(p, version, sizeof(version)));
+	assert_false(passes(p, protocol, sizeof(protocol)));
+	assert_false(passes(p, rtp, sizeof(rtp)));
+	assert_false(passes(p, keyed, 3));
+	assert_int_equal(rist_socket_filter_drops(p->rx) - drops, 6);
+
+	spec.encrypted = false;
+	assert_int_equal(rist_socket_filter_attach(p->rx, &spec), 0);
+	assert_true(passes(p, clear, sizeof(clear)));
+	assert_true(passes(p, eap, sizeof(eap)));
+	assert_false(passes(p, keyed, sizeof(keyed)));
+
+	assert_int_equal(rist_socket_filter_detach(p->rx), 0);
+	assert_true(passes(p, rtp, sizeof(rtp)));
+}
+
+static void test_socket_filter_sources(void **state)
+{
+	struct socket_pair *p = *state;
+	struct rist_socket_filter_spec spec = { .gre = false };
+	uint8_t rtp[12] = { 0x80, 0x21 };
+	struct sockaddr_in other = { .sin_family = AF_INET };
+	inet_pton(AF_INET, "192.0.2.1", &other.sin_addr);
+	struct sockaddr_in6 other6 = { .sin6_family = AF_INET6 };
+	inet_pton(AF_INET6, "2001:db8::1", &other6.sin6_addr);
+	struct sockaddr_in6 mapped = { .sin6_family = AF_INET6 };
+	inet_pton(AF_INET6, "::ffff:127.0.0.1", &mapped.sin6_addr);
+
+	assert_int_equal(rist_socket_filter_add_source(&spec, (struct sockaddr *)&other), 0);
+	assert_int_equal(rist_socket_filter_add_source(&spec, (struct sockaddr *)&other6), 0);
+	assert_int_equal(rist_socket_filter_attach(p->rx, &spec), 0);
+	assert_false(passes(p, rtp, sizeof(rtp)));
+
+	/* the mapped loopback address is the IPv4 source of the pair */
+	assert_int_equal(rist_socket_filter_add_source(&spec, (struct sockaddr *)&mapped), 0);
+	assert_int_equal(rist_socket_filter_add_source(&spec, (struct sockaddr *)&mapped), 0);
+	assert_int_equal(spec.source_count, 3);
+	assert_int_equal(rist_socket_filter_attach(p->rx, &spec), 0);
+	assert_true(passes(p, rtp, sizeof(rtp)));
+	rtp[0] = 0x40;
+	assert_false(passes(p, rtp, sizeof(rtp)));
+
+	/* a full allowlist still builds a valid program */
+	while (rist_socket_filter_add_source(&spec, (struct sockaddr *)&other6) == 0)
+		other6.sin6_addr.s6_addr[15]++;
+	assert_int_equal(spec.source_count, RIST_SOCKET_FILTER_MAX_SOURCES);
+	spec.gre = true;
+	spec.check_key = true;
+	assert_int_equal(rist_socket_filter_attach(p->rx, &spec), 0);
+	rist_socket_filter_detach(p->rx);
+}
+
+int main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(test_socket_filter_gre, setup, teardown),
+		cmocka_unit_test_setup_teardown(test_socket_filter_sources, setup, teardown),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
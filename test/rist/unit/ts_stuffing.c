@@ -0,0 +1,117 @@
+//Round trip of the MPEG-TS adaptation field stuffing suppression, alone and
+//combined with null packet deletion, on 188 and 204 byte packets.
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <cmocka.h>
+#include <stdlib.h>
+
+#include "src/mpegts.c"
+
+static void ts_packet(uint8_t *pkt, size_t packet_size, uint16_t pid, uint8_t af_len, uint8_t private_tail)
+{
+	memset(pkt, 0, packet_size);
+	pkt[0] = 0x47;
+	pkt[1] = (pid >> 8) & 0x1F;
+	pkt[2] = pid & 0xFF;
+	if (pid == 0x1FFF) {
+		pkt[3] = 0x10;
+		memset(&pkt[4], 0xFF, packet_size - 4);
+		return;
+	}
+	pkt[3] = af_len ? 0x30 : 0x10;
+	size_t payload_start = 4;
+	if (af_len) {
+		pkt[4] = af_len;
+		pkt[5] = 0x10; //PCR flag
+		memset(&pkt[6], 0x5A, 6);
+		//optional fields that end in 0xFF themselves
+		memset(&pkt[12], 0xFF, private_tail);
+		memset(&pkt[12 + private_tail], 0xFF, af_len - 7 - private_tail);
+		payload_start = 5 + af_len;
+	}
+	for (size_t i = payload_start; i < 188; i++)
+		pkt[i] = (uint8_t)(i * 7);
+	for (size_t i = 188; i < packet_size; i++)
+		pkt[i] = 0xA5;
+}
+
+static void round_trip(size_t packet_size, bool npd)
+{
+	const uint8_t af_lens[7] = { 183, 0, 100, 7, 150, 0, 20 };
+	const uint16_t pids[7] = { 0x100, 0x101, 0x1FFF, 0x100, 0x100, 0x1FFF, 0x102 };
+	uint8_t in[7 * 204];
+	for (int i = 0; i < 7; i++)
+		ts_packet(&in[i * packet_size], packet_size, pids[i], af_lens[i], i == 4 ? 3 : 0);
+	size_t len = 7 * packet_size;
+
+	uint8_t ts_buf[7 * 204];
+	struct rist_rtp_hdr_ext hdr_ext = { 0 };
+	struct rist_rtp_hdr_ext_stuffing stuffing;
+	const uint8_t *ts = in;
+	if (npd) {
+		assert_int_equal(suppress_null_packets(in, ts_buf, &len, &hdr_ext), 2);
+		ts = ts_buf;
+	}
+	int removed = suppress_ts_stuffing(ts, ts_buf, &len, &hdr_ext, &stuffing);
+	assert_true(removed > 300);
+	assert_true(CHECK_BIT(hdr_ext.flags, 6));
+	assert_int_equal(len, (npd ? 5 : 7) * packet_size - (size_t)removed);
+
+	uint8_t out[RIST_MAX_PACKET_SIZE];
+	memcpy(out, ts_buf, len);
+	assert_int_equal(expand_ts_stuffing(out, &len, hdr_ext.npd_bits, &stuffing), removed);
+	if (npd)
+		expand_null_packets(out, &len, hdr_ext.npd_bits);
+	assert_int_equal(len, 7 * packet_size);
+	assert_memory_equal(out, in, len);
+}
+
+static void test_ts_stuffing_188(void **state)
+{
+	(void)state;
+	round_trip(188, false);
+}
+
+static void test_ts_stuffing_204(void **state)
+{
+	(void)state;
+	round_trip(204, false);
+}
+
+static void test_ts_stuffing_npd(void **state)
+{
+	(void)state;
+	round_trip(188, true);
+	round_trip(204, true);
+}
+
+static void test_ts_stuffing_not_worth_it(void **state)
+{
+	(void)state;
+	uint8_t in[2 * 188];
+	ts_packet(&in[0], 188, 0x100, 0, 0);
+	ts_packet(&in[188], 188, 0x100, 9, 0);
+	size_t len = sizeof(in);
+	struct rist_rtp_hdr_ext hdr_ext = { 0 };
+	struct rist_rtp_hdr_ext_stuffing stuffing;
+	uint8_t out[sizeof(in)];
+	assert_int_equal(suppress_ts_stuffing(in, out, &len, &hdr_ext, &stuffing), 0);
+	assert_int_equal(len, sizeof(in));
+	assert_false(CHECK_BIT(hdr_ext.flags, 6));
+	len = 100;
+	assert_int_equal(suppress_ts_stuffing(in, out, &len, &hdr_ext, &stuffing), -1);
+}
+
+int main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_ts_stuffing_188),
+		cmocka_unit_test(test_ts_stuffing_204),
+		cmocka_unit_test(test_ts_stuffing_npd),
+		cmocka_unit_test(test_ts_stuffing_not_worth_it),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,73 @@
+/* librist. Copyright © 2026 SipRadius LLC. All right reserved.
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* The unit tests that include this run on cmocka when it is found and on the
+ * subset of its API below otherwise, so that they are part of every build.
+ * A failed check ends the test it is in, the others still run. Checks only
+ * work on the thread that runs the test. */
+
+#ifndef RIST_TEST_UNIT_H
+#define RIST_TEST_UNIT_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+
+#ifdef HAVE_CMOCKA
+#include <cmocka.h>
+#else
+#include <stdio.h>
+#include <string.h>
+
+struct CMUnitTest {
+	const char *name;
+	void (*test_func)(void **state);
+};
+
+#define cmocka_unit_test(f) { #f, f }
+
+static jmp_buf unit_test_env;
+
+static inline void unit_fail(const char *file, int line, const char *what)
+{
+	fprintf(stderr, "%s:%d: %s\n", file, line, what);
+	longjmp(unit_test_env, 1);
+}
+
+#define unit_check(c, what) do { if (!(c)) unit_fail(__FILE__, __LINE__, what); } while (0)
+
+#define assert_true(c) unit_check((c), #c " is false")
+#define assert_false(c) unit_check(!(c), #c " is true")
+#define assert_non_null(p) unit_check((p) != NULL, #p " is NULL")
+#define assert_memory_equal(a, b, len) unit_check(memcmp((a), (b), (len)) == 0, #a " differs from " #b)
+#define assert_int_equal(a, b) do { \
+		uintmax_t unit_a = (uintmax_t)(a), unit_b = (uintmax_t)(b); \
+		if (unit_a != unit_b) { \
+			fprintf(stderr, "%#jx != %#jx\n", unit_a, unit_b); \
+			unit_fail(__FILE__, __LINE__, #a " != " #b); \
+		} \
+	} while (0)
+
+static inline int unit_run_tests(const struct CMUnitTest *tests, size_t count)
+{
+	/* kept across the longjmp */
+	volatile int failures = 0;
+	for (volatile size_t i = 0; i < count; i++) {
+		if (setjmp(unit_test_env) == 0) {
+			tests[i].test_func(NULL);
+			fprintf(stderr, "[       OK ] %s\n", tests[i].name);
+		} else {
+			fprintf(stderr, "[  FAILED  ] %s\n", tests[i].name);
+			failures++;
+		}
+	}
+	return failures;
+}
+
+/* No group setup or teardown */
+#define cmocka_run_group_tests(tests, setup, teardown) unit_run_tests((tests), sizeof(tests) / sizeof((tests)[0]))
+#endif
+
+#endif /* RIST_TEST_UNIT_H */
@@ -56,6 +56,7 @@ static struct option long_options[] = {
 { "statsinterval",   required_argument, NULL, 'S' },
 { "verbose-level",   required_argument, NULL, 'v' },
 { "remote-logging",  required_argument, NULL, 'r' },
+{ "relay",           no_argument,       NULL, 1 },
 #if HAVE_SRP_SUPPORT
 { "srpfile",         required_argument, NULL, 'F' },
 #endif
@@ -72,6 +73,8 @@ const char help_str[] = "Usage: %s [OPTIONS] \nWhere OPTIONS are:\n"
 "       -N | --cname identifier                   | Manually configured identifier                           |\n"
 "       -v | --verbose-level value                | To disable logging: -1, log levels match syslog levels   |\n"
 "       -r | --remote-logging IP:PORT             | Send logs and stats to this IP:PORT using udp messages   |\n"
+"          | --relay                              | Cut-through relay: forward packets as they arrive with   |\n"
+"                                                 | their sequence numbers instead of after the input buffer |\n"
 #if HAVE_SRP_SUPPORT
 "       -F | --srpfile filepath                   | When in listening mode, use this file to hold the list   |\n"
 "                                                 | of usernames and passwords to validate against. Use the  |\n"
@@ -275,6 +278,7 @@ int main (int argc, char **argv) {
 	enum rist_log_level loglevel = RIST_LOG_INFO;
 	char *remote_log_address = NULL;
 	int exitcode = 0;
+	int relay = 0;
 #ifdef _WIN32
 #define STDERR_FILENO 2
 	signal(SIGINT, intHandler);
@@ -345,6 +349,9 @@ int main (int argc, char **argv) {
 		case 'S':
 			statsinterval = atoi(optarg);
 			break;
+		case 1:
+			relay = 1;
+			break;
 		case 'u':
 			rist_log(&logging_settings, RIST_LOG_INFO, "%s", help_urlstr);
 			exit(1);
@@ -444,6 +451,11 @@ usage:
 		}
 	}
 	cb_arg.sender_ctx = setup_rist_sender(&client_args);
+	if (relay && rist_receiver_relay_set(receiver_ctx, cb_arg.sender_ctx) != 0) {
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not enable the cut-through relay\n");
+		exitcode = 1;
+		goto out;
+	}
 	if (rist_start(receiver_ctx)) {
 		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not start rist receiver\n");
 		exitcode = 1;
@@ -463,7 +475,13 @@ usage:
 		{
 			struct rist_data_block *b;
 			int ret = rist_receiver_data_read2(receiver_ctx, &b, 5);
-			if (ret && b && b->payload) cb_recv(&cb_arg, b);
+			if (ret && b && b->payload) {
+				/* relay mode: the library already forwarded it */
+				if (relay)
+					rist_receiver_data_block_free2(&b);
+				else
+					cb_recv(&cb_arg, b);
+			}
 		}
 	}
 
@@ -81,6 +81,14 @@ static struct option long_options[] = {
 { "stats",           required_argument, NULL, 'S' },
 { "verbose-level",   required_argument, NULL, 'v' },
 { "remote-logging",  required_argument, NULL, 'r' },
+{ "stats-shm",       required_argument, NULL, 5 },
+{ "nack-budget",     required_argument, NULL, 6 },
+{ "overload-tier",   required_argument, NULL, 7 },
+{ "socket-filter",   required_argument, NULL, 8 },
+{ "oob-rate",        required_argument, NULL, 9 },
+{ "oob-delay",       required_argument, NULL, 10 },
+{ "early-renack",    no_argument,       NULL, 11 },
+{ "resync-policy",   required_argument, NULL, 12 },
 #if HAVE_SRP_SUPPORT
 { "srpfile",         required_argument, NULL, 'F' },
 #endif
@@ -117,6 +125,21 @@ const char help_str[] = "Usage: %s [OPTIONS] \nWhere OPTIONS are:\n"
 "       -S | --statsinterval value (ms)           | Interval at which stats get printed, 0 to disable        |\n"
 "       -v | --verbose-level value                | To disable logging: -1, log levels match syslog levels   |\n"
 "       -r | --remote-logging IP:PORT             | Send logs and stats to this IP:PORT using udp messages   |\n"
+"          | --stats-shm filepath                 | Publish live counters to this file for riststats         |\n"
+"          | --nack-budget value                  | Missing packets each flow may process per nack round,    |\n"
+"                                                 | scaled by the flow-weight url parameter (0 = no limit)   |\n"
+"          | --overload-tier value                | Highest degradation tier when the host is overloaded:    |\n"
+"                                                 | 0 = off, 1 = drain sockets first, 2 = + no late nacks,   |\n"
+"                                                 | 3 = + reduced stats/logging, 4 = + shed low weight flows |\n"
+"          | --socket-filter value                | Drop unwanted datagrams in the kernel (Linux): 0 = off,  |\n"
+"                                                 | 1 = header check, 2 = + address of connecting peers      |\n"
+"          | --oob-rate kbps                      | Pace out-of-band/tun data below the media, backing off   |\n"
+"                                                 | while the media shows loss (0 = no limit)                |\n"
+"          | --oob-delay ms                       | Drop out-of-band data queued for longer than this        |\n"
+"          | --early-renack                       | Nack lost retransmissions again as soon as a later one   |\n"
+"                                                 | of the same nack arrives (single path flows)             |\n"
+"          | --resync-policy value                | Resync flows on a sender restart or discontinuity: 0 =   |\n"
+"                                                 | off, 1 = flush the buffer, 2 = drain the buffer first    |\n"
 #if HAVE_SRP_SUPPORT
 "       -F | --srpfile filepath                   | When in listening mode, use this file to hold the list   |\n"
 "                                                 | of usernames and passwords to validate against. Use the  |\n"
@@ -515,6 +538,14 @@ int main(int argc, char *argv[])
 	enum rist_log_level loglevel = RIST_LOG_INFO;
 	int statsinterval = 1000;
 	char *remote_log_address = NULL;
+	char *stats_shm = NULL;
+	uint32_t nack_budget = 0;
+	int overload_tier = 0;
+	int socket_filter = 0;
+	uint32_t oob_rate = 0;
+	uint32_t oob_delay = 0;
+	bool early_renack = false;
+	int resync_policy = 0;
 	if (pthread_mutex_init(&signal_lock, NULL) != 0)
 	{
 		fprintf(stderr, "Could not initialize signal lock\n");
@@ -591,6 +622,30 @@ int main(int argc, char *argv[])
 		case 'r':
 			remote_log_address = strdup(optarg);
 		break;
+		case 5:
+			stats_shm = strdup(optarg);
+		break;
+		case 6:
+			nack_budget = (uint32_t)atoi(optarg);
+		break;
+		case 7:
+			overload_tier = atoi(optarg);
+		break;
+		case 8:
+			socket_filter = atoi(optarg);
+		break;
+		case 9:
+			oob_rate = (uint32_t)atoi(optarg);
+		break;
+		case 10:
+			oob_delay = (uint32_t)atoi(optarg);
+		break;
+		case 11:
+			early_renack = true;
+		break;
+		case 12:
+			resync_policy = atoi(optarg);
+		break;
 #if HAVE_SRP_SUPPORT
 		case 'F': {
 			FILE* f = fopen(optarg, "r");
@@ -695,6 +750,10 @@ int main(int argc, char *argv[])
 			rist_log(&logging_settings, RIST_LOG_ERROR, "Could not add enable out-of-band data\n");
 			exit(1);
 		}
+		if ((oob_rate || oob_delay) && rist_oob_bandwidth_set(ctx, oob_rate, oob_delay) != 0) {
+			rist_log(&logging_settings, RIST_LOG_ERROR, "Could not set the out-of-band rate\n");
+			exit(1);
+		}
 	}
 
 	if (rist_stats_callback_set(ctx, statsinterval, cb_stats, (void*)0) == -1) {
@@ -702,6 +761,36 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
+	if (stats_shm && rist_set_opt(ctx, RIST_OPT_STATS_SHM, stats_shm, NULL, NULL) != 0) {
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not enable stats page %s\n", stats_shm);
+		exit(1);
+	}
+
+	if (nack_budget && rist_receiver_flow_nack_budget_set(ctx, nack_budget) != 0) {
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not set the nack budget\n");
+		exit(1);
+	}
+
+	if (early_renack && rist_receiver_early_renack_set(ctx, true) != 0) {
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not enable early re-nacks\n");
+		exit(1);
+	}
+
+	if (resync_policy && rist_receiver_resync_policy_set(ctx, (enum rist_resync_policy)resync_policy) != 0) {
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not set the resync policy\n");
+		exit(1);
+	}
+
+	if (overload_tier && rist_receiver_overload_control_set(ctx, (enum rist_overload_tier)overload_tier) != 0) {
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not enable overload control\n");
+		exit(1);
+	}
+
+	if (socket_filter && rist_receiver_socket_filter_set(ctx, (enum rist_socket_filter)socket_filter) != 0) {
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not enable the socket filter\n");
+		exit(1);
+	}
+
 #ifdef USE_TUN
 	// Setup tun device
 	if (oobtun) {
@@ -980,6 +1069,8 @@ next:
 		free(inputurl);
 	if (outputurl)
 		free(outputurl);
+	if (stats_shm)
+		free(stats_shm);
 #ifdef USE_TUN
 	if (thread_tun_loop)
 		pthread_join(thread_tun_loop, NULL);
@@ -91,6 +91,11 @@ struct rist_sender_args {
 	int buffer_size;
 	int statsinterval;
 	uint16_t stream_id;
+	uint32_t oob_rate;
+	uint32_t oob_delay;
+	uint32_t history_mb;
+	uint32_t history_hot;
+	char *history_dir;
 #ifdef USE_TUN
 	struct rist_callback_tun_object *callback_tun_object;
 #endif
@@ -116,6 +121,13 @@ static struct option long_options[] = {
 { "encryption-type", required_argument, NULL, 'e' },
 { "profile",         required_argument, NULL, 'p' },
 { "null-packet-deletion",  no_argument, NULL, 'n' },
+{ "ts-stuffing-suppression", no_argument, NULL, 5 },
+{ "restart-marker",  no_argument,       NULL, 6 },
+{ "oob-rate",        required_argument, NULL, 7 },
+{ "oob-delay",       required_argument, NULL, 8 },
+{ "history-store",   required_argument, NULL, 9 },
+{ "history-dir",     required_argument, NULL, 10 },
+{ "history-hot",     required_argument, NULL, 11 },
 #ifdef USE_TUN
 { "tun",             required_argument, NULL, 't' },
 { "tun-mode",        required_argument, NULL, 'm' },
@@ -158,6 +170,18 @@ const char help_str[] = "Usage: %s [OPTIONS] \nWhere OPTIONS are:\n"
 "       -e | --encryption-type TYPE               | Default Encryption type (0, 128 = AES-128, 256 = AES-256)|\n"
 "       -p | --profile number                     | Rist profile (0 = simple, 1 = main, 2 = advanced)        |\n"
 "       -n | --null-packet-deletion               | Enable NPD, receiver needs to support this!              |\n"
+"          | --ts-stuffing-suppression            | Strip TS adaptation field stuffing. Not negotiated,      |\n"
+"                                                 | receivers without support (earlier librist, other        |\n"
+"                                                 | vendors) output corrupt TS, enable only if all support it|\n"
+"          | --restart-marker                     | Flag the first packets so receivers resync immediately   |\n"
+"                                                 | (receivers need a resync policy, see ristreceiver)       |\n"
+"          | --oob-rate kbps                      | Pace out-of-band/tun data below the media, backing off   |\n"
+"                                                 | while the media shows loss (0 = no limit)                |\n"
+"          | --oob-delay ms                       | Drop out-of-band data queued for longer than this        |\n"
+"          | --history-store MB                   | Move retransmission history older than --history-hot out |\n"
+"                                                 | of the heap into a ring of this size, for long buffers   |\n"
+"          | --history-dir path                   | Back the history ring with a file in this directory      |\n"
+"          | --history-hot ms                     | Age at which history moves to the ring (default 1000)    |\n"
 "       -S | --statsinterval value (ms)           | Interval at which stats get printed, 0 to disable        |\n"
 "       -v | --verbose-level value                | To disable logging: -1, log levels match syslog levels   |\n"
 "       -r | --remote-logging IP:PORT             | Send logs and stats to this IP:PORT using udp messages   |\n"
@@ -469,6 +493,8 @@ static struct rist_peer* setup_rist_peer(struct rist_ctx_wrap *w, struct rist_se
 			rist_log(&logging_settings, RIST_LOG_ERROR, "Could not enable out-of-band data\n");
 			return NULL;
 		}
+		if ((setup->oob_rate || setup->oob_delay) && rist_oob_bandwidth_set(ctx, setup->oob_rate, setup->oob_delay) != 0)
+			rist_log(&logging_settings, RIST_LOG_WARN, "Could not set the out-of-band rate\n");
 	}
 
 	if (rist_stats_callback_set(ctx, setup->statsinterval, cb_stats, NULL) == -1) {
@@ -655,7 +681,7 @@ static PTHREAD_START_FUNC(input_loop, arg)
 
 static struct rist_ctx_wrap *configure_rist_output_context(char* outputurl,
 	struct rist_sender_args *peer_args, const struct rist_udp_config *udp_config,
-	bool npd, enum rist_profile profile)
+	bool npd, bool ts_stuffing, bool restart_marker, enum rist_profile profile)
 {
 	struct rist_ctx *sender_ctx;
 	// Setup the output rist objects (a brand new instance per receiver)
@@ -682,6 +708,12 @@ static struct rist_ctx_wrap *configure_rist_output_context(char* outputurl,
 			rist_log(&logging_settings, RIST_LOG_ERROR, "Failed to enable null packet deletion\n");
 		}
 	}
+	if (ts_stuffing && rist_sender_ts_stuffing_enable(sender_ctx) != 0)
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Failed to enable TS stuffing suppression\n");
+	if (restart_marker && rist_sender_restart_marker_enable(sender_ctx) != 0)
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Failed to enable the restart marker\n");
+	if (peer_args->history_mb && rist_sender_history_set(sender_ctx, peer_args->history_hot, (size_t)peer_args->history_mb * 1024 * 1024, peer_args->history_dir) != 0)
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Failed to set up the history store, keeping the history in memory\n");
 	for (size_t j = 0; j < MAX_OUTPUT_COUNT; j++) {
 		peer_args->token = outputtoken;
 		peer_args->stream_id = udp_config->stream_id;
@@ -719,6 +751,13 @@ int main(int argc, char *argv[])
 	enum rist_profile profile = RIST_PROFILE_MAIN;
 	enum rist_log_level loglevel = RIST_LOG_INFO;
 	bool npd = false;
+	bool ts_stuffing = false;
+	bool restart_marker = false;
+	uint32_t oob_rate = 0;
+	uint32_t oob_delay = 0;
+	uint32_t history_mb = 0;
+	uint32_t history_hot = 1000;
+	char *history_dir = NULL;
 	int faststart = 0;
 	struct rist_sender_args peer_args;
 	char *remote_log_address = NULL;
@@ -811,6 +850,27 @@ int main(int argc, char *argv[])
 		case 'n':
 			npd = true;
 			break;
+		case 5:
+			ts_stuffing = true;
+			break;
+		case 6:
+			restart_marker = true;
+			break;
+		case 7:
+			oob_rate = (uint32_t)atoi(optarg);
+			break;
+		case 8:
+			oob_delay = (uint32_t)atoi(optarg);
+			break;
+		case 9:
+			history_mb = (uint32_t)atoi(optarg);
+			break;
+		case 10:
+			history_dir = strdup(optarg);
+			break;
+		case 11:
+			history_hot = (uint32_t)atoi(optarg);
+			break;
 #if HAVE_PROMETHEUS_SUPPORT
 		case 'M':
 			enable_prometheus = true;
@@ -888,6 +948,11 @@ int main(int argc, char *argv[])
 	peer_args.shared_secret = shared_secret;
 	peer_args.buffer_size = buffer_size;
 	peer_args.statsinterval = statsinterval;
+	peer_args.oob_rate = oob_rate;
+	peer_args.oob_delay = oob_delay;
+	peer_args.history_mb = history_mb;
+	peer_args.history_hot = history_hot;
+	peer_args.history_dir = history_dir;
 
 #ifdef USE_TUN
 	// Setup tun device
@@ -957,7 +1022,7 @@ int main(int argc, char *argv[])
 		else
 		{
 			// A brand new instance/context per receiver
-			callback_object[i].sender_ctx = configure_rist_output_context(outputurl, &peer_args, udp_config, npd, profile);
+			callback_object[i].sender_ctx = configure_rist_output_context(outputurl, &peer_args, udp_config, npd, ts_stuffing, restart_marker, profile);
 			if (callback_object[i].sender_ctx == NULL)
 				goto shutdown;
 		}
@@ -1119,6 +1184,7 @@ shutdown:
 #endif
 	if (shared_secret)
 		free(shared_secret);
+	free(history_dir);
 
 #if HAVE_PROMETHEUS_SUPPORT
 	rist_prometheus_stats_destroy(prom_stats_ctx);
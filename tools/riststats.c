@@ -0,0 +1,175 @@
+/* librist. Copyright © 2020 SipRadius LLC. All right reserved.
+ * Author: Sergio Ammirata, Ph.D. <sergio@ammirata.net>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Sample reader for the shared memory stats page (RIST_OPT_STATS_SHM,
+ * ristreceiver --stats-shm). Prints counters and per second rates without
+ * involving the monitored process. */
+
+#include <librist/librist.h>
+#include <librist/stats_shm.h>
+#include "getopt-shim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+static struct option long_options[] = {
+{ "interval",        required_argument, NULL, 'i' },
+{ "count",           required_argument, NULL, 'n' },
+{ "help",            no_argument,       NULL, 'h' },
+{ 0, 0, 0, 0 },
+};
+
+const char help_str[] = "Usage: %s [OPTIONS] filepath\nWhere OPTIONS are:\n"
+"       -i | --interval value (ms)                | Interval between snapshots (default 1000)                |\n"
+"       -n | --count value                        | Number of snapshots to print, 0 = until closed (default) |\n"
+"       -h | --help                               | Show this help                                           |\n";
+
+static void usage(char *cmd)
+{
+	fprintf(stderr, help_str, cmd);
+	exit(1);
+}
+
+static void sleep_ms(int ms)
+{
+#ifdef _WIN32
+	Sleep(ms);
+#else
+	usleep(ms * 1000);
+#endif
+}
+
+static double rate(uint64_t now, uint64_t before, double seconds)
+{
+	if (seconds <= 0 || now < before)
+		return 0;
+	return (double)(now - before) / seconds;
+}
+
+static const struct rist_stats_shm_flow *find_flow(const struct rist_stats_shm *s, uint32_t flow_id)
+{
+	for (uint32_t i = 0; i < s->flow_count; i++)
+		if (s->flows[i].flow_id == flow_id)
+			return &s->flows[i];
+	return NULL;
+}
+
+static const struct rist_stats_shm_peer *find_peer(const struct rist_stats_shm *s, uint32_t peer_id)
+{
+	for (uint32_t i = 0; i < s->peer_count; i++)
+		if (s->peers[i].peer_id == peer_id)
+			return &s->peers[i];
+	return NULL;
+}
+
+static void print_snapshot(const struct rist_stats_shm *cur, const struct rist_stats_shm *prev)
+{
+	double seconds = prev ? (double)(cur->timestamp - prev->timestamp) / 1000000.0 : 0;
+	printf("%s profile %u, update %"PRIu64", %u peers, %u flows\n",
+		   cur->mode == RIST_STATS_SHM_MODE_SENDER ? "sender" : "receiver",
+		   cur->profile, cur->updates, cur->peer_count, cur->flow_count);
+	if (cur->truncated & RIST_STATS_SHM_TRUNCATED_FLOWS)
+		printf("  page full, only the first %d flows are shown\n", RIST_STATS_SHM_MAX_FLOWS);
+	if (cur->truncated & RIST_STATS_SHM_TRUNCATED_PEERS)
+		printf("  page full, only the first %d peers are shown\n", RIST_STATS_SHM_MAX_PEERS);
+	for (uint32_t i = 0; i < cur->flow_count; i++) {
+		const struct rist_stats_shm_flow *f = &cur->flows[i];
+		const struct rist_stats_shm_flow *p = prev ? find_flow(prev, f->flow_id) : NULL;
+		printf("  flow %"PRIu32"%s bitrate %"PRIu64" received %"PRIu64" (%.0f/s) missing %"PRIu64" (%.0f/s) recovered %"PRIu64
+			   " lost %"PRIu64" (%.0f/s) reordered %"PRIu64" duplicates %"PRIu64" dropped late/full %"PRIu64"/%"PRIu64" missing queue %"PRIu64"\n",
+			   f->flow_id, f->dead ? " (dead)" : "", f->bitrate,
+			   f->received, p ? rate(f->received, p->received, seconds) : 0,
+			   f->missing, p ? rate(f->missing, p->missing, seconds) : 0,
+			   f->recovered, f->lost, p ? rate(f->lost, p->lost, seconds) : 0,
+			   f->reordered, f->duplicates, f->dropped_late, f->dropped_full, f->missing_queue);
+	}
+	for (uint32_t i = 0; i < cur->peer_count; i++) {
+		const struct rist_stats_shm_peer *sp = &cur->peers[i];
+		const struct rist_stats_shm_peer *p = prev ? find_peer(prev, sp->peer_id) : NULL;
+		printf("  peer %"PRIu32" flow %"PRIu32" %s%s rtt %.2f ms bandwidth %"PRIu64" retry %"PRIu64,
+			   sp->peer_id, sp->flow_id, sp->cname,
+			   (sp->flags & RIST_STATS_SHM_PEER_DEAD) ? " (dead)" : "",
+			   (double)sp->avg_rtt / 1000.0, sp->bandwidth, sp->retry_bandwidth);
+		if (cur->mode == RIST_STATS_SHM_MODE_SENDER)
+			printf(" sent %"PRIu64" (%.0f/s) retransmitted %"PRIu64" (%.0f/s) skipped bw/bloat/retry %"PRIu64"/%"PRIu64"/%"PRIu64"\n",
+				   sp->sent, p ? rate(sp->sent, p->sent, seconds) : 0,
+				   sp->retransmitted, p ? rate(sp->retransmitted, p->retransmitted, seconds) : 0,
+				   sp->bandwidth_skipped, sp->bloat_skipped, sp->retransmit_skipped);
+		else
+			printf(" received %"PRIu64" (%.0f/s) rtcp in/out %"PRIu64"/%"PRIu64"\n",
+				   sp->received_data, p ? rate(sp->received_data, p->received_data, seconds) : 0,
+				   sp->received_rtcp, sp->sent_rtcp);
+	}
+	fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	int interval = 1000;
+	int count = 0;
+	int c;
+	int option_index;
+
+	while ((c = getopt_long(argc, argv, "i:n:h", long_options, &option_index)) != -1) {
+		switch (c) {
+		case 'i':
+			interval = atoi(optarg);
+		break;
+		case 'n':
+			count = atoi(optarg);
+		break;
+		case 'h':
+			/* Fall through */
+		default:
+			usage(argv[0]);
+		break;
+		}
+	}
+	if (optind >= argc || interval <= 0)
+		usage(argv[0]);
+
+	struct rist_stats_shm_reader *reader = NULL;
+	if (rist_stats_shm_reader_open(&reader, argv[optind]) != 0) {
+		fprintf(stderr, "Could not open stats page %s\n", argv[optind]);
+		return 1;
+	}
+
+	struct rist_stats_shm *snapshots = calloc(2, sizeof(*snapshots));
+	if (!snapshots) {
+		rist_stats_shm_reader_close(&reader);
+		return 1;
+	}
+	bool have_prev = false;
+	int printed = 0;
+	int ret = 0;
+	for (;;) {
+		struct rist_stats_shm *cur = &snapshots[printed & 1];
+		struct rist_stats_shm *prev = &snapshots[(printed + 1) & 1];
+		if (rist_stats_shm_reader_snapshot(reader, cur) != 0) {
+			fprintf(stderr, "Could not get a consistent snapshot\n");
+			ret = 1;
+			break;
+		}
+		print_snapshot(cur, have_prev ? prev : NULL);
+		have_prev = true;
+		printed++;
+		if (cur->closed || (count > 0 && printed >= count))
+			break;
+		sleep_ms(interval);
+	}
+
+	free(snapshots);
+	rist_stats_shm_reader_close(&reader);
+	return ret;
+}
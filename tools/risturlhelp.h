@@ -13,16 +13,22 @@ const char help_urlstr[] = "\nUsage: append to end of individual rist:// url(s)
 "    param buffer-min=### min buffer size in milliseconds\n"
 "    param buffer-max=### max buffer size in milliseconds\n"
 "    param bandwidth=###  max bandwidth in Kbps\n"
-"    param return-bandwidth=###  max bandwidth for messaging return in Kbps\n"
+"    param return-bandwidth=###  max bandwidth for messaging return (nacks, rtcp) in Kbps, 0 = no limit\n"
 "    param reorder-buffer=###  reordering buffer size in ms\n"
 "    param cname=abcde  arbitrary name for stream for display in logging\n"
 "    param rtt-min=###  minimum expected rtt\n"
 "    param rtt-max=###  maximum expected rtt\n"
 "    param verbose-level=#  Disable -1; Error 3, Warning 4, Notice 5, Info 6, Debug 7, simulation/dry-run 100\n"
 "    param timing-mode=#  0 = RTP Timestamp (default); 1 = Arrival Time, 2 = RTP/RTCP Timestamp+NTP\n"
+"    param multicast-shared=1|0  share one socket between multicast inputs on the same port and interface\n"
+"    param multicast-source=a.b.c.d  source address for source specific multicast\n"
+"    param ecn=1|0  ECT mark data and react to congestion experienced marks\n"
+"    param stripe-ports=#  spread a sender flow over # source ports\n"
+"    param flow-weight=#  receiver only, share of the per flow nack budget (default 1)\n"
 "  Main and Advanced Profiles\n"
 "    param aes-type=#  128 = AES-128, 256 = AES-256 must have passphrase too\n"
 "    param secret=abcde  encryption passphrase\n"
+"    param cipher=aes|chacha20  cipher for the passphrase, chacha20 is faster without AES hardware\n"
 "    param virt-dst-port destination port inside the GRE header\n"
 "    param session-timeout=###  timeout in ms for closing of connection where keep-alive fails\n"
 "    param keepalive-interval=###  interval in ms\n"